@@ -42,6 +42,7 @@
 #include <cstring>
 #include <cstdio>
 #include <vector>
+#include <map>
 #include <sstream>
 
 #include <libxml/globals.h>
@@ -50,12 +51,15 @@
 #include <libxml/xmlmemory.h>
 #include <libxml/xmlschemas.h>
 #include <libxml/parserInternals.h>
+#include <libxml/SAX2.h>
 
 #include "ErrorContextAutostack.h"
 #include "Util.h"
 #include "String_InternalLibrary.h"
 #include "String_InternalXSD.h"
 #include "string_const.h"
+#include "fieldml_structs.h"
+#include "FieldmlSession.h"
 
 #include "FieldmlDOM.h"
 
@@ -63,6 +67,34 @@ using namespace std;
 
 //========================================================================
 
+/**
+ * Where an inline data payload lies in its source document, as a byte range.
+ */
+struct InlineDataRange
+{
+    long offset;
+    long length;
+};
+
+/**
+ * Used when loading inline data lazily. Wraps the parser's usual SAX handlers, keeping inline data payloads out of
+ * the document tree (and the validator) and recording where they are instead.
+ */
+struct LazyInlineData
+{
+    map<xmlNodePtr, InlineDataRange> ranges;
+    
+    long payloadStart;
+    
+    xmlParserCtxtPtr ctxt;
+    
+    startElementNsSAX2Func startElement;
+    endElementNsSAX2Func endElement;
+    charactersSAXFunc characters;
+    charactersSAXFunc ignorableWhitespace;
+    cdataBlockSAXFunc cdataBlock;
+};
+
 struct ParseState
 {
     FmlSessionHandle session;
@@ -70,6 +102,11 @@ struct ParseState
     vector<xmlNodePtr> parseStack;
     vector<xmlNodePtr> unparsedNodes;
     
+    //Only set when loading inline data lazily.
+    LazyInlineData *lazyInlineData;
+    std::string filename;
+    std::string encoding;
+    
     //14102011 CPL Currently, mesh shapes depends on an evaluator which typically depends on mesh-argument which depends on mesh.
     //To work around this cyclic dependency, the shapes attribute is analysed after rest of the document has been parsed.
     //In the long term, shapes will be a bound-type property of a mesh-type domain, so the problem will neatly vanish.
@@ -132,11 +169,10 @@ xmlMyExternalEntityLoader(const char *URL, const char *ID,
 }
 
 
-static int validate( FieldmlErrorHandler *errorHandler, xmlParserInputBufferPtr buffer, const char *resourceName )
+static xmlSchemaPtr parseSchema( FieldmlErrorHandler *errorHandler )
 {
     xmlSchemaPtr schemas = NULL;
     xmlSchemaParserCtxtPtr sctxt;
-    xmlSchemaValidCtxtPtr vctxt;
     
     LIBXML_TEST_VERSION
 
@@ -147,11 +183,6 @@ static int validate( FieldmlErrorHandler *errorHandler, xmlParserInputBufferPtr
 
     xmlSetExternalEntityLoader(xmlMyExternalEntityLoader);
 
-    if( buffer == NULL )
-    {
-        return 1;
-    }
-
     sctxt = xmlSchemaNewMemParserCtxt( FML_STRING_FIELDML_XSD, strlen( FML_STRING_FIELDML_XSD ) );
     xmlSchemaSetParserErrors( sctxt, (xmlSchemaValidityErrorFunc)addContextError, (xmlSchemaValidityWarningFunc)addContextError, errorHandler );
     schemas = xmlSchemaParse( sctxt );
@@ -160,16 +191,22 @@ static int validate( FieldmlErrorHandler *errorHandler, xmlParserInputBufferPtr
         xmlGenericError( xmlGenericErrorContext, "Internal schema failed to compile\n" );
     }
     xmlSchemaFreeParserCtxt( sctxt );
+    
+    return schemas;
+}
 
-    vctxt = xmlSchemaNewValidCtxt( schemas );
-    xmlSchemaSetValidErrors( vctxt, (xmlSchemaValidityErrorFunc)addContextError, (xmlSchemaValidityWarningFunc)addContextError, errorHandler );
 
-    int result = xmlSchemaValidateStream( vctxt, buffer, (xmlCharEncoding)0, NULL, NULL );
+static xmlSchemaValidCtxtPtr createValidator( FieldmlErrorHandler *errorHandler, xmlSchemaPtr schemas )
+{
+    xmlSchemaValidCtxtPtr vctxt = xmlSchemaNewValidCtxt( schemas );
+    xmlSchemaSetValidErrors( vctxt, (xmlSchemaValidityErrorFunc)addContextError, (xmlSchemaValidityWarningFunc)addContextError, errorHandler );
+    
+    return vctxt;
+}
 
-    xmlSchemaFreeValidCtxt( vctxt );
 
-    xmlSchemaFree( schemas );
-    
+static void logValidationError( FieldmlErrorHandler *errorHandler, const char *resourceName )
+{
     xmlErrorPtr err = xmlGetLastError();
     if( ( err != NULL ) && ( err->message != NULL ) )
     {
@@ -181,6 +218,26 @@ static int validate( FieldmlErrorHandler *errorHandler, xmlParserInputBufferPtr
     }
     
     xmlResetLastError();
+}
+
+
+static int validate( FieldmlErrorHandler *errorHandler, xmlParserInputBufferPtr buffer, const char *resourceName )
+{
+    if( buffer == NULL )
+    {
+        return 1;
+    }
+
+    xmlSchemaPtr schemas = parseSchema( errorHandler );
+    xmlSchemaValidCtxtPtr vctxt = createValidator( errorHandler, schemas );
+
+    int result = xmlSchemaValidateStream( vctxt, buffer, (xmlCharEncoding)0, NULL, NULL );
+
+    xmlSchemaFreeValidCtxt( vctxt );
+
+    xmlSchemaFree( schemas );
+    
+    logValidationError( errorHandler, resourceName );
 
     return result;
 }
@@ -434,6 +491,21 @@ public:
 
     int parseNode( xmlNodePtr node, ParseState &state )
     {
+        if( state.lazyInlineData != NULL )
+        {
+            map<xmlNodePtr, InlineDataRange>::const_iterator range = state.lazyInlineData->ranges.find( node );
+            FieldmlSession *session = FieldmlSession::handleToSession( state.session );
+            DataResource *dataResource = (DataResource*)session->getObject( resource );
+            if( ( range != state.lazyInlineData->ranges.end() ) && ( dataResource != NULL ) )
+            {
+                dataResource->deferredFile = state.filename;
+                dataResource->deferredEncoding = state.encoding;
+                dataResource->deferredOffset = range->second.offset;
+                dataResource->deferredLength = range->second.length;
+                return 0;
+            }
+        }
+        
         char *content = (char *)xmlNodeGetContent( node );
         
         FmlErrorNumber err = Fieldml_AddInlineData( state.session, resource, content, strlen( content ) );
@@ -533,6 +605,22 @@ public:
 class DataResourceParser :
     public NodeParser
 {
+private:
+    void setDataType( xmlNodePtr descriptionNode, FmlObjectHandle resource, ParseState &state )
+    {
+        const char *dataType = getStringAttribute( descriptionNode, DTYPE_ATTRIB );
+        if( dataType == NULL )
+        {
+            return;
+        }
+        
+        if( resource != FML_INVALID_HANDLE )
+        {
+            Fieldml_SetDataResourceDataType( state.session, resource, dataType );
+        }
+        xmlFree(const_cast<char *>(dataType));
+    }
+    
 public:
     DataResourceParser() {}
     
@@ -555,10 +643,21 @@ public:
             resource = Fieldml_CreateHrefDataResource( state.session, name, format, href );
             xmlFree(const_cast<char *>(href));
             xmlFree(const_cast<char *>(format));
+            setDataType( hrefDescription, resource, state );
         }
         else if( stringDescription != NULL )
         {
-            resource = Fieldml_CreateInlineDataResource( state.session, name );
+            const char *format = getStringAttribute( stringDescription, FORMAT_ATTRIB );
+            if( format == NULL )
+            {
+                resource = Fieldml_CreateInlineDataResource( state.session, name );
+            }
+            else
+            {
+                resource = Fieldml_CreateInlineDataResourceWithFormat( state.session, name, format );
+                xmlFree(const_cast<char *>(format));
+            }
+            setDataType( stringDescription, resource, state );
             TextStringParser textStringParser( resource );
             int err = textStringParser.parseNode( stringDescription, state );
             if( err != 0 )
@@ -1571,23 +1670,161 @@ static int parseDoc( xmlDocPtr doc, ParseState &state )
 }
 
 
-int FieldmlDOM::parseFieldmlFile( const char *filename, FieldmlErrorHandler *errorHandler, FmlSessionHandle session )
+//The SAX handlers' context belongs to libxml (or the schema validator), so the lazy loading state is found here. Only
+//one document is parsed at a time per thread, as imports are only parsed once their importing document has been read.
+static thread_local LazyInlineData *currentLazyInlineData = NULL;
+
+
+static bool isInlineDataNode( xmlParserCtxtPtr ctxt )
 {
-    LIBXML_TEST_VERSION
+    return ( ctxt->node != NULL ) && xmlStrEqual( ctxt->node->name, DATA_RESOURCE_STRING_TAG );
+}
 
-    xmlSubstituteEntitiesDefault( 1 );
 
-    xmlParserInputBufferPtr buffer = xmlParserInputBufferCreateFilename( filename, XML_CHAR_ENCODING_NONE );
-    if( buffer == NULL )
+static void lazyStartElement( void *context, const xmlChar *localname, const xmlChar *prefix, const xmlChar *URI,
+    int nb_namespaces, const xmlChar **namespaces, int nb_attributes, int nb_defaulted, const xmlChar **attributes )
+{
+    LazyInlineData *lazy = currentLazyInlineData;
+    xmlParserCtxtPtr ctxt = lazy->ctxt;
+    
+    lazy->startElement( context, localname, prefix, URI, nb_namespaces, namespaces, nb_attributes, nb_defaulted, attributes );
+    
+    if( xmlStrEqual( localname, DATA_RESOURCE_STRING_TAG ) )
     {
-        errorHandler->logError( "Failed to create XML buffer", filename );
-        return 1;
+        //The input is left either on or just after the start tag's closing '>'.
+        lazy->payloadStart = xmlByteConsumed( ctxt );
+        if( *ctxt->input->cur == '>' )
+        {
+            lazy->payloadStart++;
+        }
     }
+}
+
+
+static void lazyEndElement( void *context, const xmlChar *localname, const xmlChar *prefix, const xmlChar *URI )
+{
+    LazyInlineData *lazy = currentLazyInlineData;
+    xmlParserCtxtPtr ctxt = lazy->ctxt;
     
-    int err = validate( errorHandler, buffer, filename );
-    if( err != 0 )
+    if( isInlineDataNode( ctxt ) )
     {
-        return err;
+        //The input is just after the end tag, so the payload ends at the last "</" before here. Empty elements
+        //have no end tag of their own, and end up with an empty range.
+        const xmlChar *cur = ctxt->input->cur;
+        long available = cur - ctxt->input->base;
+        long back = 2;
+        while( ( back <= available ) && !( ( cur[-back] == '<' ) && ( cur[1 - back] == '/' ) ) )
+        {
+            back++;
+        }
+        
+        InlineDataRange range;
+        range.offset = lazy->payloadStart;
+        range.length = 0;
+        if( back <= available )
+        {
+            range.length = xmlByteConsumed( ctxt ) - back - lazy->payloadStart;
+        }
+        if( range.length < 0 )
+        {
+            range.length = 0;
+        }
+        lazy->ranges[ctxt->node] = range;
+    }
+    
+    lazy->endElement( context, localname, prefix, URI );
+}
+
+
+static void lazyCharacters( void *context, const xmlChar *ch, int len )
+{
+    LazyInlineData *lazy = currentLazyInlineData;
+    xmlParserCtxtPtr ctxt = lazy->ctxt;
+    
+    if( !isInlineDataNode( ctxt ) )
+    {
+        lazy->characters( context, ch, len );
+    }
+}
+
+
+static void lazyIgnorableWhitespace( void *context, const xmlChar *ch, int len )
+{
+    LazyInlineData *lazy = currentLazyInlineData;
+    xmlParserCtxtPtr ctxt = lazy->ctxt;
+    
+    if( !isInlineDataNode( ctxt ) )
+    {
+        lazy->ignorableWhitespace( context, ch, len );
+    }
+}
+
+
+static void lazyCdataBlock( void *context, const xmlChar *value, int len )
+{
+    LazyInlineData *lazy = currentLazyInlineData;
+    xmlParserCtxtPtr ctxt = lazy->ctxt;
+    
+    if( !isInlineDataNode( ctxt ) )
+    {
+        lazy->cdataBlock( context, value, len );
+    }
+}
+
+
+static void installLazyInlineData( xmlParserCtxtPtr ctxt, LazyInlineData &lazy )
+{
+    lazy.payloadStart = 0;
+    lazy.startElement = ctxt->sax->startElementNs;
+    lazy.endElement = ctxt->sax->endElementNs;
+    lazy.characters = ctxt->sax->characters;
+    lazy.ignorableWhitespace = ctxt->sax->ignorableWhitespace;
+    lazy.cdataBlock = ctxt->sax->cdataBlock;
+    
+    ctxt->sax->startElementNs = lazyStartElement;
+    ctxt->sax->endElementNs = lazyEndElement;
+    ctxt->sax->characters = lazyCharacters;
+    ctxt->sax->ignorableWhitespace = lazyIgnorableWhitespace;
+    ctxt->sax->cdataBlock = lazyCdataBlock;
+    
+    lazy.ctxt = ctxt;
+    currentLazyInlineData = &lazy;
+}
+
+
+/**
+ * Byte ranges are only meaningful if markup and the characters in numbers take one byte each.
+ */
+static bool isLazyEncoding( const xmlChar *encoding )
+{
+    return ( encoding == NULL ) ||
+        ( xmlStrcasecmp( encoding, (const xmlChar*)"UTF-8" ) == 0 ) ||
+        ( xmlStrcasecmp( encoding, (const xmlChar*)"US-ASCII" ) == 0 ) ||
+        ( xmlStrcasecmp( encoding, (const xmlChar*)"ASCII" ) == 0 ) ||
+        ( xmlStrncasecmp( encoding, (const xmlChar*)"ISO-8859-", 9 ) == 0 );
+}
+
+
+int FieldmlDOM::parseFieldmlFile( const char *filename, FieldmlErrorHandler *errorHandler, FmlSessionHandle session, bool lazyInlineData )
+{
+    LIBXML_TEST_VERSION
+
+    xmlSubstituteEntitiesDefault( 1 );
+
+    if( !lazyInlineData )
+    {
+        xmlParserInputBufferPtr buffer = xmlParserInputBufferCreateFilename( filename, XML_CHAR_ENCODING_NONE );
+        if( buffer == NULL )
+        {
+            errorHandler->logError( "Failed to create XML buffer", filename );
+            return 1;
+        }
+        
+        int err = validate( errorHandler, buffer, filename );
+        if( err != 0 )
+        {
+            return err;
+        }
     }
 
     xmlParserCtxtPtr ctxt; /* the parser context */
@@ -1600,8 +1837,51 @@ int FieldmlDOM::parseFieldmlFile( const char *filename, FieldmlErrorHandler *err
         errorHandler->logError( "Failed to allocate XML parser context" );
         return 1;
     }
+    
+    xmlSchemaPtr schemas = NULL;
+    xmlSchemaValidCtxtPtr vctxt = NULL;
+    xmlSchemaSAXPlugPtr plug = NULL;
+    LazyInlineData lazy;
+    if( lazyInlineData )
+    {
+        //Validate as part of the parse, so that the validator doesn't see the inline data either. A separate
+        //validation pass would have to take in every payload, which is very slow for large ones.
+        schemas = parseSchema( errorHandler );
+        vctxt = createValidator( errorHandler, schemas );
+        plug = xmlSchemaSAXPlug( vctxt, &ctxt->sax, &ctxt->userData );
+        if( plug == NULL )
+        {
+            xmlSchemaFreeValidCtxt( vctxt );
+            xmlSchemaFree( schemas );
+            xmlFreeParserCtxt( ctxt );
+            return parseFieldmlFile( filename, errorHandler, session, false );
+        }
+        installLazyInlineData( ctxt, lazy );
+    }
     /* parse the file, activating the DTD validation option */
     doc = xmlCtxtReadFile( ctxt, filename, NULL, 0 );
+    if( lazyInlineData )
+    {
+        bool isValid = ( xmlSchemaIsValid( vctxt ) == 1 );
+        currentLazyInlineData = NULL;
+        xmlSchemaSAXUnplug( plug );
+        xmlSchemaFreeValidCtxt( vctxt );
+        xmlSchemaFree( schemas );
+        logValidationError( errorHandler, filename );
+        
+        if( !isValid || ( ( doc != NULL ) && !isLazyEncoding( doc->encoding ) ) )
+        {
+            xmlFreeDoc( doc );
+            xmlFreeParserCtxt( ctxt );
+            if( !isValid )
+            {
+                return 1;
+            }
+            
+            //Fall back to reading the inline data up front.
+            return parseFieldmlFile( filename, errorHandler, session, false );
+        }
+    }
     /* check if parsing suceeded */
     if (doc == NULL)
     {
@@ -1613,6 +1893,16 @@ int FieldmlDOM::parseFieldmlFile( const char *filename, FieldmlErrorHandler *err
         
         state.errorHandler = errorHandler;
         state.session = session;
+        state.lazyInlineData = NULL;
+        if( lazyInlineData )
+        {
+            state.lazyInlineData = &lazy;
+            state.filename = filename;
+            if( doc->encoding != NULL )
+            {
+                state.encoding = (const char*)doc->encoding;
+            }
+        }
         parseDoc( doc, state );
         xmlFreeDoc( doc );
     }
@@ -1660,6 +1950,7 @@ int FieldmlDOM::parseFieldmlString( const char *string, const char *stringDescri
         
         state.errorHandler = errorHandler;
         state.session = session;
+        state.lazyInlineData = NULL;
         parseDoc( doc, state );
         xmlFreeDoc( doc );
     }
@@ -1668,3 +1959,58 @@ int FieldmlDOM::parseFieldmlString( const char *string, const char *stringDescri
     
     return 0;
 }
+
+
+int FieldmlDOM::readInlineData( const char *filename, const char *encoding, long offset, long length, std::string &data )
+{
+    FILE *file = fopen( filename, "rb" );
+    if( file == NULL )
+    {
+        return 1;
+    }
+    
+    data.resize( length );
+    bool isRead = ( fseek( file, offset, SEEK_SET ) == 0 ) && ( (long)fread( &data[0], 1, length, file ) == length );
+    fclose( file );
+    if( !isRead )
+    {
+        return 1;
+    }
+    
+    //Plain numeric text can be used as it is. Anything else goes back through the parser, so that the result is the
+    //same text that the document tree would have held.
+    bool isPlain = true;
+    for( long i = 0; i < length; i++ )
+    {
+        unsigned char c = data[i];
+        if( ( c == '&' ) || ( c == '<' ) || ( c == '\r' ) || ( c >= 0x80 ) )
+        {
+            isPlain = false;
+            break;
+        }
+    }
+    if( isPlain )
+    {
+        return 0;
+    }
+    
+    string wrapped = "<?xml version=\"1.0\"";
+    if( ( encoding != NULL ) && ( *encoding != 0 ) )
+    {
+        wrapped = wrapped + " encoding=\"" + encoding + "\"";
+    }
+    wrapped += "?><data>" + data + "</data>";
+    
+    xmlDocPtr doc = xmlReadMemory( wrapped.c_str(), wrapped.length(), NULL, NULL, XML_PARSE_HUGE );
+    if( doc == NULL )
+    {
+        return 1;
+    }
+    
+    char *content = (char *)xmlNodeGetContent( xmlDocGetRootElement( doc ) );
+    data = ( content != NULL ) ? content : "";
+    xmlFree( content );
+    xmlFreeDoc( doc );
+    
+    return 0;
+}
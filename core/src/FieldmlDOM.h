@@ -43,14 +43,23 @@
 #define H_FIELDMLDOM
 
 #include <cstring>
+#include <string>
 
 #include "FieldmlErrorHandler.h"
 
 namespace FieldmlDOM
 {
-    int parseFieldmlFile( const char *filename, FieldmlErrorHandler *errorHandler, FmlSessionHandle session );
+    /**
+     * If lazyInlineData is set, inline data resources just record where their data lies in the file.
+     */
+    int parseFieldmlFile( const char *filename, FieldmlErrorHandler *errorHandler, FmlSessionHandle session, bool lazyInlineData );
 
     int parseFieldmlString( const char *string, const char *stringDescription, const char *url, FieldmlErrorHandler *errorHandler, FmlSessionHandle session );
+    
+    /**
+     * Reads an inline data payload recorded by a lazy parse, decoding it as the parser would have.
+     */
+    int readInlineData( const char *filename, const char *encoding, long offset, long length, std::string &data );
 }
 
 #endif // H_FIELDMLDOM
@@ -90,6 +90,8 @@ FieldmlSession::FieldmlSession()
     lastDescription = "";
     
     region = NULL;
+    
+    lazyInlineData = false;
 }
 
 
@@ -180,7 +182,7 @@ FieldmlRegion *FieldmlSession::addResourceRegion( string href, string name )
     else
     {
         string filename = makeFilename( region->getRoot(), href );
-        result = FieldmlDOM::parseFieldmlFile( filename.c_str(), this, getSessionHandle() );
+        result = FieldmlDOM::parseFieldmlFile( filename.c_str(), this, getSessionHandle(), lazyInlineData );
     }
     
     importHrefStack.pop_back();
@@ -327,6 +329,12 @@ void FieldmlSession::setDebug( const int debugValue )
 }
 
 
+void FieldmlSession::setLazyInlineData( const bool lazy )
+{
+    lazyInlineData = lazy;
+}
+
+
 FmlSessionHandle FieldmlSession::getSessionHandle()
 {
     return handle;
@@ -70,6 +70,8 @@ private:
     
     FmlSessionHandle handle;
     
+    bool lazyInlineData;
+    
     bool getDelegateEvaluators(  const std::set<FmlObjectHandle> &evaluators, std::vector<FmlObjectHandle> &stack, std::set<FmlObjectHandle> &set );
     
     bool getDelegateEvaluators( FmlObjectHandle handle, std::vector<FmlObjectHandle> &stack, std::set<FmlObjectHandle> &set );
@@ -99,6 +101,8 @@ public:
 
     void setDebug( const int debugValue );
     
+    void setLazyInlineData( const bool lazy );
+    
     const int getErrorCount();
     
     const std::string getError( const int index );
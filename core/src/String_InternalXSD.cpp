@@ -111,11 +111,15 @@ const char * const FML_STRING_FIELDML_XSD = "<?xml version=\"1.0\" encoding=\"ut
     <xs:complexType name=\"DataResourceHref_Type\"> \
       <xs:attribute ref=\"xlink:href\" use=\"required\" /> \
       <xs:attribute name=\"format\" type=\"xs:string\" use=\"required\" /> \
+      <xs:attribute name=\"dtype\" type=\"xs:string\" use=\"optional\" /> \
     </xs:complexType> \
  \
     <xs:complexType name=\"DataResourceString_Type\"> \
       <xs:simpleContent> \
-        <xs:extension base=\"xs:string\" /> \
+        <xs:extension base=\"xs:string\"> \
+          <xs:attribute name=\"format\" type=\"xs:string\" use=\"optional\" default=\"PLAIN_TEXT\" /> \
+          <xs:attribute name=\"dtype\" type=\"xs:string\" use=\"optional\" /> \
+        </xs:extension> \
       </xs:simpleContent> \
     </xs:complexType> \
  \
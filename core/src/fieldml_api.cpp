@@ -40,6 +40,8 @@
  */
 
 #include <algorithm>
+#include <map>
+#include <mutex>
 
 #include <cstring>
 
@@ -51,6 +53,7 @@
 #include "fieldml_structs.h"
 #include "Evaluators.h"
 #include "fieldml_write.h"
+#include "FieldmlDOM.h"
 #include "string_const.h"
 #include "Util.h"
 
@@ -370,6 +373,63 @@ static DataResource *getDataResource( FieldmlSession *session, FmlObjectHandle o
 }
 
 
+//Open inline data views, by the address of their data. They're kept apart from the sessions, so that a view stays
+//valid, and can still be closed, after its session has been destroyed.
+typedef multimap<const char *, shared_ptr<string> > InlineDataViewMap;
+
+
+static InlineDataViewMap &getOpenViews( unique_lock<mutex> &lock )
+{
+    static mutex viewMutex;
+    static InlineDataViewMap openViews;
+    
+    lock = unique_lock<mutex>( viewMutex );
+    return openViews;
+}
+
+
+static bool releaseInlineDataView( const char *view )
+{
+    unique_lock<mutex> lock;
+    InlineDataViewMap &openViews = getOpenViews( lock );
+    
+    InlineDataViewMap::iterator i = openViews.find( view );
+    if( i == openViews.end() )
+    {
+        return false;
+    }
+    
+    openViews.erase( i );
+    return true;
+}
+
+
+/**
+ * Reads in the inline data of a resource that was loaded lazily, if that hasn't happened yet.
+ */
+static bool loadInlineData( FieldmlSession *session, FmlObjectHandle objectHandle, DataResource *resource )
+{
+    if( resource->deferredFile.empty() )
+    {
+        return true;
+    }
+    
+    string *data = new string();
+    if( FieldmlDOM::readInlineData( resource->deferredFile.c_str(), resource->deferredEncoding.c_str(),
+        resource->deferredOffset, resource->deferredLength, *data ) != 0 )
+    {
+        delete data;
+        session->setError( FML_ERR_READ_ERR, objectHandle, "Cannot read inline data from " + resource->deferredFile );
+        return false;
+    }
+    
+    resource->description.reset( data );
+    resource->deferredFile.clear();
+    
+    return true;
+}
+
+
 static bool checkIsValueType( FieldmlSession *session, FmlObjectHandle objectHandle, bool allowContinuous, bool allowEnsemble, bool allowMesh, bool allowBoolean )
 {
     ERROR_AUTOSTACK( session );
@@ -482,17 +542,12 @@ static bool checkIsEvaluatorTypeCompatible( FieldmlSession *session, FmlObjectHa
 }
 
 
-//========================================================================
-//
-// API
-//
-//========================================================================
-
-FmlSessionHandle Fieldml_CreateFromFile( const char * filename )
+static FmlSessionHandle createFromFile( const char * filename, bool lazyInlineData )
 {
     FieldmlSession *session = new FieldmlSession();
     ErrorContextAutostack bob( session, __FILE__, __LINE__, __ECA_FUNC__ );
     
+    session->setLazyInlineData( lazyInlineData );
     if( filename == NULL )
     {
         session->setError( FML_ERR_INVALID_PARAMETER_1, "Cannot create FieldML session. Invalid filename." );
@@ -514,6 +569,24 @@ FmlSessionHandle Fieldml_CreateFromFile( const char * filename )
     return session->getSessionHandle();
 }
 
+
+//========================================================================
+//
+// API
+//
+//========================================================================
+
+FmlSessionHandle Fieldml_CreateFromFile( const char * filename )
+{
+    return createFromFile( filename, false );
+}
+
+
+FmlSessionHandle Fieldml_CreateFromFileLazily( const char * filename )
+{
+    return createFromFile( filename, true );
+}
+
 FmlSessionHandle Fieldml_CreateFromBuffer( const void *buffer, unsigned int buffer_length, const char * name )
 {
     FieldmlSession *session = new FieldmlSession();
@@ -3344,6 +3417,12 @@ FmlObjectHandle Fieldml_CreateHrefDataResource( FmlSessionHandle handle, const c
 
 
 FmlObjectHandle Fieldml_CreateInlineDataResource( FmlSessionHandle handle, const char * name )
+{
+    return Fieldml_CreateInlineDataResourceWithFormat( handle, name, PLAIN_TEXT_NAME );
+}
+
+
+FmlObjectHandle Fieldml_CreateInlineDataResourceWithFormat( FmlSessionHandle handle, const char * name, const char * format )
 {
     FieldmlSession *session = FieldmlSession::handleToSession( handle );
     ERROR_AUTOSTACK( session );
@@ -3357,8 +3436,13 @@ FmlObjectHandle Fieldml_CreateInlineDataResource( FmlSessionHandle handle, const
         session->setError( FML_ERR_INVALID_PARAMETER_2, "Cannot create inline data resource. Invalid name." );
         return FML_INVALID_HANDLE;
     }
+    if( format == NULL )
+    {
+        session->setError( FML_ERR_INVALID_PARAMETER_3, "Cannot create inline data resource. Invalid format." );
+        return FML_INVALID_HANDLE;
+    }
 
-    DataResource *dataResource = new DataResource( name, FML_DATA_RESOURCE_INLINE, PLAIN_TEXT_NAME, "" );
+    DataResource *dataResource = new DataResource( name, FML_DATA_RESOURCE_INLINE, format, "" );
     session->setError( FML_ERR_NO_ERROR, "" );
     return addObject( session, dataResource );
 }
@@ -3414,8 +3498,19 @@ FmlErrorNumber Fieldml_AddInlineData( FmlSessionHandle handle, FmlObjectHandle o
     {
         return session->setError( FML_ERR_INVALID_OBJECT, objectHandle, "Cannot add inline data. Must be inline data resource." );
     }
+    if( !loadInlineData( session, objectHandle, resource ) )
+    {
+        return session->getLastError();
+    }
     
-    resource->description = resource->description + string( data, length );
+    //Append in place, so that building up a resource from many pieces takes linear time. Open views keep the old
+    //data, so in that case it's copied first.
+    if( resource->description.use_count() > 1 )
+    {
+        resource->description.reset( new string( *resource->description ) );
+    }
+    resource->description->append( data, length );
+    resource->dataGeneration++;
     
     return session->getLastError();
 }
@@ -3450,12 +3545,34 @@ FmlErrorNumber Fieldml_SetInlineData( FmlSessionHandle handle, FmlObjectHandle o
         return session->setError( FML_ERR_INVALID_OBJECT, objectHandle, "Cannot set inline data. Must be inline data resource." );
     }
     
-    resource->description = string( data, length );
+    resource->deferredFile.clear();
+    resource->description.reset( new string( data, length ) );
+    resource->dataGeneration++;
     
     return session->getLastError();
 }
 
 
+int Fieldml_GetDataResourceGeneration( FmlSessionHandle handle, FmlObjectHandle objectHandle )
+{
+    FieldmlSession *session = FieldmlSession::handleToSession( handle );
+    ERROR_AUTOSTACK( session );
+
+    if( session == NULL )
+    {
+        return -1;
+    }
+
+    DataResource *resource = getDataResource( session, objectHandle );
+    if( resource == NULL )
+    {
+        return -1;
+    }
+    
+    return resource->dataGeneration;
+}
+
+
 int Fieldml_GetInlineDataLength( FmlSessionHandle handle, FmlObjectHandle objectHandle )
 {
     FieldmlSession *session = FieldmlSession::handleToSession( handle );
@@ -3476,8 +3593,12 @@ int Fieldml_GetInlineDataLength( FmlSessionHandle handle, FmlObjectHandle object
         session->setError( FML_ERR_INVALID_OBJECT, objectHandle, "Cannot get inline data length. Must be inline data resource." );
         return -1;
     }
+    if( !loadInlineData( session, objectHandle, resource ) )
+    {
+        return -1;
+    }
     
-    return resource->description.length();
+    return resource->description->length();
 }
 
 
@@ -3501,8 +3622,12 @@ char * Fieldml_GetInlineData( FmlSessionHandle handle, FmlObjectHandle objectHan
         session->setError( FML_ERR_INVALID_OBJECT, objectHandle, "Cannot get inline data. Must be inline data resource." );
         return NULL;
     }
+    if( !loadInlineData( session, objectHandle, resource ) )
+    {
+        return NULL;
+    }
     
-    return cstrCopy( resource->description );
+    return cstrCopy( *resource->description );
 }
 
 
@@ -3526,14 +3651,92 @@ int Fieldml_CopyInlineData( FmlSessionHandle handle, FmlObjectHandle objectHandl
         session->setError( FML_ERR_INVALID_OBJECT, objectHandle, "Cannot copy inline data. Must be inline data resource." );
         return -1;
     }
+    if( !loadInlineData( session, objectHandle, resource ) )
+    {
+        return -1;
+    }
     
-    if( offset >= (int)resource->description.length() )
+    if( ( offset < 0 ) || ( offset >= (int)resource->description->length() ) || ( bufferLength <= 1 ) )
     {
         return 0;
     }
     
-    //This is probably not the best way to do this
-    return cappedCopy( resource->description.c_str() + offset, buffer, bufferLength );
+    //The length is already known, so don't let cappedCopy scan the whole remainder of the data for each chunk.
+    int length = resource->description->length() - offset;
+    if( length >= bufferLength )
+    {
+        length = bufferLength - 1;
+    }
+    memcpy( buffer, resource->description->c_str() + offset, length );
+    buffer[length] = 0;
+    
+    return length;
+}
+
+
+const char * Fieldml_OpenInlineDataView( FmlSessionHandle handle, FmlObjectHandle objectHandle, int *length )
+{
+    FieldmlSession *session = FieldmlSession::handleToSession( handle );
+    ERROR_AUTOSTACK( session );
+
+    if( session == NULL )
+    {
+        return NULL;
+    }
+    if( length == NULL )
+    {
+        session->setError( FML_ERR_INVALID_PARAMETER_3, objectHandle, "Cannot open inline data view. Invalid length." );
+        return NULL;
+    }
+
+    DataResource *resource = getDataResource( session, objectHandle );
+    if( resource == NULL )
+    {
+        return NULL;
+    }
+    if( resource->resourceType != FML_DATA_RESOURCE_INLINE )
+    {
+        session->setError( FML_ERR_INVALID_OBJECT, objectHandle, "Cannot open inline data view. Must be inline data resource." );
+        return NULL;
+    }
+    if( !loadInlineData( session, objectHandle, resource ) )
+    {
+        return NULL;
+    }
+    
+    {
+        unique_lock<mutex> lock;
+        getOpenViews( lock ).insert( make_pair( resource->description->c_str(), resource->description ) );
+    }
+    *length = resource->description->length();
+    
+    return resource->description->c_str();
+}
+
+
+FmlErrorNumber Fieldml_CloseInlineDataView( FmlSessionHandle handle, FmlObjectHandle objectHandle, const char *view )
+{
+    FieldmlSession *session = FieldmlSession::handleToSession( handle );
+    ERROR_AUTOSTACK( session );
+
+    if( session == NULL )
+    {
+        //The session has been destroyed, but its views are still open until they're closed.
+        return releaseInlineDataView( view ) ? FML_ERR_NO_ERROR : FML_ERR_UNKNOWN_HANDLE;
+    }
+
+    DataResource *resource = getDataResource( session, objectHandle );
+    if( resource == NULL )
+    {
+        return session->getLastError();
+    }
+    
+    if( releaseInlineDataView( view ) )
+    {
+        return session->getLastError();
+    }
+    
+    return session->setError( FML_ERR_INVALID_PARAMETER_3, objectHandle, "Cannot close inline data view. Not an open view." );
 }
 
 
@@ -3575,7 +3778,7 @@ char * Fieldml_GetDataResourceHref( FmlSessionHandle handle, FmlObjectHandle obj
     
     if( dataResource->resourceType == FML_DATA_RESOURCE_HREF )
     {
-        return cstrCopy( dataResource->description );
+        return cstrCopy( *dataResource->description );
     }
     else
     {
@@ -3617,6 +3820,58 @@ int Fieldml_CopyDataResourceFormat( FmlSessionHandle handle, FmlObjectHandle obj
 }
 
 
+FmlErrorNumber Fieldml_SetDataResourceDataType( FmlSessionHandle handle, FmlObjectHandle objectHandle, const char * dataType )
+{
+    FieldmlSession *session = FieldmlSession::handleToSession( handle );
+    ERROR_AUTOSTACK( session );
+
+    if( session == NULL )
+    {
+        return FML_ERR_UNKNOWN_HANDLE;
+    }
+
+    DataResource *dataResource = getDataResource( session, objectHandle );
+    if( dataResource == NULL )
+    {
+        return session->getLastError();
+    }
+    if( dataType == NULL )
+    {
+        return session->setError( FML_ERR_INVALID_PARAMETER_3, objectHandle, "Cannot set data resource data type. Invalid data type." );
+    }
+    
+    dataResource->dataType = dataType;
+    
+    return session->setError( FML_ERR_NO_ERROR, "" );
+}
+
+
+char * Fieldml_GetDataResourceDataType( FmlSessionHandle handle, FmlObjectHandle objectHandle )
+{
+    FieldmlSession *session = FieldmlSession::handleToSession( handle );
+    ERROR_AUTOSTACK( session );
+
+    if( session == NULL )
+    {
+        return NULL;
+    }
+
+    DataResource *dataResource = getDataResource( session, objectHandle );
+    if( dataResource == NULL )
+    {
+        return NULL;
+    }
+    
+    return cstrCopy( dataResource->dataType );
+}
+
+
+int Fieldml_CopyDataResourceDataType( FmlSessionHandle handle, FmlObjectHandle objectHandle, char * buffer, int bufferLength )
+{
+    return cappedCopyAndFree( Fieldml_GetDataResourceDataType( handle, objectHandle ), buffer, bufferLength );
+}
+
+
 FmlObjectHandle Fieldml_GetDataSource( FmlSessionHandle handle, FmlObjectHandle objectHandle )
 {
     FieldmlSession *session = FieldmlSession::handleToSession( handle );
@@ -273,6 +273,19 @@ extern "C" {
  */
 FmlSessionHandle Fieldml_CreateFromFile( const char * filename );
 
+
+/**
+ * Parses the given XML file as Fieldml_CreateFromFile does, but without reading inline data into memory. Each
+ * inline data resource just records where its data lies in the file (and in any imported files), and the data is only
+ * read when it is first needed, e.g. when a reader is opened on it or Fieldml_GetInlineData is called. The files
+ * must not be moved or changed while the session is in use.
+ * 
+ * \note Documents in encodings where markup takes more than one byte per character are read up front as usual.
+ * 
+ * \see Fieldml_CreateFromFile
+ */
+FmlSessionHandle Fieldml_CreateFromFileLazily( const char * filename );
+
 FmlSessionHandle Fieldml_CreateFromBuffer( const void *buffer, unsigned int buffer_length, const char * name );
 
 
@@ -1274,6 +1287,16 @@ FmlObjectHandle Fieldml_CreateHrefDataResource( FmlSessionHandle handle, const c
 FmlObjectHandle Fieldml_CreateInlineDataResource( FmlSessionHandle handle, const char * name );
 
 
+/**
+ * Creates a new inline data resource whose character data is in the given format, rather than PLAIN_TEXT. The
+ * format must be one that can be embedded as character data in a FieldML document (e.g. BASE64).
+ * 
+ * \see Fieldml_CreateInlineDataResource
+ * \see Fieldml_SetDataResourceDataType
+ */
+FmlObjectHandle Fieldml_CreateInlineDataResourceWithFormat( FmlSessionHandle handle, const char * name, const char * format );
+
+
 /**
  * \return The type of the given data resource.
  * 
@@ -1441,6 +1464,16 @@ FmlErrorNumber Fieldml_AddInlineData( FmlSessionHandle handle, FmlObjectHandle o
 FmlErrorNumber Fieldml_SetInlineData( FmlSessionHandle handle, FmlObjectHandle objectHandle, const char * data, const int length );
 
 
+/**
+ * \return A count of the changes made to the data resource's inline data, or -1 on error. Data read from the resource
+ * before a change can be recognised as stale by its earlier generation.
+ * 
+ * \see Fieldml_SetInlineData
+ * \see Fieldml_AddInlineData
+ */
+int Fieldml_GetDataResourceGeneration( FmlSessionHandle handle, FmlObjectHandle objectHandle );
+
+
 /**
  * \return The number of characters in the data resource's inline data.
  * 
@@ -1471,6 +1504,28 @@ char * Fieldml_GetInlineData( FmlSessionHandle handle, FmlObjectHandle objectHan
  */
 int Fieldml_CopyInlineData( FmlSessionHandle handle, FmlObjectHandle objectHandle, char * buffer, int bufferLength, int offset );
 
+
+/**
+ * Opens a read-only view of the data resource's inline data, without copying it. The view's contents remain valid and
+ * unchanged until it is closed, even if the resource's inline data is modified or the session is destroyed in the
+ * meantime. Every view must be closed, with the same handles, to release its data.
+ * 
+ * \return A pointer to the inline data, with its length in characters stored in length.
+ * 
+ * \see Fieldml_CloseInlineDataView
+ * \see Fieldml_CreateInlineDataResource
+ */
+const char * Fieldml_OpenInlineDataView( FmlSessionHandle handle, FmlObjectHandle objectHandle, int *length );
+
+
+/**
+ * Closes a view previously opened with Fieldml_OpenInlineDataView on the same data resource. If the session has since
+ * been destroyed, the view is still released.
+ * 
+ * \see Fieldml_OpenInlineDataView
+ */
+FmlErrorNumber Fieldml_CloseInlineDataView( FmlSessionHandle handle, FmlObjectHandle objectHandle, const char *view );
+
 /**
  * \return The href of the data resource's file. The data resource's type must be FieldmlDataResourceType::FML_DATA_RESOURCE_HREF.
 
@@ -1505,6 +1560,32 @@ char * Fieldml_GetDataResourceFormat( FmlSessionHandle handle, FmlObjectHandle o
 int Fieldml_CopyDataResourceFormat( FmlSessionHandle handle, FmlObjectHandle objectHandle, char * buffer, int bufferLength );
 
 
+/**
+ * Sets the storage type of the given data resource's values (e.g. float64, int32), for formats such as BASE64 where
+ * the data itself does not record it. This is serialized as the resource's dtype attribute. An empty string clears it.
+ * 
+ * \see Fieldml_GetDataResourceDataType
+ */
+FmlErrorNumber Fieldml_SetDataResourceDataType( FmlSessionHandle handle, FmlObjectHandle objectHandle, const char * dataType );
+
+
+/**
+ * \return The storage type of the given data resource's values, or an empty string if it has not been set.
+ * 
+ * \see Fieldml_SetDataResourceDataType
+ * \see Fieldml_FreeString
+ */
+char * Fieldml_GetDataResourceDataType( FmlSessionHandle handle, FmlObjectHandle objectHandle );
+
+
+/**
+ * Copies the given data resource's value storage type into the given buffer.
+ * 
+ * \see Fieldml_GetDataResourceDataType
+ */
+int Fieldml_CopyDataResourceDataType( FmlSessionHandle handle, FmlObjectHandle objectHandle, char * buffer, int bufferLength );
+
+
 /**
  * Creates a new constant evaluator whose value is determined by the given literal.
  * 
@@ -107,9 +107,12 @@ MeshType::MeshType( const string _name, bool _isVirtual ) :
 
 DataResource::DataResource( const string _name, FieldmlDataResourceType _resourceType, const string _format, const string _description ) : 
     FieldmlObject( _name, FHT_DATA_RESOURCE, false ),
-    resourceType( _resourceType ),
+    description( new std::string( _description ) ),
+    deferredOffset( 0 ),
+    deferredLength( 0 ),
     format( _format ),
-    description( _description )
+    resourceType( _resourceType ),
+    dataGeneration( 0 )
 {
 }
 
@@ -45,6 +45,7 @@
 #include <vector>
 #include <set>
 #include <string>
+#include <memory>
 
 #include "fieldml_api.h"
 #include "SimpleMap.h"
@@ -136,15 +137,31 @@ class DataResource :
 {
 public:
     //NOTE: if isInline, this is the inline string. Otherwise, it's an href.
-    std::string description;
+    //Shared with any open inline data views, so it must be replaced rather than modified while they're open.
+    std::shared_ptr<std::string> description;
     
-    //NOTE: At the moment, inline resources may only be TEXT_PLAIN. 
+    //NOTE: If set, the inline data has not been read yet, and lies at the given byte range of this file.
+    std::string deferredFile;
+    
+    std::string deferredEncoding;
+    
+    long deferredOffset;
+    
+    long deferredLength;
+    
+    //NOTE: Inline resources may be PLAIN_TEXT or any other text-safe format that the IO library understands.
     const std::string format;
     
+    //The storage type of the resource's values, for formats where that is not self-describing. Empty if unspecified.
+    std::string dataType;
+    
     const FieldmlDataResourceType resourceType;
 
     std::vector<FmlObjectHandle> dataSources;
     
+    //Incremented whenever the resource's inline data is changed, so that data decoded from earlier contents can be told apart.
+    int dataGeneration;
+    
     DataResource( const std::string _name, FieldmlDataResourceType _type, const std::string _format, const std::string _description );
         
     virtual ~DataResource();
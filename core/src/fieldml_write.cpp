@@ -375,6 +375,17 @@ static int writeDataSource( xmlTextWriterPtr writer, FmlSessionHandle handle, Fm
 }
 
 
+static void writeDataType( xmlTextWriterPtr writer, FmlSessionHandle handle, FmlObjectHandle object )
+{
+    char *dataType = Fieldml_GetDataResourceDataType( handle, object );
+    if( ( dataType != NULL ) && ( dataType[0] != 0 ) )
+    {
+        xmlTextWriterWriteAttribute( writer, DTYPE_ATTRIB, (const xmlChar*)dataType );
+    }
+    Fieldml_FreeString(dataType);
+}
+
+
 static int writeDataResource( xmlTextWriterPtr writer, FmlSessionHandle handle, FmlObjectHandle object )
 {
     char tBuffer[tBufferLength];
@@ -394,6 +405,7 @@ static int writeDataResource( xmlTextWriterPtr writer, FmlSessionHandle handle,
         xmlTextWriterStartElement( writer, DATA_RESOURCE_HREF_TAG );
         xmlTextWriterWriteAttribute( writer, QUALIFIED_HREF_ATTRIB, (const xmlChar*)href );
         xmlTextWriterWriteAttribute( writer, FORMAT_ATTRIB, (const xmlChar*)resourceFormat );
+        writeDataType( writer, handle, object );
         xmlTextWriterEndElement( writer );
         Fieldml_FreeString(href);
         Fieldml_FreeString(resourceFormat);
@@ -401,6 +413,15 @@ static int writeDataResource( xmlTextWriterPtr writer, FmlSessionHandle handle,
     else if( type == FML_DATA_RESOURCE_INLINE )
     {
         xmlTextWriterStartElement( writer, DATA_RESOURCE_STRING_TAG );
+        
+        //PLAIN_TEXT is the schema default, so existing documents are written out unchanged.
+        char *resourceFormat = Fieldml_GetDataResourceFormat( handle, object );
+        if( ( resourceFormat != NULL ) && ( strcmp( resourceFormat, PLAIN_TEXT_NAME ) != 0 ) )
+        {
+            xmlTextWriterWriteAttribute( writer, FORMAT_ATTRIB, (const xmlChar*)resourceFormat );
+        }
+        Fieldml_FreeString(resourceFormat);
+        writeDataType( writer, handle, object );
 
         int offset = 0;
         int length = 1;
@@ -129,6 +129,7 @@ const xmlChar * const REGION_ATTRIB                     = (const xmlChar* const)
 const xmlChar * const REMOTE_NAME_ATTRIB                = (const xmlChar* const)"remoteName";
 const xmlChar * const LOCAL_NAME_ATTRIB                 = (const xmlChar* const)"localName";
 const xmlChar * const FORMAT_ATTRIB                     = (const xmlChar* const)"format";
+const xmlChar * const DTYPE_ATTRIB                      = (const xmlChar* const)"dtype";
 const xmlChar * const RANK_ATTRIB                       = (const xmlChar* const)"rank";
 const xmlChar * const LOCATION_ATTRIB                   = (const xmlChar* const)"location";
 const xmlChar * const NAME_ATTRIB                       = (const xmlChar* const)"name";
@@ -123,6 +123,7 @@ extern const xmlChar * const REGION_ATTRIB;
 extern const xmlChar * const REMOTE_NAME_ATTRIB;
 extern const xmlChar * const LOCAL_NAME_ATTRIB;
 extern const xmlChar * const FORMAT_ATTRIB;
+extern const xmlChar * const DTYPE_ATTRIB;
 extern const xmlChar * const RANK_ATTRIB;
 extern const xmlChar * const LOCATION_ATTRIB;
 extern const xmlChar * const NAME_ATTRIB;
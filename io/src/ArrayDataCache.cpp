@@ -0,0 +1,217 @@
+/* \file
+ * $Id$
+ * \author Caton Little
+ * \brief 
+ *
+ * \section LICENSE
+ *
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is FieldML
+ *
+ * The Initial Developer of the Original Code is Auckland Uniservices Ltd,
+ * Auckland, New Zealand. Portions created by the Initial Developer are
+ * Copyright (C) 2010 the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either the GNU General Public License Version 2 or later (the "GPL"), or
+ * the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ */
+
+#include "ArrayDataCache.h"
+
+using namespace std;
+
+bool ArrayDataCacheKey::operator<( const ArrayDataCacheKey &other ) const
+{
+    if( resource != other.resource )
+    {
+        return resource < other.resource;
+    }
+    if( generation != other.generation )
+    {
+        return generation < other.generation;
+    }
+    if( valueType != other.valueType )
+    {
+        return valueType < other.valueType;
+    }
+    if( firstRow != other.firstRow )
+    {
+        return firstRow < other.firstRow;
+    }
+    if( rowCount != other.rowCount )
+    {
+        return rowCount < other.rowCount;
+    }
+    if( location != other.location )
+    {
+        return location < other.location;
+    }
+
+    return shape < other.shape;
+}
+
+
+ArrayDataCache::ArrayDataCache() :
+    byteLimit( 0 ),
+    byteCount( 0 ),
+    hits( 0 ),
+    misses( 0 )
+{
+}
+
+
+ArrayDataCache::~ArrayDataCache()
+{
+    clear();
+}
+
+
+void ArrayDataCache::remove( BlockList::iterator block )
+{
+    byteCount -= block->byteCount;
+    delete[] block->data;
+    index.erase( block->key );
+    blocks.erase( block );
+}
+
+
+void ArrayDataCache::evict( int64_t requiredBytes )
+{
+    while( !blocks.empty() && ( byteCount + requiredBytes > byteLimit ) )
+    {
+        BlockList::iterator oldest = blocks.end();
+        oldest--;
+        remove( oldest );
+    }
+}
+
+
+void ArrayDataCache::setLimit( int64_t limit )
+{
+    byteLimit = ( limit < 0 ) ? 0 : limit;
+    evict( 0 );
+}
+
+
+int64_t ArrayDataCache::getLimit()
+{
+    return byteLimit;
+}
+
+
+const char *ArrayDataCache::find( const ArrayDataCacheKey &key )
+{
+    BlockMap::iterator i = index.find( key );
+    if( i == index.end() )
+    {
+        misses++;
+        return NULL;
+    }
+
+    hits++;
+    blocks.splice( blocks.begin(), blocks, i->second );
+
+    return i->second->data;
+}
+
+
+void ArrayDataCache::store( const ArrayDataCacheKey &key, char *data, int64_t dataBytes )
+{
+    if( dataBytes > byteLimit )
+    {
+        delete[] data;
+        return;
+    }
+
+    BlockMap::iterator existing = index.find( key );
+    if( existing != index.end() )
+    {
+        remove( existing->second );
+    }
+
+    evict( dataBytes );
+
+    Block block;
+    block.key = key;
+    block.data = data;
+    block.byteCount = dataBytes;
+
+    blocks.push_front( block );
+    index[key] = blocks.begin();
+    byteCount += dataBytes;
+}
+
+
+void ArrayDataCache::invalidate( FmlObjectHandle resource )
+{
+    BlockList::iterator i = blocks.begin();
+    while( i != blocks.end() )
+    {
+        BlockList::iterator next = i;
+        next++;
+        if( i->key.resource == resource )
+        {
+            remove( i );
+        }
+        i = next;
+    }
+}
+
+
+void ArrayDataCache::invalidateStale( FmlObjectHandle resource, int generation )
+{
+    BlockList::iterator i = blocks.begin();
+    while( i != blocks.end() )
+    {
+        BlockList::iterator next = i;
+        next++;
+        if( ( i->key.resource == resource ) && ( i->key.generation != generation ) )
+        {
+            remove( i );
+        }
+        i = next;
+    }
+}
+
+
+void ArrayDataCache::clear()
+{
+    for( BlockList::iterator i = blocks.begin(); i != blocks.end(); i++ )
+    {
+        delete[] i->data;
+    }
+    blocks.clear();
+    index.clear();
+    byteCount = 0;
+}
+
+
+void ArrayDataCache::getStatistics( int64_t &hitCount, int64_t &missCount, int64_t &bytesUsed )
+{
+    hitCount = hits;
+    missCount = misses;
+    bytesUsed = byteCount;
+}
@@ -0,0 +1,158 @@
+/* \file
+ * $Id$
+ * \author Caton Little
+ * \brief 
+ *
+ * \section LICENSE
+ *
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is FieldML
+ *
+ * The Initial Developer of the Original Code is Auckland Uniservices Ltd,
+ * Auckland, New Zealand. Portions created by the Initial Developer are
+ * Copyright (C) 2010 the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either the GNU General Public License Version 2 or later (the "GPL"), or
+ * the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ */
+
+#ifndef H_ARRAY_DATA_CACHE
+#define H_ARRAY_DATA_CACHE
+
+#include <string>
+#include <vector>
+#include <list>
+#include <map>
+
+#include "FieldmlIoApi.h"
+
+/**
+ * The type of the values held in a cached block. Blocks decoded as one type are never handed out as another.
+ */
+enum ArrayDataValueType
+{
+    ARRAY_VALUE_INT,
+    ARRAY_VALUE_DOUBLE,
+    ARRAY_VALUE_BOOLEAN,
+    ARRAY_VALUE_FLOAT,
+};
+
+
+/**
+ * Identifies a block of decoded values: a run of outermost rows from a particular array in a particular data
+ * resource. The shape records the raw sizes and the inner window of the viewing data source, so that data sources
+ * which lay the same data out differently never share blocks.
+ */
+class ArrayDataCacheKey
+{
+public:
+    FmlObjectHandle resource;
+
+    //The resource's data generation when the block was decoded.
+    int generation;
+
+    std::string location;
+
+    ArrayDataValueType valueType;
+
+    std::vector<int> shape;
+
+    int firstRow;
+
+    int rowCount;
+
+    bool operator<( const ArrayDataCacheKey &other ) const;
+};
+
+
+/**
+ * A memory-bounded, least-recently-used cache of decoded array blocks. There is one of these per FieldML session,
+ * shared by all readers opened on that session.
+ */
+class ArrayDataCache
+{
+private:
+    class Block
+    {
+    public:
+        ArrayDataCacheKey key;
+        char *data;
+        int64_t byteCount;
+    };
+
+    typedef std::list<Block> BlockList;
+
+    typedef std::map<ArrayDataCacheKey, BlockList::iterator> BlockMap;
+
+    //Most recently used blocks are at the front.
+    BlockList blocks;
+
+    BlockMap index;
+
+    int64_t byteLimit;
+
+    int64_t byteCount;
+
+    int64_t hits;
+
+    int64_t misses;
+
+    void evict( int64_t requiredBytes );
+
+    void remove( BlockList::iterator block );
+
+public:
+    ArrayDataCache();
+
+    virtual ~ArrayDataCache();
+
+    void setLimit( int64_t limit );
+
+    int64_t getLimit();
+
+    /**
+     * Returns the block's data, or NULL if the block is not cached. Updates the hit/miss statistics.
+     */
+    const char *find( const ArrayDataCacheKey &key );
+
+    /**
+     * Takes ownership of the given block data. The data is discarded immediately if it would not fit in the cache.
+     */
+    void store( const ArrayDataCacheKey &key, char *data, int64_t dataBytes );
+
+    void invalidate( FmlObjectHandle resource );
+
+    /**
+     * Discards the given resource's blocks from generations other than the given one.
+     */
+    void invalidateStale( FmlObjectHandle resource, int generation );
+
+    void clear();
+
+    void getStatistics( int64_t &hitCount, int64_t &missCount, int64_t &bytesUsed );
+};
+
+#endif //H_ARRAY_DATA_CACHE
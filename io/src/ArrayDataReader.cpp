@@ -39,19 +39,22 @@
  *
  */
 
+#include <algorithm>
+
 #include "StringUtil.h"
 #include "FieldmlIoApi.h"
 
 #include "ArrayDataReader.h"
-#include "Hdf5ArrayDataReader.h"
-#include "TextArrayDataReader.h"
+#include "ArrayFormatRegistry.h"
+#include "CachedArrayDataReader.h"
 
 using namespace std;
 
 ArrayDataReader * ArrayDataReader::createInternal( FieldmlIoContext *context, const string root,
-	FmlObjectHandle source, void *buffer )
+	FmlObjectHandle source, void *buffer, int64_t bufferLength )
 {
     ArrayDataReader *reader = NULL;
+    bool cached = false;
 
     FmlObjectHandle resource = Fieldml_GetDataSourceResource( context->getSession(), source );
     string format;
@@ -60,49 +63,581 @@ ArrayDataReader * ArrayDataReader::createInternal( FieldmlIoContext *context, co
     {
         context->setError( FML_IOERR_CORE_ERROR );
     }
-    else if( format == StringUtil::HDF5_NAME )
-    {
-#ifdef FIELDML_HDF5_ARRAY
-        reader = Hdf5ArrayDataReader::create( context, root, source );
-#endif //FIELDML_HDF5_ARRAY
-    }
-    else if( format == StringUtil::PHDF5_NAME )
+    else
     {
-#ifdef FIELDML_PHDF5_ARRAY
-        reader = Hdf5ArrayDataReader::create( context, root, source );
-#endif //FIELDML_PHDF5_ARRAY
+        reader = ArrayFormatRegistry::getRegistry().createReader( format, context, root, source, buffer, bufferLength, cached );
     }
-    else if( format == StringUtil::PLAIN_TEXT_NAME )
+    Fieldml_FreeString(temp_string);
+    
+    if( reader == NULL )
     {
-    		reader = TextArrayDataReader::create( context, root, source, buffer );
+        return NULL;
     }
-    else
+    
+    const int rank = Fieldml_GetArrayDataSourceRank( context->getSession(), source );
+    reader->slabRank = rank;
+    
+    if( ( buffer == NULL ) && cached )
     {
-        context->setError( FML_IOERR_UNSUPPORTED );
+        //Caller-supplied buffers have no identity that the cache could key on, and may change between readers.
+        reader = CachedArrayDataReader::create( context, reader, source );
+        reader->slabRank = rank;
     }
-    Fieldml_FreeString(temp_string);
+    
     return reader;
 }
 
 ArrayDataReader * ArrayDataReader::create( FieldmlIoContext *context, const string root, FmlObjectHandle source )
 {
-    return ArrayDataReader::createInternal( context, root, source, 0 );
+    return ArrayDataReader::createInternal( context, root, source, 0, -1 );
 }
 
 
-ArrayDataReader * ArrayDataReader::createWithBuffer( FieldmlIoContext *context, const string root, FmlObjectHandle source, void *buffer )
+ArrayDataReader * ArrayDataReader::createWithBuffer( FieldmlIoContext *context, const string root, FmlObjectHandle source, void *buffer,
+    int64_t bufferLength )
 {
-    return ArrayDataReader::createInternal( context, root, source, buffer );
+    return ArrayDataReader::createInternal( context, root, source, buffer, bufferLength );
 }
 
 
 ArrayDataReader::ArrayDataReader( FieldmlIoContext *_context ) :
+    rowRank( 0 ),
+    rowCount( 0 ),
+    rowOffsets( NULL ),
+    rowSizes( NULL ),
+    slabRank( 0 ),
     context( _context )
 {
 }
 
 
+std::recursive_mutex &ArrayDataReader::getSharedStateLock()
+{
+    static std::recursive_mutex sharedStateLock;
+    return sharedStateLock;
+}
+
+
+bool ArrayDataReader::isConcurrent()
+{
+    return false;
+}
+
+
+FmlIoErrorNumber ArrayDataReader::setAccessPattern( FieldmlAccessPattern pattern )
+{
+    return FML_IOERR_NO_ERROR;
+}
+
+
+FmlIoErrorNumber ArrayDataReader::lockedSetAccessPattern( FieldmlAccessPattern pattern )
+{
+    ReadGuard guard( this );
+    
+    return setAccessPattern( pattern );
+}
+
+
+FmlIoErrorNumber ArrayDataReader::setTransferMode( FieldmlTransferMode mode )
+{
+    if( mode != FML_TRANSFER_MODE_INDEPENDENT )
+    {
+        return context->setError( FML_IOERR_UNSUPPORTED );
+    }
+    
+    return FML_IOERR_NO_ERROR;
+}
+
+
+FmlIoErrorNumber ArrayDataReader::lockedSetTransferMode( FieldmlTransferMode mode )
+{
+    ReadGuard guard( this );
+    
+    return setTransferMode( mode );
+}
+
+
+int ArrayDataReader::getSlabRank()
+{
+    return slabRank;
+}
+
+
+ArrayDataReader::ReadGuard::ReadGuard( ArrayDataReader *reader ) :
+    readGuard( reader->readLock ),
+    sharedGuard( getSharedStateLock(), defer_lock )
+{
+    if( !reader->isConcurrent() )
+    {
+        sharedGuard.lock();
+    }
+}
+
+
+FmlIoErrorNumber ArrayDataReader::lockedReadSlab( ArrayDataValueType valueType, const int *offsets, const int *sizes, void *valueBuffer )
+{
+    ReadGuard guard( this );
+    
+    return dispatchSlabRead( valueType, offsets, sizes, valueBuffer );
+}
+
+
+FmlIoErrorNumber ArrayDataReader::prepareSlabReads( const int *sizes )
+{
+    return FML_IOERR_NO_ERROR;
+}
+
+
+FmlIoErrorNumber ArrayDataReader::lockedPrepareSlabReads( const int *sizes )
+{
+    if( slabRank <= 0 )
+    {
+        return context->setError( FML_IOERR_UNSUPPORTED );
+    }
+    
+    ReadGuard guard( this );
+    
+    preparedSizes.assign( sizes, sizes + slabRank );
+    
+    return prepareSlabReads( sizes );
+}
+
+
+FmlIoErrorNumber ArrayDataReader::lockedReadPreparedSlab( ArrayDataValueType valueType, const int *offsets, void *valueBuffer )
+{
+    ReadGuard guard( this );
+    
+    if( preparedSizes.empty() )
+    {
+        return context->setError( FML_IOERR_UNSUPPORTED );
+    }
+    
+    return dispatchSlabRead( valueType, offsets, &preparedSizes[0], valueBuffer );
+}
+
+
+FmlIoErrorNumber ArrayDataReader::dispatchSlabRead( ArrayDataValueType valueType, const int *offsets, const int *sizes, void *valueBuffer )
+{
+    if( valueType == ARRAY_VALUE_INT )
+    {
+        return readIntSlab( offsets, sizes, (int*)valueBuffer );
+    }
+    else if( valueType == ARRAY_VALUE_DOUBLE )
+    {
+        return readDoubleSlab( offsets, sizes, (double*)valueBuffer );
+    }
+    else if( valueType == ARRAY_VALUE_FLOAT )
+    {
+        return readFloatSlab( offsets, sizes, (float*)valueBuffer );
+    }
+    
+    return readBooleanSlab( offsets, sizes, (FmlBoolean*)valueBuffer );
+}
+
+
+FmlIoErrorNumber ArrayDataReader::readFloatSlab( const int *offsets, const int *sizes, float *valueBuffer )
+{
+    long valueCount = 1;
+    for( int i = 0; i < slabRank; i++ )
+    {
+        valueCount *= ( sizes[i] > 0 ) ? sizes[i] : 0;
+    }
+    
+    double *doubles = new double[( valueCount > 0 ) ? valueCount : 1];
+    FmlIoErrorNumber err = readDoubleSlab( offsets, sizes, doubles );
+    if( err == FML_IOERR_NO_ERROR )
+    {
+        for( long i = 0; i < valueCount; i++ )
+        {
+            valueBuffer[i] = (float)doubles[i];
+        }
+    }
+    delete[] doubles;
+    
+    return err;
+}
+
+
+//Orders slabs by where they start in storage order, i.e. lexicographically by their offsets.
+class SlabStartOrder
+{
+private:
+    const int *offsets;
+    
+    const int rank;
+    
+public:
+    SlabStartOrder( const int *_offsets, int _rank ) :
+        offsets( _offsets ),
+        rank( _rank )
+    {
+    }
+    
+    bool operator()( int a, int b ) const
+    {
+        return lexicographical_compare( offsets + ( a * rank ), offsets + ( ( a + 1 ) * rank ),
+            offsets + ( b * rank ), offsets + ( ( b + 1 ) * rank ) );
+    }
+};
+
+
+void ArrayDataReader::sortSlabs( int slabCount, int rank, const int *offsets, vector<int> &order )
+{
+    order.resize( slabCount );
+    for( int i = 0; i < slabCount; i++ )
+    {
+        order[i] = i;
+    }
+    
+    stable_sort( order.begin(), order.end(), SlabStartOrder( offsets, rank ) );
+}
+
+
+int ArrayDataReader::getValueSize( ArrayDataValueType valueType )
+{
+    if( valueType == ARRAY_VALUE_INT )
+    {
+        return sizeof( int );
+    }
+    else if( valueType == ARRAY_VALUE_DOUBLE )
+    {
+        return sizeof( double );
+    }
+    else if( valueType == ARRAY_VALUE_FLOAT )
+    {
+        return sizeof( float );
+    }
+    
+    return sizeof( FmlBoolean );
+}
+
+
+FmlIoErrorNumber ArrayDataReader::readStridedSlab( ArrayDataValueType valueType, const int *offsets, const int *sizes, const int *strides, void *valueBuffer )
+{
+    const int rank = slabRank;
+    const int innermost = rank - 1;
+    
+    bool contiguous = true;
+    for( int i = 0; i < rank; i++ )
+    {
+        if( sizes[i] <= 0 )
+        {
+            //Readers deal with empty slabs however they see fit.
+            return dispatchSlabRead( valueType, offsets, sizes, valueBuffer );
+        }
+        if( strides[i] != 1 )
+        {
+            contiguous = false;
+        }
+    }
+    
+    if( contiguous )
+    {
+        return dispatchSlabRead( valueType, offsets, sizes, valueBuffer );
+    }
+    
+    //Innermost runs are only contiguous if the innermost stride is one. Otherwise, each value is a run of its own.
+    const int runLength = ( strides[innermost] == 1 ) ? sizes[innermost] : 1;
+    const int lastDimension = ( runLength == 1 ) ? innermost : innermost - 1;
+    
+    int runCount = 1;
+    for( int i = 0; i <= lastDimension; i++ )
+    {
+        runCount *= sizes[i];
+    }
+    
+    vector<int> runOffsets( (long)runCount * rank );
+    vector<int> runSizes( (long)runCount * rank, 1 );
+    vector<int> index( rank, 0 );
+    for( int run = 0; run < runCount; run++ )
+    {
+        int *runOffset = &runOffsets[(long)run * rank];
+        for( int i = 0; i < rank; i++ )
+        {
+            runOffset[i] = offsets[i] + ( index[i] * strides[i] );
+        }
+        runSizes[( (long)run * rank ) + innermost] = runLength;
+        
+        for( int depth = lastDimension; depth >= 0; depth-- )
+        {
+            index[depth]++;
+            if( index[depth] < sizes[depth] )
+            {
+                break;
+            }
+            index[depth] = 0;
+        }
+    }
+    
+    return readSlabList( valueType, runCount, &runOffsets[0], &runSizes[0], valueBuffer );
+}
+
+
+FmlIoErrorNumber ArrayDataReader::readSlabList( ArrayDataValueType valueType, int slabCount, const int *offsets, const int *sizes, void *valueBuffer )
+{
+    const int rank = slabRank;
+    const int valueSize = getValueSize( valueType );
+    
+    //Where each slab's values go in the buffer.
+    vector<long> starts( slabCount );
+    long valueCount = 0;
+    for( int slab = 0; slab < slabCount; slab++ )
+    {
+        long slabValues = 1;
+        for( int i = 0; i < rank; i++ )
+        {
+            slabValues *= sizes[( slab * rank ) + i];
+        }
+        starts[slab] = valueCount;
+        valueCount += slabValues;
+    }
+    
+    //Reading in storage order saves forward-only readers from rewinding between slabs.
+    vector<int> order;
+    sortSlabs( slabCount, rank, offsets, order );
+    
+    for( int i = 0; i < slabCount; i++ )
+    {
+        const int slab = order[i];
+        const long nextStart = ( slab + 1 < slabCount ) ? starts[slab + 1] : valueCount;
+        if( nextStart == starts[slab] )
+        {
+            continue;
+        }
+        
+        char *slabBuffer = (char*)valueBuffer + ( starts[slab] * valueSize );
+        FmlIoErrorNumber err = dispatchSlabRead( valueType, offsets + ( slab * rank ), sizes + ( slab * rank ), slabBuffer );
+        if( err != FML_IOERR_NO_ERROR )
+        {
+            return err;
+        }
+    }
+    
+    return FML_IOERR_NO_ERROR;
+}
+
+
+FmlIoErrorNumber ArrayDataReader::readPoints( ArrayDataValueType valueType, int pointCount, const int *points, void *valueBuffer )
+{
+    vector<int> sizes( (long)pointCount * slabRank, 1 );
+    
+    return readSlabList( valueType, pointCount, points, sizes.empty() ? NULL : &sizes[0], valueBuffer );
+}
+
+
+FmlIoErrorNumber ArrayDataReader::lockedReadStridedSlab( ArrayDataValueType valueType, const int *offsets, const int *sizes, const int *strides, void *valueBuffer )
+{
+    if( slabRank <= 0 )
+    {
+        return context->setError( FML_IOERR_UNSUPPORTED );
+    }
+    
+    for( int i = 0; i < slabRank; i++ )
+    {
+        if( ( sizes[i] < 0 ) || ( strides[i] <= 0 ) )
+        {
+            return context->setError( FML_IOERR_INVALID_PARAMETER );
+        }
+    }
+    
+    ReadGuard guard( this );
+    
+    return readStridedSlab( valueType, offsets, sizes, strides, valueBuffer );
+}
+
+
+FmlIoErrorNumber ArrayDataReader::lockedReadSlabList( ArrayDataValueType valueType, int slabCount, const int *offsets, const int *sizes, void *valueBuffer )
+{
+    if( slabRank <= 0 )
+    {
+        return context->setError( FML_IOERR_UNSUPPORTED );
+    }
+    
+    for( long i = 0; i < (long)slabCount * slabRank; i++ )
+    {
+        if( sizes[i] < 0 )
+        {
+            return context->setError( FML_IOERR_INVALID_PARAMETER );
+        }
+    }
+    
+    ReadGuard guard( this );
+    
+    return readSlabList( valueType, slabCount, offsets, sizes, valueBuffer );
+}
+
+
+FmlIoErrorNumber ArrayDataReader::lockedReadPoints( ArrayDataValueType valueType, int pointCount, const int *points, void *valueBuffer )
+{
+    if( slabRank <= 0 )
+    {
+        return context->setError( FML_IOERR_UNSUPPORTED );
+    }
+    
+    ReadGuard guard( this );
+    
+    return readPoints( valueType, pointCount, points, valueBuffer );
+}
+
+
+FmlIoErrorNumber ArrayDataReader::getExtents( FmlObjectHandle source, int rank, int *sizes )
+{
+    int *rawSizes = new int[rank];
+    int *offsets = new int[rank];
+    
+    Fieldml_GetArrayDataSourceSizes( context->getSession(), source, sizes );
+    Fieldml_GetArrayDataSourceRawSizes( context->getSession(), source, rawSizes );
+    Fieldml_GetArrayDataSourceOffsets( context->getSession(), source, offsets );
+    
+    FmlIoErrorNumber err = FML_IOERR_NO_ERROR;
+    for( int i = 0; i < rank; i++ )
+    {
+        if( sizes[i] == 0 )
+        {
+            //NOTE: Intentional. If the array-source size has not been set, use the underlying size.
+            sizes[i] = rawSizes[i] - offsets[i];
+        }
+        if( sizes[i] <= 0 )
+        {
+            err = FML_IOERR_UNSUPPORTED;
+        }
+    }
+    
+    delete[] rawSizes;
+    delete[] offsets;
+    
+    return err;
+}
+
+
+FmlIoErrorNumber ArrayDataReader::beginRows( FmlObjectHandle source )
+{
+    int rank = Fieldml_GetArrayDataSourceRank( context->getSession(), source );
+    if( rank <= 0 )
+    {
+        return context->setError( FML_IOERR_CORE_ERROR );
+    }
+    
+    int *sizes = new int[rank];
+    FmlIoErrorNumber err = getExtents( source, rank, sizes );
+    if( err != FML_IOERR_NO_ERROR )
+    {
+        delete[] sizes;
+        return context->setError( err );
+    }
+    
+    delete[] rowOffsets;
+    delete[] rowSizes;
+    
+    rowRank = rank;
+    rowCount = sizes[0];
+    rowSizes = sizes;
+    rowOffsets = new int[rank];
+    for( int i = 0; i < rank; i++ )
+    {
+        rowOffsets[i] = 0;
+    }
+    
+    return FML_IOERR_NO_ERROR;
+}
+
+
+int ArrayDataReader::nextRows( int maxRows )
+{
+    if( rowRank == 0 )
+    {
+        context->setError( FML_IOERR_UNSUPPORTED );
+        return -1;
+    }
+    if( maxRows <= 0 )
+    {
+        context->setError( FML_IOERR_INVALID_PARAMETER );
+        return -1;
+    }
+    
+    int rows = rowCount - rowOffsets[0];
+    if( rows > maxRows )
+    {
+        rows = maxRows;
+    }
+    rowSizes[0] = rows;
+    
+    return rows;
+}
+
+
+int ArrayDataReader::readNextIntRows( int maxRows, int *valueBuffer )
+{
+    int rows = nextRows( maxRows );
+    if( rows <= 0 )
+    {
+        return rows;
+    }
+    
+    if( lockedReadSlab( ARRAY_VALUE_INT, rowOffsets, rowSizes, valueBuffer ) != FML_IOERR_NO_ERROR )
+    {
+        return -1;
+    }
+    
+    rowOffsets[0] += rows;
+    return rows;
+}
+
+
+int ArrayDataReader::readNextDoubleRows( int maxRows, double *valueBuffer )
+{
+    int rows = nextRows( maxRows );
+    if( rows <= 0 )
+    {
+        return rows;
+    }
+    
+    if( lockedReadSlab( ARRAY_VALUE_DOUBLE, rowOffsets, rowSizes, valueBuffer ) != FML_IOERR_NO_ERROR )
+    {
+        return -1;
+    }
+    
+    rowOffsets[0] += rows;
+    return rows;
+}
+
+
+int ArrayDataReader::readNextBooleanRows( int maxRows, FmlBoolean *valueBuffer )
+{
+    int rows = nextRows( maxRows );
+    if( rows <= 0 )
+    {
+        return rows;
+    }
+    
+    if( lockedReadSlab( ARRAY_VALUE_BOOLEAN, rowOffsets, rowSizes, valueBuffer ) != FML_IOERR_NO_ERROR )
+    {
+        return -1;
+    }
+    
+    rowOffsets[0] += rows;
+    return rows;
+}
+
+
+const int *ArrayDataReader::getIntSlabPointer( const int *offsets, const int *sizes )
+{
+    context->setError( FML_IOERR_UNSUPPORTED );
+    return NULL;
+}
+
+
+const double *ArrayDataReader::getDoubleSlabPointer( const int *offsets, const int *sizes )
+{
+    context->setError( FML_IOERR_UNSUPPORTED );
+    return NULL;
+}
+
+
 ArrayDataReader::~ArrayDataReader()
 {
+    delete[] rowOffsets;
+    delete[] rowSizes;
+    
     delete context;
 }
@@ -42,7 +42,11 @@
 #ifndef H_ARRAY_DATA_READER
 #define H_ARRAY_DATA_READER
 
+#include <mutex>
+#include <vector>
+
 #include "FieldmlIoContext.h"
+#include "ArrayDataCache.h"
 
 enum ArrayDataSourceType
 {
@@ -53,30 +57,191 @@ enum ArrayDataSourceType
 
 class ArrayDataReader
 {
+private:
+    //Row iteration state. Only set up for readers opened as row iterators.
+    int rowRank;
+    
+    int rowCount;
+    
+    int *rowOffsets;
+    
+    int *rowSizes;
+    
+    //The rank of the slabs that this reader reads, i.e. that of its data source.
+    int slabRank;
+    
+    //Held for the duration of each read, so that synchronous and asynchronous reads never overlap.
+    std::mutex readLock;
+    
+    //The slab sizes bound by prepareSlabReads(), if any.
+    std::vector<int> preparedSizes;
+    
+    /**
+     * Holds the locks that a read from the given reader needs, for as long as it's in scope.
+     */
+    class ReadGuard
+    {
+    private:
+        std::lock_guard<std::mutex> readGuard;
+        
+        std::unique_lock<std::recursive_mutex> sharedGuard;
+        
+    public:
+        ReadGuard( ArrayDataReader *reader );
+    };
+    
+    FmlIoErrorNumber dispatchSlabRead( ArrayDataValueType valueType, const int *offsets, const int *sizes, void *valueBuffer );
+    
+    int nextRows( int maxRows );
+
 protected:
     FieldmlIoContext * const context;
 
     ArrayDataReader( FieldmlIoContext *_context );
     
     static ArrayDataReader *createInternal( FieldmlIoContext *context, const std::string root,
-    	FmlObjectHandle source, void *buffer );
+    	FmlObjectHandle source, void *buffer, int64_t bufferLength );
+    
+    /**
+     * Fills in the indexes of the given slabs, ordered by where each slab starts in storage order.
+     */
+    static void sortSlabs( int slabCount, int rank, const int *offsets, std::vector<int> &order );
 
 public:
     virtual FmlIoErrorNumber readIntSlab( const int *offsets, const int *sizes, int *valueBuffer ) = 0;
     
     virtual FmlIoErrorNumber readDoubleSlab( const int *offsets, const int *sizes, double *valueBuffer ) = 0;
     
+    /**
+     * Reads single precision values. By default, the slab is read as doubles, which are then narrowed.
+     */
+    virtual FmlIoErrorNumber readFloatSlab( const int *offsets, const int *sizes, float *valueBuffer );
+    
     //TODO Provide options for reading into 32/64 bit packed boolean arrays?
     virtual FmlIoErrorNumber readBooleanSlab( const int *offsets, const int *sizes, FmlBoolean *valueBuffer ) = 0;
     
+    /**
+     * Returns the given slab's values in place, or NULL if they aren't stored contiguously as that type. By default,
+     * readers only ever copy values out.
+     */
+    virtual const int *getIntSlabPointer( const int *offsets, const int *sizes );
+    
+    virtual const double *getDoubleSlabPointer( const int *offsets, const int *sizes );
+    
     virtual FmlIoErrorNumber close() = 0;
     
+    /**
+     * Returns true if reads only touch the reader's own state, so that they can run on any thread alongside other
+     * readers' reads. Other readers' reads are serialised with each other. By default, readers are assumed not to be.
+     */
+    virtual bool isConcurrent();
+    
+    /**
+     * Adapts the reader to the given access pattern. By default, hints are ignored.
+     */
+    virtual FmlIoErrorNumber setAccessPattern( FieldmlAccessPattern pattern );
+    
+    /**
+     * Sets the access pattern on behalf of the API, once any read in progress has finished.
+     */
+    FmlIoErrorNumber lockedSetAccessPattern( FieldmlAccessPattern pattern );
+    
+    /**
+     * Sets how slabs are transferred across processes. By default, only independent transfers are supported.
+     */
+    virtual FmlIoErrorNumber setTransferMode( FieldmlTransferMode mode );
+    
+    /**
+     * Sets the transfer mode on behalf of the API, once any read in progress has finished.
+     */
+    FmlIoErrorNumber lockedSetTransferMode( FieldmlTransferMode mode );
+    
+    /**
+     * Reads a slab on behalf of the API, on whatever thread the read is done on. Takes whatever locks the reader needs.
+     */
+    FmlIoErrorNumber lockedReadSlab( ArrayDataValueType valueType, const int *offsets, const int *sizes, void *valueBuffer );
+    
+    /**
+     * Gets the reader ready for reads of slabs with the given sizes. By default, there's nothing to get ready.
+     */
+    virtual FmlIoErrorNumber prepareSlabReads( const int *sizes );
+    
+    /**
+     * Binds the given slab sizes on behalf of the API, for use by lockedReadPreparedSlab().
+     */
+    FmlIoErrorNumber lockedPrepareSlabReads( const int *sizes );
+    
+    /**
+     * Reads a slab of the prepared sizes on behalf of the API. Returns FML_IOERR_UNSUPPORTED if there are none.
+     */
+    FmlIoErrorNumber lockedReadPreparedSlab( ArrayDataValueType valueType, const int *offsets, void *valueBuffer );
+    
+    /**
+     * Reads the slab made up of every strides[i]'th value along each dimension, starting at the given offsets and
+     * taking sizes[i] values along each. By default, this is read as a list of the slab's innermost runs.
+     */
+    virtual FmlIoErrorNumber readStridedSlab( ArrayDataValueType valueType, const int *offsets, const int *sizes, const int *strides, void *valueBuffer );
+    
+    /**
+     * Reads the given slabs one after another into the buffer. The offsets and sizes hold those of each slab in turn.
+     * By default, the slabs are read one at a time, in storage order.
+     */
+    virtual FmlIoErrorNumber readSlabList( ArrayDataValueType valueType, int slabCount, const int *offsets, const int *sizes, void *valueBuffer );
+    
+    /**
+     * Reads the values at the given points, which hold the indexes of each point in turn. By default, this is read as
+     * a list of single-valued slabs.
+     */
+    virtual FmlIoErrorNumber readPoints( ArrayDataValueType valueType, int pointCount, const int *points, void *valueBuffer );
+    
+    FmlIoErrorNumber lockedReadStridedSlab( ArrayDataValueType valueType, const int *offsets, const int *sizes, const int *strides, void *valueBuffer );
+    
+    FmlIoErrorNumber lockedReadSlabList( ArrayDataValueType valueType, int slabCount, const int *offsets, const int *sizes, void *valueBuffer );
+    
+    FmlIoErrorNumber lockedReadPoints( ArrayDataValueType valueType, int pointCount, const int *points, void *valueBuffer );
+    
+    int getSlabRank();
+    
+    /**
+     * The lock that serialises reads by readers that aren't concurrent with anything else that touches the state they
+     * share, e.g. the session's decoded-data cache or a third-party library. It is recursive, so that code which
+     * takes it can call other code which does too.
+     */
+    static std::recursive_mutex &getSharedStateLock();
+    
+    static int getValueSize( ArrayDataValueType valueType );
+    
+    /**
+     * Gets the extents of the array that this reader reads from the given data source. By default these come from the
+     * data source's sizes, falling back to its raw sizes less its offsets.
+     */
+    virtual FmlIoErrorNumber getExtents( FmlObjectHandle source, int rank, int *sizes );
+    
+    /**
+     * Starts a forward-only scan of the data source's outermost rows.
+     */
+    FmlIoErrorNumber beginRows( FmlObjectHandle source );
+    
+    /**
+     * Reads up to maxRows of the next outermost rows. Returns the number of rows read, zero once there are no rows
+     * left, or -1 on error.
+     */
+    int readNextIntRows( int maxRows, int *valueBuffer );
+    
+    int readNextDoubleRows( int maxRows, double *valueBuffer );
+    
+    int readNextBooleanRows( int maxRows, FmlBoolean *valueBuffer );
+    
     virtual ~ArrayDataReader();
 
     static ArrayDataReader *create( FieldmlIoContext *context, const std::string root, FmlObjectHandle source);
 
+    /**
+     * Creates a reader for the given buffer, which holds the data source's resource contents. The buffer's length in
+     * bytes is negative if it isn't known.
+     */
     static ArrayDataReader *createWithBuffer( FieldmlIoContext *context, const std::string root,
-    	FmlObjectHandle source, void *buffer );
+    	FmlObjectHandle source, void *buffer, int64_t bufferLength );
 };
 
 
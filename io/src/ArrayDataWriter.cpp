@@ -40,13 +40,14 @@
  */
 
 #include "StringUtil.h"
+#include "FieldmlIoSession.h"
 #include "ArrayDataWriter.h"
-#include "Hdf5ArrayDataWriter.h"
-#include "TextArrayDataWriter.h"
+#include "ArrayFormatRegistry.h"
 
 using namespace std;
 
-ArrayDataWriter *ArrayDataWriter::create( FieldmlIoContext *context, const string root, FmlObjectHandle source, FieldmlHandleType handleType, bool append, int *sizes, int rank )
+ArrayDataWriter *ArrayDataWriter::create( FieldmlIoContext *context, const string root, FmlObjectHandle source, FieldmlHandleType handleType, bool append, int *sizes, int rank,
+    const FieldmlArrayWriterOptions *options )
 {
     ArrayDataWriter *writer = NULL;
     
@@ -58,39 +59,42 @@ ArrayDataWriter *ArrayDataWriter::create( FieldmlIoContext *context, const strin
     {
         context->setError( FML_IOERR_CORE_ERROR );
     }
-    else if( format == StringUtil::HDF5_NAME )
-    {
-#ifdef FIELDML_HDF5_ARRAY
-        writer = Hdf5ArrayDataWriter::create( context, root, source, handleType, append, sizes, rank );
-#endif //FIELDML_HDF5_ARRAY
-    }
-    else if( format == StringUtil::PHDF5_NAME )
-    {
-#ifdef FIELDML_PHDF5_ARRAY
-        writer = Hdf5ArrayDataWriter::create( context, root, source, handleType, append, sizes, rank );
-#endif //FIELDML_PHDF5_ARRAY
-    }
-    else if( format == StringUtil::PLAIN_TEXT_NAME )
-    {
-        writer = TextArrayDataWriter::create( context, root, source, handleType, append, sizes, rank );
-    }
     else
     {
-        context->setError( FML_IOERR_UNSUPPORTED );
+        writer = ArrayFormatRegistry::getRegistry().createWriter( format, context, root, source, handleType, append, sizes, rank, options );
     }
     Fieldml_FreeString(temp_string);
     
+    if( writer != NULL )
+    {
+        writer->resource = resource;
+        FieldmlIoSession::getSession().invalidateDataCache( context->getSession(), resource );
+    }
+    
     return writer;
 }
 
 
 ArrayDataWriter::ArrayDataWriter( FieldmlIoContext *_context ) :
-    context( _context )
+    context( _context ),
+    resource( FML_INVALID_HANDLE )
+{
+}
+
+
+FmlIoErrorNumber ArrayDataWriter::setTransferMode( FieldmlTransferMode mode )
 {
+    if( mode != FML_TRANSFER_MODE_INDEPENDENT )
+    {
+        return context->setError( FML_IOERR_UNSUPPORTED );
+    }
+    
+    return FML_IOERR_NO_ERROR;
 }
 
 
 ArrayDataWriter::~ArrayDataWriter()
 {
+    FieldmlIoSession::getSession().invalidateDataCache( context->getSession(), resource );
     delete context;
 }
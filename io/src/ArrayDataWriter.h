@@ -51,6 +51,9 @@ class ArrayDataWriter
 protected:
     FieldmlIoContext *const context;
 
+    //The data resource being written to. Cached data decoded from it is discarded when the writer opens and closes.
+    FmlObjectHandle resource;
+
     ArrayDataWriter( FieldmlIoContext *_context );
 public:
     virtual FmlIoErrorNumber writeIntSlab( const int *offsets, const int *sizes, const int *valueBuffer ) = 0;
@@ -62,9 +65,15 @@ public:
     
     virtual FmlIoErrorNumber close() = 0;
     
+    /**
+     * Sets how slabs are transferred across processes. By default, only independent transfers are supported.
+     */
+    virtual FmlIoErrorNumber setTransferMode( FieldmlTransferMode mode );
+    
     virtual ~ArrayDataWriter();
     
-    static ArrayDataWriter *create( FieldmlIoContext *context, const std::string root, FmlObjectHandle source, FieldmlHandleType handleType, bool append, int *sizes, int rank );
+    static ArrayDataWriter *create( FieldmlIoContext *context, const std::string root, FmlObjectHandle source, FieldmlHandleType handleType, bool append, int *sizes, int rank,
+        const FieldmlArrayWriterOptions *options );
 };
 
 
@@ -0,0 +1,259 @@
+/* \file
+ * $Id$
+ * \author Caton Little
+ * \brief 
+ *
+ * \section LICENSE
+ *
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is FieldML
+ *
+ * The Initial Developer of the Original Code is Auckland Uniservices Ltd,
+ * Auckland, New Zealand. Portions created by the Initial Developer are
+ * Copyright (C) 2010 the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either the GNU General Public License Version 2 or later (the "GPL"), or
+ * the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ */
+
+#include <cstring>
+
+#include "StringUtil.h"
+#include "FieldmlIoApi.h"
+
+#include "ArrayFormatRegistry.h"
+#include "Base64ArrayDataReader.h"
+#include "Base64ArrayDataWriter.h"
+#include "ExternalArrayDataReader.h"
+#include "ExternalArrayDataWriter.h"
+#include "Hdf5ArrayDataReader.h"
+#include "Hdf5ArrayDataWriter.h"
+#include "RawArrayDataReader.h"
+#include "RawArrayDataWriter.h"
+#include "ShardedArrayDataReader.h"
+#include "ShardedArrayDataWriter.h"
+#include "TextArrayDataReader.h"
+#include "TextArrayDataWriter.h"
+
+using namespace std;
+
+/**
+ * Adapters from each built-in format's own factories to the common factory signatures.
+ */
+static ArrayDataReader *createTextReader( FieldmlIoContext *context, const string root, FmlObjectHandle source, void *buffer,
+    int64_t bufferLength )
+{
+    return TextArrayDataReader::create( context, root, source, buffer, bufferLength );
+}
+
+
+static ArrayDataWriter *createTextWriter( FieldmlIoContext *context, const string root, FmlObjectHandle source,
+    FieldmlHandleType handleType, bool append, int *sizes, int rank, const FieldmlArrayWriterOptions *options )
+{
+    return TextArrayDataWriter::create( context, root, source, handleType, append, sizes, rank );
+}
+
+
+static ArrayDataReader *createBase64Reader( FieldmlIoContext *context, const string root, FmlObjectHandle source, void *buffer,
+    int64_t bufferLength )
+{
+    return Base64ArrayDataReader::create( context, source, buffer, bufferLength );
+}
+
+
+static ArrayDataWriter *createBase64Writer( FieldmlIoContext *context, const string root, FmlObjectHandle source,
+    FieldmlHandleType handleType, bool append, int *sizes, int rank, const FieldmlArrayWriterOptions *options )
+{
+    return Base64ArrayDataWriter::create( context, source, handleType, append );
+}
+
+
+static ArrayDataReader *createRawReader( FieldmlIoContext *context, const string root, FmlObjectHandle source, void *buffer,
+    int64_t bufferLength )
+{
+    return RawArrayDataReader::create( context, root, source, buffer, bufferLength );
+}
+
+
+static ArrayDataWriter *createRawWriter( FieldmlIoContext *context, const string root, FmlObjectHandle source,
+    FieldmlHandleType handleType, bool append, int *sizes, int rank, const FieldmlArrayWriterOptions *options )
+{
+    return RawArrayDataWriter::create( context, root, source, handleType, append, sizes, rank );
+}
+
+
+static ArrayDataReader *createShardedReader( FieldmlIoContext *context, const string root, FmlObjectHandle source, void *buffer,
+    int64_t bufferLength )
+{
+    return ShardedArrayDataReader::create( context, root, source, buffer, bufferLength );
+}
+
+
+static ArrayDataWriter *createShardedWriter( FieldmlIoContext *context, const string root, FmlObjectHandle source,
+    FieldmlHandleType handleType, bool append, int *sizes, int rank, const FieldmlArrayWriterOptions *options )
+{
+    return ShardedArrayDataWriter::create( context, root, source, handleType, append, sizes, rank, options );
+}
+
+
+#if defined FIELDML_HDF5_ARRAY || defined FIELDML_PHDF5_ARRAY
+static ArrayDataReader *createHdf5Reader( FieldmlIoContext *context, const string root, FmlObjectHandle source, void *buffer,
+    int64_t bufferLength )
+{
+    return Hdf5ArrayDataReader::create( context, root, source, buffer, bufferLength );
+}
+
+
+static ArrayDataWriter *createHdf5Writer( FieldmlIoContext *context, const string root, FmlObjectHandle source,
+    FieldmlHandleType handleType, bool append, int *sizes, int rank, const FieldmlArrayWriterOptions *options )
+{
+    return Hdf5ArrayDataWriter::create( context, root, source, handleType, append, sizes, rank, options );
+}
+#endif //FIELDML_HDF5_ARRAY || FIELDML_PHDF5_ARRAY
+
+
+ArrayFormatRegistry::ArrayFormatRegistry()
+{
+    registerFormat( StringUtil::PLAIN_TEXT_NAME, createTextReader, createTextWriter, true );
+#ifdef FIELDML_ZLIB_STREAMS
+    registerFormat( StringUtil::PLAIN_TEXT_GZIP_NAME, createTextReader, createTextWriter, true );
+#endif //FIELDML_ZLIB_STREAMS
+    registerFormat( StringUtil::BASE64_NAME, createBase64Reader, createBase64Writer, true );
+    registerFormat( StringUtil::RAW_BINARY_NAME, createRawReader, createRawWriter, false );
+    registerFormat( StringUtil::SHARDED_NAME, createShardedReader, createShardedWriter, true );
+#ifdef FIELDML_HDF5_ARRAY
+    registerFormat( StringUtil::HDF5_NAME, createHdf5Reader, createHdf5Writer, true );
+#endif //FIELDML_HDF5_ARRAY
+#ifdef FIELDML_PHDF5_ARRAY
+    registerFormat( StringUtil::PHDF5_NAME, createHdf5Reader, createHdf5Writer, true );
+#endif //FIELDML_PHDF5_ARRAY
+}
+
+
+ArrayFormatRegistry &ArrayFormatRegistry::getRegistry()
+{
+    //Constructed on first use, so that formats can be registered from other static initializers.
+    static ArrayFormatRegistry registry;
+    return registry;
+}
+
+
+void ArrayFormatRegistry::registerFormat( const string &name, ArrayDataReaderFactory readerFactory, ArrayDataWriterFactory writerFactory, bool cached )
+{
+    Format format;
+    format.readerFactory = readerFactory;
+    format.writerFactory = writerFactory;
+    format.cached = cached;
+    format.external = false;
+    memset( &format.callbacks, 0, sizeof( format.callbacks ) );
+    format.userData = NULL;
+    
+    lock_guard<mutex> guard( lock );
+    formats[name] = format;
+}
+
+
+void ArrayFormatRegistry::registerExternalFormat( const string &name, const FieldmlArrayFormatCallbacks &callbacks, void *userData )
+{
+    Format format;
+    format.readerFactory = NULL;
+    format.writerFactory = NULL;
+    format.cached = true;
+    format.external = true;
+    format.callbacks = callbacks;
+    format.userData = userData;
+    
+    lock_guard<mutex> guard( lock );
+    formats[name] = format;
+}
+
+
+void ArrayFormatRegistry::unregisterFormat( const string &name )
+{
+    lock_guard<mutex> guard( lock );
+    formats.erase( name );
+}
+
+
+bool ArrayFormatRegistry::find( const string &name, Format &format )
+{
+    lock_guard<mutex> guard( lock );
+    map<string, Format>::iterator i = formats.find( name );
+    if( i == formats.end() )
+    {
+        return false;
+    }
+    
+    //Copied out, so that the format can be used while other threads change the registry.
+    format = i->second;
+    return true;
+}
+
+
+bool ArrayFormatRegistry::isRegistered( const string &name )
+{
+    Format format;
+    return find( name, format );
+}
+
+
+ArrayDataReader *ArrayFormatRegistry::createReader( const string &name, FieldmlIoContext *context, const string root, FmlObjectHandle source,
+    void *buffer, int64_t bufferLength, bool &cached )
+{
+    Format format;
+    if( !find( name, format ) )
+    {
+        context->setError( FML_IOERR_UNSUPPORTED );
+        return NULL;
+    }
+    
+    cached = format.cached;
+    if( format.external )
+    {
+        return ExternalArrayDataReader::create( context, root, source, buffer, bufferLength, format.callbacks, format.userData );
+    }
+    
+    return format.readerFactory( context, root, source, buffer, bufferLength );
+}
+
+
+ArrayDataWriter *ArrayFormatRegistry::createWriter( const string &name, FieldmlIoContext *context, const string root, FmlObjectHandle source,
+    FieldmlHandleType handleType, bool append, int *sizes, int rank, const FieldmlArrayWriterOptions *options )
+{
+    Format format;
+    if( !find( name, format ) )
+    {
+        context->setError( FML_IOERR_UNSUPPORTED );
+        return NULL;
+    }
+    
+    if( format.external )
+    {
+        return ExternalArrayDataWriter::create( context, root, source, handleType, append, sizes, rank, format.callbacks, format.userData );
+    }
+    
+    return format.writerFactory( context, root, source, handleType, append, sizes, rank, options );
+}
@@ -0,0 +1,114 @@
+/* \file
+ * $Id$
+ * \author Caton Little
+ * \brief 
+ *
+ * \section LICENSE
+ *
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is FieldML
+ *
+ * The Initial Developer of the Original Code is Auckland Uniservices Ltd,
+ * Auckland, New Zealand. Portions created by the Initial Developer are
+ * Copyright (C) 2010 the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either the GNU General Public License Version 2 or later (the "GPL"), or
+ * the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ */
+
+#ifndef H_ARRAY_FORMAT_REGISTRY
+#define H_ARRAY_FORMAT_REGISTRY
+
+#include <string>
+#include <map>
+#include <mutex>
+
+#include "FieldmlIoContext.h"
+#include "ArrayDataReader.h"
+#include "ArrayDataWriter.h"
+
+typedef ArrayDataReader *(*ArrayDataReaderFactory)( FieldmlIoContext *context, const std::string root, FmlObjectHandle source, void *buffer,
+    int64_t bufferLength );
+
+typedef ArrayDataWriter *(*ArrayDataWriterFactory)( FieldmlIoContext *context, const std::string root, FmlObjectHandle source,
+    FieldmlHandleType handleType, bool append, int *sizes, int rank, const FieldmlArrayWriterOptions *options );
+
+/**
+ * Maps data resource format names to the readers and writers that handle them. The library's own formats are
+ * registered when the registry is first used, and applications can add or replace formats at any time through the
+ * callback API.
+ */
+class ArrayFormatRegistry
+{
+private:
+    class Format
+    {
+    public:
+        ArrayDataReaderFactory readerFactory;
+        
+        ArrayDataWriterFactory writerFactory;
+        
+        //Readers for formats that hold their data in memory as is gain nothing from the decoded-block cache.
+        bool cached;
+        
+        //Only set for application-defined formats, in which case the factories are unused.
+        bool external;
+        
+        FieldmlArrayFormatCallbacks callbacks;
+        
+        void *userData;
+    };
+    
+    std::map<std::string, Format> formats;
+    
+    std::mutex lock;
+    
+    ArrayFormatRegistry();
+    
+    bool find( const std::string &name, Format &format );
+    
+public:
+    void registerFormat( const std::string &name, ArrayDataReaderFactory readerFactory, ArrayDataWriterFactory writerFactory, bool cached );
+    
+    void registerExternalFormat( const std::string &name, const FieldmlArrayFormatCallbacks &callbacks, void *userData );
+    
+    void unregisterFormat( const std::string &name );
+    
+    bool isRegistered( const std::string &name );
+    
+    /**
+     * Creates a reader for the given format, or returns NULL and sets FML_IOERR_UNSUPPORTED if there isn't one.
+     */
+    ArrayDataReader *createReader( const std::string &name, FieldmlIoContext *context, const std::string root, FmlObjectHandle source,
+        void *buffer, int64_t bufferLength, bool &cached );
+    
+    ArrayDataWriter *createWriter( const std::string &name, FieldmlIoContext *context, const std::string root, FmlObjectHandle source,
+        FieldmlHandleType handleType, bool append, int *sizes, int rank, const FieldmlArrayWriterOptions *options );
+    
+    static ArrayFormatRegistry &getRegistry();
+};
+
+#endif //H_ARRAY_FORMAT_REGISTRY
@@ -0,0 +1,275 @@
+/* \file
+ * $Id$
+ * \author Caton Little
+ * \brief 
+ *
+ * \section LICENSE
+ *
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is FieldML
+ *
+ * The Initial Developer of the Original Code is Auckland Uniservices Ltd,
+ * Auckland, New Zealand. Portions created by the Initial Developer are
+ * Copyright (C) 2010 the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either the GNU General Public License Version 2 or later (the "GPL"), or
+ * the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ */
+
+#include <system_error>
+
+#include "ArrayReadQueue.h"
+
+using namespace std;
+
+//Enough to keep a few storage devices busy, without swamping the application's own threads.
+static const int MAX_WORKER_THREADS = 4;
+
+
+ArrayReadQueue &ArrayReadQueue::getQueue()
+{
+    //Constructed on first use, and destroyed (stopping the workers) before the readers are.
+    static ArrayReadQueue queue;
+    return queue;
+}
+
+
+ArrayReadQueue::ArrayReadQueue() :
+    nextHandle( 0 ),
+    stopping( false )
+{
+}
+
+
+ArrayReadQueue::~ArrayReadQueue()
+{
+    {
+        lock_guard<mutex> guard( lock );
+        stopping = true;
+    }
+    workAvailable.notify_all();
+    
+    for( size_t i = 0; i < workers.size(); i++ )
+    {
+        workers[i].join();
+    }
+    
+    for( map<FmlRequestHandle, ArrayReadRequest*>::iterator i = requests.begin(); i != requests.end(); i++ )
+    {
+        delete i->second;
+    }
+}
+
+
+FmlRequestHandle ArrayReadQueue::submit( ArrayDataReader *reader, ArrayDataValueType valueType, const int *offsets, const int *sizes, void *valueBuffer )
+{
+    const int rank = reader->getSlabRank();
+    
+    ArrayReadRequest *request = new ArrayReadRequest();
+    request->reader = reader;
+    request->valueType = valueType;
+    request->offsets.assign( offsets, offsets + rank );
+    request->sizes.assign( sizes, sizes + rank );
+    request->valueBuffer = valueBuffer;
+    request->complete = false;
+    request->result = FML_IOERR_NO_ERROR;
+    
+    FmlRequestHandle handle;
+    bool synchronous;
+    {
+        lock_guard<mutex> guard( lock );
+        
+        //Workers are only started once they're needed, so applications that never read asynchronously pay nothing.
+        if( workers.empty() )
+        {
+            int threadCount = (int)thread::hardware_concurrency();
+            if( threadCount > MAX_WORKER_THREADS )
+            {
+                threadCount = MAX_WORKER_THREADS;
+            }
+            if( threadCount < 1 )
+            {
+                threadCount = 1;
+            }
+            for( int i = 0; i < threadCount; i++ )
+            {
+                try
+                {
+                    workers.push_back( thread( &ArrayReadQueue::work, this ) );
+                }
+                catch( const system_error & )
+                {
+                    //Make do with however many started.
+                    break;
+                }
+            }
+        }
+        
+        synchronous = workers.empty();
+        if( !synchronous )
+        {
+            handle = nextHandle++;
+            requests[handle] = request;
+            pending.push_back( request );
+        }
+    }
+    
+    if( !synchronous )
+    {
+        workAvailable.notify_one();
+        return handle;
+    }
+    
+    //No threads to be had, so the read is done now, and the request handed back already complete.
+    request->result = reader->lockedReadSlab( valueType, &request->offsets[0], &request->sizes[0], valueBuffer );
+    request->complete = true;
+    
+    lock_guard<mutex> guard( lock );
+    handle = nextHandle++;
+    requests[handle] = request;
+    
+    return handle;
+}
+
+
+ArrayReadRequest *ArrayReadQueue::takeRequest()
+{
+    //The oldest request whose reader isn't already busy. Any others for the same reader have to wait their turn.
+    for( deque<ArrayReadRequest*>::iterator i = pending.begin(); i != pending.end(); i++ )
+    {
+        if( busyReaders.count( ( *i )->reader ) == 0 )
+        {
+            ArrayReadRequest *request = *i;
+            pending.erase( i );
+            busyReaders.insert( request->reader );
+            return request;
+        }
+    }
+    
+    return NULL;
+}
+
+
+void ArrayReadQueue::work()
+{
+    unique_lock<mutex> guard( lock );
+    
+    while( true )
+    {
+        ArrayReadRequest *request = takeRequest();
+        if( request == NULL )
+        {
+            if( stopping )
+            {
+                return;
+            }
+            workAvailable.wait( guard );
+            continue;
+        }
+        
+        guard.unlock();
+        FmlIoErrorNumber result = request->reader->lockedReadSlab( request->valueType, &request->offsets[0], &request->sizes[0],
+            request->valueBuffer );
+        guard.lock();
+        
+        request->result = result;
+        request->complete = true;
+        busyReaders.erase( request->reader );
+        
+        //Finishing a request may free up another one for the same reader.
+        workAvailable.notify_all();
+        workDone.notify_all();
+    }
+}
+
+
+bool ArrayReadQueue::wait( FmlRequestHandle handle, FmlIoErrorNumber &result )
+{
+    unique_lock<mutex> guard( lock );
+    
+    map<FmlRequestHandle, ArrayReadRequest*>::iterator i = requests.find( handle );
+    if( i == requests.end() )
+    {
+        return false;
+    }
+    
+    ArrayReadRequest *request = i->second;
+    while( !request->complete )
+    {
+        workDone.wait( guard );
+    }
+    
+    result = request->result;
+    requests.erase( handle );
+    delete request;
+    
+    return true;
+}
+
+
+bool ArrayReadQueue::test( FmlRequestHandle handle, bool &complete )
+{
+    lock_guard<mutex> guard( lock );
+    
+    map<FmlRequestHandle, ArrayReadRequest*>::iterator i = requests.find( handle );
+    if( i == requests.end() )
+    {
+        return false;
+    }
+    
+    complete = i->second->complete;
+    return true;
+}
+
+
+bool ArrayReadQueue::isReaderIdle( ArrayDataReader *reader )
+{
+    if( busyReaders.count( reader ) != 0 )
+    {
+        return false;
+    }
+    
+    for( deque<ArrayReadRequest*>::iterator i = pending.begin(); i != pending.end(); i++ )
+    {
+        if( ( *i )->reader == reader )
+        {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+
+void ArrayReadQueue::waitForReader( ArrayDataReader *reader )
+{
+    unique_lock<mutex> guard( lock );
+    
+    while( !isReaderIdle( reader ) )
+    {
+        workDone.wait( guard );
+    }
+}
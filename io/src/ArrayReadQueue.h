@@ -0,0 +1,144 @@
+/* \file
+ * $Id$
+ * \author Caton Little
+ * \brief 
+ *
+ * \section LICENSE
+ *
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is FieldML
+ *
+ * The Initial Developer of the Original Code is Auckland Uniservices Ltd,
+ * Auckland, New Zealand. Portions created by the Initial Developer are
+ * Copyright (C) 2010 the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either the GNU General Public License Version 2 or later (the "GPL"), or
+ * the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ */
+
+#ifndef H_ARRAY_READ_QUEUE
+#define H_ARRAY_READ_QUEUE
+
+#include <vector>
+#include <deque>
+#include <map>
+#include <set>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+#include "FieldmlIoApi.h"
+#include "ArrayDataReader.h"
+#include "ArrayDataCache.h"
+
+/**
+ * An asynchronous slab read. The offsets and sizes are copied, but the value buffer is the caller's.
+ */
+class ArrayReadRequest
+{
+public:
+    ArrayDataReader *reader;
+    
+    ArrayDataValueType valueType;
+    
+    std::vector<int> offsets;
+    
+    std::vector<int> sizes;
+    
+    void *valueBuffer;
+    
+    bool complete;
+    
+    FmlIoErrorNumber result;
+};
+
+
+/**
+ * Services asynchronous slab reads on a pool of I/O worker threads, shared by all sessions. A reader's requests are
+ * run one at a time, in the order they were made, but requests for different readers run side by side wherever the
+ * readers allow it.
+ */
+class ArrayReadQueue
+{
+private:
+    std::mutex lock;
+    
+    std::condition_variable workAvailable;
+    
+    std::condition_variable workDone;
+    
+    //Requests that haven't been started yet, oldest first.
+    std::deque<ArrayReadRequest*> pending;
+    
+    //Every request that hasn't been waited on yet, whether or not it's complete.
+    std::map<FmlRequestHandle, ArrayReadRequest*> requests;
+    
+    //Readers with a request in progress.
+    std::set<ArrayDataReader*> busyReaders;
+    
+    std::vector<std::thread> workers;
+    
+    FmlRequestHandle nextHandle;
+    
+    bool stopping;
+    
+    ArrayReadQueue();
+    
+    void work();
+    
+    ArrayReadRequest *takeRequest();
+    
+    bool isReaderIdle( ArrayDataReader *reader );
+    
+public:
+    virtual ~ArrayReadQueue();
+    
+    /**
+     * Queues a read of the given slab, returning the request's handle.
+     */
+    FmlRequestHandle submit( ArrayDataReader *reader, ArrayDataValueType valueType, const int *offsets, const int *sizes, void *valueBuffer );
+    
+    /**
+     * Waits for the given request to complete, and releases it. Returns false if there is no such request.
+     */
+    bool wait( FmlRequestHandle handle, FmlIoErrorNumber &result );
+    
+    /**
+     * Checks whether the given request has completed, without waiting or releasing it. Returns false if there is no
+     * such request.
+     */
+    bool test( FmlRequestHandle handle, bool &complete );
+    
+    /**
+     * Waits until none of the given reader's requests are pending or in progress, so that it can be closed. Completed
+     * requests can still be waited on afterwards.
+     */
+    void waitForReader( ArrayDataReader *reader );
+    
+    static ArrayReadQueue &getQueue();
+};
+
+#endif //H_ARRAY_READ_QUEUE
@@ -0,0 +1,327 @@
+/* \file
+ * $Id$
+ * \author Caton Little
+ * \brief 
+ *
+ * \section LICENSE
+ *
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is FieldML
+ *
+ * The Initial Developer of the Original Code is Auckland Uniservices Ltd,
+ * Auckland, New Zealand. Portions created by the Initial Developer are
+ * Copyright (C) 2010 the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either the GNU General Public License Version 2 or later (the "GPL"), or
+ * the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ */
+
+#include <sstream>
+#include <cstring>
+
+#include "StringUtil.h"
+#include "FieldmlIoApi.h"
+
+#include "Base64ArrayDataReader.h"
+
+using namespace std;
+
+Base64ArrayDataReader *Base64ArrayDataReader::create( FieldmlIoContext *context, FmlObjectHandle source, void *buffer, int64_t bufferLength )
+{
+    FmlObjectHandle resource = Fieldml_GetDataSourceResource( context->getSession(), source );
+    FieldmlDataResourceType type = Fieldml_GetDataResourceType( context->getSession(), resource );
+    
+    int rank = Fieldml_GetArrayDataSourceRank( context->getSession(), source );
+    if( rank <= 0 )
+    {
+        context->setError( FML_IOERR_CORE_ERROR );
+        return NULL;
+    }
+    
+    string typeName;
+    char *temp_string = Fieldml_GetDataResourceDataType( context->getSession(), resource );
+    if( !StringUtil::safeString( temp_string, typeName ) )
+    {
+        context->setError( FML_IOERR_CORE_ERROR );
+        return NULL;
+    }
+    Fieldml_FreeString(temp_string);
+    
+    BinaryData::ValueType valueType = typeName.empty() ? BinaryData::VALUE_FLOAT64 : BinaryData::parseType( typeName );
+    if( valueType == BinaryData::VALUE_UNKNOWN )
+    {
+        context->setError( FML_IOERR_UNSUPPORTED );
+        return NULL;
+    }
+    
+    Base64ArrayDataReader *reader = new Base64ArrayDataReader( context, source, rank, valueType );
+    
+    bool decoded = false;
+    if( buffer != NULL )
+    {
+        const char *data = (const char *)buffer;
+        decoded = BinaryData::decodeBase64( data, ( bufferLength >= 0 ) ? bufferLength : strlen( data ), reader->bytes );
+    }
+    else if( type == FML_DATA_RESOURCE_INLINE )
+    {
+        int length;
+        const char *view = Fieldml_OpenInlineDataView( context->getSession(), resource, &length );
+        if( view == NULL )
+        {
+            context->setError( FML_IOERR_CORE_ERROR );
+            delete reader;
+            return NULL;
+        }
+        decoded = BinaryData::decodeBase64( view, length, reader->bytes );
+        Fieldml_CloseInlineDataView( context->getSession(), resource, view );
+    }
+    else
+    {
+        //Binary data is better kept in a binary file than in a base64 one.
+        context->setError( FML_IOERR_UNSUPPORTED );
+        delete reader;
+        return NULL;
+    }
+    
+    if( !decoded )
+    {
+        context->setError( FML_IOERR_READ_ERROR );
+        delete reader;
+        return NULL;
+    }
+    
+    return reader;
+}
+
+
+Base64ArrayDataReader::Base64ArrayDataReader( FieldmlIoContext *_context, FmlObjectHandle _source, int rank, BinaryData::ValueType _valueType ) :
+    ArrayDataReader( _context ),
+    closed( false ),
+    source( _source ),
+    sourceRank( rank ),
+    valueType( _valueType ),
+    valueSize( BinaryData::typeSize( _valueType ) ),
+    firstValue( -1 )
+{
+    sourceSizes = new int[sourceRank];
+    sourceRawSizes = new int[sourceRank];
+    sourceOffsets = new int[sourceRank];
+    
+    Fieldml_GetArrayDataSourceSizes( context->getSession(), source, sourceSizes );
+    Fieldml_GetArrayDataSourceRawSizes( context->getSession(), source, sourceRawSizes );
+    Fieldml_GetArrayDataSourceOffsets( context->getSession(), source, sourceOffsets );
+    
+    sourceRawStrides = new long[sourceRank];
+    sourceRawStrides[sourceRank - 1] = 1;
+    for( int i = sourceRank - 2; i >= 0; i-- )
+    {
+        sourceRawStrides[i] = sourceRawStrides[i + 1] * sourceRawSizes[i + 1];
+    }
+    
+    string location;
+    char *temp_string = Fieldml_GetArrayDataSourceLocation( context->getSession(), source );
+    StringUtil::safeString( temp_string, location );
+    Fieldml_FreeString(temp_string);
+    
+    std::istringstream sstr( location );
+    long valueNumber;
+    if( location.empty() )
+    {
+        firstValue = 0;
+    }
+    else if( ( sstr >> valueNumber ) && ( valueNumber >= 1 ) )
+    {
+        firstValue = valueNumber - 1;
+    }
+}
+
+
+bool Base64ArrayDataReader::checkDimensions( const int *offsets, const int *sizes )
+{
+    for( int i = 0; i < sourceRank; i++ )
+    {
+        if( offsets[i] < 0 )
+        {
+            return false;
+        }
+        if( sizes[i] <= 0 )
+        {
+            return false;
+        }
+        
+        int rawSize = sourceSizes[i];
+        if( rawSize == 0 )
+        {
+            //NOTE: Intentional. If the array-source size has not been set, use the underlying size.
+            rawSize = sourceRawSizes[i] - sourceOffsets[i];
+        }
+        if( offsets[i] + sizes[i] > rawSize )
+        {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+
+template <class T> FmlIoErrorNumber Base64ArrayDataReader::readSlab( const int *offsets, const int *sizes, T *valueBuffer )
+{
+    if( closed )
+    {
+        return FML_IOERR_RESOURCE_CLOSED;
+    }
+    
+    if( firstValue < 0 )
+    {
+        return context->setError( FML_IOERR_INVALID_LOCATION );
+    }
+    
+    if( !checkDimensions( offsets, sizes ) )
+    {
+        return context->setError( FML_IOERR_INVALID_PARAMETER );
+    }
+    
+    //The last value of the slab is the furthest into the data, so checking it covers the whole slab.
+    long lastValue = firstValue;
+    for( int i = 0; i < sourceRank; i++ )
+    {
+        lastValue += ( sourceOffsets[i] + offsets[i] + sizes[i] - 1 ) * sourceRawStrides[i];
+    }
+    if( ( lastValue + 1 ) * valueSize > (long)bytes.size() )
+    {
+        return context->setError( FML_IOERR_UNEXPECTED_EOF );
+    }
+    
+    const int innermost = sourceRank - 1;
+    const int runLength = sizes[innermost];
+    
+    int *index = new int[sourceRank];
+    for( int i = 0; i < sourceRank; i++ )
+    {
+        index[i] = 0;
+    }
+    
+    while( true )
+    {
+        long runStart = firstValue;
+        for( int i = 0; i < sourceRank; i++ )
+        {
+            runStart += ( sourceOffsets[i] + offsets[i] + index[i] ) * sourceRawStrides[i];
+        }
+        
+        const unsigned char *run = &bytes[runStart * valueSize];
+        for( int i = 0; i < runLength; i++ )
+        {
+            valueBuffer[i] = BinaryData::decodeValue<T>( run + ( i * valueSize ), valueType );
+        }
+        valueBuffer += runLength;
+        
+        int depth = innermost - 1;
+        while( depth >= 0 )
+        {
+            index[depth]++;
+            if( index[depth] < sizes[depth] )
+            {
+                break;
+            }
+            index[depth] = 0;
+            depth--;
+        }
+        if( depth < 0 )
+        {
+            break;
+        }
+    }
+    
+    delete[] index;
+    
+    return FML_IOERR_NO_ERROR;
+}
+
+
+FmlIoErrorNumber Base64ArrayDataReader::readIntSlab( const int *offsets, const int *sizes, int *valueBuffer )
+{
+    return readSlab( offsets, sizes, valueBuffer );
+}
+
+
+FmlIoErrorNumber Base64ArrayDataReader::readDoubleSlab( const int *offsets, const int *sizes, double *valueBuffer )
+{
+    return readSlab( offsets, sizes, valueBuffer );
+}
+
+
+FmlIoErrorNumber Base64ArrayDataReader::readBooleanSlab( const int *offsets, const int *sizes, FmlBoolean *valueBuffer )
+{
+    FmlIoErrorNumber err = readSlab( offsets, sizes, valueBuffer );
+    if( err != FML_IOERR_NO_ERROR )
+    {
+        return err;
+    }
+    
+    long count = 1;
+    for( int i = 0; i < sourceRank; i++ )
+    {
+        count *= sizes[i];
+    }
+    for( long i = 0; i < count; i++ )
+    {
+        valueBuffer[i] = ( valueBuffer[i] != 0 ) ? 1 : 0;
+    }
+    
+    return FML_IOERR_NO_ERROR;
+}
+
+
+bool Base64ArrayDataReader::isConcurrent()
+{
+    //The decoded values belong to the reader alone.
+    return true;
+}
+
+
+FmlIoErrorNumber Base64ArrayDataReader::close()
+{
+    if( closed )
+    {
+        return FML_IOERR_NO_ERROR;
+    }
+    
+    closed = true;
+    bytes.clear();
+    
+    return FML_IOERR_NO_ERROR;
+}
+
+
+Base64ArrayDataReader::~Base64ArrayDataReader()
+{
+    delete[] sourceSizes;
+    delete[] sourceRawSizes;
+    delete[] sourceOffsets;
+    delete[] sourceRawStrides;
+}
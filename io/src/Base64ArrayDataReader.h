@@ -0,0 +1,108 @@
+/* \file
+ * $Id$
+ * \author Caton Little
+ * \brief 
+ *
+ * \section LICENSE
+ *
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is FieldML
+ *
+ * The Initial Developer of the Original Code is Auckland Uniservices Ltd,
+ * Auckland, New Zealand. Portions created by the Initial Developer are
+ * Copyright (C) 2010 the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either the GNU General Public License Version 2 or later (the "GPL"), or
+ * the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ */
+
+#ifndef H_BASE64_ARRAY_DATA_READER
+#define H_BASE64_ARRAY_DATA_READER
+
+#include <string>
+#include <vector>
+
+#include "FieldmlIoContext.h"
+#include "ArrayDataReader.h"
+#include "BinaryData.h"
+
+/**
+ * Reads arrays of little-endian binary values that have been base64 encoded, usually as the character data of an
+ * inline data resource. The resource's dtype gives the values' storage type, and defaults to float64. The data
+ * source's location is the 1-based index of the array's first value among the resource's values.
+ */
+class Base64ArrayDataReader :
+    public ArrayDataReader
+{
+private:
+    bool closed;
+    
+    const FmlObjectHandle source;
+
+    int sourceRank;
+    
+    int *sourceSizes;
+    
+    int *sourceRawSizes;
+    
+    int *sourceOffsets;
+    
+    //The number of raw values spanned by a unit step in each dimension.
+    long *sourceRawStrides;
+    
+    const BinaryData::ValueType valueType;
+    
+    const int valueSize;
+    
+    //All of the resource's values, decoded up front. Unlike text, binary values can then be read in any order.
+    std::vector<unsigned char> bytes;
+    
+    long firstValue;
+    
+    Base64ArrayDataReader( FieldmlIoContext *_context, FmlObjectHandle _source, int _sourceRank, BinaryData::ValueType _valueType );
+    
+    bool checkDimensions( const int *offsets, const int *sizes );
+    
+    template <class T> FmlIoErrorNumber readSlab( const int *offsets, const int *sizes, T *valueBuffer );
+
+public:
+    virtual FmlIoErrorNumber readIntSlab( const int *offsets, const int *sizes, int *valueBuffer );
+    
+    virtual FmlIoErrorNumber readDoubleSlab( const int *offsets, const int *sizes, double *valueBuffer );
+    
+    virtual FmlIoErrorNumber readBooleanSlab( const int *offsets, const int *sizes, FmlBoolean *valueBuffer );
+
+    virtual FmlIoErrorNumber close();
+    
+    virtual bool isConcurrent();
+    
+    virtual ~Base64ArrayDataReader();
+    
+    static Base64ArrayDataReader *create( FieldmlIoContext *_context, FmlObjectHandle source, void *buffer, int64_t bufferLength );
+};
+
+
+#endif //H_BASE64_ARRAY_DATA_READER
@@ -0,0 +1,275 @@
+/* \file
+ * $Id$
+ * \author Caton Little
+ * \brief 
+ *
+ * \section LICENSE
+ *
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is FieldML
+ *
+ * The Initial Developer of the Original Code is Auckland Uniservices Ltd,
+ * Auckland, New Zealand. Portions created by the Initial Developer are
+ * Copyright (C) 2010 the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either the GNU General Public License Version 2 or later (the "GPL"), or
+ * the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ */
+
+#include "StringUtil.h"
+#include "FieldmlIoApi.h"
+
+#include "Base64ArrayDataWriter.h"
+
+using namespace std;
+
+//Encoded text is handed to the data resource in chunks of about this size, rather than all at once on close.
+static const size_t TEXT_FLUSH_SIZE = 1024 * 1024;
+
+//Values are converted to their storage type in batches of this many.
+static const int CONVERT_BATCH_VALUES = 4096;
+
+
+Base64ArrayDataWriter *Base64ArrayDataWriter::create( FieldmlIoContext *context, FmlObjectHandle source, FieldmlHandleType handleType, bool append )
+{
+    FmlObjectHandle resource = Fieldml_GetDataSourceResource( context->getSession(), source );
+    if( Fieldml_GetDataResourceType( context->getSession(), resource ) != FML_DATA_RESOURCE_INLINE )
+    {
+        context->setError( FML_IOERR_UNSUPPORTED );
+        return NULL;
+    }
+    
+    string typeName;
+    char *temp_string = Fieldml_GetDataResourceDataType( context->getSession(), resource );
+    if( !StringUtil::safeString( temp_string, typeName ) )
+    {
+        context->setError( FML_IOERR_CORE_ERROR );
+        return NULL;
+    }
+    Fieldml_FreeString(temp_string);
+    
+    BinaryData::ValueType valueType;
+    if( !typeName.empty() )
+    {
+        valueType = BinaryData::parseType( typeName );
+    }
+    else if( append )
+    {
+        //Existing data without a dtype can only have been read as the default.
+        valueType = BinaryData::VALUE_FLOAT64;
+    }
+    else
+    {
+        if( handleType == FHT_ENSEMBLE_TYPE )
+        {
+            valueType = BinaryData::VALUE_INT32;
+        }
+        else if( handleType == FHT_BOOLEAN_TYPE )
+        {
+            valueType = BinaryData::VALUE_INT8;
+        }
+        else
+        {
+            valueType = BinaryData::VALUE_FLOAT64;
+        }
+        
+        if( Fieldml_SetDataResourceDataType( context->getSession(), resource, BinaryData::typeName( valueType ) ) != FML_ERR_NO_ERROR )
+        {
+            context->setError( FML_IOERR_CORE_ERROR );
+            return NULL;
+        }
+    }
+    
+    if( valueType == BinaryData::VALUE_UNKNOWN )
+    {
+        context->setError( FML_IOERR_UNSUPPORTED );
+        return NULL;
+    }
+    
+    Base64ArrayDataWriter *writer = new Base64ArrayDataWriter( context, source, valueType, append );
+    if( writer->sourceRank <= 0 )
+    {
+        context->setError( FML_IOERR_CORE_ERROR );
+        delete writer;
+        return NULL;
+    }
+    
+    return writer;
+}
+
+
+Base64ArrayDataWriter::Base64ArrayDataWriter( FieldmlIoContext *_context, FmlObjectHandle _source, BinaryData::ValueType _valueType, bool _append ) :
+    ArrayDataWriter( _context ),
+    closed( false ),
+    source( _source ),
+    append( _append ),
+    started( false ),
+    sourceSizes( NULL ),
+    offset( 0 ),
+    valueType( _valueType )
+{
+    sourceRank = Fieldml_GetArrayDataSourceRank( context->getSession(), source );
+    if( sourceRank <= 0 )
+    {
+        return;
+    }
+    
+    sourceSizes = new int[sourceRank];
+    Fieldml_GetArrayDataSourceSizes( context->getSession(), source, sourceSizes );
+    
+    bytes.resize( CONVERT_BATCH_VALUES * BinaryData::typeSize( valueType ) );
+}
+
+
+FmlIoErrorNumber Base64ArrayDataWriter::store()
+{
+    FmlObjectHandle resource = Fieldml_GetDataSourceResource( context->getSession(), source );
+    
+    FmlErrorNumber err;
+    if( append || started )
+    {
+        err = Fieldml_AddInlineData( context->getSession(), resource, text.c_str(), text.size() );
+    }
+    else
+    {
+        err = Fieldml_SetInlineData( context->getSession(), resource, text.c_str(), text.size() );
+    }
+    started = true;
+    text.clear();
+    
+    if( err != FML_ERR_NO_ERROR )
+    {
+        return context->setError( FML_IOERR_CORE_ERROR );
+    }
+    
+    return FML_IOERR_NO_ERROR;
+}
+
+
+template <class T> FmlIoErrorNumber Base64ArrayDataWriter::writeSlab( const int *offsets, const int *sizes, const T *valueBuffer )
+{
+    if( closed )
+    {
+        return FML_IOERR_RESOURCE_CLOSED;
+    }
+    
+    if( offsets[0] != offset )
+    {
+        return context->setError( FML_IOERR_UNSUPPORTED );
+    }
+    
+    for( int i = 1; i < sourceRank; i++ )
+    {
+        if( offsets[i] != 0 )
+        {
+            return context->setError( FML_IOERR_UNSUPPORTED );
+        }
+        
+        if( sizes[i] != sourceSizes[i] )
+        {
+            return context->setError( FML_IOERR_UNSUPPORTED );
+        }
+    }
+    
+    //Only whole outermost rows can be written, so the slab is one contiguous run of values.
+    long count = 1;
+    for( int i = 0; i < sourceRank; i++ )
+    {
+        count *= sizes[i];
+    }
+    
+    const int valueSize = BinaryData::typeSize( valueType );
+    for( long start = 0; start < count; start += CONVERT_BATCH_VALUES )
+    {
+        int batch = CONVERT_BATCH_VALUES;
+        if( start + batch > count )
+        {
+            batch = (int)( count - start );
+        }
+        
+        for( int i = 0; i < batch; i++ )
+        {
+            BinaryData::encodeValue( valueBuffer[start + i], valueType, &bytes[i * valueSize] );
+        }
+        encoder.append( &bytes[0], (long)batch * valueSize, text );
+        
+        if( text.size() >= TEXT_FLUSH_SIZE )
+        {
+            FmlIoErrorNumber err = store();
+            if( err != FML_IOERR_NO_ERROR )
+            {
+                return err;
+            }
+        }
+    }
+    
+    offset += sizes[0];
+    
+    return FML_IOERR_NO_ERROR;
+}
+
+
+FmlIoErrorNumber Base64ArrayDataWriter::writeIntSlab( const int *offsets, const int *sizes, const int *valueBuffer )
+{
+    return writeSlab( offsets, sizes, valueBuffer );
+}
+
+
+FmlIoErrorNumber Base64ArrayDataWriter::writeDoubleSlab( const int *offsets, const int *sizes, const double *valueBuffer )
+{
+    return writeSlab( offsets, sizes, valueBuffer );
+}
+
+
+FmlIoErrorNumber Base64ArrayDataWriter::writeBooleanSlab( const int *offsets, const int *sizes, const FmlBoolean *valueBuffer )
+{
+    return writeSlab( offsets, sizes, valueBuffer );
+}
+
+
+FmlIoErrorNumber Base64ArrayDataWriter::close()
+{
+    if( closed )
+    {
+        return FML_IOERR_NO_ERROR;
+    }
+    
+    closed = true;
+    
+    encoder.finish( text );
+    if( started && text.empty() )
+    {
+        return FML_IOERR_NO_ERROR;
+    }
+    
+    return store();
+}
+
+
+Base64ArrayDataWriter::~Base64ArrayDataWriter()
+{
+    delete[] sourceSizes;
+}
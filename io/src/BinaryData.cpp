@@ -0,0 +1,352 @@
+/* \file
+ * $Id$
+ * \author Caton Little
+ * \brief 
+ *
+ * \section LICENSE
+ *
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is FieldML
+ *
+ * The Initial Developer of the Original Code is Auckland Uniservices Ltd,
+ * Auckland, New Zealand. Portions created by the Initial Developer are
+ * Copyright (C) 2010 the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either the GNU General Public License Version 2 or later (the "GPL"), or
+ * the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ */
+
+#include "BinaryData.h"
+
+using namespace std;
+
+//Each 76 character line of base64 holds 57 bytes.
+static const int BASE64_LINE_BYTES = 57;
+
+static const char BASE64_DIGITS[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static const int BASE64_PADDING = -2;
+
+static const int BASE64_SPACE = -3;
+
+static const int BASE64_INVALID = -1;
+
+static const char RAW_MAGIC[] = "FMLRAW";
+
+static const unsigned char RAW_VERSION = 1;
+
+namespace BinaryData
+{
+    ValueType parseType( const string &name )
+    {
+        if( name == "float64" )
+        {
+            return VALUE_FLOAT64;
+        }
+        else if( name == "float32" )
+        {
+            return VALUE_FLOAT32;
+        }
+        else if( name == "int32" )
+        {
+            return VALUE_INT32;
+        }
+        else if( name == "int8" )
+        {
+            return VALUE_INT8;
+        }
+
+        return VALUE_UNKNOWN;
+    }
+
+
+    const char *typeName( ValueType type )
+    {
+        switch( type )
+        {
+        case VALUE_FLOAT64:
+            return "float64";
+        case VALUE_FLOAT32:
+            return "float32";
+        case VALUE_INT32:
+            return "int32";
+        case VALUE_INT8:
+            return "int8";
+        default:
+            return "";
+        }
+    }
+
+
+    int typeSize( ValueType type )
+    {
+        switch( type )
+        {
+        case VALUE_FLOAT64:
+            return 8;
+        case VALUE_FLOAT32:
+        case VALUE_INT32:
+            return 4;
+        case VALUE_INT8:
+            return 1;
+        default:
+            return 0;
+        }
+    }
+
+
+    bool isLittleEndian()
+    {
+        const uint16_t probe = 1;
+        return *(const unsigned char*)&probe == 1;
+    }
+
+
+    static int base64Digit( char c )
+    {
+        if( ( c >= 'A' ) && ( c <= 'Z' ) )
+        {
+            return c - 'A';
+        }
+        if( ( c >= 'a' ) && ( c <= 'z' ) )
+        {
+            return c - 'a' + 26;
+        }
+        if( ( c >= '0' ) && ( c <= '9' ) )
+        {
+            return c - '0' + 52;
+        }
+        if( c == '+' )
+        {
+            return 62;
+        }
+        if( c == '/' )
+        {
+            return 63;
+        }
+        if( c == '=' )
+        {
+            return BASE64_PADDING;
+        }
+        if( ( c == ' ' ) || ( c == '\t' ) || ( c == '\r' ) || ( c == '\n' ) )
+        {
+            return BASE64_SPACE;
+        }
+
+        return BASE64_INVALID;
+    }
+
+
+    bool decodeBase64( const char *text, long length, vector<unsigned char> &bytes )
+    {
+        bytes.reserve( bytes.size() + ( length / 4 ) * 3 );
+
+        unsigned int quantum = 0;
+        int digits = 0;
+        for( long i = 0; i < length; i++ )
+        {
+            int digit = base64Digit( text[i] );
+            if( digit >= 0 )
+            {
+                quantum = ( quantum << 6 ) | digit;
+                digits++;
+                if( digits == 4 )
+                {
+                    bytes.push_back( (unsigned char)( quantum >> 16 ) );
+                    bytes.push_back( (unsigned char)( quantum >> 8 ) );
+                    bytes.push_back( (unsigned char)quantum );
+                    quantum = 0;
+                    digits = 0;
+                }
+            }
+            else if( digit == BASE64_PADDING )
+            {
+                //Padding ends a partial quantum. Any further padding characters are then ignored.
+                if( digits == 2 )
+                {
+                    bytes.push_back( (unsigned char)( quantum >> 4 ) );
+                }
+                else if( digits == 3 )
+                {
+                    bytes.push_back( (unsigned char)( quantum >> 10 ) );
+                    bytes.push_back( (unsigned char)( quantum >> 2 ) );
+                }
+                else if( digits == 1 )
+                {
+                    return false;
+                }
+                quantum = 0;
+                digits = 0;
+            }
+            else if( digit == BASE64_INVALID )
+            {
+                return false;
+            }
+        }
+
+        //Unpadded trailing digits are a truncated encoding.
+        return digits == 0;
+    }
+
+
+    static uint64_t readUnsigned( const unsigned char *bytes, int size, bool littleEndianData )
+    {
+        uint64_t value = 0;
+        for( int i = 0; i < size; i++ )
+        {
+            value = ( value << 8 ) | bytes[littleEndianData ? ( size - 1 - i ) : i];
+        }
+        
+        return value;
+    }
+
+
+    static void writeUnsigned( uint64_t value, int size, unsigned char *bytes )
+    {
+        for( int i = 0; i < size; i++ )
+        {
+            bytes[isLittleEndian() ? i : ( size - 1 - i )] = (unsigned char)( value >> ( 8 * i ) );
+        }
+    }
+
+
+    bool readRawHeader( const unsigned char *data, int64_t length, ValueType &type, bool &littleEndian,
+        vector<int64_t> &dims, int64_t &dataStart )
+    {
+        if( ( length < RAW_HEADER_FIXED_SIZE ) || ( memcmp( data, RAW_MAGIC, 6 ) != 0 ) || ( data[6] != RAW_VERSION ) || ( data[7] > 1 ) )
+        {
+            return false;
+        }
+        
+        littleEndian = ( data[7] == 0 );
+        type = (ValueType)data[8];
+        if( typeSize( type ) == 0 )
+        {
+            return false;
+        }
+        
+        uint64_t rank = readUnsigned( data + 12, 4, littleEndian );
+        if( ( rank == 0 ) || ( (int64_t)( RAW_HEADER_FIXED_SIZE + ( rank * 8 ) ) > length ) )
+        {
+            return false;
+        }
+        
+        dims.clear();
+        int64_t count = 1;
+        for( uint64_t i = 0; i < rank; i++ )
+        {
+            //Every factor is checked before it's multiplied in, as the header can't be trusted not to overflow.
+            const int64_t dim = (int64_t)readUnsigned( data + RAW_HEADER_FIXED_SIZE + ( i * 8 ), 8, littleEndian );
+            if( ( dim <= 0 ) || ( dim > INT64_MAX / count ) )
+            {
+                return false;
+            }
+            dims.push_back( dim );
+            count *= dim;
+        }
+        
+        dataStart = RAW_HEADER_FIXED_SIZE + ( rank * 8 );
+        
+        return count <= ( length - dataStart ) / typeSize( type );
+    }
+
+
+    void writeRawHeader( ValueType type, const vector<int64_t> &dims, vector<unsigned char> &header )
+    {
+        header.assign( RAW_HEADER_FIXED_SIZE + ( dims.size() * 8 ), 0 );
+        memcpy( &header[0], RAW_MAGIC, 6 );
+        header[6] = RAW_VERSION;
+        header[7] = isLittleEndian() ? 0 : 1;
+        header[8] = (unsigned char)type;
+        writeUnsigned( dims.size(), 4, &header[12] );
+        for( size_t i = 0; i < dims.size(); i++ )
+        {
+            writeUnsigned( dims[i], 8, &header[RAW_HEADER_FIXED_SIZE + ( i * 8 )] );
+        }
+    }
+
+
+    void Base64Encoder::encodeLine( const unsigned char *bytes, int count, string &text )
+    {
+        for( int i = 0; i < count; i += 3 )
+        {
+            unsigned int quantum = bytes[i] << 16;
+            if( i + 1 < count )
+            {
+                quantum |= bytes[i + 1] << 8;
+            }
+            if( i + 2 < count )
+            {
+                quantum |= bytes[i + 2];
+            }
+
+            text.push_back( BASE64_DIGITS[( quantum >> 18 ) & 0x3f] );
+            text.push_back( BASE64_DIGITS[( quantum >> 12 ) & 0x3f] );
+            text.push_back( ( i + 1 < count ) ? BASE64_DIGITS[( quantum >> 6 ) & 0x3f] : '=' );
+            text.push_back( ( i + 2 < count ) ? BASE64_DIGITS[quantum & 0x3f] : '=' );
+        }
+        text.push_back( '\n' );
+    }
+
+
+    void Base64Encoder::append( const unsigned char *bytes, long count, string &text )
+    {
+        long used = 0;
+        if( !pending.empty() )
+        {
+            used = BASE64_LINE_BYTES - (long)pending.size();
+            if( used > count )
+            {
+                used = count;
+            }
+            pending.insert( pending.end(), bytes, bytes + used );
+            if( pending.size() < (size_t)BASE64_LINE_BYTES )
+            {
+                return;
+            }
+            encodeLine( &pending[0], BASE64_LINE_BYTES, text );
+            pending.clear();
+        }
+
+        while( count - used >= BASE64_LINE_BYTES )
+        {
+            encodeLine( bytes + used, BASE64_LINE_BYTES, text );
+            used += BASE64_LINE_BYTES;
+        }
+
+        pending.insert( pending.end(), bytes + used, bytes + count );
+    }
+
+
+    void Base64Encoder::finish( string &text )
+    {
+        if( !pending.empty() )
+        {
+            encodeLine( &pending[0], (int)pending.size(), text );
+            pending.clear();
+        }
+    }
+}
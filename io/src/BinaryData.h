@@ -0,0 +1,192 @@
+/* \file
+ * $Id$
+ * \author Caton Little
+ * \brief 
+ *
+ * \section LICENSE
+ *
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is FieldML
+ *
+ * The Initial Developer of the Original Code is Auckland Uniservices Ltd,
+ * Auckland, New Zealand. Portions created by the Initial Developer are
+ * Copyright (C) 2010 the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either the GNU General Public License Version 2 or later (the "GPL"), or
+ * the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ */
+
+#ifndef H_BINARY_DATA
+#define H_BINARY_DATA
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include <stdint.h>
+
+#include "FieldmlIoApi.h"
+
+/**
+ * Helpers for array formats that store values as binary, rather than as formatted text. Values are always stored
+ * little-endian, whatever the host byte order.
+ */
+namespace BinaryData
+{
+    /**
+     * The storage types that binary values can have, as named by a data resource's dtype.
+     */
+    enum ValueType
+    {
+        VALUE_UNKNOWN = 0,
+        VALUE_FLOAT64 = 1,
+        VALUE_FLOAT32 = 2,
+        VALUE_INT32 = 3,
+        VALUE_INT8 = 4,
+    };
+
+    /**
+     * Returns the storage type with the given name, or VALUE_UNKNOWN if there isn't one.
+     */
+    ValueType parseType( const std::string &name );
+
+    const char *typeName( ValueType type );
+
+    int typeSize( ValueType type );
+
+    bool isLittleEndian();
+
+    /**
+     * Decodes base64 text, ignoring whitespace. Padding may appear part way through the text, so the output of several
+     * separate encodings can simply be concatenated. Returns false if the text contains anything else.
+     */
+    bool decodeBase64( const char *text, long length, std::vector<unsigned char> &bytes );
+
+    /**
+     * Raw binary files start with a fixed header: the magic string "FMLRAW", a version byte, a byte order byte (0 for
+     * little-endian, 1 for big-endian), a value type byte, three reserved bytes, then the rank as 32 bits and each
+     * dimension as 64 bits, in the file's byte order. The values follow, contiguously and outermost index first.
+     */
+    const int RAW_HEADER_FIXED_SIZE = 16;
+
+    /**
+     * Parses a raw binary header, returning false if it is not one. On success, dataStart is the offset of the values.
+     */
+    bool readRawHeader( const unsigned char *data, int64_t length, ValueType &type, bool &littleEndian,
+        std::vector<int64_t> &dims, int64_t &dataStart );
+
+    /**
+     * Builds a raw binary header for values stored in the host's byte order.
+     */
+    void writeRawHeader( ValueType type, const std::vector<int64_t> &dims, std::vector<unsigned char> &header );
+
+
+    template <class T> T decodeValue( const unsigned char *bytes, ValueType type, bool littleEndianData = true )
+    {
+        unsigned char ordered[8];
+        const int size = typeSize( type );
+        const bool swap = ( littleEndianData != isLittleEndian() );
+        for( int i = 0; i < size; i++ )
+        {
+            ordered[i] = swap ? bytes[size - 1 - i] : bytes[i];
+        }
+
+        if( type == VALUE_FLOAT64 )
+        {
+            double value;
+            memcpy( &value, ordered, sizeof( value ) );
+            return (T)value;
+        }
+        else if( type == VALUE_FLOAT32 )
+        {
+            float value;
+            memcpy( &value, ordered, sizeof( value ) );
+            return (T)value;
+        }
+        else if( type == VALUE_INT32 )
+        {
+            int32_t value;
+            memcpy( &value, ordered, sizeof( value ) );
+            return (T)value;
+        }
+
+        return (T)(int8_t)ordered[0];
+    }
+
+
+    template <class T> void encodeValue( T value, ValueType type, unsigned char *bytes )
+    {
+        unsigned char ordered[8];
+        const int size = typeSize( type );
+
+        if( type == VALUE_FLOAT64 )
+        {
+            double stored = (double)value;
+            memcpy( ordered, &stored, sizeof( stored ) );
+        }
+        else if( type == VALUE_FLOAT32 )
+        {
+            float stored = (float)value;
+            memcpy( ordered, &stored, sizeof( stored ) );
+        }
+        else if( type == VALUE_INT32 )
+        {
+            int32_t stored = (int32_t)value;
+            memcpy( ordered, &stored, sizeof( stored ) );
+        }
+        else
+        {
+            ordered[0] = (unsigned char)(int8_t)value;
+        }
+
+        for( int i = 0; i < size; i++ )
+        {
+            bytes[i] = isLittleEndian() ? ordered[i] : ordered[size - 1 - i];
+        }
+    }
+
+
+    /**
+     * Base64-encodes a stream of bytes in 76-character lines, holding back any bytes that don't fill a whole line
+     * until more arrive or the encoder is finished.
+     */
+    class Base64Encoder
+    {
+    private:
+        std::vector<unsigned char> pending;
+
+        void encodeLine( const unsigned char *bytes, int count, std::string &text );
+
+    public:
+        void append( const unsigned char *bytes, long count, std::string &text );
+
+        /**
+         * Encodes any remaining bytes as a final, padded, line.
+         */
+        void finish( std::string &text );
+    };
+}
+
+#endif //H_BINARY_DATA
@@ -0,0 +1,458 @@
+/* \file
+ * $Id$
+ * \author Caton Little
+ * \brief 
+ *
+ * \section LICENSE
+ *
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is FieldML
+ *
+ * The Initial Developer of the Original Code is Auckland Uniservices Ltd,
+ * Auckland, New Zealand. Portions created by the Initial Developer are
+ * Copyright (C) 2010 the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either the GNU General Public License Version 2 or later (the "GPL"), or
+ * the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ */
+
+#include <cstring>
+
+#include "StringUtil.h"
+#include "FieldmlIoApi.h"
+#include "FieldmlIoSession.h"
+
+#include "CachedArrayDataReader.h"
+
+using namespace std;
+
+//The number of values to aim for in each cached block. Rows are never split, so wide arrays get single-row blocks.
+static const int CACHE_BLOCK_VALUES = 16384;
+
+
+ArrayDataReader *CachedArrayDataReader::create( FieldmlIoContext *context, ArrayDataReader *delegate, FmlObjectHandle source )
+{
+    {
+        lock_guard<recursive_mutex> guard( getSharedStateLock() );
+        ArrayDataCache *cache = FieldmlIoSession::getSession().getDataCache( context->getSession(), false );
+        if( ( cache == NULL ) || ( cache->getLimit() <= 0 ) )
+        {
+            return delegate;
+        }
+
+        //Blocks decoded before the resource's inline data last changed can never be hit again, so there's no point
+        //letting them take up room until they're evicted.
+        FmlObjectHandle resource = Fieldml_GetDataSourceResource( context->getSession(), source );
+        cache->invalidateStale( resource, Fieldml_GetDataResourceGeneration( context->getSession(), resource ) );
+    }
+
+    int rank = Fieldml_GetArrayDataSourceRank( context->getSession(), source );
+    if( rank <= 0 )
+    {
+        return delegate;
+    }
+
+    int *rawSizes = new int[rank];
+    int *offsets = new int[rank];
+    int *sizes = new int[rank];
+
+    Fieldml_GetArrayDataSourceRawSizes( context->getSession(), source, rawSizes );
+    Fieldml_GetArrayDataSourceOffsets( context->getSession(), source, offsets );
+    Fieldml_GetArrayDataSourceSizes( context->getSession(), source, sizes );
+
+    bool extentsKnown = true;
+    for( int i = 0; i < rank; i++ )
+    {
+        if( sizes[i] == 0 )
+        {
+            //NOTE: Intentional. If the array-source size has not been set, use the underlying size.
+            sizes[i] = rawSizes[i] - offsets[i];
+        }
+        if( sizes[i] <= 0 )
+        {
+            extentsKnown = false;
+        }
+    }
+
+    if( !extentsKnown )
+    {
+        //Without known extents, blocks can't be laid out. Just use the original reader.
+        delete[] rawSizes;
+        delete[] offsets;
+        delete[] sizes;
+        return delegate;
+    }
+
+    FieldmlIoContext *cacheContext = FieldmlIoSession::getSession().createContext( context->getSession() );
+    CachedArrayDataReader *reader = new CachedArrayDataReader( cacheContext, delegate, source, rank, rawSizes, offsets, sizes );
+    delete[] rawSizes;
+
+    return reader;
+}
+
+
+CachedArrayDataReader::CachedArrayDataReader( FieldmlIoContext *_context, ArrayDataReader *_delegate, FmlObjectHandle source, int _rank,
+    const int *rawSizes, int *_windowOffsets, int *_windowSizes ) :
+    ArrayDataReader( _context ),
+    delegate( _delegate ),
+    rank( _rank ),
+    windowOffsets( _windowOffsets ),
+    windowSizes( _windowSizes ),
+    collective( false )
+{
+    blockKey.resource = Fieldml_GetDataSourceResource( context->getSession(), source );
+    blockKey.generation = Fieldml_GetDataResourceGeneration( context->getSession(), blockKey.resource );
+    char *temp_string = Fieldml_GetArrayDataSourceLocation( context->getSession(), source );
+    StringUtil::safeString( temp_string, blockKey.location );
+    Fieldml_FreeString( temp_string );
+
+    for( int i = 0; i < rank; i++ )
+    {
+        blockKey.shape.push_back( rawSizes[i] );
+    }
+    for( int i = 1; i < rank; i++ )
+    {
+        blockKey.shape.push_back( windowOffsets[i] );
+        blockKey.shape.push_back( windowSizes[i] );
+    }
+
+    rowValues = 1;
+    for( int i = 1; i < rank; i++ )
+    {
+        rowValues *= windowSizes[i];
+    }
+
+    blockRows = CACHE_BLOCK_VALUES / rowValues;
+    if( blockRows < 1 )
+    {
+        blockRows = 1;
+    }
+}
+
+
+bool CachedArrayDataReader::isInWindow( const int *offsets, const int *sizes )
+{
+    for( int i = 0; i < rank; i++ )
+    {
+        if( ( offsets[i] < 0 ) || ( sizes[i] <= 0 ) || ( offsets[i] + sizes[i] > windowSizes[i] ) )
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+FmlIoErrorNumber CachedArrayDataReader::readDelegate( const int *offsets, const int *sizes, ArrayDataValueType valueType, void *valueBuffer )
+{
+    if( valueType == ARRAY_VALUE_INT )
+    {
+        return delegate->readIntSlab( offsets, sizes, (int*)valueBuffer );
+    }
+    else if( valueType == ARRAY_VALUE_DOUBLE )
+    {
+        return delegate->readDoubleSlab( offsets, sizes, (double*)valueBuffer );
+    }
+    else if( valueType == ARRAY_VALUE_FLOAT )
+    {
+        return delegate->readFloatSlab( offsets, sizes, (float*)valueBuffer );
+    }
+
+    return delegate->readBooleanSlab( offsets, sizes, (FmlBoolean*)valueBuffer );
+}
+
+
+void CachedArrayDataReader::copyRows( const char *block, int firstRow, int rowCount, const int *offsets, const int *sizes, int elementSize, char *valueBuffer )
+{
+    if( rank == 1 )
+    {
+        memcpy( valueBuffer, block + ( firstRow * elementSize ), rowCount * elementSize );
+        return;
+    }
+
+    //Walk the inner indexes, copying one contiguous run of the innermost dimension at a time.
+    int *index = new int[rank];
+    int *strides = new int[rank];
+
+    strides[rank - 1] = 1;
+    for( int i = rank - 2; i >= 1; i-- )
+    {
+        strides[i] = strides[i + 1] * windowSizes[i + 1];
+    }
+
+    const int runBytes = sizes[rank - 1] * elementSize;
+    for( int row = 0; row < rowCount; row++ )
+    {
+        const char *rowData = block + ( (long)( firstRow + row ) * rowValues * elementSize );
+        for( int i = 1; i < rank; i++ )
+        {
+            index[i] = 0;
+        }
+
+        while( true )
+        {
+            long valueOffset = 0;
+            for( int i = 1; i < rank; i++ )
+            {
+                valueOffset += (long)( offsets[i] + index[i] ) * strides[i];
+            }
+            memcpy( valueBuffer, rowData + ( valueOffset * elementSize ), runBytes );
+            valueBuffer += runBytes;
+
+            int depth = rank - 2;
+            while( depth >= 1 )
+            {
+                index[depth]++;
+                if( index[depth] < sizes[depth] )
+                {
+                    break;
+                }
+                index[depth] = 0;
+                depth--;
+            }
+            if( depth < 1 )
+            {
+                break;
+            }
+        }
+    }
+
+    delete[] strides;
+    delete[] index;
+}
+
+
+ArrayDataCache *CachedArrayDataReader::getCache( int elementSize )
+{
+    ArrayDataCache *cache = FieldmlIoSession::getSession().getDataCache( context->getSession(), false );
+    if( collective || ( cache == NULL ) || ( (int64_t)blockRows * rowValues * elementSize > cache->getLimit() ) )
+    {
+        return NULL;
+    }
+
+    return cache;
+}
+
+
+FmlIoErrorNumber CachedArrayDataReader::readSlab( const int *offsets, const int *sizes, ArrayDataValueType valueType, int elementSize, void *valueBuffer )
+{
+    ArrayDataCache *cache = getCache( elementSize );
+    if( ( cache == NULL ) || !isInWindow( offsets, sizes ) )
+    {
+        return readDelegate( offsets, sizes, valueType, valueBuffer );
+    }
+
+    int *blockOffsets = new int[rank];
+    int *blockSizes = new int[rank];
+    for( int i = 1; i < rank; i++ )
+    {
+        blockOffsets[i] = 0;
+        blockSizes[i] = windowSizes[i];
+    }
+
+    long sliceValues = 1;
+    for( int i = 1; i < rank; i++ )
+    {
+        sliceValues *= sizes[i];
+    }
+
+    FmlIoErrorNumber err = FML_IOERR_NO_ERROR;
+    char *output = (char*)valueBuffer;
+    const int endRow = offsets[0] + sizes[0];
+    int row = offsets[0];
+    while( row < endRow )
+    {
+        //Blocks are aligned in raw row space, so that data sources with different outer offsets can share them.
+        const int rawRow = windowOffsets[0] + row;
+        int blockStart = ( rawRow / blockRows ) * blockRows;
+        int blockEnd = blockStart + blockRows;
+        if( blockStart < windowOffsets[0] )
+        {
+            blockStart = windowOffsets[0];
+        }
+        if( blockEnd > windowOffsets[0] + windowSizes[0] )
+        {
+            blockEnd = windowOffsets[0] + windowSizes[0];
+        }
+
+        blockKey.valueType = valueType;
+        blockKey.firstRow = blockStart;
+        blockKey.rowCount = blockEnd - blockStart;
+
+        char *loaded = NULL;
+        const char *block = cache->find( blockKey );
+        if( block == NULL )
+        {
+            loaded = new char[(long)blockKey.rowCount * rowValues * elementSize];
+            blockOffsets[0] = blockStart - windowOffsets[0];
+            blockSizes[0] = blockKey.rowCount;
+            err = readDelegate( blockOffsets, blockSizes, valueType, loaded );
+            if( err != FML_IOERR_NO_ERROR )
+            {
+                delete[] loaded;
+                break;
+            }
+            block = loaded;
+        }
+
+        int copyCount = ( blockEnd - windowOffsets[0] ) - row;
+        if( row + copyCount > endRow )
+        {
+            copyCount = endRow - row;
+        }
+
+        copyRows( block, rawRow - blockStart, copyCount, offsets, sizes, elementSize, output );
+        output += copyCount * sliceValues * elementSize;
+
+        if( loaded != NULL )
+        {
+            cache->store( blockKey, loaded, (int64_t)blockKey.rowCount * rowValues * elementSize );
+        }
+
+        row += copyCount;
+    }
+
+    delete[] blockOffsets;
+    delete[] blockSizes;
+
+    return err;
+}
+
+
+FmlIoErrorNumber CachedArrayDataReader::readIntSlab( const int *offsets, const int *sizes, int *valueBuffer )
+{
+    return readSlab( offsets, sizes, ARRAY_VALUE_INT, sizeof( int ), valueBuffer );
+}
+
+
+FmlIoErrorNumber CachedArrayDataReader::readDoubleSlab( const int *offsets, const int *sizes, double *valueBuffer )
+{
+    return readSlab( offsets, sizes, ARRAY_VALUE_DOUBLE, sizeof( double ), valueBuffer );
+}
+
+
+FmlIoErrorNumber CachedArrayDataReader::readFloatSlab( const int *offsets, const int *sizes, float *valueBuffer )
+{
+    return readSlab( offsets, sizes, ARRAY_VALUE_FLOAT, sizeof( float ), valueBuffer );
+}
+
+
+FmlIoErrorNumber CachedArrayDataReader::readBooleanSlab( const int *offsets, const int *sizes, FmlBoolean *valueBuffer )
+{
+    return readSlab( offsets, sizes, ARRAY_VALUE_BOOLEAN, sizeof( FmlBoolean ), valueBuffer );
+}
+
+
+const int *CachedArrayDataReader::getIntSlabPointer( const int *offsets, const int *sizes )
+{
+    return delegate->getIntSlabPointer( offsets, sizes );
+}
+
+
+const double *CachedArrayDataReader::getDoubleSlabPointer( const int *offsets, const int *sizes )
+{
+    return delegate->getDoubleSlabPointer( offsets, sizes );
+}
+
+
+FmlIoErrorNumber CachedArrayDataReader::setAccessPattern( FieldmlAccessPattern pattern )
+{
+    return delegate->setAccessPattern( pattern );
+}
+
+
+FmlIoErrorNumber CachedArrayDataReader::setTransferMode( FieldmlTransferMode mode )
+{
+    FmlIoErrorNumber err = delegate->setTransferMode( mode );
+    if( err == FML_IOERR_NO_ERROR )
+    {
+        collective = ( mode == FML_TRANSFER_MODE_COLLECTIVE );
+    }
+    
+    return err;
+}
+
+
+FmlIoErrorNumber CachedArrayDataReader::prepareSlabReads( const int *sizes )
+{
+    return delegate->prepareSlabReads( sizes );
+}
+
+
+//Gathers are served a slab at a time from cached blocks where possible. Otherwise the delegate can do them in one go.
+FmlIoErrorNumber CachedArrayDataReader::readStridedSlab( ArrayDataValueType valueType, const int *offsets, const int *sizes, const int *strides, void *valueBuffer )
+{
+    if( getCache( getValueSize( valueType ) ) == NULL )
+    {
+        return delegate->readStridedSlab( valueType, offsets, sizes, strides, valueBuffer );
+    }
+
+    return ArrayDataReader::readStridedSlab( valueType, offsets, sizes, strides, valueBuffer );
+}
+
+
+FmlIoErrorNumber CachedArrayDataReader::readSlabList( ArrayDataValueType valueType, int slabCount, const int *offsets, const int *sizes, void *valueBuffer )
+{
+    if( getCache( getValueSize( valueType ) ) == NULL )
+    {
+        return delegate->readSlabList( valueType, slabCount, offsets, sizes, valueBuffer );
+    }
+
+    return ArrayDataReader::readSlabList( valueType, slabCount, offsets, sizes, valueBuffer );
+}
+
+
+FmlIoErrorNumber CachedArrayDataReader::readPoints( ArrayDataValueType valueType, int pointCount, const int *points, void *valueBuffer )
+{
+    if( getCache( getValueSize( valueType ) ) == NULL )
+    {
+        return delegate->readPoints( valueType, pointCount, points, valueBuffer );
+    }
+
+    return ArrayDataReader::readPoints( valueType, pointCount, points, valueBuffer );
+}
+
+
+FmlIoErrorNumber CachedArrayDataReader::close()
+{
+    return delegate->close();
+}
+
+
+FmlIoErrorNumber CachedArrayDataReader::getExtents( FmlObjectHandle source, int rank, int *sizes )
+{
+    return delegate->getExtents( source, rank, sizes );
+}
+
+
+CachedArrayDataReader::~CachedArrayDataReader()
+{
+    delete delegate;
+
+    delete[] windowOffsets;
+    delete[] windowSizes;
+}
@@ -0,0 +1,130 @@
+/* \file
+ * $Id$
+ * \author Caton Little
+ * \brief 
+ *
+ * \section LICENSE
+ *
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is FieldML
+ *
+ * The Initial Developer of the Original Code is Auckland Uniservices Ltd,
+ * Auckland, New Zealand. Portions created by the Initial Developer are
+ * Copyright (C) 2010 the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either the GNU General Public License Version 2 or later (the "GPL"), or
+ * the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ */
+
+#ifndef H_CACHED_ARRAY_DATA_READER
+#define H_CACHED_ARRAY_DATA_READER
+
+#include <string>
+
+#include "FieldmlIoContext.h"
+#include "ArrayDataReader.h"
+#include "ArrayDataCache.h"
+
+/**
+ * Wraps another reader, satisfying reads from the session's decoded-block cache where possible. Blocks are runs of
+ * whole outermost rows of the data source, so overlapping reads from any data source that views the same array only
+ * decode the underlying data once.
+ */
+class CachedArrayDataReader :
+    public ArrayDataReader
+{
+private:
+    ArrayDataReader * const delegate;
+
+    const int rank;
+
+    //The data source's window onto the raw array.
+    int * const windowOffsets;
+
+    int * const windowSizes;
+
+    int rowValues;
+
+    int blockRows;
+
+    ArrayDataCacheKey blockKey;
+
+    //Collective reads must reach the delegate on every process, whatever this process has cached.
+    bool collective;
+
+    CachedArrayDataReader( FieldmlIoContext *_context, ArrayDataReader *_delegate, FmlObjectHandle source, int _rank,
+        const int *rawSizes, int *_windowOffsets, int *_windowSizes );
+
+    bool isInWindow( const int *offsets, const int *sizes );
+
+    //Returns the session's cache, or NULL if reads of values of the given size can't use it.
+    ArrayDataCache *getCache( int elementSize );
+
+    FmlIoErrorNumber readDelegate( const int *offsets, const int *sizes, ArrayDataValueType valueType, void *valueBuffer );
+
+    void copyRows( const char *block, int firstRow, int rowCount, const int *offsets, const int *sizes, int elementSize, char *valueBuffer );
+
+    FmlIoErrorNumber readSlab( const int *offsets, const int *sizes, ArrayDataValueType valueType, int elementSize, void *valueBuffer );
+
+public:
+    virtual FmlIoErrorNumber readIntSlab( const int *offsets, const int *sizes, int *valueBuffer );
+
+    virtual FmlIoErrorNumber readDoubleSlab( const int *offsets, const int *sizes, double *valueBuffer );
+    
+    virtual FmlIoErrorNumber readFloatSlab( const int *offsets, const int *sizes, float *valueBuffer );
+
+    virtual FmlIoErrorNumber readBooleanSlab( const int *offsets, const int *sizes, FmlBoolean *valueBuffer );
+
+    virtual FmlIoErrorNumber readStridedSlab( ArrayDataValueType valueType, const int *offsets, const int *sizes, const int *strides, void *valueBuffer );
+
+    virtual FmlIoErrorNumber readSlabList( ArrayDataValueType valueType, int slabCount, const int *offsets, const int *sizes, void *valueBuffer );
+
+    virtual FmlIoErrorNumber readPoints( ArrayDataValueType valueType, int pointCount, const int *points, void *valueBuffer );
+
+    virtual const int *getIntSlabPointer( const int *offsets, const int *sizes );
+
+    virtual const double *getDoubleSlabPointer( const int *offsets, const int *sizes );
+
+    virtual FmlIoErrorNumber close();
+    
+    virtual FmlIoErrorNumber setAccessPattern( FieldmlAccessPattern pattern );
+    
+    virtual FmlIoErrorNumber setTransferMode( FieldmlTransferMode mode );
+    
+    virtual FmlIoErrorNumber prepareSlabReads( const int *sizes );
+
+    virtual FmlIoErrorNumber getExtents( FmlObjectHandle source, int rank, int *sizes );
+
+    virtual ~CachedArrayDataReader();
+
+    /**
+     * Returns a caching wrapper around the given reader, or the reader itself if the session's cache is disabled or
+     * the data source's extents are not known up front.
+     */
+    static ArrayDataReader *create( FieldmlIoContext *context, ArrayDataReader *delegate, FmlObjectHandle source );
+};
+
+#endif //H_CACHED_ARRAY_DATA_READER
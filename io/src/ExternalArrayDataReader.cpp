@@ -0,0 +1,142 @@
+/* \file
+ * $Id$
+ * \author Caton Little
+ * \brief 
+ *
+ * \section LICENSE
+ *
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is FieldML
+ *
+ * The Initial Developer of the Original Code is Auckland Uniservices Ltd,
+ * Auckland, New Zealand. Portions created by the Initial Developer are
+ * Copyright (C) 2010 the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either the GNU General Public License Version 2 or later (the "GPL"), or
+ * the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ */
+
+#include "FieldmlIoApi.h"
+
+#include "ExternalArrayDataReader.h"
+
+using namespace std;
+
+ExternalArrayDataReader *ExternalArrayDataReader::create( FieldmlIoContext *context, const string root, FmlObjectHandle source, void *buffer,
+    int64_t bufferLength, const FieldmlArrayFormatCallbacks &callbacks, void *userData )
+{
+    if( callbacks.openReader == NULL )
+    {
+        context->setError( FML_IOERR_UNSUPPORTED );
+        return NULL;
+    }
+    
+    void *state = callbacks.openReader( context->getSession(), source, root.c_str(), buffer, bufferLength, userData );
+    if( state == NULL )
+    {
+        context->setError( FML_IOERR_READ_ERROR );
+        return NULL;
+    }
+    
+    return new ExternalArrayDataReader( context, callbacks, state );
+}
+
+
+ExternalArrayDataReader::ExternalArrayDataReader( FieldmlIoContext *_context, const FieldmlArrayFormatCallbacks &_callbacks, void *_state ) :
+    ArrayDataReader( _context ),
+    closed( false ),
+    callbacks( _callbacks ),
+    state( _state )
+{
+}
+
+
+FmlIoErrorNumber ExternalArrayDataReader::readIntSlab( const int *offsets, const int *sizes, int *valueBuffer )
+{
+    if( closed )
+    {
+        return FML_IOERR_RESOURCE_CLOSED;
+    }
+    if( callbacks.readIntSlab == NULL )
+    {
+        return context->setError( FML_IOERR_UNSUPPORTED );
+    }
+    
+    return context->setError( callbacks.readIntSlab( state, offsets, sizes, valueBuffer ) );
+}
+
+
+FmlIoErrorNumber ExternalArrayDataReader::readDoubleSlab( const int *offsets, const int *sizes, double *valueBuffer )
+{
+    if( closed )
+    {
+        return FML_IOERR_RESOURCE_CLOSED;
+    }
+    if( callbacks.readDoubleSlab == NULL )
+    {
+        return context->setError( FML_IOERR_UNSUPPORTED );
+    }
+    
+    return context->setError( callbacks.readDoubleSlab( state, offsets, sizes, valueBuffer ) );
+}
+
+
+FmlIoErrorNumber ExternalArrayDataReader::readBooleanSlab( const int *offsets, const int *sizes, FmlBoolean *valueBuffer )
+{
+    if( closed )
+    {
+        return FML_IOERR_RESOURCE_CLOSED;
+    }
+    if( callbacks.readBooleanSlab == NULL )
+    {
+        return context->setError( FML_IOERR_UNSUPPORTED );
+    }
+    
+    return context->setError( callbacks.readBooleanSlab( state, offsets, sizes, valueBuffer ) );
+}
+
+
+FmlIoErrorNumber ExternalArrayDataReader::close()
+{
+    if( closed )
+    {
+        return FML_IOERR_NO_ERROR;
+    }
+    
+    closed = true;
+    if( callbacks.closeReader == NULL )
+    {
+        return FML_IOERR_NO_ERROR;
+    }
+    
+    return callbacks.closeReader( state );
+}
+
+
+ExternalArrayDataReader::~ExternalArrayDataReader()
+{
+    close();
+}
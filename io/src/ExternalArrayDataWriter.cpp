@@ -0,0 +1,142 @@
+/* \file
+ * $Id$
+ * \author Caton Little
+ * \brief 
+ *
+ * \section LICENSE
+ *
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is FieldML
+ *
+ * The Initial Developer of the Original Code is Auckland Uniservices Ltd,
+ * Auckland, New Zealand. Portions created by the Initial Developer are
+ * Copyright (C) 2010 the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either the GNU General Public License Version 2 or later (the "GPL"), or
+ * the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ */
+
+#include "FieldmlIoApi.h"
+
+#include "ExternalArrayDataWriter.h"
+
+using namespace std;
+
+ExternalArrayDataWriter *ExternalArrayDataWriter::create( FieldmlIoContext *context, const string root, FmlObjectHandle source, FieldmlHandleType handleType,
+    bool append, int *sizes, int rank, const FieldmlArrayFormatCallbacks &callbacks, void *userData )
+{
+    if( callbacks.openWriter == NULL )
+    {
+        context->setError( FML_IOERR_UNSUPPORTED );
+        return NULL;
+    }
+    
+    void *state = callbacks.openWriter( context->getSession(), source, root.c_str(), handleType, append ? 1 : 0, sizes, rank, userData );
+    if( state == NULL )
+    {
+        context->setError( FML_IOERR_WRITE_ERROR );
+        return NULL;
+    }
+    
+    return new ExternalArrayDataWriter( context, callbacks, state );
+}
+
+
+ExternalArrayDataWriter::ExternalArrayDataWriter( FieldmlIoContext *_context, const FieldmlArrayFormatCallbacks &_callbacks, void *_state ) :
+    ArrayDataWriter( _context ),
+    closed( false ),
+    callbacks( _callbacks ),
+    state( _state )
+{
+}
+
+
+FmlIoErrorNumber ExternalArrayDataWriter::writeIntSlab( const int *offsets, const int *sizes, const int *valueBuffer )
+{
+    if( closed )
+    {
+        return FML_IOERR_RESOURCE_CLOSED;
+    }
+    if( callbacks.writeIntSlab == NULL )
+    {
+        return context->setError( FML_IOERR_UNSUPPORTED );
+    }
+    
+    return context->setError( callbacks.writeIntSlab( state, offsets, sizes, valueBuffer ) );
+}
+
+
+FmlIoErrorNumber ExternalArrayDataWriter::writeDoubleSlab( const int *offsets, const int *sizes, const double *valueBuffer )
+{
+    if( closed )
+    {
+        return FML_IOERR_RESOURCE_CLOSED;
+    }
+    if( callbacks.writeDoubleSlab == NULL )
+    {
+        return context->setError( FML_IOERR_UNSUPPORTED );
+    }
+    
+    return context->setError( callbacks.writeDoubleSlab( state, offsets, sizes, valueBuffer ) );
+}
+
+
+FmlIoErrorNumber ExternalArrayDataWriter::writeBooleanSlab( const int *offsets, const int *sizes, const FmlBoolean *valueBuffer )
+{
+    if( closed )
+    {
+        return FML_IOERR_RESOURCE_CLOSED;
+    }
+    if( callbacks.writeBooleanSlab == NULL )
+    {
+        return context->setError( FML_IOERR_UNSUPPORTED );
+    }
+    
+    return context->setError( callbacks.writeBooleanSlab( state, offsets, sizes, valueBuffer ) );
+}
+
+
+FmlIoErrorNumber ExternalArrayDataWriter::close()
+{
+    if( closed )
+    {
+        return FML_IOERR_NO_ERROR;
+    }
+    
+    closed = true;
+    if( callbacks.closeWriter == NULL )
+    {
+        return FML_IOERR_NO_ERROR;
+    }
+    
+    return callbacks.closeWriter( state );
+}
+
+
+ExternalArrayDataWriter::~ExternalArrayDataWriter()
+{
+    close();
+}
@@ -39,6 +39,7 @@
  *
  */
 
+#include <cstdio>
 #include <cstring>
 
 #include "StringUtil.h"
@@ -49,6 +50,11 @@
 
 #include "ArrayDataReader.h"
 #include "ArrayDataWriter.h"
+#include "ArrayFormatRegistry.h"
+#include "ArrayReadQueue.h"
+#include "Hdf5HandleCache.h"
+#include "OutputStream.h"
+#include "ShardManifest.h"
 
 using namespace std;
 
@@ -58,6 +64,84 @@ using namespace std;
 //
 //========================================================================
 
+static FmlRequestHandle queueSlabRead( FmlReaderHandle readerHandle, ArrayDataValueType valueType, const int *offsets, const int *sizes,
+    void *valueBuffer )
+{
+    ArrayDataReader *reader = FieldmlIoSession::getSession().handleToReader( readerHandle );
+    if( reader == NULL )
+    {
+        FieldmlIoSession::getSession().setError( FML_IOERR_UNKNOWN_OBJECT );
+        return FML_INVALID_HANDLE;
+    }
+    if( ( offsets == NULL ) || ( sizes == NULL ) || ( valueBuffer == NULL ) )
+    {
+        FieldmlIoSession::getSession().setError( FML_IOERR_INVALID_PARAMETER );
+        return FML_INVALID_HANDLE;
+    }
+    
+    FieldmlIoSession::getSession().setError( FML_IOERR_NO_ERROR );
+    return ArrayReadQueue::getQueue().submit( reader, valueType, offsets, sizes, valueBuffer );
+}
+
+
+static FmlIoErrorNumber stridedSlabRead( FmlReaderHandle readerHandle, ArrayDataValueType valueType, const int *offsets, const int *sizes,
+    const int *strides, void *valueBuffer )
+{
+    ArrayDataReader *reader = FieldmlIoSession::getSession().handleToReader( readerHandle );
+    if( reader == NULL )
+    {
+        return FieldmlIoSession::getSession().setError( FML_IOERR_UNKNOWN_OBJECT );
+    }
+    if( ( offsets == NULL ) || ( sizes == NULL ) || ( strides == NULL ) || ( valueBuffer == NULL ) )
+    {
+        return FieldmlIoSession::getSession().setError( FML_IOERR_INVALID_PARAMETER );
+    }
+    
+    return reader->lockedReadStridedSlab( valueType, offsets, sizes, strides, valueBuffer );
+}
+
+
+static FmlIoErrorNumber slabListRead( FmlReaderHandle readerHandle, ArrayDataValueType valueType, int slabCount, const int *offsets,
+    const int *sizes, void *valueBuffer )
+{
+    ArrayDataReader *reader = FieldmlIoSession::getSession().handleToReader( readerHandle );
+    if( reader == NULL )
+    {
+        return FieldmlIoSession::getSession().setError( FML_IOERR_UNKNOWN_OBJECT );
+    }
+    if( slabCount < 0 )
+    {
+        return FieldmlIoSession::getSession().setError( FML_IOERR_INVALID_PARAMETER );
+    }
+    if( ( slabCount > 0 ) && ( ( offsets == NULL ) || ( sizes == NULL ) || ( valueBuffer == NULL ) ) )
+    {
+        return FieldmlIoSession::getSession().setError( FML_IOERR_INVALID_PARAMETER );
+    }
+    
+    return reader->lockedReadSlabList( valueType, slabCount, offsets, sizes, valueBuffer );
+}
+
+
+static FmlIoErrorNumber pointListRead( FmlReaderHandle readerHandle, ArrayDataValueType valueType, int pointCount, const int *points,
+    void *valueBuffer )
+{
+    ArrayDataReader *reader = FieldmlIoSession::getSession().handleToReader( readerHandle );
+    if( reader == NULL )
+    {
+        return FieldmlIoSession::getSession().setError( FML_IOERR_UNKNOWN_OBJECT );
+    }
+    if( pointCount < 0 )
+    {
+        return FieldmlIoSession::getSession().setError( FML_IOERR_INVALID_PARAMETER );
+    }
+    if( ( pointCount > 0 ) && ( ( points == NULL ) || ( valueBuffer == NULL ) ) )
+    {
+        return FieldmlIoSession::getSession().setError( FML_IOERR_INVALID_PARAMETER );
+    }
+    
+    return reader->lockedReadPoints( valueType, pointCount, points, valueBuffer );
+}
+
 
 
 //========================================================================
@@ -73,7 +157,7 @@ FmlIoErrorNumber FieldmlIo_GetLastError()
 }
 
 FmlReaderHandle Fieldml_OpenReaderInternal( FmlSessionHandle handle, FmlObjectHandle objectHandle,
-	ArrayDataSourceType sourceType, void *buffer)
+	ArrayDataSourceType sourceType, void *buffer, int64_t bufferLength)
 {
     if( Fieldml_IsObjectLocal( handle, objectHandle, 0 ) != 1 )
     {
@@ -92,11 +176,13 @@ FmlReaderHandle Fieldml_OpenReaderInternal( FmlSessionHandle handle, FmlObjectHa
         }
         else
         {
+            //Opening a reader may use the same third-party libraries as asynchronous reads in progress.
+            lock_guard<recursive_mutex> guard( ArrayDataReader::getSharedStateLock() );
         	if (sourceType == ARRAY_DATA_SOURCE_DEFAULT)
         		reader = ArrayDataReader::create( FieldmlIoSession::getSession().createContext( handle ), root, objectHandle);
         	else
         		reader = ArrayDataReader::createWithBuffer( FieldmlIoSession::getSession().createContext( handle ),
-        			root, objectHandle, buffer);
+        			root, objectHandle, buffer, bufferLength);
         }
         Fieldml_FreeString(region_string);
     }
@@ -117,12 +203,25 @@ FmlReaderHandle Fieldml_OpenReaderInternal( FmlSessionHandle handle, FmlObjectHa
 
 FmlReaderHandle Fieldml_OpenReader( FmlSessionHandle handle, FmlObjectHandle objectHandle)
 {
-    return Fieldml_OpenReaderInternal(handle, objectHandle, ARRAY_DATA_SOURCE_DEFAULT, 0);
+    return Fieldml_OpenReaderInternal(handle, objectHandle, ARRAY_DATA_SOURCE_DEFAULT, 0, -1);
 }
 
 FmlReaderHandle Fieldml_OpenReaderWithBuffer( FmlSessionHandle handle, FmlObjectHandle objectHandle, void *buffer)
 {
-	return Fieldml_OpenReaderInternal(handle, objectHandle, ARRAY_DATA_SOURCE_BUFFER, buffer);
+	return Fieldml_OpenReaderInternal(handle, objectHandle, ARRAY_DATA_SOURCE_BUFFER, buffer, -1);
+}
+
+
+FmlReaderHandle Fieldml_OpenReaderWithImage( FmlSessionHandle handle, FmlObjectHandle objectHandle, const void *image, int64_t imageLength )
+{
+    if( ( image == NULL ) || ( imageLength <= 0 ) )
+    {
+        FieldmlIoSession::getSession().setError( FML_IOERR_INVALID_PARAMETER );
+        return FML_INVALID_HANDLE;
+    }
+    
+    //Readers never write to their buffer.
+    return Fieldml_OpenReaderInternal( handle, objectHandle, ARRAY_DATA_SOURCE_BUFFER, const_cast<void*>( image ), imageLength );
 }
 
 FmlIoErrorNumber Fieldml_ReadIntSlab( FmlReaderHandle readerHandle, const int *offsets, const int *sizes, int *valueBuffer )
@@ -133,7 +232,7 @@ FmlIoErrorNumber Fieldml_ReadIntSlab( FmlReaderHandle readerHandle, const int *o
         return FieldmlIoSession::getSession().setError( FML_IOERR_UNKNOWN_OBJECT );
     }
 
-    return reader->readIntSlab( offsets, sizes, valueBuffer );
+    return reader->lockedReadSlab( ARRAY_VALUE_INT, offsets, sizes, valueBuffer );
 }
 
 
@@ -145,7 +244,19 @@ FmlIoErrorNumber Fieldml_ReadDoubleSlab( FmlReaderHandle readerHandle, const int
         return FieldmlIoSession::getSession().setError( FML_IOERR_UNKNOWN_OBJECT );
     }
 
-    return reader->readDoubleSlab( offsets, sizes, valueBuffer );
+    return reader->lockedReadSlab( ARRAY_VALUE_DOUBLE, offsets, sizes, valueBuffer );
+}
+
+
+FmlIoErrorNumber Fieldml_ReadFloatSlab( FmlReaderHandle readerHandle, const int *offsets, const int *sizes, float *valueBuffer )
+{
+    ArrayDataReader *reader = FieldmlIoSession::getSession().handleToReader( readerHandle );
+    if( reader == NULL )
+    {
+        return FieldmlIoSession::getSession().setError( FML_IOERR_UNKNOWN_OBJECT );
+    }
+
+    return reader->lockedReadSlab( ARRAY_VALUE_FLOAT, offsets, sizes, valueBuffer );
 }
 
 
@@ -157,7 +268,316 @@ FmlIoErrorNumber Fieldml_ReadBooleanSlab( FmlReaderHandle readerHandle, const in
         return FieldmlIoSession::getSession().setError( FML_IOERR_UNKNOWN_OBJECT );
     }
 
-    return reader->readBooleanSlab( offsets, sizes, valueBuffer );
+    return reader->lockedReadSlab( ARRAY_VALUE_BOOLEAN, offsets, sizes, valueBuffer );
+}
+
+
+FmlIoErrorNumber Fieldml_PrepareSlabReads( FmlReaderHandle readerHandle, const int *sizes )
+{
+    ArrayDataReader *reader = FieldmlIoSession::getSession().handleToReader( readerHandle );
+    if( reader == NULL )
+    {
+        return FieldmlIoSession::getSession().setError( FML_IOERR_UNKNOWN_OBJECT );
+    }
+    if( sizes == NULL )
+    {
+        return FieldmlIoSession::getSession().setError( FML_IOERR_INVALID_PARAMETER );
+    }
+
+    return FieldmlIoSession::getSession().setError( reader->lockedPrepareSlabReads( sizes ) );
+}
+
+
+FmlIoErrorNumber Fieldml_ReadPreparedIntSlab( FmlReaderHandle readerHandle, const int *offsets, int *valueBuffer )
+{
+    ArrayDataReader *reader = FieldmlIoSession::getSession().handleToReader( readerHandle );
+    if( reader == NULL )
+    {
+        return FieldmlIoSession::getSession().setError( FML_IOERR_UNKNOWN_OBJECT );
+    }
+
+    return reader->lockedReadPreparedSlab( ARRAY_VALUE_INT, offsets, valueBuffer );
+}
+
+
+FmlIoErrorNumber Fieldml_ReadPreparedDoubleSlab( FmlReaderHandle readerHandle, const int *offsets, double *valueBuffer )
+{
+    ArrayDataReader *reader = FieldmlIoSession::getSession().handleToReader( readerHandle );
+    if( reader == NULL )
+    {
+        return FieldmlIoSession::getSession().setError( FML_IOERR_UNKNOWN_OBJECT );
+    }
+
+    return reader->lockedReadPreparedSlab( ARRAY_VALUE_DOUBLE, offsets, valueBuffer );
+}
+
+
+FmlIoErrorNumber Fieldml_ReadPreparedBooleanSlab( FmlReaderHandle readerHandle, const int *offsets, FmlBoolean *valueBuffer )
+{
+    ArrayDataReader *reader = FieldmlIoSession::getSession().handleToReader( readerHandle );
+    if( reader == NULL )
+    {
+        return FieldmlIoSession::getSession().setError( FML_IOERR_UNKNOWN_OBJECT );
+    }
+
+    return reader->lockedReadPreparedSlab( ARRAY_VALUE_BOOLEAN, offsets, valueBuffer );
+}
+
+
+FmlIoErrorNumber Fieldml_ReadIntSlabStrided( FmlReaderHandle readerHandle, const int *offsets, const int *sizes, const int *strides, int *valueBuffer )
+{
+    return stridedSlabRead( readerHandle, ARRAY_VALUE_INT, offsets, sizes, strides, valueBuffer );
+}
+
+
+FmlIoErrorNumber Fieldml_ReadDoubleSlabStrided( FmlReaderHandle readerHandle, const int *offsets, const int *sizes, const int *strides, double *valueBuffer )
+{
+    return stridedSlabRead( readerHandle, ARRAY_VALUE_DOUBLE, offsets, sizes, strides, valueBuffer );
+}
+
+
+FmlIoErrorNumber Fieldml_ReadBooleanSlabStrided( FmlReaderHandle readerHandle, const int *offsets, const int *sizes, const int *strides, FmlBoolean *valueBuffer )
+{
+    return stridedSlabRead( readerHandle, ARRAY_VALUE_BOOLEAN, offsets, sizes, strides, valueBuffer );
+}
+
+
+FmlIoErrorNumber Fieldml_ReadIntSlabList( FmlReaderHandle readerHandle, int slabCount, const int *offsets, const int *sizes, int *valueBuffer )
+{
+    return slabListRead( readerHandle, ARRAY_VALUE_INT, slabCount, offsets, sizes, valueBuffer );
+}
+
+
+FmlIoErrorNumber Fieldml_ReadDoubleSlabList( FmlReaderHandle readerHandle, int slabCount, const int *offsets, const int *sizes, double *valueBuffer )
+{
+    return slabListRead( readerHandle, ARRAY_VALUE_DOUBLE, slabCount, offsets, sizes, valueBuffer );
+}
+
+
+FmlIoErrorNumber Fieldml_ReadBooleanSlabList( FmlReaderHandle readerHandle, int slabCount, const int *offsets, const int *sizes, FmlBoolean *valueBuffer )
+{
+    return slabListRead( readerHandle, ARRAY_VALUE_BOOLEAN, slabCount, offsets, sizes, valueBuffer );
+}
+
+
+FmlIoErrorNumber Fieldml_ReadIntPoints( FmlReaderHandle readerHandle, int pointCount, const int *points, int *valueBuffer )
+{
+    return pointListRead( readerHandle, ARRAY_VALUE_INT, pointCount, points, valueBuffer );
+}
+
+
+FmlIoErrorNumber Fieldml_ReadDoublePoints( FmlReaderHandle readerHandle, int pointCount, const int *points, double *valueBuffer )
+{
+    return pointListRead( readerHandle, ARRAY_VALUE_DOUBLE, pointCount, points, valueBuffer );
+}
+
+
+FmlIoErrorNumber Fieldml_ReadBooleanPoints( FmlReaderHandle readerHandle, int pointCount, const int *points, FmlBoolean *valueBuffer )
+{
+    return pointListRead( readerHandle, ARRAY_VALUE_BOOLEAN, pointCount, points, valueBuffer );
+}
+
+
+FmlRequestHandle Fieldml_ReadIntSlabAsync( FmlReaderHandle readerHandle, const int *offsets, const int *sizes, int *valueBuffer )
+{
+    return queueSlabRead( readerHandle, ARRAY_VALUE_INT, offsets, sizes, valueBuffer );
+}
+
+
+FmlRequestHandle Fieldml_ReadDoubleSlabAsync( FmlReaderHandle readerHandle, const int *offsets, const int *sizes, double *valueBuffer )
+{
+    return queueSlabRead( readerHandle, ARRAY_VALUE_DOUBLE, offsets, sizes, valueBuffer );
+}
+
+
+FmlRequestHandle Fieldml_ReadBooleanSlabAsync( FmlReaderHandle readerHandle, const int *offsets, const int *sizes, FmlBoolean *valueBuffer )
+{
+    return queueSlabRead( readerHandle, ARRAY_VALUE_BOOLEAN, offsets, sizes, valueBuffer );
+}
+
+
+FmlIoErrorNumber Fieldml_WaitRequest( FmlRequestHandle requestHandle )
+{
+    FmlIoErrorNumber result;
+    if( !ArrayReadQueue::getQueue().wait( requestHandle, result ) )
+    {
+        return FieldmlIoSession::getSession().setError( FML_IOERR_UNKNOWN_OBJECT );
+    }
+    
+    return FieldmlIoSession::getSession().setError( result );
+}
+
+
+FmlIoErrorNumber Fieldml_TestRequest( FmlRequestHandle requestHandle, FmlBoolean *isComplete )
+{
+    if( isComplete == NULL )
+    {
+        return FieldmlIoSession::getSession().setError( FML_IOERR_INVALID_PARAMETER );
+    }
+    
+    bool complete;
+    if( !ArrayReadQueue::getQueue().test( requestHandle, complete ) )
+    {
+        return FieldmlIoSession::getSession().setError( FML_IOERR_UNKNOWN_OBJECT );
+    }
+    
+    *isComplete = complete ? 1 : 0;
+    return FieldmlIoSession::getSession().setError( FML_IOERR_NO_ERROR );
+}
+
+
+FmlIoErrorNumber Fieldml_SetReaderAccessPattern( FmlReaderHandle readerHandle, FieldmlAccessPattern pattern )
+{
+    ArrayDataReader *reader = FieldmlIoSession::getSession().handleToReader( readerHandle );
+    if( reader == NULL )
+    {
+        return FieldmlIoSession::getSession().setError( FML_IOERR_UNKNOWN_OBJECT );
+    }
+    if( ( pattern != FML_ACCESS_PATTERN_NORMAL ) && ( pattern != FML_ACCESS_PATTERN_SEQUENTIAL ) && ( pattern != FML_ACCESS_PATTERN_RANDOM ) )
+    {
+        return FieldmlIoSession::getSession().setError( FML_IOERR_INVALID_PARAMETER );
+    }
+    
+    return FieldmlIoSession::getSession().setError( reader->lockedSetAccessPattern( pattern ) );
+}
+
+
+FmlIoErrorNumber Fieldml_SetReaderTransferMode( FmlReaderHandle readerHandle, FieldmlTransferMode mode )
+{
+    ArrayDataReader *reader = FieldmlIoSession::getSession().handleToReader( readerHandle );
+    if( reader == NULL )
+    {
+        return FieldmlIoSession::getSession().setError( FML_IOERR_UNKNOWN_OBJECT );
+    }
+    if( ( mode != FML_TRANSFER_MODE_INDEPENDENT ) && ( mode != FML_TRANSFER_MODE_COLLECTIVE ) )
+    {
+        return FieldmlIoSession::getSession().setError( FML_IOERR_INVALID_PARAMETER );
+    }
+    
+    return FieldmlIoSession::getSession().setError( reader->lockedSetTransferMode( mode ) );
+}
+
+
+const double *Fieldml_GetDoubleSlabPointer( FmlReaderHandle readerHandle, const int *offsets, const int *sizes )
+{
+    ArrayDataReader *reader = FieldmlIoSession::getSession().handleToReader( readerHandle );
+    if( reader == NULL )
+    {
+        FieldmlIoSession::getSession().setError( FML_IOERR_UNKNOWN_OBJECT );
+        return NULL;
+    }
+
+    return reader->getDoubleSlabPointer( offsets, sizes );
+}
+
+
+const int *Fieldml_GetIntSlabPointer( FmlReaderHandle readerHandle, const int *offsets, const int *sizes )
+{
+    ArrayDataReader *reader = FieldmlIoSession::getSession().handleToReader( readerHandle );
+    if( reader == NULL )
+    {
+        FieldmlIoSession::getSession().setError( FML_IOERR_UNKNOWN_OBJECT );
+        return NULL;
+    }
+
+    return reader->getIntSlabPointer( offsets, sizes );
+}
+
+
+FmlIoErrorNumber Fieldml_RegisterArrayFormat( const char *format, const FieldmlArrayFormatCallbacks *callbacks, void *userData )
+{
+    if( ( format == NULL ) || ( callbacks == NULL ) )
+    {
+        return FieldmlIoSession::getSession().setError( FML_IOERR_INVALID_PARAMETER );
+    }
+    
+    ArrayFormatRegistry::getRegistry().registerExternalFormat( format, *callbacks, userData );
+    
+    return FieldmlIoSession::getSession().setError( FML_IOERR_NO_ERROR );
+}
+
+
+FmlIoErrorNumber Fieldml_UnregisterArrayFormat( const char *format )
+{
+    if( format == NULL )
+    {
+        return FieldmlIoSession::getSession().setError( FML_IOERR_INVALID_PARAMETER );
+    }
+    
+    ArrayFormatRegistry::getRegistry().unregisterFormat( format );
+    
+    return FieldmlIoSession::getSession().setError( FML_IOERR_NO_ERROR );
+}
+
+
+FmlBoolean Fieldml_IsArrayFormatRegistered( const char *format )
+{
+    if( format == NULL )
+    {
+        return 0;
+    }
+    
+    return ArrayFormatRegistry::getRegistry().isRegistered( format ) ? 1 : 0;
+}
+
+
+FmlReaderHandle Fieldml_OpenRowIterator( FmlSessionHandle handle, FmlObjectHandle objectHandle )
+{
+    FmlReaderHandle readerHandle = Fieldml_OpenReader( handle, objectHandle );
+    if( readerHandle == FML_INVALID_HANDLE )
+    {
+        return FML_INVALID_HANDLE;
+    }
+    
+    ArrayDataReader *reader = FieldmlIoSession::getSession().handleToReader( readerHandle );
+    FmlIoErrorNumber err = reader->beginRows( objectHandle );
+    if( err != FML_IOERR_NO_ERROR )
+    {
+        Fieldml_CloseReader( readerHandle );
+        FieldmlIoSession::getSession().setError( err );
+        return FML_INVALID_HANDLE;
+    }
+    
+    return readerHandle;
+}
+
+
+int Fieldml_ReadNextRows( FmlReaderHandle readerHandle, int maxRows, double *valueBuffer )
+{
+    ArrayDataReader *reader = FieldmlIoSession::getSession().handleToReader( readerHandle );
+    if( reader == NULL )
+    {
+        FieldmlIoSession::getSession().setError( FML_IOERR_UNKNOWN_OBJECT );
+        return -1;
+    }
+
+    return reader->readNextDoubleRows( maxRows, valueBuffer );
+}
+
+
+int Fieldml_ReadNextIntRows( FmlReaderHandle readerHandle, int maxRows, int *valueBuffer )
+{
+    ArrayDataReader *reader = FieldmlIoSession::getSession().handleToReader( readerHandle );
+    if( reader == NULL )
+    {
+        FieldmlIoSession::getSession().setError( FML_IOERR_UNKNOWN_OBJECT );
+        return -1;
+    }
+
+    return reader->readNextIntRows( maxRows, valueBuffer );
+}
+
+
+int Fieldml_ReadNextBooleanRows( FmlReaderHandle readerHandle, int maxRows, FmlBoolean *valueBuffer )
+{
+    ArrayDataReader *reader = FieldmlIoSession::getSession().handleToReader( readerHandle );
+    if( reader == NULL )
+    {
+        FieldmlIoSession::getSession().setError( FML_IOERR_UNKNOWN_OBJECT );
+        return -1;
+    }
+
+    return reader->readNextBooleanRows( maxRows, valueBuffer );
 }
 
 
@@ -171,6 +591,10 @@ FmlIoErrorNumber Fieldml_CloseReader( FmlReaderHandle readerHandle )
 
     FieldmlIoSession::getSession().removeReader( readerHandle );
     
+    ArrayReadQueue::getQueue().waitForReader( reader );
+    
+    lock_guard<recursive_mutex> guard( ArrayDataReader::getSharedStateLock() );
+    
     FmlIoErrorNumber err = reader->close();
     
     delete reader;
@@ -181,6 +605,27 @@ FmlIoErrorNumber Fieldml_CloseReader( FmlReaderHandle readerHandle )
 
 FmlWriterHandle Fieldml_OpenArrayWriter( FmlSessionHandle handle, FmlObjectHandle objectHandle, FmlObjectHandle typeHandle, FmlBoolean append, int *sizes, int rank )
 {
+    return Fieldml_OpenArrayWriterWithOptions( handle, objectHandle, typeHandle, append, sizes, rank, NULL );
+}
+
+
+FmlWriterHandle Fieldml_OpenArrayWriterWithOptions( FmlSessionHandle handle, FmlObjectHandle objectHandle, FmlObjectHandle typeHandle, FmlBoolean append,
+    int *sizes, int rank, const FieldmlArrayWriterOptions *options )
+{
+    if( options != NULL )
+    {
+        bool valid = ( options->deflateLevel >= 0 ) && ( options->deflateLevel <= 9 ) && ( options->storageBits >= 0 );
+        for( int i = 0; valid && ( options->chunkSizes != NULL ) && ( i < rank ); i++ )
+        {
+            valid = ( options->chunkSizes[i] > 0 );
+        }
+        if( !valid )
+        {
+            FieldmlIoSession::getSession().setError( FML_IOERR_INVALID_PARAMETER );
+            return FML_INVALID_HANDLE;
+        }
+    }
+
     if( Fieldml_IsObjectLocal( handle, objectHandle, 0 ) != 1 )
     {
         FieldmlIoSession::getSession().setError( FML_IOERR_NONLOCAL_OBJECT );
@@ -229,7 +674,8 @@ FmlWriterHandle Fieldml_OpenArrayWriter( FmlSessionHandle handle, FmlObjectHandl
         }
         else
         {
-            writer = ArrayDataWriter::create( context, root, objectHandle, type, ( append == 1 ), sizes, rank );
+            lock_guard<recursive_mutex> guard( ArrayDataReader::getSharedStateLock() );
+            writer = ArrayDataWriter::create( context, root, objectHandle, type, ( append == 1 ), sizes, rank, options );
         }
     }
     
@@ -251,6 +697,7 @@ FmlIoErrorNumber Fieldml_WriteIntSlab( FmlWriterHandle writerHandle, const int *
         return FieldmlIoSession::getSession().setError( FML_IOERR_UNKNOWN_OBJECT );
     }
 
+    lock_guard<recursive_mutex> guard( ArrayDataReader::getSharedStateLock() );
     return writer->writeIntSlab( offsets, sizes, valueBuffer );
 }
 
@@ -263,6 +710,7 @@ FmlIoErrorNumber Fieldml_WriteDoubleSlab( FmlWriterHandle writerHandle, const in
         return FieldmlIoSession::getSession().setError( FML_IOERR_UNKNOWN_OBJECT );
     }
 
+    lock_guard<recursive_mutex> guard( ArrayDataReader::getSharedStateLock() );
     return writer->writeDoubleSlab( offsets, sizes, valueBuffer );
 }
 
@@ -275,6 +723,7 @@ FmlIoErrorNumber Fieldml_WriteBooleanSlab( FmlWriterHandle writerHandle, const i
         return FieldmlIoSession::getSession().setError( FML_IOERR_UNKNOWN_OBJECT );
     }
 
+    lock_guard<recursive_mutex> guard( ArrayDataReader::getSharedStateLock() );
     return writer->writeBooleanSlab( offsets, sizes, valueBuffer );
 }
 
@@ -289,9 +738,239 @@ FmlIoErrorNumber Fieldml_CloseWriter( FmlWriterHandle writerHandle )
 
     FieldmlIoSession::getSession().removeWriter( writerHandle );
     
+    lock_guard<recursive_mutex> guard( ArrayDataReader::getSharedStateLock() );
+    
     FmlIoErrorNumber err = writer->close();
     
     delete writer;
     
     return FieldmlIoSession::getSession().setError( err );
 }
+
+
+FmlIoErrorNumber Fieldml_SetWriterTransferMode( FmlWriterHandle writerHandle, FieldmlTransferMode mode )
+{
+    ArrayDataWriter *writer = FieldmlIoSession::getSession().handleToWriter( writerHandle );
+    if( writer == NULL )
+    {
+        return FieldmlIoSession::getSession().setError( FML_IOERR_UNKNOWN_OBJECT );
+    }
+    if( ( mode != FML_TRANSFER_MODE_INDEPENDENT ) && ( mode != FML_TRANSFER_MODE_COLLECTIVE ) )
+    {
+        return FieldmlIoSession::getSession().setError( FML_IOERR_INVALID_PARAMETER );
+    }
+
+    lock_guard<recursive_mutex> guard( ArrayDataReader::getSharedStateLock() );
+    return FieldmlIoSession::getSession().setError( writer->setTransferMode( mode ) );
+}
+
+
+FmlIoErrorNumber Fieldml_SetTextWriterThreads( int threadCount )
+{
+    if( threadCount < 0 )
+    {
+        return FieldmlIoSession::getSession().setError( FML_IOERR_INVALID_PARAMETER );
+    }
+    
+    FieldmlOutputStream::setFileThreadCount( threadCount );
+    
+    return FieldmlIoSession::getSession().setError( FML_IOERR_NO_ERROR );
+}
+
+
+FmlIoErrorNumber Fieldml_SetDataCacheLimit( FmlSessionHandle handle, int64_t byteLimit )
+{
+    if( Fieldml_GetLastError( handle ) == FML_ERR_UNKNOWN_HANDLE )
+    {
+        return FieldmlIoSession::getSession().setError( FML_IOERR_UNKNOWN_OBJECT );
+    }
+    if( byteLimit < 0 )
+    {
+        return FieldmlIoSession::getSession().setError( FML_IOERR_INVALID_PARAMETER );
+    }
+    
+    lock_guard<recursive_mutex> guard( ArrayDataReader::getSharedStateLock() );
+    FieldmlIoSession::getSession().getDataCache( handle, true )->setLimit( byteLimit );
+    
+    return FieldmlIoSession::getSession().setError( FML_IOERR_NO_ERROR );
+}
+
+
+FmlIoErrorNumber Fieldml_GetDataCacheStatistics( FmlSessionHandle handle, int64_t *hits, int64_t *misses, int64_t *bytesUsed )
+{
+    if( Fieldml_GetLastError( handle ) == FML_ERR_UNKNOWN_HANDLE )
+    {
+        return FieldmlIoSession::getSession().setError( FML_IOERR_UNKNOWN_OBJECT );
+    }
+    if( ( hits == NULL ) || ( misses == NULL ) || ( bytesUsed == NULL ) )
+    {
+        return FieldmlIoSession::getSession().setError( FML_IOERR_INVALID_PARAMETER );
+    }
+    
+    lock_guard<recursive_mutex> guard( ArrayDataReader::getSharedStateLock() );
+    ArrayDataCache *cache = FieldmlIoSession::getSession().getDataCache( handle, false );
+    if( cache == NULL )
+    {
+        *hits = 0;
+        *misses = 0;
+        *bytesUsed = 0;
+    }
+    else
+    {
+        cache->getStatistics( *hits, *misses, *bytesUsed );
+    }
+    
+    return FieldmlIoSession::getSession().setError( FML_IOERR_NO_ERROR );
+}
+
+
+FmlIoErrorNumber Fieldml_ClearDataCache( FmlSessionHandle handle )
+{
+    if( Fieldml_GetLastError( handle ) == FML_ERR_UNKNOWN_HANDLE )
+    {
+        return FieldmlIoSession::getSession().setError( FML_IOERR_UNKNOWN_OBJECT );
+    }
+    
+    lock_guard<recursive_mutex> guard( ArrayDataReader::getSharedStateLock() );
+    ArrayDataCache *cache = FieldmlIoSession::getSession().getDataCache( handle, false );
+    if( cache != NULL )
+    {
+        cache->clear();
+    }
+    
+    return FieldmlIoSession::getSession().setError( FML_IOERR_NO_ERROR );
+}
+
+
+FmlIoErrorNumber Fieldml_SetHdf5CacheOptions( FmlSessionHandle handle, const FieldmlHdf5CacheOptions *options )
+{
+    if( Fieldml_GetLastError( handle ) == FML_ERR_UNKNOWN_HANDLE )
+    {
+        return FieldmlIoSession::getSession().setError( FML_IOERR_UNKNOWN_OBJECT );
+    }
+    
+#if defined FIELDML_HDF5_ARRAY || defined FIELDML_PHDF5_ARRAY
+    if( ( options != NULL ) && ( ( options->chunkCacheBytes < 0 ) || ( options->chunkCacheSlots < 0 ) ||
+        ( options->chunkCachePreemption > 1 ) || ( options->metadataCacheBytes < 0 ) || ( options->pageBufferBytes < 0 ) ) )
+    {
+        return FieldmlIoSession::getSession().setError( FML_IOERR_INVALID_PARAMETER );
+    }
+    
+    lock_guard<recursive_mutex> guard( ArrayDataReader::getSharedStateLock() );
+    FieldmlIoSession::getSession().setHdf5CacheOptions( handle, options );
+    
+    //Files kept open while idle have the old options, so they have to be opened afresh.
+    Hdf5HandleCache::getCache().closeIdleFiles( handle );
+    
+    return FieldmlIoSession::getSession().setError( FML_IOERR_NO_ERROR );
+#else
+    return FieldmlIoSession::getSession().setError( FML_IOERR_UNSUPPORTED );
+#endif //FIELDML_HDF5_ARRAY || FIELDML_PHDF5_ARRAY
+}
+
+
+FmlIoErrorNumber Fieldml_SetStreamRequestCallback( FmlSessionHandle handle, Fieldml_StreamRequestCallbackFunction function, void *userData )
+{
+    if( Fieldml_GetLastError( handle ) == FML_ERR_UNKNOWN_HANDLE )
+    {
+        return FieldmlIoSession::getSession().setError( FML_IOERR_UNKNOWN_OBJECT );
+    }
+    
+    FieldmlIoSession::getSession().setStreamRequestCallback( handle, function, userData );
+    
+    return FieldmlIoSession::getSession().setError( FML_IOERR_NO_ERROR );
+}
+
+
+FmlIoErrorNumber Fieldml_WriteShardManifest( FmlSessionHandle handle, FmlObjectHandle resourceHandle, int shardCount, const int *firstRows,
+    const int *rowCounts, const char * const *formats, const char * const *hrefs )
+{
+    if( ( shardCount <= 0 ) || ( firstRows == NULL ) || ( rowCounts == NULL ) || ( formats == NULL ) || ( hrefs == NULL ) )
+    {
+        return FieldmlIoSession::getSession().setError( FML_IOERR_INVALID_PARAMETER );
+    }
+    
+    if( Fieldml_IsObjectLocal( handle, resourceHandle, 0 ) != 1 )
+    {
+        return FieldmlIoSession::getSession().setError( FML_IOERR_NONLOCAL_OBJECT );
+    }
+    
+    string format;
+    char *temp_string = Fieldml_GetDataResourceFormat( handle, resourceHandle );
+    bool valid = StringUtil::safeString( temp_string, format );
+    Fieldml_FreeString( temp_string );
+    if( !valid )
+    {
+        return FieldmlIoSession::getSession().setError( FML_IOERR_CORE_ERROR );
+    }
+    if( format != StringUtil::SHARDED_NAME )
+    {
+        return FieldmlIoSession::getSession().setError( FML_IOERR_UNSUPPORTED );
+    }
+    
+    vector<ShardManifest::Shard> shards( shardCount );
+    for( int i = 0; i < shardCount; i++ )
+    {
+        if( ( formats[i] == NULL ) || ( hrefs[i] == NULL ) )
+        {
+            return FieldmlIoSession::getSession().setError( FML_IOERR_INVALID_PARAMETER );
+        }
+        shards[i].firstRow = firstRows[i];
+        shards[i].rowCount = rowCounts[i];
+        shards[i].format = formats[i];
+        shards[i].href = hrefs[i];
+    }
+    if( !ShardManifest::validate( shards ) )
+    {
+        return FieldmlIoSession::getSession().setError( FML_IOERR_INVALID_PARAMETER );
+    }
+    const string text = ShardManifest::format( shards );
+    
+    FieldmlDataResourceType type = Fieldml_GetDataResourceType( handle, resourceHandle );
+    if( type == FML_DATA_RESOURCE_INLINE )
+    {
+        if( Fieldml_SetInlineData( handle, resourceHandle, text.c_str(), (int)text.length() ) != FML_ERR_NO_ERROR )
+        {
+            return FieldmlIoSession::getSession().setError( FML_IOERR_CORE_ERROR );
+        }
+    }
+    else if( type == FML_DATA_RESOURCE_HREF )
+    {
+        string root;
+        string href;
+        char *region_string = Fieldml_GetRegionRoot( handle );
+        char *temp_href = Fieldml_GetDataResourceHref( handle, resourceHandle );
+        valid = StringUtil::safeString( region_string, root ) && StringUtil::safeString( temp_href, href );
+        Fieldml_FreeString( region_string );
+        Fieldml_FreeString( temp_href );
+        if( !valid )
+        {
+            return FieldmlIoSession::getSession().setError( FML_IOERR_CORE_ERROR );
+        }
+        
+        FILE *file = fopen( StringUtil::makeFilename( root, href ).c_str(), "w" );
+        if( file == NULL )
+        {
+            return FieldmlIoSession::getSession().setError( FML_IOERR_WRITE_ERROR );
+        }
+        bool written = ( fwrite( text.data(), 1, text.length(), file ) == text.length() );
+        if( fclose( file ) != 0 )
+        {
+            written = false;
+        }
+        if( !written )
+        {
+            return FieldmlIoSession::getSession().setError( FML_IOERR_WRITE_ERROR );
+        }
+    }
+    else
+    {
+        return FieldmlIoSession::getSession().setError( FML_IOERR_UNSUPPORTED );
+    }
+    
+    //Data decoded from the shards of an earlier manifest may no longer be where it was.
+    lock_guard<recursive_mutex> guard( ArrayDataReader::getSharedStateLock() );
+    FieldmlIoSession::getSession().invalidateDataCache( handle, resourceHandle );
+    
+    return FieldmlIoSession::getSession().setError( FML_IOERR_NO_ERROR );
+}
@@ -47,7 +47,7 @@
  * \file
  * API notes:
  * 
- * If a function returns a FmlReaderHandle or FmlWriterHandle
+ * If a function returns a FmlReaderHandle, FmlWriterHandle or FmlRequestHandle
  * it will return FML_INVALID_HANDLE on error.
  */
 
@@ -75,6 +75,8 @@ typedef int32_t FmlReaderHandle;                ///< A handle to a data reader.
 
 typedef int32_t FmlWriterHandle;                ///< A handle to a data writer.
 
+typedef int32_t FmlRequestHandle;               ///< A handle to an asynchronous read request.
+
 typedef int32_t FmlIoErrorNumber;               ///< A FieldML IO library error code.
 
 /*
@@ -113,6 +115,123 @@ enum FieldmlStreamRequestStatus
     FML_STREAM_REQUEST_STATUS_END,
 };
 
+
+/**
+ * Hints about how a reader's data will be read, in the manner of posix_fadvise().
+ * 
+ * \see Fieldml_SetReaderAccessPattern
+ */
+enum FieldmlAccessPattern
+{
+    FML_ACCESS_PATTERN_NORMAL,          ///< No particular pattern. This is the default.
+    FML_ACCESS_PATTERN_SEQUENTIAL,      ///< Slabs will mostly be read in order, each starting where the last one ended.
+    FML_ACCESS_PATTERN_RANDOM,          ///< Slabs will be read in no particular order.
+};
+
+
+/**
+ * How the processes of a parallel program transfer data to and from a shared array.
+ * 
+ * \see Fieldml_SetReaderTransferMode
+ * \see Fieldml_SetWriterTransferMode
+ */
+enum FieldmlTransferMode
+{
+    FML_TRANSFER_MODE_INDEPENDENT,      ///< Each process transfers its own slabs independently of the others. This is the default.
+    FML_TRANSFER_MODE_COLLECTIVE,       ///< All processes transfer their slabs together, so that they can be combined into fewer, larger transfers.
+};
+
+
+/**
+ * Supplies the contents of an externally stored data resource on demand. The status is START when the resource's data
+ * is wanted from the beginning (including when a reader needs to go back to an earlier position), REQUESTED when the
+ * data following the last delivered chunk is wanted, and END when the stream is no longer needed, in which case the
+ * buffer is NULL. The callback should copy up to bufferSize bytes into the buffer, set bytesRead to the number copied,
+ * and return OK, END if there is no more data after these bytes, or ERROR.
+ * 
+ * \see Fieldml_SetStreamRequestCallback
+ */
+typedef FieldmlStreamRequestStatus (*Fieldml_StreamRequestCallbackFunction)( const char *href, FieldmlStreamRequestStatus status,
+    char *buffer, int bufferSize, int *bytesRead, void *userData );
+
+
+/**
+ * The callbacks that implement an application-defined array format. The open callbacks return the format's own
+ * reader or writer state, which is passed to the other callbacks, or NULL on failure. Any callback may be NULL, in which
+ * case the corresponding operation is unsupported. Readers opened with a buffer or image are given it, along with its
+ * length in bytes, which is negative if the caller didn't give one. Otherwise the buffer is NULL.
+ * 
+ * \see Fieldml_RegisterArrayFormat
+ */
+typedef struct
+{
+    void *(*openReader)( FmlSessionHandle handle, FmlObjectHandle sourceHandle, const char *root, void *buffer, int64_t bufferLength,
+        void *userData );
+    
+    FmlIoErrorNumber (*readIntSlab)( void *reader, const int *offsets, const int *sizes, int *valueBuffer );
+    
+    FmlIoErrorNumber (*readDoubleSlab)( void *reader, const int *offsets, const int *sizes, double *valueBuffer );
+    
+    FmlIoErrorNumber (*readBooleanSlab)( void *reader, const int *offsets, const int *sizes, FmlBoolean *valueBuffer );
+    
+    FmlIoErrorNumber (*closeReader)( void *reader );
+    
+    void *(*openWriter)( FmlSessionHandle handle, FmlObjectHandle sourceHandle, const char *root, FieldmlHandleType valueType,
+        FmlBoolean append, const int *sizes, int rank, void *userData );
+    
+    FmlIoErrorNumber (*writeIntSlab)( void *writer, const int *offsets, const int *sizes, const int *valueBuffer );
+    
+    FmlIoErrorNumber (*writeDoubleSlab)( void *writer, const int *offsets, const int *sizes, const double *valueBuffer );
+    
+    FmlIoErrorNumber (*writeBooleanSlab)( void *writer, const int *offsets, const int *sizes, const FmlBoolean *valueBuffer );
+    
+    FmlIoErrorNumber (*closeWriter)( void *writer );
+} FieldmlArrayFormatCallbacks;
+
+
+/**
+ * Options for how a writer lays out the arrays it creates. Currently only HDF5 and PHDF5 arrays use these options.
+ * Their storage is chunked if chunk sizes, compression, shuffling or an extendable array are asked for, and otherwise
+ * left contiguous. Other formats ignore the options, as do writers appending to an array that already exists.
+ * 
+ * \see Fieldml_OpenArrayWriterWithOptions
+ */
+typedef struct
+{
+    const int *chunkSizes;      ///< The size of each chunk in each dimension, or NULL to choose chunk sizes automatically if the array is chunked.
+    
+    int deflateLevel;           ///< The deflate compression level, from 1 to 9, or 0 for no compression.
+    
+    FmlBoolean shuffle;         ///< Whether to shuffle the bytes of each chunk's values before compressing them.
+    
+    FmlBoolean extendable;      ///< Whether the outermost dimension can grow without limit, e.g. one row per time step.
+    
+    int storageBits;            ///< The bits to store each value in, or 0 for the default of 64 for doubles and 32 for integers.
+    
+    FmlBoolean pagedFileSpace;  ///< Whether a file the writer creates has paged file space, which readers need in order to page buffer it.
+} FieldmlArrayWriterOptions;
+
+
+/**
+ * Tuning for the caches that HDF5 keeps for each open file. HDF5's defaults suit small or contiguous datasets. Chunked,
+ * compressed datasets that are read a few values at a time need a chunk cache that holds every chunk in use, or each
+ * read decompresses its chunk all over again. A zero leaves the corresponding setting at HDF5's default.
+ * 
+ * \see Fieldml_SetHdf5CacheOptions
+ */
+typedef struct
+{
+    int64_t chunkCacheBytes;        ///< The size of each dataset's raw data chunk cache, in bytes. HDF5's default is 1MB.
+    
+    int chunkCacheSlots;            ///< The number of chunk cache hash slots, ideally a prime about 100 times the number of chunks that fit.
+    
+    double chunkCachePreemption;    ///< From 0 to 1, how strongly chunks that have been read in full are preferred for eviction. Negative for the default.
+    
+    int64_t metadataCacheBytes;     ///< The initial size of each file's metadata cache, in bytes.
+    
+    int64_t pageBufferBytes;        ///< The size of each file's page buffer, in bytes. Zero, the default, disables page buffering.
+} FieldmlHdf5CacheOptions;
+
 /*
 
  API
@@ -134,8 +253,11 @@ FmlReaderHandle Fieldml_OpenReader( FmlSessionHandle handle, FmlObjectHandle obj
 
 /**
  * Creates a new reader for the given data source's raw data. Fieldml_CloseReader() should be called
- * when the caller no longer needs to use it. Reader created using this function will use an
- * external callback function user set later to read the required data in.
+ * when the caller no longer needs to use it. The buffer holds the data source's data resource contents,
+ * and is used in place of the resource's file or inline data.
+ *
+ * For text data sources, the buffer is a null-terminated string that is read in place rather than
+ * copied, so it must remain valid and unchanged until the reader is closed.
  *
  * \see Fieldml_ReadIntSlab
  * \see Fieldml_ReadDoubleSlab
@@ -144,6 +266,30 @@ FmlReaderHandle Fieldml_OpenReader( FmlSessionHandle handle, FmlObjectHandle obj
  */
 FmlReaderHandle Fieldml_OpenReaderWithBuffer( FmlSessionHandle handle, FmlObjectHandle objectHandle, void *buffer);
 
+/**
+ * As Fieldml_OpenReaderWithBuffer(), for an image of the data source's data resource that is imageLength bytes
+ * long. Text images need not be null-terminated. HDF5 data sources can only be read from an image, which is
+ * opened in place through HDF5's in-memory file driver rather than copied. As with any buffer, the image must
+ * remain valid and unchanged until the reader is closed.
+ * 
+ * \see Fieldml_OpenReaderWithBuffer
+ */
+FmlReaderHandle Fieldml_OpenReaderWithImage( FmlSessionHandle handle, FmlObjectHandle objectHandle, const void *image, int64_t imageLength );
+
+
+/**
+ * Sets the callback used to fetch the contents of the given session's href data resources, in place of opening the
+ * referenced files. Readers pull the data through the callback a chunk at a time as they need it, so text data can be
+ * read from pipes, network streams or decompressors without being staged in full. Formats that need random access to
+ * their data (e.g. RAW_BINARY) read the whole stream into memory when they are opened. HDF5 resources are not affected.
+ * As with files, text data that starts with the gzip magic number is decompressed as it is read, so the callback should
+ * serve the resource's data as stored. Passing a NULL function restores normal file access. The callback applies to
+ * readers opened after this call.
+ * 
+ * \see Fieldml_OpenReader
+ */
+FmlIoErrorNumber Fieldml_SetStreamRequestCallback( FmlSessionHandle handle, Fieldml_StreamRequestCallbackFunction function, void *userData );
+
 /**
  * Reads data from the multi-dimensional array specified by the given offsets and sizes into the given buffer. The first
  * size/offset is applied to the outermost index, and so on.
@@ -158,6 +304,13 @@ FmlIoErrorNumber Fieldml_ReadIntSlab( FmlReaderHandle readerHandle, const int *o
 FmlIoErrorNumber Fieldml_ReadDoubleSlab( FmlReaderHandle readerHandle, const int *offsets, const int *sizes, double *valueBuffer );
 
 
+/**
+ * As Fieldml_ReadDoubleSlab(), but delivering single precision values. HDF5 arrays stored as single precision values
+ * are read without ever being widened to doubles.
+ */
+FmlIoErrorNumber Fieldml_ReadFloatSlab( FmlReaderHandle readerHandle, const int *offsets, const int *sizes, float *valueBuffer );
+
+
 /**
  * Reads data from the multi-dimensional array specified by the given offsets and sizes into the given buffer. The first
  * size/offset is applied to the outermost index, and so on.
@@ -166,7 +319,247 @@ FmlIoErrorNumber Fieldml_ReadBooleanSlab( FmlReaderHandle readerHandle, const in
 
 
 /**
- * Closes the given data reader. The reader's handle should not be used after this call.
+ * Binds the given slab sizes to the reader, so that slabs of that shape can then be read by their offsets alone. Readers
+ * set up whatever they can for slabs of that shape up front, so that each read does as little work as possible. This
+ * suits code that reads many identically shaped slabs, e.g. one row per time step. Preparing again replaces the sizes.
+ * 
+ * \see Fieldml_ReadPreparedIntSlab
+ * \see Fieldml_ReadPreparedDoubleSlab
+ * \see Fieldml_ReadPreparedBooleanSlab
+ */
+FmlIoErrorNumber Fieldml_PrepareSlabReads( FmlReaderHandle readerHandle, const int *sizes );
+
+
+/**
+ * As Fieldml_ReadIntSlab(), using the sizes bound by Fieldml_PrepareSlabReads(). Returns FML_IOERR_UNSUPPORTED if
+ * the reader hasn't been prepared.
+ */
+FmlIoErrorNumber Fieldml_ReadPreparedIntSlab( FmlReaderHandle readerHandle, const int *offsets, int *valueBuffer );
+
+
+/**
+ * As Fieldml_ReadDoubleSlab(), using the sizes bound by Fieldml_PrepareSlabReads(). Returns FML_IOERR_UNSUPPORTED if
+ * the reader hasn't been prepared.
+ */
+FmlIoErrorNumber Fieldml_ReadPreparedDoubleSlab( FmlReaderHandle readerHandle, const int *offsets, double *valueBuffer );
+
+
+/**
+ * As Fieldml_ReadBooleanSlab(), using the sizes bound by Fieldml_PrepareSlabReads(). Returns FML_IOERR_UNSUPPORTED if
+ * the reader hasn't been prepared.
+ */
+FmlIoErrorNumber Fieldml_ReadPreparedBooleanSlab( FmlReaderHandle readerHandle, const int *offsets, FmlBoolean *valueBuffer );
+
+
+/**
+ * Reads every strides[i]'th value along each dimension of the array, starting at the given offsets and taking sizes[i]
+ * values along each, into the given buffer. Strides must be positive; strides of one read an ordinary slab. Formats
+ * that can select strided data directly (e.g. HDF5) do so, rather than reading the whole span of the slab.
+ */
+FmlIoErrorNumber Fieldml_ReadIntSlabStrided( FmlReaderHandle readerHandle, const int *offsets, const int *sizes, const int *strides, int *valueBuffer );
+
+
+/**
+ * The double-valued version of Fieldml_ReadIntSlabStrided().
+ */
+FmlIoErrorNumber Fieldml_ReadDoubleSlabStrided( FmlReaderHandle readerHandle, const int *offsets, const int *sizes, const int *strides, double *valueBuffer );
+
+
+/**
+ * The boolean-valued version of Fieldml_ReadIntSlabStrided().
+ */
+FmlIoErrorNumber Fieldml_ReadBooleanSlabStrided( FmlReaderHandle readerHandle, const int *offsets, const int *sizes, const int *strides, FmlBoolean *valueBuffer );
+
+
+/**
+ * Reads the given number of slabs in a single call, one after another into the given buffer. The offsets and sizes
+ * hold those of each slab in turn, as for Fieldml_ReadIntSlab(). Slabs may be given in any order, and may overlap.
+ * HDF5 data is read as a single selection. Other formats read the slabs in storage order, so that text data is not
+ * rewound between them where it can be avoided.
+ * 
+ * \see Fieldml_ReadIntPoints
+ */
+FmlIoErrorNumber Fieldml_ReadIntSlabList( FmlReaderHandle readerHandle, int slabCount, const int *offsets, const int *sizes, int *valueBuffer );
+
+
+/**
+ * The double-valued version of Fieldml_ReadIntSlabList().
+ */
+FmlIoErrorNumber Fieldml_ReadDoubleSlabList( FmlReaderHandle readerHandle, int slabCount, const int *offsets, const int *sizes, double *valueBuffer );
+
+
+/**
+ * The boolean-valued version of Fieldml_ReadIntSlabList().
+ */
+FmlIoErrorNumber Fieldml_ReadBooleanSlabList( FmlReaderHandle readerHandle, int slabCount, const int *offsets, const int *sizes, FmlBoolean *valueBuffer );
+
+
+/**
+ * Reads the values at the given number of points into the given buffer, in the order given. The points hold the
+ * indexes of each point in turn, outermost first. This gathers scattered values, e.g. the nodes of a set of elements,
+ * in one call; text data is read in a single forward pass, and HDF5 data as a single point selection.
+ */
+FmlIoErrorNumber Fieldml_ReadIntPoints( FmlReaderHandle readerHandle, int pointCount, const int *points, int *valueBuffer );
+
+
+/**
+ * The double-valued version of Fieldml_ReadIntPoints().
+ */
+FmlIoErrorNumber Fieldml_ReadDoublePoints( FmlReaderHandle readerHandle, int pointCount, const int *points, double *valueBuffer );
+
+
+/**
+ * The boolean-valued version of Fieldml_ReadIntPoints().
+ */
+FmlIoErrorNumber Fieldml_ReadBooleanPoints( FmlReaderHandle readerHandle, int pointCount, const int *points, FmlBoolean *valueBuffer );
+
+
+/**
+ * Starts reading data from the multi-dimensional array specified by the given offsets and sizes into the given buffer,
+ * returning as soon as the read has been queued. The read is done by one of the library's I/O worker threads, so the
+ * caller can get on with other work in the meantime. The offsets and sizes are copied, but the buffer must remain
+ * valid, and must not be used, until Fieldml_WaitRequest() has been called on the returned handle.
+ * 
+ * A reader may have any number of outstanding requests, which are serviced in order. Requests for different readers
+ * may be serviced at the same time. Stream request callbacks may be called on worker threads as a result.
+ * 
+ * \see Fieldml_WaitRequest
+ * \see Fieldml_TestRequest
+ */
+FmlRequestHandle Fieldml_ReadIntSlabAsync( FmlReaderHandle readerHandle, const int *offsets, const int *sizes, int *valueBuffer );
+
+
+/**
+ * The double-valued version of Fieldml_ReadIntSlabAsync().
+ * 
+ * \see Fieldml_ReadIntSlabAsync
+ */
+FmlRequestHandle Fieldml_ReadDoubleSlabAsync( FmlReaderHandle readerHandle, const int *offsets, const int *sizes, double *valueBuffer );
+
+
+/**
+ * The boolean-valued version of Fieldml_ReadIntSlabAsync().
+ * 
+ * \see Fieldml_ReadIntSlabAsync
+ */
+FmlRequestHandle Fieldml_ReadBooleanSlabAsync( FmlReaderHandle readerHandle, const int *offsets, const int *sizes, FmlBoolean *valueBuffer );
+
+
+/**
+ * Waits for the given asynchronous read to complete, and returns its result. The request handle is released, and
+ * can't be used again.
+ * 
+ * \see Fieldml_ReadIntSlabAsync
+ */
+FmlIoErrorNumber Fieldml_WaitRequest( FmlRequestHandle requestHandle );
+
+
+/**
+ * Sets isComplete to 1 if the given asynchronous read has completed, or 0 if it hasn't, without waiting. The request
+ * must still be waited on to get its result and release it.
+ * 
+ * \see Fieldml_ReadIntSlabAsync
+ */
+FmlIoErrorNumber Fieldml_TestRequest( FmlRequestHandle requestHandle, FmlBoolean *isComplete );
+
+
+/**
+ * Tells the given reader how its data is going to be read, so that it can fetch the data accordingly. For text data
+ * in files, or fetched through a stream request callback, a sequential pattern makes the reader fetch the next chunk
+ * of data on a helper thread while the current one is being parsed. For RAW_BINARY data, the hint is passed on to the
+ * operating system's paging. Readers that have no use for a hint ignore it.
+ * 
+ * \see Fieldml_OpenReader
+ */
+FmlIoErrorNumber Fieldml_SetReaderAccessPattern( FmlReaderHandle readerHandle, FieldmlAccessPattern pattern );
+
+
+/**
+ * Sets how the given reader's slab reads are done across the processes of a parallel program. Only PHDF5 data supports
+ * collective reads. In collective mode, every process in MPI_COMM_WORLD must make the same sequence of slab reads on its
+ * own reader for the same data source. Processes with nothing to read take part by reading an empty slab, i.e. one
+ * with a size of zero in some dimension. Collective reads bypass the session's data cache.
+ * 
+ * \see Fieldml_OpenReader
+ */
+FmlIoErrorNumber Fieldml_SetReaderTransferMode( FmlReaderHandle readerHandle, FieldmlTransferMode mode );
+
+
+/**
+ * Returns a pointer to the values of the given slab where they are stored, without copying them, or NULL if the
+ * reader can't do that. Only formats that keep their values in memory in the host's representation (e.g. RAW_BINARY)
+ * can, and then only for slabs that are contiguous in storage. The pointer is valid until the reader is closed.
+ * 
+ * \see Fieldml_ReadDoubleSlab
+ */
+const double *Fieldml_GetDoubleSlabPointer( FmlReaderHandle readerHandle, const int *offsets, const int *sizes );
+
+
+/**
+ * As Fieldml_GetDoubleSlabPointer(), but for integer data.
+ */
+const int *Fieldml_GetIntSlabPointer( FmlReaderHandle readerHandle, const int *offsets, const int *sizes );
+
+
+/**
+ * Creates a reader for a forward-only scan of the given data source's outermost rows. Each row is the full extent of
+ * the inner dimensions. The slab functions can still be used on the returned reader, and Fieldml_CloseReader() should
+ * be called when the caller no longer needs it.
+ * 
+ * \see Fieldml_ReadNextRows
+ * \see Fieldml_CloseReader
+ */
+FmlReaderHandle Fieldml_OpenRowIterator( FmlSessionHandle handle, FmlObjectHandle objectHandle );
+
+
+/**
+ * Reads up to maxRows of the next outermost rows into the given buffer, which must have room for maxRows rows.
+ * Returns the number of rows read, zero once all rows have been read, or -1 on error.
+ * 
+ * \see Fieldml_OpenRowIterator
+ */
+int Fieldml_ReadNextRows( FmlReaderHandle readerHandle, int maxRows, double *valueBuffer );
+
+
+/**
+ * As Fieldml_ReadNextRows(), but for integer data.
+ */
+int Fieldml_ReadNextIntRows( FmlReaderHandle readerHandle, int maxRows, int *valueBuffer );
+
+
+/**
+ * As Fieldml_ReadNextRows(), but for boolean data.
+ */
+int Fieldml_ReadNextBooleanRows( FmlReaderHandle readerHandle, int maxRows, FmlBoolean *valueBuffer );
+
+
+/**
+ * Registers an application-defined array format. Readers and writers opened on data resources with the given format
+ * will then use the given callbacks, which are copied. This replaces any format already registered with that name,
+ * including the library's own.
+ * 
+ * \see Fieldml_UnregisterArrayFormat
+ */
+FmlIoErrorNumber Fieldml_RegisterArrayFormat( const char *format, const FieldmlArrayFormatCallbacks *callbacks, void *userData );
+
+
+/**
+ * Removes the given array format, so that resources in that format can no longer be read or written.
+ * 
+ * \see Fieldml_RegisterArrayFormat
+ */
+FmlIoErrorNumber Fieldml_UnregisterArrayFormat( const char *format );
+
+
+/**
+ * \return 1 if readers and writers can be opened for resources in the given format, 0 if not.
+ */
+FmlBoolean Fieldml_IsArrayFormatRegistered( const char *format );
+
+
+/**
+ * Closes the given data reader, once any of its asynchronous reads still in progress have completed. The reader's
+ * handle should not be used after this call, though its completed requests must still be waited on.
  * 
  * \see Fieldml_OpenReader
  */
@@ -183,6 +576,29 @@ FmlIoErrorNumber Fieldml_CloseReader( FmlReaderHandle readerHandle );
  */
 FmlWriterHandle Fieldml_OpenArrayWriter( FmlSessionHandle handle, FmlObjectHandle objectHandle, FmlObjectHandle typeHandle, FmlBoolean append, int *sizes, int rank );
 
+
+/**
+ * As Fieldml_OpenArrayWriter(), but with the given options for the layout of any array the writer creates. Chunk
+ * sizes larger than the array are clipped to the array's size. Automatic chunk sizes are chosen from the array's sizes,
+ * filling the innermost dimensions first up to about 1MB, since the array is created before any slab is written.
+ * Deflate levels outside 0 to 9 are invalid. If the options are NULL, this is the same as Fieldml_OpenArrayWriter().
+ * 
+ * Extendable arrays may start out with no outermost rows at all. Writes past the end of an HDF5 array that has
+ * unlimited dimensions, whether created by this writer or already in the file, grow the array to fit. The data
+ * source's raw sizes grow with it, as do any of its sizes that ran to the end of the array. PHDF5 arrays can only grow
+ * with the collective transfer mode, in which every process takes part in every write, even with an empty slab, and
+ * the array grows to hold all of their slabs. Writes past the end with the independent transfer mode are unsupported.
+ * 
+ * Doubles can be stored in 32 bits, as single precision values, and integers in 16 bits, halving the size of the array
+ * when the values' precision or range allows it. Values are converted as they are written, and converted back as they
+ * are read. Writes of integers that don't fit in 16 bits fail, whereas doubles just lose precision. Any other storage
+ * size is unsupported.
+ * 
+ * \see Fieldml_OpenArrayWriter
+ */
+FmlWriterHandle Fieldml_OpenArrayWriterWithOptions( FmlSessionHandle handle, FmlObjectHandle objectHandle, FmlObjectHandle typeHandle, FmlBoolean append,
+    int *sizes, int rank, const FieldmlArrayWriterOptions *options );
+
 /**
  * Write out some integer values to the given data writer. The data will be interpreted as an n-dimensional array of
  * the given size, and written out at the given offset. The first
@@ -225,6 +641,87 @@ FmlIoErrorNumber Fieldml_WriteBooleanSlab( FmlWriterHandle writerHandle, const i
  */
 FmlIoErrorNumber Fieldml_CloseWriter( FmlWriterHandle writerHandle );
 
+
+/**
+ * Sets how the given writer's slab writes are done across the processes of a parallel program. Only PHDF5 data
+ * supports collective writes. In collective mode, every process in MPI_COMM_WORLD must make the same sequence of slab
+ * writes on its own writer for the same data source. Processes with nothing to write take part by writing an empty
+ * slab, i.e. one with a size of zero in some dimension.
+ * 
+ * \see Fieldml_OpenArrayWriter
+ */
+FmlIoErrorNumber Fieldml_SetWriterTransferMode( FmlWriterHandle writerHandle, FieldmlTransferMode mode );
+
+
+/**
+ * Sets the number of threads that text writers opened from now on use to format large slabs for files. Zero, the
+ * default, uses one thread per processor, and one formats everything on the writing thread. Writers fall back to
+ * formatting on the writing thread if no more threads can be started.
+ * 
+ * \see Fieldml_OpenArrayWriter
+ */
+FmlIoErrorNumber Fieldml_SetTextWriterThreads( int threadCount );
+
+
+/**
+ * Sets the maximum number of bytes of decoded array data that the given session may cache. Readers opened after
+ * this call share the cache, so data sources that view the same data resource only decode overlapping data once.
+ * Cached data for a data resource is discarded whenever a writer is opened or closed on that resource.
+ * A limit of zero, which is the default, disables caching and discards any data already cached.
+ * 
+ * \see Fieldml_GetDataCacheStatistics
+ * \see Fieldml_ClearDataCache
+ */
+FmlIoErrorNumber Fieldml_SetDataCacheLimit( FmlSessionHandle handle, int64_t byteLimit );
+
+
+/**
+ * Gets the number of cache hits and misses for the given session's decoded data cache, along with the number of bytes
+ * currently cached. Hits and misses are counted per cached block, not per read.
+ * 
+ * \see Fieldml_SetDataCacheLimit
+ */
+FmlIoErrorNumber Fieldml_GetDataCacheStatistics( FmlSessionHandle handle, int64_t *hits, int64_t *misses, int64_t *bytesUsed );
+
+
+/**
+ * Discards all decoded data cached for the given session. The cache's limit and statistics are unaffected.
+ * 
+ * \see Fieldml_SetDataCacheLimit
+ */
+FmlIoErrorNumber Fieldml_ClearDataCache( FmlSessionHandle handle );
+
+
+/**
+ * Sets how the given session's HDF5 and PHDF5 files are cached by HDF5, or restores the defaults if the options are
+ * NULL. The options apply to files opened after this call; files that are already open keep their settings until
+ * their last reader or writer is closed.
+ * 
+ * The options only change how files are opened, not how they are created. Page buffering only applies to files with
+ * paged file space, which writers only create when their options ask for it, and other files are opened without a page
+ * buffer. Parallel files are never page buffered.
+ * 
+ * Returns FML_IOERR_UNSUPPORTED if the library was built without HDF5 support.
+ * 
+ * \see FieldmlHdf5CacheOptions
+ */
+FmlIoErrorNumber Fieldml_SetHdf5CacheOptions( FmlSessionHandle handle, const FieldmlHdf5CacheOptions *options );
+
+
+/**
+ * Writes the manifest of the given SHARDED data resource, whose arrays have their outermost rows split across several
+ * shards. Shard i holds rowCounts[i] rows starting at row firstRows[i], in a data resource of its own with the given
+ * format and href. Shard hrefs are relative to the manifest's directory, and each shard holds its rows at the location
+ * of the data source being read or written. Shards may not overlap, and may not be sharded themselves. Href resources'
+ * manifests are written to file, and inline resources' manifests become their inline data.
+ * 
+ * Readers of sharded data sources assemble slabs that span several shards from each shard in turn. Writers only open
+ * the shards that they write to, so once the manifest is in place, each process of a parallel job can write its own
+ * rows to a shard of its own without any coordination.
+ */
+FmlIoErrorNumber Fieldml_WriteShardManifest( FmlSessionHandle handle, FmlObjectHandle resourceHandle, int shardCount, const int *firstRows,
+    const int *rowCounts, const char * const *formats, const char * const *hrefs );
+
 }
 
 #endif // __cplusplus
@@ -47,6 +47,12 @@ using namespace std;
 
 FieldmlIoSession FieldmlIoSession::singleton;
 
+thread_local FmlIoErrorNumber FieldmlIoSession::lastError = FML_IOERR_NO_ERROR;
+
+thread_local int FieldmlIoSession::contextLine = 0;
+
+thread_local const char *FieldmlIoSession::contextFile = NULL;
+
 class FieldmlIoSessionContext :
     public FieldmlIoContext
 {
@@ -94,7 +100,6 @@ FieldmlIoSession &FieldmlIoSession::getSession()
 FieldmlIoSession::FieldmlIoSession()
 {
     debug = 1;
-    lastError = FML_IOERR_NO_ERROR;
 }
 
 
@@ -108,6 +113,10 @@ FieldmlIoSession::~FieldmlIoSession()
     {
         delete *i;
     }
+    for( map<FmlSessionHandle, ArrayDataCache*>::iterator i = dataCaches.begin(); i != dataCaches.end(); i++ )
+    {
+        delete i->second;
+    }
 }
 
 
@@ -159,6 +168,112 @@ FieldmlIoContext *FieldmlIoSession::createContext( FmlSessionHandle session )
 }
 
 
+void FieldmlIoSession::pruneDataCaches()
+{
+    //Session handles are never reused, so a cache belonging to a destroyed session can never be hit again.
+    map<FmlSessionHandle, ArrayDataCache*>::iterator i = dataCaches.begin();
+    while( i != dataCaches.end() )
+    {
+        map<FmlSessionHandle, ArrayDataCache*>::iterator next = i;
+        next++;
+        if( Fieldml_GetLastError( i->first ) == FML_ERR_UNKNOWN_HANDLE )
+        {
+            delete i->second;
+            dataCaches.erase( i );
+        }
+        i = next;
+    }
+}
+
+
+ArrayDataCache *FieldmlIoSession::getDataCache( FmlSessionHandle session, bool create )
+{
+    map<FmlSessionHandle, ArrayDataCache*>::iterator i = dataCaches.find( session );
+    if( i != dataCaches.end() )
+    {
+        return i->second;
+    }
+    
+    if( !create )
+    {
+        return NULL;
+    }
+    
+    pruneDataCaches();
+    
+    ArrayDataCache *cache = new ArrayDataCache();
+    dataCaches[session] = cache;
+    
+    return cache;
+}
+
+
+void FieldmlIoSession::invalidateDataCache( FmlSessionHandle session, FmlObjectHandle resource )
+{
+    lock_guard<recursive_mutex> guard( ArrayDataReader::getSharedStateLock() );
+    
+    ArrayDataCache *cache = getDataCache( session, false );
+    if( cache != NULL )
+    {
+        cache->invalidate( resource );
+    }
+}
+
+
+void FieldmlIoSession::setStreamRequestCallback( FmlSessionHandle session, Fieldml_StreamRequestCallbackFunction function, void *userData )
+{
+    if( function == NULL )
+    {
+        streamCallbacks.erase( session );
+        return;
+    }
+    
+    StreamRequestCallback callback;
+    callback.function = function;
+    callback.userData = userData;
+    streamCallbacks[session] = callback;
+}
+
+
+Fieldml_StreamRequestCallbackFunction FieldmlIoSession::getStreamRequestCallback( FmlSessionHandle session, void *&userData )
+{
+    map<FmlSessionHandle, StreamRequestCallback>::iterator i = streamCallbacks.find( session );
+    if( i == streamCallbacks.end() )
+    {
+        userData = NULL;
+        return NULL;
+    }
+    
+    userData = i->second.userData;
+    return i->second.function;
+}
+
+
+void FieldmlIoSession::setHdf5CacheOptions( FmlSessionHandle session, const FieldmlHdf5CacheOptions *options )
+{
+    if( options == NULL )
+    {
+        hdf5CacheOptions.erase( session );
+        return;
+    }
+    
+    hdf5CacheOptions[session] = *options;
+}
+
+
+bool FieldmlIoSession::getHdf5CacheOptions( FmlSessionHandle session, FieldmlHdf5CacheOptions &options )
+{
+    map<FmlSessionHandle, FieldmlHdf5CacheOptions>::iterator i = hdf5CacheOptions.find( session );
+    if( i == hdf5CacheOptions.end() )
+    {
+        return false;
+    }
+    
+    options = i->second;
+    return true;
+}
+
+
 ArrayDataReader *FieldmlIoSession::handleToReader( FmlReaderHandle handle )
 {
     if( ( handle < 0 ) || ( (unsigned int)handle >= readers.size() ) )
@@ -44,19 +44,29 @@
 
 #include <vector>
 #include <set>
+#include <map>
 
 #include "FieldmlIoContext.h"
 #include "ArrayDataReader.h"
 #include "ArrayDataWriter.h"
+#include "ArrayDataCache.h"
 
 class FieldmlIoSession
 {
 private:
-    FmlIoErrorNumber lastError;
+    class StreamRequestCallback
+    {
+    public:
+        Fieldml_StreamRequestCallbackFunction function;
+        void *userData;
+    };
     
-    int contextLine;
+    //Per thread, so that reads done by the I/O workers don't clobber the application's error state.
+    static thread_local FmlIoErrorNumber lastError;
     
-    const char *contextFile;
+    static thread_local int contextLine;
+    
+    static thread_local const char *contextFile;
     
     int debug;
     
@@ -64,8 +74,16 @@ private:
     
     std::vector<ArrayDataWriter *> writers;
     
+    std::map<FmlSessionHandle, ArrayDataCache *> dataCaches;
+    
+    std::map<FmlSessionHandle, StreamRequestCallback> streamCallbacks;
+    
+    std::map<FmlSessionHandle, FieldmlHdf5CacheOptions> hdf5CacheOptions;
+    
     static FieldmlIoSession singleton;
     
+    void pruneDataCaches();
+    
 public:
     FieldmlIoSession();
 
@@ -93,6 +111,24 @@ public:
 
     FieldmlIoContext *createContext( FmlSessionHandle session );
 
+    ArrayDataCache *getDataCache( FmlSessionHandle session, bool create );
+    
+    void invalidateDataCache( FmlSessionHandle session, FmlObjectHandle resource );
+    
+    void setStreamRequestCallback( FmlSessionHandle session, Fieldml_StreamRequestCallbackFunction function, void *userData );
+    
+    /**
+     * Returns the session's stream request callback, or NULL if it doesn't have one.
+     */
+    Fieldml_StreamRequestCallbackFunction getStreamRequestCallback( FmlSessionHandle session, void *&userData );
+    
+    void setHdf5CacheOptions( FmlSessionHandle session, const FieldmlHdf5CacheOptions *options );
+    
+    /**
+     * Gets the session's HDF5 cache options, returning false if it doesn't have any.
+     */
+    bool getHdf5CacheOptions( FmlSessionHandle session, FieldmlHdf5CacheOptions &options );
+
     static FieldmlIoSession &getSession(); 
 };
 
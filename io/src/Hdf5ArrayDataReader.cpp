@@ -39,16 +39,41 @@
  *
  */
 
+#include <cstring>
+#include <vector>
+
 #include "StringUtil.h"
 #include "FieldmlIoApi.h"
 
 #include "Hdf5ArrayDataReader.h"
+#include "Hdf5HandleCache.h"
 
 using namespace std;
 
 #if defined FIELDML_HDF5_ARRAY || FIELDML_PHDF5_ARRAY
 
-Hdf5ArrayDataReader *Hdf5ArrayDataReader::create( FieldmlIoContext *context, const string root, FmlObjectHandle source )
+//The memory datatype that values of the given type are read as.
+static hid_t getNativeType( ArrayDataValueType valueType )
+{
+    if( valueType == ARRAY_VALUE_INT )
+    {
+        return H5T_NATIVE_INT;
+    }
+    else if( valueType == ARRAY_VALUE_DOUBLE )
+    {
+        return H5T_NATIVE_DOUBLE;
+    }
+    else if( valueType == ARRAY_VALUE_FLOAT )
+    {
+        return H5T_NATIVE_FLOAT;
+    }
+    
+    return H5T_NATIVE_INT8;
+}
+
+
+Hdf5ArrayDataReader *Hdf5ArrayDataReader::create( FieldmlIoContext *context, const string root, FmlObjectHandle source,
+    const void *image, int64_t imageLength )
 {
     Hdf5ArrayDataReader *reader = NULL;
 
@@ -60,10 +85,15 @@ Hdf5ArrayDataReader *Hdf5ArrayDataReader::create( FieldmlIoContext *context, con
     {
         context->setError( FML_IOERR_CORE_ERROR );
     }
+    else if( ( image != NULL ) && ( ( imageLength <= 0 ) || ( format != StringUtil::HDF5_NAME ) ) )
+    {
+        //An HDF5 file can't be opened without knowing how long it is, and parallel files have to be on disk.
+        context->setError( FML_IOERR_UNSUPPORTED );
+    }
     else if( format == StringUtil::HDF5_NAME )
     {
 #ifdef FIELDML_HDF5_ARRAY
-        Hdf5ArrayDataReader *hdf5reader = new Hdf5ArrayDataReader( context, root, source, H5P_DEFAULT );
+        Hdf5ArrayDataReader *hdf5reader = new Hdf5ArrayDataReader( context, root, source, H5P_DEFAULT, image, imageLength );
         if( !hdf5reader->ok )
         {
             delete hdf5reader;
@@ -80,7 +110,7 @@ Hdf5ArrayDataReader *Hdf5ArrayDataReader::create( FieldmlIoContext *context, con
         hid_t accessProperties = H5Pcreate( H5P_FILE_ACCESS );
         if( H5Pset_fapl_mpio( accessProperties, MPI_COMM_WORLD, MPI_INFO_NULL ) >= 0 )
         {
-            Hdf5ArrayDataReader *hdf5reader = new Hdf5ArrayDataReader( context, root, source, accessProperties );
+            Hdf5ArrayDataReader *hdf5reader = new Hdf5ArrayDataReader( context, root, source, accessProperties, NULL, 0 );
             if( !hdf5reader->ok )
             {
                 delete hdf5reader;
@@ -100,29 +130,35 @@ Hdf5ArrayDataReader *Hdf5ArrayDataReader::create( FieldmlIoContext *context, con
 
 
 #if defined FIELDML_HDF5_ARRAY || FIELDML_PHDF5_ARRAY
-Hdf5ArrayDataReader::Hdf5ArrayDataReader( FieldmlIoContext *_context, const string root, FmlObjectHandle source, hid_t accessProperties ) :
+Hdf5ArrayDataReader::Hdf5ArrayDataReader( FieldmlIoContext *_context, const string root, FmlObjectHandle source, hid_t accessProperties,
+    const void *image, int64_t imageLength ) :
     ArrayDataReader( _context ),
     closed( false )
 {
+    file = -1;
+    dataset = -1;
+    dataspace = -1;
+    storageClass = H5T_NO_CLASS;
+    storageSize = 0;
+    
     hStrides = NULL;
     hSizes = NULL;
     hOffsets = NULL;
+    sourceOffsets = NULL;
+    selectedSizes = NULL;
+    hShifts = NULL;
+    
+    memorySpace = -1;
+    selectionValid = false;
+    
+    parallel = ( accessProperties != H5P_DEFAULT );
+    transferProperties = H5P_DEFAULT;
     
     ok = false;
     closed = true;
 
     while( true )
     {
-        FmlObjectHandle resource = Fieldml_GetDataSourceResource( context->getSession(), source );
-
-        string description;
-        char *temp_href = Fieldml_GetDataResourceHref( context->getSession(), resource );
-        if( !StringUtil::safeString( temp_href, description ) )
-        {
-            break;
-        }
-        Fieldml_FreeString(temp_href);
-
         string location;
         char *temp_string = Fieldml_GetArrayDataSourceLocation( context->getSession(), source );
         if( !StringUtil::safeString( temp_string, location ) )
@@ -131,15 +167,32 @@ Hdf5ArrayDataReader::Hdf5ArrayDataReader( FieldmlIoContext *_context, const stri
         }
         Fieldml_FreeString(temp_string);
 
-        const string filename = StringUtil::makeFilename( root, description );
+        if( image != NULL )
+        {
+            file = Hdf5HandleCache::getCache().openImage( context->getSession(), image, imageLength );
+        }
+        else
+        {
+            FmlObjectHandle resource = Fieldml_GetDataSourceResource( context->getSession(), source );
+
+            string description;
+            char *temp_href = Fieldml_GetDataResourceHref( context->getSession(), resource );
+            if( !StringUtil::safeString( temp_href, description ) )
+            {
+                break;
+            }
+            Fieldml_FreeString(temp_href);
+
+            const string filename = StringUtil::makeFilename( root, description );
 
-        file = H5Fopen( filename.c_str(), H5F_ACC_RDONLY, accessProperties );
+            file = Hdf5HandleCache::getCache().openFile( context->getSession(), filename, HDF5_FILE_READ, accessProperties, false );
+        }
         if( file < 0 )
         {
             break;
         }
         
-        dataset = H5Dopen( file, location.c_str(), H5P_DEFAULT );
+        dataset = Hdf5HandleCache::getCache().openDataset( file, location );
         if( dataset < 0 )
         {
             break;
@@ -157,70 +210,177 @@ Hdf5ArrayDataReader::Hdf5ArrayDataReader( FieldmlIoContext *_context, const stri
             break;
         }
         
-        datatype = H5Dget_type( dataset );
+        hid_t datatype = H5Dget_type( dataset );
         if( datatype < 0 )
         {
             break;
         }
+        storageClass = H5Tget_class( datatype );
+        storageSize = H5Tget_size( datatype );
+        H5Tclose( datatype );
         
         hOffsets = new hsize_t[rank];
         hSizes = new hsize_t[rank];
         hStrides = new hsize_t[rank];
+        selectedSizes = new hsize_t[rank];
+        hShifts = new hssize_t[rank];
+        sourceOffsets = new hsize_t[rank];
         for( int i = 0; i < rank; i++ )
         {
             hStrides[i] = 1;
+            sourceOffsets[i] = 0;
         }
-    
-        hid_t nativeType = H5Tget_native_type( datatype, H5T_DIR_DESCEND );
-        if( H5Tequal( nativeType, H5T_NATIVE_INT ) || H5Tequal( nativeType, H5T_NATIVE_SHORT ) )
-        {
-            datatype = H5T_NATIVE_INT;
-        }
-        else if( H5Tequal( nativeType, H5T_NATIVE_DOUBLE ) || H5Tequal( nativeType, H5T_NATIVE_FLOAT ) )
-        {
-            datatype = H5T_NATIVE_DOUBLE;
-        }
-        else if( H5Tequal( nativeType, H5T_NATIVE_INT8 ) )
+        
+        //A source whose rank doesn't match the dataset's can't be read anyway.
+        if( Fieldml_GetArrayDataSourceRank( context->getSession(), source ) == rank )
         {
-            datatype = H5T_NATIVE_INT8;
+            int *offsets = new int[rank];
+            Fieldml_GetArrayDataSourceOffsets( context->getSession(), source, offsets );
+            for( int i = 0; i < rank; i++ )
+            {
+                sourceOffsets[i] = ( offsets[i] > 0 ) ? offsets[i] : 0;
+            }
+            delete[] offsets;
         }
         
         ok = true;
         closed = false;
         break;
     }
+    
+    if( !ok )
+    {
+        releaseHandles();
+    }
 }
 
 
-FmlIoErrorNumber Hdf5ArrayDataReader::readSlab( const int *offsets, const int *sizes, hid_t requiredDatatype, void *valueBuffer )
+void Hdf5ArrayDataReader::releaseHandles()
 {
-    if( datatype != requiredDatatype )
+    if( dataspace >= 0 )
     {
-        return context->setError( FML_IOERR_UNSUPPORTED );
+        H5Sclose( dataspace );
+        dataspace = -1;
+    }
+    if( dataset >= 0 )
+    {
+        Hdf5HandleCache::getCache().closeDataset( file, dataset );
+        dataset = -1;
+    }
+    if( file >= 0 )
+    {
+        Hdf5HandleCache::getCache().closeFile( file );
+        file = -1;
+    }
+}
+
+
+bool Hdf5ArrayDataReader::canRead( hid_t requiredDatatype )
+{
+    //Booleans are only ever stored as bytes. Integers can be read as any numeric type, but reading floating point
+    //values as integers would silently truncate them.
+    if( requiredDatatype == H5T_NATIVE_INT8 )
+    {
+        return ( storageClass == H5T_INTEGER ) && ( storageSize == 1 );
+    }
+    else if( requiredDatatype == H5T_NATIVE_INT )
+    {
+        return ( storageClass == H5T_INTEGER );
     }
+    
+    return ( storageClass == H5T_INTEGER ) || ( storageClass == H5T_FLOAT );
+}
 
+
+bool Hdf5ArrayDataReader::selectShape( const int *sizes )
+{
+    if( selectionValid )
+    {
+        bool sameShape = true;
+        for( int i = 0; sameShape && ( i < rank ); i++ )
+        {
+            sameShape = ( selectedSizes[i] == (hsize_t)sizes[i] );
+        }
+        if( sameShape )
+        {
+            return true;
+        }
+    }
+    
+    selectionValid = false;
+    if( memorySpace >= 0 )
+    {
+        H5Sclose( memorySpace );
+        memorySpace = -1;
+    }
+    
     for( int i = 0; i < rank; i++ )
     {
-        hOffsets[i] = offsets[i];
+        hOffsets[i] = 0;
         hSizes[i] = sizes[i];
     }
     
-    hid_t bufferSpace = H5Screate_simple( rank, hSizes, NULL );
+    memorySpace = H5Screate_simple( rank, hSizes, NULL );
+    if( ( memorySpace < 0 ) || ( H5Sselect_hyperslab( dataspace, H5S_SELECT_SET, hOffsets, NULL, hSizes, NULL ) < 0 ) )
+    {
+        return false;
+    }
+    
+    for( int i = 0; i < rank; i++ )
+    {
+        selectedSizes[i] = hSizes[i];
+    }
+    selectionValid = true;
     
-    herr_t status;
-    status = H5Sselect_hyperslab( dataspace, H5S_SELECT_SET, hOffsets, NULL, hSizes, NULL );
+    return true;
+}
 
-    hid_t transferProperties = H5P_DEFAULT;
 
-    //if( collective )
-    //{
-    //    transferProperties = H5Pcreate (H5P_DATASET_XFER);
-    //    H5Pset_dxpl_mpio(transferProperties, H5FD_MPIO_COLLECTIVE);
-    //}
-        
-    status = H5Dread( dataset, requiredDatatype, bufferSpace, dataspace, transferProperties, valueBuffer );
+FmlIoErrorNumber Hdf5ArrayDataReader::prepareSlabReads( const int *sizes )
+{
+    if( closed )
+    {
+        return FML_IOERR_RESOURCE_CLOSED;
+    }
+    
+    for( int i = 0; i < rank; i++ )
+    {
+        if( sizes[i] <= 0 )
+        {
+            //Nothing to set up for empty or invalid slabs. Reads will deal with them.
+            return FML_IOERR_NO_ERROR;
+        }
+    }
+    
+    if( !selectShape( sizes ) )
+    {
+        return context->setError( FML_IOERR_READ_ERROR );
+    }
+    
+    return FML_IOERR_NO_ERROR;
+}
+
+
+FmlIoErrorNumber Hdf5ArrayDataReader::readSelection( hid_t requiredDatatype, hsize_t valueCount, void *valueBuffer )
+{
+    //Whatever is selected is read from where it is, not from where the last slab was.
+    for( int i = 0; i < rank; i++ )
+    {
+        hShifts[i] = 0;
+    }
+    H5Soffset_simple( dataspace, hShifts );
+    selectionValid = false;
     
-    //H5Pclose( transferProperties );
+    //Collective reads need every process to take part, even those that have nothing to read.
+    hsize_t bufferSize = ( valueCount > 0 ) ? valueCount : 1;
+    hid_t bufferSpace = H5Screate_simple( 1, &bufferSize, NULL );
+    if( valueCount == 0 )
+    {
+        H5Sselect_none( bufferSpace );
+        H5Sselect_none( dataspace );
+    }
+    
+    herr_t status = H5Dread( dataset, requiredDatatype, bufferSpace, dataspace, transferProperties, valueBuffer );
     
     H5Sclose( bufferSpace );
     
@@ -233,6 +393,54 @@ FmlIoErrorNumber Hdf5ArrayDataReader::readSlab( const int *offsets, const int *s
 }
 
 
+FmlIoErrorNumber Hdf5ArrayDataReader::readSlab( const int *offsets, const int *sizes, hid_t requiredDatatype, void *valueBuffer )
+{
+    if( !canRead( requiredDatatype ) )
+    {
+        return context->setError( FML_IOERR_UNSUPPORTED );
+    }
+
+    bool empty = false;
+    for( int i = 0; i < rank; i++ )
+    {
+        if( sizes[i] == 0 )
+        {
+            empty = true;
+        }
+    }
+    
+    if( empty && ( transferProperties == H5P_DEFAULT ) )
+    {
+        return FML_IOERR_NO_ERROR;
+    }
+    
+    if( empty )
+    {
+        return readSelection( requiredDatatype, 0, valueBuffer );
+    }
+    
+    if( !selectShape( sizes ) )
+    {
+        return context->setError( FML_IOERR_READ_ERROR );
+    }
+    
+    //Slabs that don't fit in the dataset are caught by the read itself.
+    for( int i = 0; i < rank; i++ )
+    {
+        hShifts[i] = sourceOffsets[i] + offsets[i];
+    }
+    H5Soffset_simple( dataspace, hShifts );
+    
+    herr_t status = H5Dread( dataset, requiredDatatype, memorySpace, dataspace, transferProperties, valueBuffer );
+    if( status >= 0 )
+    {
+        return FML_IOERR_NO_ERROR;
+    }
+    
+    return context->setError( FML_IOERR_READ_ERROR );
+}
+
+
 FmlIoErrorNumber Hdf5ArrayDataReader::readIntSlab( const int *offsets, const int *sizes, int *valueBuffer )
 {
     if( closed )
@@ -255,6 +463,17 @@ FmlIoErrorNumber Hdf5ArrayDataReader::readDoubleSlab( const int *offsets, const
 }
 
 
+FmlIoErrorNumber Hdf5ArrayDataReader::readFloatSlab( const int *offsets, const int *sizes, float *valueBuffer )
+{
+    if( closed )
+    {
+        return FML_IOERR_RESOURCE_CLOSED;
+    }
+    
+    return readSlab( offsets, sizes, H5T_NATIVE_FLOAT, valueBuffer );
+}
+
+
 FmlIoErrorNumber Hdf5ArrayDataReader::readBooleanSlab( const int *offsets, const int *sizes, FmlBoolean *valueBuffer )
 {
     if( closed )
@@ -266,6 +485,276 @@ FmlIoErrorNumber Hdf5ArrayDataReader::readBooleanSlab( const int *offsets, const
 }
 
 
+FmlIoErrorNumber Hdf5ArrayDataReader::readStridedSlab( ArrayDataValueType valueType, const int *offsets, const int *sizes, const int *strides, void *valueBuffer )
+{
+    if( closed )
+    {
+        return FML_IOERR_RESOURCE_CLOSED;
+    }
+    
+    const hid_t requiredDatatype = getNativeType( valueType );
+    if( !canRead( requiredDatatype ) )
+    {
+        return context->setError( FML_IOERR_UNSUPPORTED );
+    }
+    
+    hsize_t valueCount = 1;
+    for( int i = 0; i < rank; i++ )
+    {
+        hOffsets[i] = sourceOffsets[i] + offsets[i];
+        hSizes[i] = sizes[i];
+        hStrides[i] = strides[i];
+        valueCount *= sizes[i];
+    }
+    
+    if( valueCount == 0 )
+    {
+        return readSlab( offsets, sizes, requiredDatatype, valueBuffer );
+    }
+    
+    herr_t status = H5Sselect_hyperslab( dataspace, H5S_SELECT_SET, hOffsets, hStrides, hSizes, NULL );
+    for( int i = 0; i < rank; i++ )
+    {
+        hStrides[i] = 1;
+    }
+    if( status < 0 )
+    {
+        selectionValid = false;
+        return context->setError( FML_IOERR_READ_ERROR );
+    }
+    
+    return readSelection( requiredDatatype, valueCount, valueBuffer );
+}
+
+
+FmlIoErrorNumber Hdf5ArrayDataReader::readSlabList( ArrayDataValueType valueType, int slabCount, const int *offsets, const int *sizes, void *valueBuffer )
+{
+    if( closed )
+    {
+        return FML_IOERR_RESOURCE_CLOSED;
+    }
+    
+    const hid_t requiredDatatype = getNativeType( valueType );
+    if( !canRead( requiredDatatype ) )
+    {
+        return context->setError( FML_IOERR_UNSUPPORTED );
+    }
+    
+    vector<int> order;
+    sortSlabs( slabCount, rank, offsets, order );
+    
+    //A union of hyperslabs is read in storage order. This only keeps each slab's values together if no outermost row
+    //is in more than one slab. Any other list of slabs is read as a list of points instead.
+    vector<hsize_t> slabValues( slabCount );
+    hsize_t valueCount = 0;
+    int rowEnd = 0;
+    bool disjoint = true;
+    for( int i = 0; i < slabCount; i++ )
+    {
+        const int slab = order[i];
+        const int *slabOffsets = offsets + ( slab * rank );
+        const int *slabSizes = sizes + ( slab * rank );
+        
+        slabValues[slab] = 1;
+        for( int j = 0; j < rank; j++ )
+        {
+            slabValues[slab] *= slabSizes[j];
+        }
+        if( slabValues[slab] == 0 )
+        {
+            continue;
+        }
+        
+        if( ( valueCount > 0 ) && ( slabOffsets[0] < rowEnd ) )
+        {
+            disjoint = false;
+        }
+        rowEnd = slabOffsets[0] + slabSizes[0];
+        valueCount += slabValues[slab];
+    }
+    
+    if( !disjoint )
+    {
+        vector<int> points( valueCount * rank );
+        int *point = &points[0];
+        for( int slab = 0; slab < slabCount; slab++ )
+        {
+            const int *slabOffsets = offsets + ( slab * rank );
+            const int *slabSizes = sizes + ( slab * rank );
+            vector<int> index( rank, 0 );
+            for( hsize_t value = 0; value < slabValues[slab]; value++ )
+            {
+                for( int j = 0; j < rank; j++ )
+                {
+                    point[j] = slabOffsets[j] + index[j];
+                }
+                point += rank;
+                
+                for( int depth = rank - 1; depth >= 0; depth-- )
+                {
+                    index[depth]++;
+                    if( index[depth] < slabSizes[depth] )
+                    {
+                        break;
+                    }
+                    index[depth] = 0;
+                }
+            }
+        }
+        
+        return readPoints( valueType, (int)valueCount, &points[0], valueBuffer );
+    }
+    
+    if( ( valueCount == 0 ) && ( transferProperties == H5P_DEFAULT ) )
+    {
+        return FML_IOERR_NO_ERROR;
+    }
+    
+    H5Sselect_none( dataspace );
+    for( int i = 0; i < slabCount; i++ )
+    {
+        const int slab = order[i];
+        if( slabValues[slab] == 0 )
+        {
+            continue;
+        }
+        
+        for( int j = 0; j < rank; j++ )
+        {
+            hOffsets[j] = sourceOffsets[j] + offsets[( slab * rank ) + j];
+            hSizes[j] = sizes[( slab * rank ) + j];
+        }
+        if( H5Sselect_hyperslab( dataspace, H5S_SELECT_OR, hOffsets, NULL, hSizes, NULL ) < 0 )
+        {
+            selectionValid = false;
+            return context->setError( FML_IOERR_READ_ERROR );
+        }
+    }
+    
+    //Slabs that are already in storage order can be read straight into place.
+    bool inOrder = true;
+    for( int i = 0; i < slabCount; i++ )
+    {
+        if( order[i] != i )
+        {
+            inOrder = false;
+        }
+    }
+    if( inOrder )
+    {
+        return readSelection( requiredDatatype, valueCount, valueBuffer );
+    }
+    
+    const int valueSize = getValueSize( valueType );
+    vector<char> storageValues( valueCount * valueSize );
+    FmlIoErrorNumber err = readSelection( requiredDatatype, valueCount, &storageValues[0] );
+    if( err != FML_IOERR_NO_ERROR )
+    {
+        return err;
+    }
+    
+    vector<hsize_t> starts( slabCount );
+    hsize_t start = 0;
+    for( int slab = 0; slab < slabCount; slab++ )
+    {
+        starts[slab] = start;
+        start += slabValues[slab];
+    }
+    
+    const char *storageValue = &storageValues[0];
+    for( int i = 0; i < slabCount; i++ )
+    {
+        const int slab = order[i];
+        memcpy( (char*)valueBuffer + ( starts[slab] * valueSize ), storageValue, slabValues[slab] * valueSize );
+        storageValue += slabValues[slab] * valueSize;
+    }
+    
+    return FML_IOERR_NO_ERROR;
+}
+
+
+FmlIoErrorNumber Hdf5ArrayDataReader::readPoints( ArrayDataValueType valueType, int pointCount, const int *points, void *valueBuffer )
+{
+    if( closed )
+    {
+        return FML_IOERR_RESOURCE_CLOSED;
+    }
+    
+    const hid_t requiredDatatype = getNativeType( valueType );
+    if( !canRead( requiredDatatype ) )
+    {
+        return context->setError( FML_IOERR_UNSUPPORTED );
+    }
+    
+    if( pointCount == 0 )
+    {
+        if( transferProperties == H5P_DEFAULT )
+        {
+            return FML_IOERR_NO_ERROR;
+        }
+        return readSelection( requiredDatatype, 0, valueBuffer );
+    }
+    
+    //Element selections are read in the order that the points are given, so the values need no rearranging.
+    vector<hsize_t> coordinates( (long)pointCount * rank );
+    for( long i = 0; i < (long)pointCount * rank; i++ )
+    {
+        if( points[i] < 0 )
+        {
+            return context->setError( FML_IOERR_INVALID_PARAMETER );
+        }
+        coordinates[i] = sourceOffsets[i % rank] + points[i];
+    }
+    
+    if( H5Sselect_elements( dataspace, H5S_SELECT_SET, pointCount, &coordinates[0] ) < 0 )
+    {
+        selectionValid = false;
+        return context->setError( FML_IOERR_READ_ERROR );
+    }
+    
+    return readSelection( requiredDatatype, pointCount, valueBuffer );
+}
+
+
+FmlIoErrorNumber Hdf5ArrayDataReader::setTransferMode( FieldmlTransferMode mode )
+{
+    if( closed )
+    {
+        return FML_IOERR_RESOURCE_CLOSED;
+    }
+    
+    if( transferProperties != H5P_DEFAULT )
+    {
+        H5Pclose( transferProperties );
+        transferProperties = H5P_DEFAULT;
+    }
+    
+    if( mode == FML_TRANSFER_MODE_INDEPENDENT )
+    {
+        return FML_IOERR_NO_ERROR;
+    }
+    
+#ifdef FIELDML_PHDF5_ARRAY
+    if( parallel )
+    {
+        transferProperties = H5Pcreate( H5P_DATASET_XFER );
+        if( ( transferProperties >= 0 ) && ( H5Pset_dxpl_mpio( transferProperties, H5FD_MPIO_COLLECTIVE ) >= 0 ) )
+        {
+            return FML_IOERR_NO_ERROR;
+        }
+        
+        if( transferProperties >= 0 )
+        {
+            H5Pclose( transferProperties );
+        }
+        transferProperties = H5P_DEFAULT;
+    }
+#endif //FIELDML_PHDF5_ARRAY
+    
+    return context->setError( FML_IOERR_UNSUPPORTED );
+}
+
+
 FmlIoErrorNumber Hdf5ArrayDataReader::close()
 {
     if( closed )
@@ -273,15 +762,63 @@ FmlIoErrorNumber Hdf5ArrayDataReader::close()
         return FML_IOERR_NO_ERROR;
     }
     
-    H5Sclose( dataspace );
-    H5Dclose( dataset );
-    H5Fclose( file );
+    if( transferProperties != H5P_DEFAULT )
+    {
+        H5Pclose( transferProperties );
+        transferProperties = H5P_DEFAULT;
+    }
+    
+    if( memorySpace >= 0 )
+    {
+        H5Sclose( memorySpace );
+        memorySpace = -1;
+    }
+    selectionValid = false;
+    
+    releaseHandles();
     
     closed = true;
     return FML_IOERR_NO_ERROR;
 }
 
 
+FmlIoErrorNumber Hdf5ArrayDataReader::getExtents( FmlObjectHandle source, int sourceRank, int *sizes )
+{
+    if( closed )
+    {
+        return FML_IOERR_RESOURCE_CLOSED;
+    }
+    
+    if( sourceRank != rank )
+    {
+        return FML_IOERR_INVALID_PARAMETER;
+    }
+    
+    ArrayDataReader::getExtents( source, sourceRank, sizes );
+    
+    //HDF5 data sources usually leave their sizes unset, so any gaps are filled in from the dataset itself, less the
+    //source's offsets into it.
+    hsize_t *dims = new hsize_t[rank];
+    H5Sget_simple_extent_dims( dataspace, dims, NULL );
+    
+    FmlIoErrorNumber err = FML_IOERR_NO_ERROR;
+    for( int i = 0; i < rank; i++ )
+    {
+        if( sizes[i] <= 0 )
+        {
+            sizes[i] = (int)dims[i] - (int)sourceOffsets[i];
+        }
+        if( sizes[i] <= 0 )
+        {
+            err = FML_IOERR_UNSUPPORTED;
+        }
+    }
+    delete[] dims;
+    
+    return err;
+}
+
+
 Hdf5ArrayDataReader::~Hdf5ArrayDataReader()
 {
     if( !closed )
@@ -292,6 +829,9 @@ Hdf5ArrayDataReader::~Hdf5ArrayDataReader()
     delete[] hStrides;
     delete[] hSizes;
     delete[] hOffsets;
+    delete[] sourceOffsets;
+    delete[] selectedSizes;
+    delete[] hShifts;
 }
 
 #endif //defined FIELDML_HDF5_ARRAY || FIELDML_PHDF5_ARRAY
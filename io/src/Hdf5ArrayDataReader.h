@@ -58,13 +58,47 @@ private:
     
     //Note: In the future, support will be added for non-scalar types that correspond to structured FieldML types.
     //The datatype will need to be checked against the FieldML type to ensure commensurability.
-    hid_t datatype;
+    H5T_class_t storageClass;
+    
+    size_t storageSize;
     int rank;
     hsize_t *hStrides;
     hsize_t *hSizes;
     hsize_t *hOffsets;
     
-    Hdf5ArrayDataReader( FieldmlIoContext *_context, const std::string root, FmlObjectHandle source, hid_t fileAccessProperties );
+    //The data source's offsets into the dataset, which every read is relative to.
+    hsize_t *sourceOffsets;
+    
+    //Set if the file was opened with the MPI-IO driver, which is the only one that can do collective transfers.
+    bool parallel;
+    
+    //The dataset transfer properties for the current transfer mode.
+    hid_t transferProperties;
+    
+    //The memory dataspace for slabs of the selected sizes. The dataset's dataspace has a matching hyperslab selected
+    //at its origin, which each read moves into place, so that reads of the same shape don't have to set anything up.
+    hid_t memorySpace;
+    
+    hsize_t *selectedSizes;
+    
+    hssize_t *hShifts;
+    
+    bool selectionValid;
+    
+    bool selectShape( const int *sizes );
+    
+    //Whether the stored values can be read as the given memory datatype, with HDF5 converting them as needed.
+    bool canRead( hid_t requiredDatatype );
+    
+    //Reads whatever is selected in the dataset's dataspace, as a run of the given number of values.
+    FmlIoErrorNumber readSelection( hid_t requiredDatatype, hsize_t valueCount, void *valueBuffer );
+    
+    //Hands the file and dataset back to the handle cache, along with anything else that's open.
+    void releaseHandles();
+    
+    //If an image is given, it is read in place of the resource's file.
+    Hdf5ArrayDataReader( FieldmlIoContext *_context, const std::string root, FmlObjectHandle source, hid_t fileAccessProperties,
+        const void *image, int64_t imageLength );
 
     FmlIoErrorNumber readSlab( const int *offsets, const int *sizes, hid_t requiredDatatype, void *valueBuffer );
     
@@ -75,6 +109,8 @@ public:
     
     virtual FmlIoErrorNumber readDoubleSlab( const int *offsets, const int *sizes, double *valueBuffer );
     
+    virtual FmlIoErrorNumber readFloatSlab( const int *offsets, const int *sizes, float *valueBuffer );
+    
     virtual FmlIoErrorNumber readBooleanSlab( const int *offsets, const int *sizes, FmlBoolean *valueBuffer );
     
    // virtual FmlIoErrorNumber setStreamRequestCallback( Fieldml_StreamRequestCallbackFunction function, void *user_data_in )
@@ -82,11 +118,24 @@ public:
    //	 return 0;
     //}
 
+    virtual FmlIoErrorNumber prepareSlabReads( const int *sizes );
+    
+    virtual FmlIoErrorNumber readStridedSlab( ArrayDataValueType valueType, const int *offsets, const int *sizes, const int *strides, void *valueBuffer );
+    
+    virtual FmlIoErrorNumber readSlabList( ArrayDataValueType valueType, int slabCount, const int *offsets, const int *sizes, void *valueBuffer );
+    
+    virtual FmlIoErrorNumber readPoints( ArrayDataValueType valueType, int pointCount, const int *points, void *valueBuffer );
+    
     virtual FmlIoErrorNumber close();
     
+    virtual FmlIoErrorNumber setTransferMode( FieldmlTransferMode mode );
+    
+    virtual FmlIoErrorNumber getExtents( FmlObjectHandle source, int rank, int *sizes );
+    
     virtual ~Hdf5ArrayDataReader();
 
-    static Hdf5ArrayDataReader *create( FieldmlIoContext *context, const std::string root, FmlObjectHandle source );
+    static Hdf5ArrayDataReader *create( FieldmlIoContext *context, const std::string root, FmlObjectHandle source,
+        const void *image, int64_t imageLength );
 };
 #endif //defined FIELDML_HDF5_ARRAY || FIELDML_PHDF5_ARRAY
     
@@ -39,17 +39,24 @@
  *
  */
 
+#include <climits>
+
 #include "StringUtil.h"
 #include "FieldmlIoApi.h"
 
 #include "ArrayDataWriter.h"
 #include "Hdf5ArrayDataWriter.h"
+#include "Hdf5HandleCache.h"
 
 using namespace std;
 
 #if defined FIELDML_HDF5_ARRAY || defined FIELDML_PHDF5_ARRAY
 
-Hdf5ArrayDataWriter *Hdf5ArrayDataWriter::create( FieldmlIoContext *context, const string root, FmlObjectHandle source, FieldmlHandleType handleType, bool append, int *sizes, int rank )
+//The size to aim for when choosing chunk sizes automatically. This is the size of HDF5's default chunk cache.
+static const hsize_t AUTOMATIC_CHUNK_BYTES = 1024 * 1024;
+
+Hdf5ArrayDataWriter *Hdf5ArrayDataWriter::create( FieldmlIoContext *context, const string root, FmlObjectHandle source, FieldmlHandleType handleType, bool append, int *sizes, int rank,
+    const FieldmlArrayWriterOptions *options )
 {
     Hdf5ArrayDataWriter *writer = NULL;
     
@@ -64,7 +71,7 @@ Hdf5ArrayDataWriter *Hdf5ArrayDataWriter::create( FieldmlIoContext *context, con
     else if( format == StringUtil::HDF5_NAME )
     {
 #ifdef FIELDML_HDF5_ARRAY
-        Hdf5ArrayDataWriter *hdf5writer = new Hdf5ArrayDataWriter( context, root, source, handleType, append, sizes, rank, H5P_DEFAULT );
+        Hdf5ArrayDataWriter *hdf5writer = new Hdf5ArrayDataWriter( context, root, source, handleType, append, sizes, rank, H5P_DEFAULT, options );
         if( !hdf5writer->ok )
         {
             delete hdf5writer;
@@ -81,7 +88,7 @@ Hdf5ArrayDataWriter *Hdf5ArrayDataWriter::create( FieldmlIoContext *context, con
         hid_t accessProperties = H5Pcreate( H5P_FILE_ACCESS );
         if( H5Pset_fapl_mpio( accessProperties, MPI_COMM_WORLD, MPI_INFO_NULL ) >= 0 )
         {
-            Hdf5ArrayDataWriter *hdf5writer = new Hdf5ArrayDataWriter( context, root, source, handleType, append, sizes, rank, accessProperties );
+            Hdf5ArrayDataWriter *hdf5writer = new Hdf5ArrayDataWriter( context, root, source, handleType, append, sizes, rank, accessProperties, options );
             if( !hdf5writer->ok )
             {
                 delete hdf5writer;
@@ -100,18 +107,24 @@ Hdf5ArrayDataWriter *Hdf5ArrayDataWriter::create( FieldmlIoContext *context, con
 }
 
 
-Hdf5ArrayDataWriter::Hdf5ArrayDataWriter( FieldmlIoContext *_context, const string root, FmlObjectHandle source, FieldmlHandleType handleType, bool append, int *sizes, int _rank, hid_t accessProperties ) :
+Hdf5ArrayDataWriter::Hdf5ArrayDataWriter( FieldmlIoContext *_context, const string root, FmlObjectHandle _source, FieldmlHandleType handleType, bool append, int *sizes, int _rank,
+    hid_t accessProperties, const FieldmlArrayWriterOptions *options ) :
     ArrayDataWriter( _context )
 {
     rank = _rank;
+    source = _source;
     file = -1;
     dataset = -1;
     dataspace = -1;
+    shortIntegers = false;
     
     hStrides = NULL;
     hSizes = NULL;
     hOffsets = NULL;
     
+    parallel = ( accessProperties != H5P_DEFAULT );
+    transferProperties = H5P_DEFAULT;
+    
     ok = false;
     closed = true;
     
@@ -137,18 +150,10 @@ Hdf5ArrayDataWriter::Hdf5ArrayDataWriter( FieldmlIoContext *_context, const stri
 
         const string filename = StringUtil::makeFilename( root, description );
         //TODO Add an API-level enum to allow the user to append data, nuke any existing file, or fail if the file already exists. 
-        if( !append )
-        {
-            file = H5Fcreate( filename.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, accessProperties );
-        }
-        else
-        {
-            file = H5Fopen( filename.c_str(), H5F_ACC_RDWR, accessProperties );
-            if( file < 0 )
-            {
-                file = H5Fcreate( filename.c_str(), H5F_ACC_EXCL, H5P_DEFAULT, accessProperties );
-            }
-        }
+        //A file that's in use by other readers or writers can be added to, but not replaced.
+        const bool pagedFileSpace = ( options != NULL ) && ( options->pagedFileSpace == 1 );
+        file = Hdf5HandleCache::getCache().openFile( context->getSession(), filename, append ? HDF5_FILE_APPEND : HDF5_FILE_CREATE, accessProperties,
+            pagedFileSpace );
         
         if( file < 0 )
         {
@@ -169,12 +174,12 @@ Hdf5ArrayDataWriter::Hdf5ArrayDataWriter( FieldmlIoContext *_context, const stri
         H5Eget_auto1( &func, &client_data ); 
         H5Eset_auto1( NULL, NULL );
         //It's fine if this call fails.
-        dataset = H5Dopen( file, location.c_str(), H5P_DEFAULT );
+        dataset = Hdf5HandleCache::getCache().openDataset( file, location );
         H5Eset_auto1( func, client_data );
 
         if( dataset < 0 )
         {
-            if( !initializeWithNewDataset( location, sizes, handleType ) )
+            if( !initializeWithNewDataset( location, sizes, handleType, options ) )
             {
                 break;
             }
@@ -187,13 +192,17 @@ Hdf5ArrayDataWriter::Hdf5ArrayDataWriter( FieldmlIoContext *_context, const stri
             }
         }
 
-        datatype = H5Dget_type( dataset );
-        if( datatype < 0 )
+        hid_t storedType = H5Dget_type( dataset );
+        if( storedType < 0 )
         {
             break;
         }
 
-        hid_t nativeType = H5Tget_native_type( datatype, H5T_DIR_DESCEND );
+        //Values are always written from the FieldML type's own native type, and converted to the stored type.
+        hid_t nativeType = H5Tget_native_type( storedType, H5T_DIR_DESCEND );
+        H5Tclose( storedType );
+        datatype = -1;
+        shortIntegers = ( H5Tequal( nativeType, H5T_NATIVE_SHORT ) > 0 );
         if( H5Tequal( nativeType, H5T_NATIVE_INT ) || H5Tequal( nativeType, H5T_NATIVE_SHORT ) )
         {
             datatype = H5T_NATIVE_INT;
@@ -206,33 +215,137 @@ Hdf5ArrayDataWriter::Hdf5ArrayDataWriter( FieldmlIoContext *_context, const stri
         {
             datatype = H5T_NATIVE_INT8;
         }
+        H5Tclose( nativeType );
         
         ok = true;
         closed = false;
         break;
     }
+    
+    if( !ok )
+    {
+        releaseHandles();
+    }
 }
 
 
-bool Hdf5ArrayDataWriter::initializeWithNewDataset( const string location, int *sizes, FieldmlHandleType handleType )
+void Hdf5ArrayDataWriter::releaseHandles()
 {
+    if( dataspace >= 0 )
+    {
+        H5Sclose( dataspace );
+        dataspace = -1;
+    }
+    if( dataset >= 0 )
+    {
+        Hdf5HandleCache::getCache().closeDataset( file, dataset );
+        dataset = -1;
+    }
+    if( file >= 0 )
+    {
+        Hdf5HandleCache::getCache().closeFile( file );
+        file = -1;
+    }
+}
+
+
+hid_t Hdf5ArrayDataWriter::createChunkedProperties( int *sizes, const FieldmlArrayWriterOptions *options )
+{
+    if( ( options->deflateLevel < 0 ) || ( options->deflateLevel > 9 ) )
+    {
+        context->setError( FML_IOERR_INVALID_PARAMETER );
+        return -1;
+    }
+    
+    hsize_t *chunkSizes = new hsize_t[rank];
+    
+    //The dataset is created when the writer is opened, before the shape of any slab is known, so automatic chunks are
+    //cut from the array's own extents. Fill the innermost dimensions first, so that each chunk holds contiguous runs of
+    //values.
+    hsize_t chunkBytes = H5Tget_size( datatype );
+    for( int i = rank - 1; i >= 0; i-- )
+    {
+        if( options->chunkSizes != NULL )
+        {
+            chunkSizes[i] = options->chunkSizes[i];
+        }
+        else
+        {
+            chunkSizes[i] = ( chunkBytes < AUTOMATIC_CHUNK_BYTES ) ? ( AUTOMATIC_CHUNK_BYTES / chunkBytes ) : 1;
+        }
+        
+        //Extendable arrays will outgrow their initial outermost size, so chunks aren't limited by it.
+        const bool growing = ( i == 0 ) && ( options->extendable == 1 );
+        if( !growing && ( chunkSizes[i] > (hsize_t)sizes[i] ) )
+        {
+            chunkSizes[i] = sizes[i];
+        }
+        if( chunkSizes[i] < 1 )
+        {
+            chunkSizes[i] = 1;
+        }
+        chunkBytes *= chunkSizes[i];
+    }
+    
+    hid_t creationProperties = H5Pcreate( H5P_DATASET_CREATE );
+    bool ok = ( creationProperties >= 0 ) && ( H5Pset_chunk( creationProperties, rank, chunkSizes ) >= 0 );
+    delete[] chunkSizes;
+    
+    //Filters run in the order they're added, so the shuffle has to come first.
+    if( ok && ( options->shuffle == 1 ) )
+    {
+        ok = ( H5Pset_shuffle( creationProperties ) >= 0 );
+    }
+    if( ok && ( options->deflateLevel > 0 ) )
+    {
+        ok = ( H5Zfilter_avail( H5Z_FILTER_DEFLATE ) > 0 ) && ( H5Pset_deflate( creationProperties, options->deflateLevel ) >= 0 );
+        if( !ok )
+        {
+            context->setError( FML_IOERR_UNSUPPORTED );
+        }
+    }
+    
+    if( !ok )
+    {
+        if( creationProperties >= 0 )
+        {
+            H5Pclose( creationProperties );
+        }
+        return -1;
+    }
+    
+    return creationProperties;
+}
+
+
+bool Hdf5ArrayDataWriter::initializeWithNewDataset( const string location, int *sizes, FieldmlHandleType handleType, const FieldmlArrayWriterOptions *options )
+{
+    const bool extendable = ( options != NULL ) && ( options->extendable == 1 ) && ( rank > 0 );
+    hsize_t *maxSizes = new hsize_t[rank];
     for( int i = 0; i < rank; i++ )
     {
         hSizes[i] = sizes[i];
+        maxSizes[i] = sizes[i];
+    }
+    if( extendable )
+    {
+        maxSizes[0] = H5S_UNLIMITED;
     }
-    dataspace = H5Screate_simple( rank, hSizes, NULL );
+    dataspace = H5Screate_simple( rank, hSizes, maxSizes );
+    delete[] maxSizes;
     if( dataspace < 0 )
     {
         return false;
     }
     
+    const int storageBits = ( options != NULL ) ? options->storageBits : 0;
     if( handleType == FHT_CONTINUOUS_TYPE )
     {
-        datatype = H5T_NATIVE_DOUBLE;
+        datatype = ( storageBits == 32 ) ? H5T_NATIVE_FLOAT : H5T_NATIVE_DOUBLE;
     }
     else if( handleType == FHT_ENSEMBLE_TYPE )
     {
-        datatype = H5T_NATIVE_INT;
+        datatype = ( storageBits == 16 ) ? H5T_NATIVE_SHORT : H5T_NATIVE_INT;
     }
     else if( handleType == FHT_BOOLEAN_TYPE )
     {
@@ -244,12 +357,49 @@ bool Hdf5ArrayDataWriter::initializeWithNewDataset( const string location, int *
     {
         return false;
     }
+    
+    if( ( storageBits != 0 ) && ( storageBits != (int)H5Tget_size( datatype ) * 8 ) )
+    {
+        context->setError( FML_IOERR_UNSUPPORTED );
+        return false;
+    }
+
+    //Only chunk when something needs it. Chunked arrays cost more to read a few values from, so options that just set
+    //the storage size leave arrays contiguous. Empty arrays can't be chunked, and have nothing to compress anyway.
+    //Extendable arrays have to be chunked, and may start out with no outermost rows.
+    bool chunked = ( options != NULL ) && ( rank > 0 ) && ( ( options->chunkSizes != NULL ) || ( options->deflateLevel != 0 ) ||
+        ( options->shuffle == 1 ) || extendable );
+    for( int i = 0; chunked && ( i < rank ); i++ )
+    {
+        chunked = ( sizes[i] > 0 ) || ( extendable && ( i == 0 ) );
+    }
+    if( extendable && !chunked )
+    {
+        return false;
+    }
+    
+    hid_t creationProperties = H5P_DEFAULT;
+    if( chunked )
+    {
+        creationProperties = createChunkedProperties( sizes, options );
+        if( creationProperties < 0 )
+        {
+            return false;
+        }
+    }
 
-    dataset = H5Dcreate( file, location.c_str(), datatype, dataspace, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT );
+    dataset = H5Dcreate( file, location.c_str(), datatype, dataspace, H5P_DEFAULT, creationProperties, H5P_DEFAULT );
+    
+    if( creationProperties != H5P_DEFAULT )
+    {
+        H5Pclose( creationProperties );
+    }
+    
     if( dataset < 0 )
     {
         return false;
     }
+    Hdf5HandleCache::getCache().addDataset( file, location, dataset );
     
     return true;
 }
@@ -294,6 +444,131 @@ bool Hdf5ArrayDataWriter::initializeWithExistingDataset( int *sizes )
 }
 
 
+FmlIoErrorNumber Hdf5ArrayDataWriter::extendToFit( const int *offsets, const int *sizes, bool empty )
+{
+    //Other writers sharing the dataset handle may have extended it since this writer's dataspace was fetched.
+    hid_t currentSpace = H5Dget_space( dataset );
+    if( currentSpace < 0 )
+    {
+        return FML_IOERR_WRITE_ERROR;
+    }
+    H5Sclose( dataspace );
+    dataspace = currentSpace;
+    
+    hsize_t *dims = new hsize_t[rank];
+    hsize_t *maxDims = new hsize_t[rank];
+    hsize_t *ends = new hsize_t[rank];
+    H5Sget_simple_extent_dims( dataspace, dims, maxDims );
+    
+    //Slabs that don't fit in the dataset's maximum dimensions are left for the write itself to fail.
+    for( int i = 0; i < rank; i++ )
+    {
+        const hsize_t end = (hsize_t)offsets[i] + sizes[i];
+        ends[i] = 0;
+        if( !empty && ( offsets[i] >= 0 ) && ( end > dims[i] ) && ( ( maxDims[i] == H5S_UNLIMITED ) || ( end <= maxDims[i] ) ) )
+        {
+            ends[i] = end;
+        }
+    }
+    delete[] maxDims;
+    
+    FmlIoErrorNumber err = FML_IOERR_NO_ERROR;
+#ifdef FIELDML_PHDF5_ARRAY
+    if( parallel && ( transferProperties != H5P_DEFAULT ) )
+    {
+        //Extending a dataset is collective, so every process extends it to hold the furthest of all their slabs.
+        hsize_t *localEnds = ends;
+        ends = new hsize_t[rank];
+        if( MPI_Allreduce( localEnds, ends, rank, MPI_UNSIGNED_LONG_LONG, MPI_MAX, MPI_COMM_WORLD ) != MPI_SUCCESS )
+        {
+            err = FML_IOERR_WRITE_ERROR;
+        }
+        delete[] localEnds;
+    }
+#endif //FIELDML_PHDF5_ARRAY
+    
+    bool growing = false;
+    for( int i = 0; ( err == FML_IOERR_NO_ERROR ) && ( i < rank ); i++ )
+    {
+        if( ends[i] > dims[i] )
+        {
+            dims[i] = ends[i];
+            growing = true;
+        }
+    }
+    delete[] ends;
+    
+    if( growing && parallel && ( transferProperties == H5P_DEFAULT ) )
+    {
+        //Independent writers can't agree on a new size, so only collective ones can grow a parallel dataset.
+        err = FML_IOERR_UNSUPPORTED;
+    }
+    else if( growing )
+    {
+        err = FML_IOERR_WRITE_ERROR;
+        if( H5Dset_extent( dataset, dims ) >= 0 )
+        {
+            //The dataspace doesn't follow the dataset's extent.
+            H5Sclose( dataspace );
+            dataspace = H5Dget_space( dataset );
+            if( dataspace >= 0 )
+            {
+                updateSourceSizes( dims );
+                err = FML_IOERR_NO_ERROR;
+            }
+        }
+    }
+    delete[] dims;
+    
+    return err;
+}
+
+
+void Hdf5ArrayDataWriter::updateSourceSizes( const hsize_t *dims )
+{
+    const FmlSessionHandle session = context->getSession();
+    if( Fieldml_GetArrayDataSourceRank( session, source ) != rank )
+    {
+        return;
+    }
+    
+    int *rawSizes = new int[rank];
+    int *offsets = new int[rank];
+    int *sizes = new int[rank];
+    Fieldml_GetArrayDataSourceRawSizes( session, source, rawSizes );
+    Fieldml_GetArrayDataSourceOffsets( session, source, offsets );
+    Fieldml_GetArrayDataSourceSizes( session, source, sizes );
+    
+    bool rawSizesValid = true;
+    for( int i = 0; i < rank; i++ )
+    {
+        if( rawSizes[i] < (int)dims[i] )
+        {
+            //Sizes that ran to the end of the array keep doing so. Unset sizes already do.
+            if( ( sizes[i] > 0 ) && ( offsets[i] + sizes[i] >= rawSizes[i] ) )
+            {
+                sizes[i] = (int)dims[i] - offsets[i];
+            }
+            rawSizes[i] = (int)dims[i];
+        }
+        if( rawSizes[i] <= 0 )
+        {
+            rawSizesValid = false;
+        }
+    }
+    
+    if( rawSizesValid )
+    {
+        Fieldml_SetArrayDataSourceRawSizes( session, source, rawSizes );
+    }
+    Fieldml_SetArrayDataSourceSizes( session, source, sizes );
+    
+    delete[] rawSizes;
+    delete[] offsets;
+    delete[] sizes;
+}
+
+
 FmlIoErrorNumber Hdf5ArrayDataWriter::writeSlab( const int *offsets, const int *sizes, hid_t requiredDatatype, const void *valueBuffer )
 {
     if( datatype != requiredDatatype )
@@ -302,28 +577,45 @@ FmlIoErrorNumber Hdf5ArrayDataWriter::writeSlab( const int *offsets, const int *
         return -1;
     }
 
+    bool empty = false;
     for( int i = 0; i < rank; i++ )
     {
         hOffsets[i] = offsets[i];
         hSizes[i] = sizes[i];
+        if( sizes[i] == 0 )
+        {
+            empty = true;
+        }
     }
     
-    hid_t bufferSpace = H5Screate_simple( rank, hSizes, NULL );
+    if( empty && ( transferProperties == H5P_DEFAULT ) )
+    {
+        return FML_IOERR_NO_ERROR;
+    }
     
-    herr_t status;
-    status = H5Sselect_hyperslab( dataspace, H5S_SELECT_SET, hOffsets, NULL, hSizes, NULL );
+    FmlIoErrorNumber err = extendToFit( offsets, sizes, empty );
+    if( err != FML_IOERR_NO_ERROR )
+    {
+        return context->setError( err );
+    }
     
-    hid_t transferProperties = H5P_DEFAULT;
-
-//    if( collective )
-//    {
-//        transferProperties = H5Pcreate (H5P_DATASET_XFER);
-//        H5Pset_dxpl_mpio(transferProperties, H5FD_MPIO_COLLECTIVE);
-//    }
+    hid_t bufferSpace;
+    herr_t status;
+    if( empty )
+    {
+        //Collective writes need every process to take part, even those that have nothing to write.
+        hsize_t one = 1;
+        bufferSpace = H5Screate_simple( 1, &one, NULL );
+        H5Sselect_none( bufferSpace );
+        status = H5Sselect_none( dataspace );
+    }
+    else
+    {
+        bufferSpace = H5Screate_simple( rank, hSizes, NULL );
+        status = H5Sselect_hyperslab( dataspace, H5S_SELECT_SET, hOffsets, NULL, hSizes, NULL );
+    }
     
     status = H5Dwrite( dataset, requiredDatatype, bufferSpace, dataspace, transferProperties, valueBuffer );
-
-//    H5Pclose( transferProperties );    
     
     H5Sclose( bufferSpace );
     
@@ -343,6 +635,22 @@ FmlIoErrorNumber Hdf5ArrayDataWriter::writeIntSlab( const int *offsets, const in
         return FML_IOERR_RESOURCE_CLOSED;
     }
     
+    if( shortIntegers )
+    {
+        long valueCount = 1;
+        for( int i = 0; i < rank; i++ )
+        {
+            valueCount *= sizes[i];
+        }
+        for( long i = 0; i < valueCount; i++ )
+        {
+            if( ( valueBuffer[i] < SHRT_MIN ) || ( valueBuffer[i] > SHRT_MAX ) )
+            {
+                return context->setError( FML_IOERR_INVALID_PARAMETER );
+            }
+        }
+    }
+    
     return writeSlab( offsets, sizes, H5T_NATIVE_INT, valueBuffer );
 }
 
@@ -369,6 +677,45 @@ FmlIoErrorNumber Hdf5ArrayDataWriter::writeBooleanSlab( const int *offsets, cons
 }
 
 
+FmlIoErrorNumber Hdf5ArrayDataWriter::setTransferMode( FieldmlTransferMode mode )
+{
+    if( closed )
+    {
+        return FML_IOERR_RESOURCE_CLOSED;
+    }
+    
+    if( transferProperties != H5P_DEFAULT )
+    {
+        H5Pclose( transferProperties );
+        transferProperties = H5P_DEFAULT;
+    }
+    
+    if( mode == FML_TRANSFER_MODE_INDEPENDENT )
+    {
+        return FML_IOERR_NO_ERROR;
+    }
+    
+#ifdef FIELDML_PHDF5_ARRAY
+    if( parallel )
+    {
+        transferProperties = H5Pcreate( H5P_DATASET_XFER );
+        if( ( transferProperties >= 0 ) && ( H5Pset_dxpl_mpio( transferProperties, H5FD_MPIO_COLLECTIVE ) >= 0 ) )
+        {
+            return FML_IOERR_NO_ERROR;
+        }
+        
+        if( transferProperties >= 0 )
+        {
+            H5Pclose( transferProperties );
+        }
+        transferProperties = H5P_DEFAULT;
+    }
+#endif //FIELDML_PHDF5_ARRAY
+    
+    return context->setError( FML_IOERR_UNSUPPORTED );
+}
+
+
 FmlIoErrorNumber Hdf5ArrayDataWriter::close()
 {
     if( closed )
@@ -378,9 +725,13 @@ FmlIoErrorNumber Hdf5ArrayDataWriter::close()
     
     closed = true;
     
-    H5Sclose( dataspace );
-    H5Dclose( dataset );
-    H5Fclose( file );
+    if( transferProperties != H5P_DEFAULT )
+    {
+        H5Pclose( transferProperties );
+        transferProperties = H5P_DEFAULT;
+    }
+    
+    releaseHandles();
     
     return FML_IOERR_NO_ERROR;
 }
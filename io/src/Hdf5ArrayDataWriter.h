@@ -61,20 +61,45 @@ private:
     //The datatype will need to be checked against the FieldML type to ensure commensurability.
     hid_t datatype;
     int rank;
+    
+    //Set if integers are stored in 16 bits, in which case writes of integers that don't fit are refused.
+    bool shortIntegers;
+    
+    //The data source being written, whose sizes follow the dataset's as it grows.
+    FmlObjectHandle source;
+    
     hsize_t *hStrides;
     hsize_t *hSizes;
     hsize_t *hOffsets;
     
+    //Set if the file was opened with the MPI-IO driver, which is the only one that can do collective transfers.
+    bool parallel;
+    
+    //The dataset transfer properties for the current transfer mode.
+    hid_t transferProperties;
+    
+    //Hands the file and dataset back to the handle cache, along with anything else that's open.
+    void releaseHandles();
+    
     bool initializeWithExistingDataset( int *sizes );
     
-    bool initializeWithNewDataset( const std::string sourceName, int *sizes, FieldmlHandleType handleType );
+    bool initializeWithNewDataset( const std::string sourceName, int *sizes, FieldmlHandleType handleType, const FieldmlArrayWriterOptions *options );
+    
+    hid_t createChunkedProperties( int *sizes, const FieldmlArrayWriterOptions *options );
+    
+    //Grows the dataset, as far as its maximum dimensions allow, so that it holds the given slab. Collective writers
+    //grow it to hold every process's slab, so all of them have to call this, even those with an empty slab.
+    FmlIoErrorNumber extendToFit( const int *offsets, const int *sizes, bool empty );
+    
+    void updateSourceSizes( const hsize_t *dims );
 
     FmlIoErrorNumber writeSlab( const int *offsets, const int *sizes, hid_t requiredDatatype, const void *valueBuffer );
 
 public:
     bool ok;
 
-    Hdf5ArrayDataWriter( FieldmlIoContext *_context, const std::string root, FmlObjectHandle source, FieldmlHandleType handleType, bool append, int *sizes, int rank, hid_t fileAccessProperties );
+    Hdf5ArrayDataWriter( FieldmlIoContext *_context, const std::string root, FmlObjectHandle source, FieldmlHandleType handleType, bool append, int *sizes, int rank,
+        hid_t fileAccessProperties, const FieldmlArrayWriterOptions *options );
     
     virtual FmlIoErrorNumber writeIntSlab( const int *offsets, const int *sizes, const int *valueBuffer );
     
@@ -84,9 +109,12 @@ public:
     
     virtual FmlIoErrorNumber close();
     
+    virtual FmlIoErrorNumber setTransferMode( FieldmlTransferMode mode );
+    
     virtual ~Hdf5ArrayDataWriter();
     
-    static Hdf5ArrayDataWriter *create( FieldmlIoContext *context, const std::string root, FmlObjectHandle source, FieldmlHandleType handleType, bool append, int *sizes, int rank );
+    static Hdf5ArrayDataWriter *create( FieldmlIoContext *context, const std::string root, FmlObjectHandle source, FieldmlHandleType handleType, bool append, int *sizes, int rank,
+        const FieldmlArrayWriterOptions *options );
 };
 #endif //FIELDML_HDF5_ARRAY || FIELDML_PHDF5_ARRAY
 
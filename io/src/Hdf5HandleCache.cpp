@@ -0,0 +1,522 @@
+/* \file
+ * $Id$
+ * \author Caton Little
+ * \brief 
+ *
+ * \section LICENSE
+ *
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is FieldML
+ *
+ * The Initial Developer of the Original Code is Auckland Uniservices Ltd,
+ * Auckland, New Zealand. Portions created by the Initial Developer are
+ * Copyright (C) 2010 the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either the GNU General Public License Version 2 or later (the "GPL"), or
+ * the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ */
+
+#include <cstdio>
+
+#include "FieldmlIoSession.h"
+#include "Hdf5HandleCache.h"
+
+using namespace std;
+
+#if defined FIELDML_HDF5_ARRAY || defined FIELDML_PHDF5_ARRAY
+
+//How far the core driver grows an in-memory file. Images are read-only, so this is never used.
+static const size_t IMAGE_INCREMENT = 65536;
+
+//Enough to step back and forth between a few files, or through the arrays of one, without holding on to many handles.
+static const size_t MAX_IDLE_FILES = 4;
+
+static const size_t MAX_IDLE_DATASETS = 16;
+
+Hdf5HandleCache::Hdf5HandleCache()
+{
+}
+
+
+Hdf5HandleCache::~Hdf5HandleCache()
+{
+}
+
+
+Hdf5HandleCache &Hdf5HandleCache::getCache()
+{
+    //Never destroyed, as readers and writers that are still open at exit release their handles from static destructors.
+    static Hdf5HandleCache *cache = new Hdf5HandleCache();
+    return *cache;
+}
+
+
+Hdf5HandleCache::File *Hdf5HandleCache::findFile( hid_t file )
+{
+    for( map<FileKey, File>::iterator i = files.begin(); i != files.end(); i++ )
+    {
+        if( i->second.file == file )
+        {
+            return &i->second;
+        }
+    }
+    
+    return NULL;
+}
+
+
+void Hdf5HandleCache::releaseFile( map<FileKey, File>::iterator i )
+{
+    for( map<string, Dataset>::iterator j = i->second.datasets.begin(); j != i->second.datasets.end(); j++ )
+    {
+        H5Dclose( j->second.dataset );
+    }
+    H5Fclose( i->second.file );
+    idleFiles.remove( i->first );
+    files.erase( i );
+}
+
+
+void Hdf5HandleCache::closeIdleFiles( const string &filename )
+{
+    //Session handles are never reused, so an idle file belonging to a destroyed session can never be used again.
+    list<FileKey> keys = idleFiles;
+    for( list<FileKey>::iterator i = keys.begin(); i != keys.end(); i++ )
+    {
+        if( ( Fieldml_GetLastError( i->first ) == FML_ERR_UNKNOWN_HANDLE ) || ( !filename.empty() && ( i->second == filename ) ) )
+        {
+            releaseFile( files.find( *i ) );
+        }
+    }
+}
+
+
+void Hdf5HandleCache::closeIdleFiles( FmlSessionHandle session )
+{
+    list<FileKey> keys = idleFiles;
+    for( list<FileKey>::iterator i = keys.begin(); i != keys.end(); i++ )
+    {
+        if( i->first == session )
+        {
+            releaseFile( files.find( *i ) );
+        }
+    }
+}
+
+
+/**
+ * Returns a copy of the given file access properties, tuned with the session's HDF5 cache options. Settings that HDF5
+ * rejects are left at their defaults. Page buffering is only turned on if allowed, in which case pageBuffered is set.
+ */
+static hid_t createAccessProperties( FmlSessionHandle session, hid_t accessProperties, bool allowPageBuffer, bool &pageBuffered )
+{
+    hid_t properties = ( accessProperties == H5P_DEFAULT ) ? H5Pcreate( H5P_FILE_ACCESS ) : H5Pcopy( accessProperties );
+    pageBuffered = false;
+    
+    FieldmlHdf5CacheOptions options;
+    if( ( properties < 0 ) || !FieldmlIoSession::getSession().getHdf5CacheOptions( session, options ) )
+    {
+        return properties;
+    }
+    
+    H5E_BEGIN_TRY
+    {
+        int metadataElements;
+        size_t chunkSlots;
+        size_t chunkBytes;
+        double preemption;
+        if( H5Pget_cache( properties, &metadataElements, &chunkSlots, &chunkBytes, &preemption ) >= 0 )
+        {
+            if( options.chunkCacheBytes > 0 )
+            {
+                chunkBytes = options.chunkCacheBytes;
+            }
+            if( options.chunkCacheSlots > 0 )
+            {
+                chunkSlots = options.chunkCacheSlots;
+            }
+            if( options.chunkCachePreemption >= 0 )
+            {
+                preemption = options.chunkCachePreemption;
+            }
+            H5Pset_cache( properties, metadataElements, chunkSlots, chunkBytes, preemption );
+        }
+        
+        H5AC_cache_config_t config;
+        config.version = H5AC__CURR_CACHE_CONFIG_VERSION;
+        if( ( options.metadataCacheBytes > 0 ) && ( H5Pget_mdc_config( properties, &config ) >= 0 ) )
+        {
+            config.set_initial_size = true;
+            config.initial_size = options.metadataCacheBytes;
+            if( config.max_size < config.initial_size )
+            {
+                config.max_size = config.initial_size;
+            }
+            if( config.min_size > config.initial_size )
+            {
+                config.min_size = config.initial_size;
+            }
+            H5Pset_mdc_config( properties, &config );
+        }
+        
+#if H5_VERSION_GE( 1, 10, 1 )
+        if( allowPageBuffer && ( options.pageBufferBytes > 0 ) )
+        {
+            pageBuffered = ( H5Pset_page_buffer_size( properties, options.pageBufferBytes, 0, 0 ) >= 0 );
+        }
+#endif
+    }
+    H5E_END_TRY;
+    
+    return properties;
+}
+
+
+static hid_t openOrCreate( const string &filename, Hdf5FileMode mode, hid_t createProperties, hid_t accessProperties )
+{
+    hid_t file;
+    if( mode == HDF5_FILE_READ )
+    {
+        file = H5Fopen( filename.c_str(), H5F_ACC_RDONLY, accessProperties );
+    }
+    else if( mode == HDF5_FILE_CREATE )
+    {
+        file = H5Fcreate( filename.c_str(), H5F_ACC_TRUNC, createProperties, accessProperties );
+    }
+    else
+    {
+        file = H5Fopen( filename.c_str(), H5F_ACC_RDWR, accessProperties );
+        if( file < 0 )
+        {
+            file = H5Fcreate( filename.c_str(), H5F_ACC_EXCL, createProperties, accessProperties );
+        }
+    }
+    
+    return file;
+}
+
+
+hid_t Hdf5HandleCache::openFile( FmlSessionHandle session, const string &filename, Hdf5FileMode mode, hid_t accessProperties, bool pagedFileSpace )
+{
+    const bool parallel = ( accessProperties != H5P_DEFAULT );
+    const FileKey key( session, filename );
+    
+    //Writers have to see the file as it is, and can't open it while it's open read-only, even by another session.
+    closeIdleFiles( ( mode == HDF5_FILE_READ ) ? string() : filename );
+    
+    map<FileKey, File>::iterator existing = files.find( key );
+    if( ( existing != files.end() ) && ( existing->second.users == 0 ) )
+    {
+        if( existing->second.parallel == parallel )
+        {
+            idleFiles.remove( key );
+            existing->second.users = 1;
+            return existing->second.file;
+        }
+        
+        releaseFile( existing );
+        existing = files.end();
+    }
+    if( existing != files.end() )
+    {
+        File &entry = existing->second;
+        if( ( mode == HDF5_FILE_CREATE ) || ( entry.parallel != parallel ) || ( ( mode == HDF5_FILE_APPEND ) && !entry.writable ) )
+        {
+            return -1;
+        }
+        
+        entry.users++;
+        return entry.file;
+    }
+    
+    //Parallel HDF5 doesn't support page buffering.
+    bool pageBuffered;
+    hid_t fileAccess = createAccessProperties( session, accessProperties, !parallel, pageBuffered );
+    
+    //Paged file space is up to the writer, whatever the session's page buffering.
+    hid_t fileCreate = H5P_DEFAULT;
+#if H5_VERSION_GE( 1, 10, 1 )
+    if( pagedFileSpace && !parallel )
+    {
+        fileCreate = H5Pcreate( H5P_FILE_CREATE );
+        if( ( fileCreate >= 0 ) && ( H5Pset_file_space_strategy( fileCreate, H5F_FSPACE_STRATEGY_PAGE, 0, 1 ) < 0 ) )
+        {
+            H5Pclose( fileCreate );
+            fileCreate = H5P_DEFAULT;
+        }
+    }
+#endif
+    
+    hid_t file = -1;
+#if H5_VERSION_GE( 1, 10, 1 )
+    if( pageBuffered )
+    {
+        //Only files with paged file space can be page buffered, so files that don't have it are opened again without.
+        H5E_BEGIN_TRY
+        {
+            file = openOrCreate( filename, mode, fileCreate, fileAccess );
+        }
+        H5E_END_TRY;
+        
+        if( file < 0 )
+        {
+            H5Pset_page_buffer_size( fileAccess, 0, 0, 0 );
+        }
+    }
+#endif
+    if( file < 0 )
+    {
+        file = openOrCreate( filename, mode, fileCreate, fileAccess );
+    }
+    H5Pclose( fileAccess );
+    if( fileCreate != H5P_DEFAULT )
+    {
+        H5Pclose( fileCreate );
+    }
+    
+    if( file < 0 )
+    {
+        return file;
+    }
+    
+    File &entry = files[key];
+    entry.file = file;
+    entry.writable = ( mode != HDF5_FILE_READ );
+    entry.parallel = parallel;
+    //Closing a parallel file is collective, so it can't be left to whenever the cache gets round to it.
+    entry.reusable = !entry.writable && !parallel;
+    entry.users = 1;
+    
+    return file;
+}
+
+
+/**
+ * File image callbacks that hand HDF5 the caller's image instead of a copy of it. The core driver only asks for a
+ * buffer of the image's own size, and only writes to it if the file is writable, which images never are.
+ */
+static void *imageMalloc( size_t size, H5FD_file_image_op_t operation, void *image )
+{
+    return image;
+}
+
+
+static void *imageMemcpy( void *destination, const void *source, size_t size, H5FD_file_image_op_t operation, void *image )
+{
+    if( destination != source )
+    {
+        return NULL;
+    }
+    
+    return destination;
+}
+
+
+static void *imageRealloc( void *buffer, size_t size, H5FD_file_image_op_t operation, void *image )
+{
+    return NULL;
+}
+
+
+static herr_t imageFree( void *buffer, H5FD_file_image_op_t operation, void *image )
+{
+    return 0;
+}
+
+
+static void *imageCopy( void *image )
+{
+    return image;
+}
+
+
+static herr_t imageRelease( void *image )
+{
+    return 0;
+}
+
+
+hid_t Hdf5HandleCache::openImage( FmlSessionHandle session, const void *image, int64_t imageLength )
+{
+    //The core driver treats files with the same name as the same file, so images are named after where they are.
+    char name[64];
+    snprintf( name, sizeof( name ), "fieldml-image-%p-%lld", image, (long long)imageLength );
+    const FileKey key( session, name );
+    
+    closeIdleFiles( string() );
+    
+    map<FileKey, File>::iterator existing = files.find( key );
+    if( existing != files.end() )
+    {
+        existing->second.users++;
+        return existing->second.file;
+    }
+    
+    H5FD_file_image_callbacks_t callbacks = { imageMalloc, imageMemcpy, imageRealloc, imageFree, imageCopy, imageRelease, (void*)image };
+    
+    //Images are in memory already, so there is nothing to page buffer.
+    bool pageBuffered;
+    hid_t file = -1;
+    hid_t accessProperties = createAccessProperties( session, H5P_DEFAULT, false, pageBuffered );
+    if( ( H5Pset_fapl_core( accessProperties, IMAGE_INCREMENT, 0 ) >= 0 ) &&
+        ( H5Pset_file_image_callbacks( accessProperties, &callbacks ) >= 0 ) &&
+        ( H5Pset_file_image( accessProperties, (void*)image, imageLength ) >= 0 ) )
+    {
+        file = H5Fopen( name, H5F_ACC_RDONLY, accessProperties );
+    }
+    H5Pclose( accessProperties );
+    
+    if( file < 0 )
+    {
+        return file;
+    }
+    
+    //The image belongs to the caller, so its file can't outlive its last user.
+    File &entry = files[key];
+    entry.file = file;
+    entry.writable = false;
+    entry.parallel = false;
+    entry.reusable = false;
+    entry.users = 1;
+    
+    return file;
+}
+
+
+hid_t Hdf5HandleCache::openDataset( hid_t file, const string &location )
+{
+    File *entry = findFile( file );
+    if( entry == NULL )
+    {
+        return -1;
+    }
+    
+    map<string, Dataset>::iterator existing = entry->datasets.find( location );
+    if( existing != entry->datasets.end() )
+    {
+        if( existing->second.users == 0 )
+        {
+            entry->idleDatasets.remove( location );
+        }
+        existing->second.users++;
+        return existing->second.dataset;
+    }
+    
+    hid_t dataset = H5Dopen( file, location.c_str(), H5P_DEFAULT );
+    if( dataset >= 0 )
+    {
+        addDataset( file, location, dataset );
+    }
+    
+    return dataset;
+}
+
+
+void Hdf5HandleCache::addDataset( hid_t file, const string &location, hid_t dataset )
+{
+    File *entry = findFile( file );
+    if( entry == NULL )
+    {
+        H5Dclose( dataset );
+        return;
+    }
+    
+    Dataset &datasetEntry = entry->datasets[location];
+    datasetEntry.dataset = dataset;
+    datasetEntry.users = 1;
+}
+
+
+void Hdf5HandleCache::closeDataset( hid_t file, hid_t dataset )
+{
+    File *entry = findFile( file );
+    if( entry == NULL )
+    {
+        return;
+    }
+    
+    for( map<string, Dataset>::iterator i = entry->datasets.begin(); i != entry->datasets.end(); i++ )
+    {
+        if( i->second.dataset == dataset )
+        {
+            i->second.users--;
+            if( i->second.users > 0 )
+            {
+                return;
+            }
+            
+            if( !entry->reusable )
+            {
+                H5Dclose( dataset );
+                entry->datasets.erase( i );
+                return;
+            }
+            
+            entry->idleDatasets.push_front( i->first );
+            if( entry->idleDatasets.size() > MAX_IDLE_DATASETS )
+            {
+                map<string, Dataset>::iterator oldest = entry->datasets.find( entry->idleDatasets.back() );
+                H5Dclose( oldest->second.dataset );
+                entry->datasets.erase( oldest );
+                entry->idleDatasets.pop_back();
+            }
+            return;
+        }
+    }
+}
+
+
+void Hdf5HandleCache::closeFile( hid_t file )
+{
+    for( map<FileKey, File>::iterator i = files.begin(); i != files.end(); i++ )
+    {
+        if( i->second.file != file )
+        {
+            continue;
+        }
+        
+        i->second.users--;
+        if( i->second.users > 0 )
+        {
+            return;
+        }
+        
+        if( !i->second.reusable || ( Fieldml_GetLastError( i->first.first ) == FML_ERR_UNKNOWN_HANDLE ) )
+        {
+            releaseFile( i );
+            return;
+        }
+        
+        idleFiles.push_front( i->first );
+        if( idleFiles.size() > MAX_IDLE_FILES )
+        {
+            releaseFile( files.find( idleFiles.back() ) );
+        }
+        return;
+    }
+}
+
+#endif //FIELDML_HDF5_ARRAY || FIELDML_PHDF5_ARRAY
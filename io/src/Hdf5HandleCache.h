@@ -0,0 +1,164 @@
+/* \file
+ * $Id$
+ * \author Caton Little
+ * \brief 
+ *
+ * \section LICENSE
+ *
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is FieldML
+ *
+ * The Initial Developer of the Original Code is Auckland Uniservices Ltd,
+ * Auckland, New Zealand. Portions created by the Initial Developer are
+ * Copyright (C) 2010 the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either the GNU General Public License Version 2 or later (the "GPL"), or
+ * the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ */
+
+#ifndef H_HDF5_HANDLE_CACHE
+#define H_HDF5_HANDLE_CACHE
+
+#include <string>
+#include <map>
+#include <list>
+
+#include "FieldmlIoApi.h"
+
+#if defined FIELDML_HDF5_ARRAY || defined FIELDML_PHDF5_ARRAY
+#include <hdf5.h>
+
+/**
+ * How a reader or writer needs an HDF5 file to be opened.
+ */
+enum Hdf5FileMode
+{
+    HDF5_FILE_READ,         ///< Open an existing file for reading.
+    HDF5_FILE_APPEND,       ///< Open an existing file for writing, or create it if there isn't one.
+    HDF5_FILE_CREATE,       ///< Create a new file for writing, replacing any existing one.
+};
+
+
+/**
+ * Shares open HDF5 files and datasets between the readers and writers of a session, so that a file holding many
+ * arrays is only opened once however many of them are in use. Handles are reference counted, and closed once their
+ * last user releases them, except that a few files that were only being read are kept open while idle, along with a
+ * few of their datasets, so that reading arrays one after another doesn't keep reopening them. Idle files are closed
+ * as soon as anything wants to write to them, or their session is destroyed.
+ * 
+ * HDF5 is not thread-safe, so the cache must only be used while holding ArrayDataReader's shared state lock.
+ */
+class Hdf5HandleCache
+{
+private:
+    class Dataset
+    {
+    public:
+        hid_t dataset;
+        
+        int users;
+    };
+    
+    class File
+    {
+    public:
+        hid_t file;
+        
+        bool writable;
+        
+        bool parallel;
+        
+        //Whether the file can be kept open while idle. Only serial files opened for reading can be.
+        bool reusable;
+        
+        int users;
+        
+        std::map<std::string, Dataset> datasets;
+        
+        //The locations of the datasets nobody is using, most recently used first.
+        std::list<std::string> idleDatasets;
+    };
+    
+    typedef std::pair<FmlSessionHandle, std::string> FileKey;
+    
+    std::map<FileKey, File> files;
+    
+    //The files nobody is using, most recently used first.
+    std::list<FileKey> idleFiles;
+    
+    Hdf5HandleCache();
+    
+    File *findFile( hid_t file );
+    
+    void releaseFile( std::map<FileKey, File>::iterator i );
+    
+    /**
+     * Closes the idle files of destroyed sessions, and of the given file if it's not empty.
+     */
+    void closeIdleFiles( const std::string &filename );
+    
+public:
+    virtual ~Hdf5HandleCache();
+    
+    /**
+     * Returns the given file, opened in a mode compatible with the one requested, or a negative handle on failure. A
+     * file that is already open is shared if it is writable or only needs to be read, but a file that is in use can't
+     * be replaced. The file access properties must match those of any existing user. A new serial file has paged file
+     * space if asked for.
+     */
+    hid_t openFile( FmlSessionHandle session, const std::string &filename, Hdf5FileMode mode, hid_t accessProperties, bool pagedFileSpace );
+    
+    /**
+     * Returns a read-only file backed by the given in-memory image, which is used in place rather than copied and
+     * must outlive the file. Opening the same image again shares the file, as with openFile().
+     */
+    hid_t openImage( FmlSessionHandle session, const void *image, int64_t imageLength );
+    
+    /**
+     * Returns the given dataset in a file opened through the cache, or a negative handle if it can't be opened.
+     */
+    hid_t openDataset( hid_t file, const std::string &location );
+    
+    /**
+     * Adds a newly created dataset to the cache, which then owns it.
+     */
+    void addDataset( hid_t file, const std::string &location, hid_t dataset );
+    
+    void closeDataset( hid_t file, hid_t dataset );
+    
+    void closeFile( hid_t file );
+    
+    /**
+     * Closes the given session's idle files, e.g. so that they're reopened with new cache options.
+     */
+    void closeIdleFiles( FmlSessionHandle session );
+    
+    static Hdf5HandleCache &getCache();
+};
+
+#endif //FIELDML_HDF5_ARRAY || FIELDML_PHDF5_ARRAY
+
+#endif //H_HDF5_HANDLE_CACHE
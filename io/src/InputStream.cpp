@@ -42,7 +42,16 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <climits>
 #include <string>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <system_error>
+
+#ifdef FIELDML_ZLIB_STREAMS
+#include <zlib.h>
+#endif //FIELDML_ZLIB_STREAMS
 
 #include "FieldmlIoApi.h"
 #include "InputStream.h"
@@ -55,6 +64,8 @@ class FileInputStream :
 private:
     FILE *file;
     
+    char *fileBuffer;
+    
 protected:
     int loadBuffer();
     
@@ -70,9 +81,9 @@ class StringInputStream :
     public FieldmlInputStream
 {
 private:
-    int stringPos;
-    int stringMaxLen;
-    const std::string string;
+    long stringPos;
+    long stringMaxLen;
+    const char * const string;
 
 protected:
     int loadBuffer();
@@ -82,41 +93,186 @@ public:
     virtual long tell();
     virtual bool seek( long pos );
 
-    StringInputStream( const std::string _string );
+    virtual bool isInMemory();
+
+    StringInputStream( const char *_string, long _length );
     virtual ~StringInputStream();
 };
 
- class CallbackStream :
-	  public FieldmlInputStream
- {
- private:
-	  const std::string href;
-	  int requested;
-	  int requestedBufferPos;
-	  void *user_data;
-	  void *requestedBuffer;
-	  unsigned int memoryBufferSize;
-	  FieldmlStreamRequestStatus status;
 
- protected:
-	  int loadBuffer();
+class InlineDataInputStream :
+    public StringInputStream
+{
+private:
+    const FmlSessionHandle session;
+    const FmlObjectHandle resource;
+    const char * const view;
+    
+public:
+    InlineDataInputStream( FmlSessionHandle _session, FmlObjectHandle _resource, const char *_view, int _length );
+    virtual ~InlineDataInputStream();
+};
+
+#ifdef FIELDML_ZLIB_STREAMS
+/**
+ * Reads a gzip-compressed file, decompressing straight into the stream's buffer.
+ */
+class GzipFileInputStream :
+    public FieldmlInputStream
+{
+private:
+    gzFile file;
+    
+    char *fileBuffer;
+    
+protected:
+    int loadBuffer();
+    
+public:
+    virtual long tell();
+    virtual bool seek( long pos );
+
+    GzipFileInputStream( gzFile _file );
+    virtual ~GzipFileInputStream();
+};
+
+
+/**
+ * Decompresses gzip data from another stream, for compressed data that doesn't come from a file.
+ */
+class InflateInputStream :
+    public FieldmlInputStream
+{
+private:
+    FieldmlInputStream * const source;
+    
+    z_stream zstream;
+    
+    char *sourceBuffer;
+    
+    char *inflateBuffer;
+    
+    //The position in the decompressed data of the start of the current buffer.
+    long bufferStart;
+    
+    bool finished;
+    
+    void restart();
+    
+protected:
+    int loadBuffer();
+    
+public:
+    virtual long tell();
+    virtual bool seek( long pos );
+
+    InflateInputStream( FieldmlInputStream *_source );
+    virtual ~InflateInputStream();
+};
+#endif //FIELDML_ZLIB_STREAMS
+
+
+/**
+ * Reads another stream a chunk ahead, on a helper thread, so that the next chunk is usually ready by the time the
+ * current one has been parsed. The other stream isn't touched by the caller's thread while a chunk is being fetched.
+ * The helper lives as long as the stream, and is handed one chunk at a time, so a large file costs one thread rather
+ * than one per chunk.
+ */
+class ReadAheadInputStream :
+    public FieldmlInputStream
+{
+private:
+    FieldmlInputStream * const source;
+    
+    //The buffer being parsed, and the one being filled.
+    char *buffers[2];
+    
+    int frontBuffer;
+    
+    //The stream position of the start of the buffer being parsed.
+    long bufferStart;
+    
+    std::mutex lock;
+    
+    std::condition_variable fillChanged;
+    
+    std::thread helper;
+    
+    //Set if the helper couldn't be started, in which case chunks are fetched on the caller's thread instead.
+    bool synchronous;
+    
+    bool stopping;
+    
+    //Whether a chunk has been asked for, and whether it has arrived.
+    bool fillPending;
+    
+    bool fillDone;
+    
+    long fillCount;
+    
+    void startFill();
+    
+    long finishFill();
+    
+    void fill();
+    
+protected:
+    int loadBuffer();
+    
+public:
+    virtual long tell();
+    virtual bool seek( long pos );
+
+    ReadAheadInputStream( FieldmlInputStream *_source );
+    virtual ~ReadAheadInputStream();
+};
+
+
+class CallbackStream :
+    public FieldmlInputStream
+{
+private:
+    const std::string href;
+    const Fieldml_StreamRequestCallbackFunction function;
+    void * const userData;
+    char *callbackBuffer;
+    
+    //The stream position of the start of the current buffer.
+    long bufferStart;
+    
+    FieldmlStreamRequestStatus status;
+    
+    void restart();
 
- public:
+protected:
+    int loadBuffer();
 
-	  virtual long tell();
-	  virtual bool seek( long pos );
+public:
+    virtual long tell();
+    virtual bool seek( long pos );
 
- };
+    CallbackStream( const std::string _href, Fieldml_StreamRequestCallbackFunction _function, void *_userData );
+    virtual ~CallbackStream();
+};
 
 static const int BUFFER_SIZE = 1024;
 
+//Decompression costs more per call than a plain read, so compressed files are read in bigger chunks.
+static const int GZIP_BUFFER_SIZE = 65536;
+
+//Read-ahead is only worth a thread hand-off for fairly large chunks.
+static const int READ_AHEAD_BUFFER_SIZE = 256 * 1024;
+
+//Callbacks may be reading from something slow, so ask them for bigger chunks than plain files.
+static const int CALLBACK_BUFFER_SIZE = 65536;
+
 //Using a #define because the relevant buffer is allocated on stack.
 #define NBUFFER_SIZE 64
 
 
 FieldmlInputStream::FieldmlInputStream()
 {
-    buffer = (char*)calloc( 1, BUFFER_SIZE );
+    buffer = NULL;
     bufferCount = 0;
     bufferPos = 0;
     isEof = false;
@@ -263,6 +419,50 @@ FmlBoolean FieldmlInputStream::readBoolean()
 }
 
 
+int FieldmlInputStream::skipValues( long count )
+{
+    int d;
+    int inValue = 0;
+    
+    //Uses the same notion of a value as readDouble, but without the parsing.
+    while( count > 0 )
+    {
+        if( bufferPos >= bufferCount )
+        {
+            if( !loadBuffer() )
+            {
+                if( inValue && ( count == 1 ) )
+                {
+                    return FML_IOERR_NO_ERROR;
+                }
+                return FML_IOERR_UNEXPECTED_EOF;
+            }
+        }
+        
+        while( bufferPos < bufferCount )
+        {
+            d = buffer[bufferPos];
+            if( ( ( d >= '0' ) && ( d <= '9' ) ) || ( d == 'e' ) || ( d == 'E' ) || ( d == '-' ) || ( d == '+') || ( d == '.' ) )
+            {
+                inValue = 1;
+            }
+            else if( inValue )
+            {
+                inValue = 0;
+                count--;
+                if( count == 0 )
+                {
+                    return FML_IOERR_NO_ERROR;
+                }
+            }
+            bufferPos++;
+        }
+    }
+    
+    return FML_IOERR_NO_ERROR;
+}
+
+
 int FieldmlInputStream::skipLine()
 {
     while( true )
@@ -297,15 +497,136 @@ FieldmlInputStream *FieldmlInputStream::createTextFileStream( const string filen
         return NULL;
     }
     
+    //Compressed files are recognised by the gzip magic number, whatever they're called.
+    unsigned char magic[2];
+    bool compressed = ( fread( magic, 1, 2, file ) == 2 ) && ( magic[0] == 0x1f ) && ( magic[1] == 0x8b );
+    if( compressed )
+    {
+        fclose( file );
+        return createGzipFileStream( filename );
+    }
+    rewind( file );
+    
     return new FileInputStream( file );
 }
 
 
-FieldmlInputStream *FieldmlInputStream::createStringStream( const string sourceString )
+FieldmlInputStream *FieldmlInputStream::createGzipFileStream( const string filename )
+{
+#ifdef FIELDML_ZLIB_STREAMS
+    gzFile file = gzopen( filename.c_str(), "rb" );
+    if( file == NULL )
+    {
+        return NULL;
+    }
+    gzbuffer( file, GZIP_BUFFER_SIZE );
+    
+    return new GzipFileInputStream( file );
+#else
+    return NULL;
+#endif //FIELDML_ZLIB_STREAMS
+}
+
+
+FieldmlInputStream *FieldmlInputStream::createStringStream( const char *sourceString, long length )
+{
+    return new StringInputStream( sourceString, length );
+}
+
+
+FieldmlInputStream *FieldmlInputStream::createInlineDataStream( FmlSessionHandle session, FmlObjectHandle resource )
+{
+    int length;
+    const char *view = Fieldml_OpenInlineDataView( session, resource, &length );
+    if( view == NULL )
+    {
+        return NULL;
+    }
+    
+    return new InlineDataInputStream( session, resource, view, length );
+}
+
+
+FieldmlInputStream *FieldmlInputStream::createCallbackStream( const string href, Fieldml_StreamRequestCallbackFunction function, void *userData )
+{
+    if( function == NULL )
+    {
+        return NULL;
+    }
+    
+    return new CallbackStream( href, function, userData );
+}
+
+
+FieldmlInputStream *FieldmlInputStream::createDecompressingStream( FieldmlInputStream *source )
 {
-    return new StringInputStream( sourceString );
+    if( source == NULL )
+    {
+        return NULL;
+    }
+    
+    //As with files, compressed data is recognised by the gzip magic number.
+    unsigned char magic[2];
+    long count = source->readBytes( (char*)magic, 2 );
+    if( ( count > 0 ) && !source->seek( 0 ) )
+    {
+        delete source;
+        return NULL;
+    }
+    if( ( count < 2 ) || ( magic[0] != 0x1f ) || ( magic[1] != 0x8b ) )
+    {
+        return source;
+    }
+    
+#ifdef FIELDML_ZLIB_STREAMS
+    return new InflateInputStream( source );
+#else
+    delete source;
+    return NULL;
+#endif //FIELDML_ZLIB_STREAMS
 }
 
+
+long FieldmlInputStream::readBytes( char *destination, long count )
+{
+    long total = 0;
+    
+    while( total < count )
+    {
+        if( bufferPos >= bufferCount )
+        {
+            if( !loadBuffer() )
+            {
+                break;
+            }
+        }
+        
+        long length = bufferCount - bufferPos;
+        if( length > count - total )
+        {
+            length = count - total;
+        }
+        memcpy( destination + total, buffer + bufferPos, length );
+        bufferPos += length;
+        total += length;
+    }
+    
+    return total;
+}
+
+
+FieldmlInputStream *FieldmlInputStream::createReadAheadStream( FieldmlInputStream *source )
+{
+    return new ReadAheadInputStream( source );
+}
+
+
+bool FieldmlInputStream::isInMemory()
+{
+    return false;
+}
+
+
 bool FieldmlInputStream::eof()
 {
     return isEof;
@@ -314,13 +635,14 @@ bool FieldmlInputStream::eof()
 
 FieldmlInputStream::~FieldmlInputStream()
 {
-    free( buffer );
 }
 
 
 FileInputStream::FileInputStream( FILE *_file ) :
     file( _file )
 {
+    fileBuffer = (char*)calloc( 1, BUFFER_SIZE );
+    buffer = fileBuffer;
 }
 
 
@@ -330,6 +652,7 @@ FileInputStream::~FileInputStream()
     {
         fclose( file );
     }
+    free( fileBuffer );
 }
 
 
@@ -337,7 +660,7 @@ int FileInputStream::loadBuffer()
 {
     bufferPos = 0;
 
-    bufferCount = fread( buffer, 1, BUFFER_SIZE, file );
+    bufferCount = fread( fileBuffer, 1, BUFFER_SIZE, file );
     if( bufferCount <= 0 )
     {
         isEof = true;
@@ -366,26 +689,26 @@ bool FileInputStream::seek( long pos )
 }
 
 
-StringInputStream::StringInputStream( const std::string _string ) :
+StringInputStream::StringInputStream( const char *_string, long _length ) :
     string( _string )
 {
     stringPos = 0;
-    stringMaxLen = string.length();
+    stringMaxLen = _length;
 }
 
 int StringInputStream::loadBuffer()
 {
-    int len;
+    long len;
     
     bufferPos = 0;
 
-    len = BUFFER_SIZE;
-    if( len + stringPos > stringMaxLen )
+    //The string itself serves as the buffer, so there's nothing to copy.
+    len = stringMaxLen - stringPos;
+    if( len > INT_MAX )
     {
-        len = stringMaxLen - stringPos;
+        len = INT_MAX;
     }
-    //NOTE: Ugly. Maybe just remove the idea of a superclass buffer. 
-    memcpy( buffer, string.c_str() + stringPos, len );
+    buffer = string + stringPos;
     stringPos += len;
     bufferCount = len;
 
@@ -417,6 +740,481 @@ bool StringInputStream::seek( long pos )
     return true;
 }
 
+bool StringInputStream::isInMemory()
+{
+    return true;
+}
+
+
 StringInputStream::~StringInputStream()
 {
 }
+
+
+InlineDataInputStream::InlineDataInputStream( FmlSessionHandle _session, FmlObjectHandle _resource, const char *_view, int _length ) :
+    StringInputStream( _view, _length ),
+    session( _session ),
+    resource( _resource ),
+    view( _view )
+{
+}
+
+
+InlineDataInputStream::~InlineDataInputStream()
+{
+    Fieldml_CloseInlineDataView( session, resource, view );
+}
+
+
+CallbackStream::CallbackStream( const string _href, Fieldml_StreamRequestCallbackFunction _function, void *_userData ) :
+    href( _href ),
+    function( _function ),
+    userData( _userData )
+{
+    callbackBuffer = new char[CALLBACK_BUFFER_SIZE];
+    buffer = callbackBuffer;
+    bufferStart = 0;
+    status = FML_STREAM_REQUEST_STATUS_START;
+}
+
+
+CallbackStream::~CallbackStream()
+{
+    int bytesRead = 0;
+    function( href.c_str(), FML_STREAM_REQUEST_STATUS_END, NULL, 0, &bytesRead, userData );
+    
+    delete[] callbackBuffer;
+}
+
+
+int CallbackStream::loadBuffer()
+{
+    bufferStart += bufferCount;
+    bufferPos = 0;
+    bufferCount = 0;
+    
+    if( ( status == FML_STREAM_REQUEST_STATUS_END ) || ( status == FML_STREAM_REQUEST_STATUS_ERROR ) )
+    {
+        isEof = true;
+        return 0;
+    }
+    
+    int bytesRead = 0;
+    FieldmlStreamRequestStatus result = function( href.c_str(), status, callbackBuffer, CALLBACK_BUFFER_SIZE, &bytesRead, userData );
+    if( ( bytesRead < 0 ) || ( bytesRead > CALLBACK_BUFFER_SIZE ) || ( result == FML_STREAM_REQUEST_STATUS_ERROR ) )
+    {
+        bytesRead = 0;
+        result = FML_STREAM_REQUEST_STATUS_ERROR;
+    }
+    else if( ( result != FML_STREAM_REQUEST_STATUS_END ) && ( bytesRead == 0 ) )
+    {
+        //A callback that has nothing more to give is at the end, whatever it says.
+        result = FML_STREAM_REQUEST_STATUS_END;
+    }
+    
+    status = ( result == FML_STREAM_REQUEST_STATUS_OK ) ? FML_STREAM_REQUEST_STATUS_REQUESTED : result;
+    bufferCount = bytesRead;
+    
+    if( bufferCount <= 0 )
+    {
+        isEof = true;
+        return 0;
+    }
+    
+    return 1;
+}
+
+
+void CallbackStream::restart()
+{
+    status = FML_STREAM_REQUEST_STATUS_START;
+    bufferStart = 0;
+    bufferCount = 0;
+    bufferPos = 0;
+    isEof = false;
+}
+
+
+long CallbackStream::tell()
+{
+    return bufferStart + bufferPos;
+}
+
+
+bool CallbackStream::seek( long pos )
+{
+    if( pos < 0 )
+    {
+        return false;
+    }
+    
+    if( pos < bufferStart )
+    {
+        //The callback can only deliver data in order, so going backwards means starting again.
+        restart();
+    }
+    
+    while( pos >= bufferStart + bufferCount )
+    {
+        if( !loadBuffer() )
+        {
+            return false;
+        }
+    }
+    
+    bufferPos = pos - bufferStart;
+    isEof = false;
+    return true;
+}
+
+
+#ifdef FIELDML_ZLIB_STREAMS
+GzipFileInputStream::GzipFileInputStream( gzFile _file ) :
+    file( _file )
+{
+    fileBuffer = new char[GZIP_BUFFER_SIZE];
+    buffer = fileBuffer;
+}
+
+
+GzipFileInputStream::~GzipFileInputStream()
+{
+    gzclose( file );
+    delete[] fileBuffer;
+}
+
+
+int GzipFileInputStream::loadBuffer()
+{
+    bufferPos = 0;
+
+    bufferCount = gzread( file, fileBuffer, GZIP_BUFFER_SIZE );
+    if( bufferCount <= 0 )
+    {
+        bufferCount = 0;
+        isEof = true;
+        return 0;
+    }
+    
+    return 1;
+}
+
+
+long GzipFileInputStream::tell()
+{
+    return gztell( file ) - ( bufferCount - bufferPos );
+}
+
+
+bool GzipFileInputStream::seek( long pos )
+{
+    //Positions are in the uncompressed data. Seeking backwards makes zlib decompress from the start again.
+    if( gzseek( file, pos, SEEK_SET ) == pos )
+    {
+        bufferPos = bufferCount;
+        isEof = false;
+        return true;
+    }
+    
+    return false;
+}
+
+
+InflateInputStream::InflateInputStream( FieldmlInputStream *_source ) :
+    source( _source ),
+    bufferStart( 0 ),
+    finished( false )
+{
+    sourceBuffer = new char[GZIP_BUFFER_SIZE];
+    inflateBuffer = new char[GZIP_BUFFER_SIZE];
+    buffer = inflateBuffer;
+    
+    memset( &zstream, 0, sizeof( zstream ) );
+    //Adding 16 to the window size asks for a gzip header and trailer rather than a zlib one.
+    if( inflateInit2( &zstream, 15 + 16 ) != Z_OK )
+    {
+        finished = true;
+    }
+}
+
+
+InflateInputStream::~InflateInputStream()
+{
+    inflateEnd( &zstream );
+    delete source;
+    delete[] sourceBuffer;
+    delete[] inflateBuffer;
+}
+
+
+int InflateInputStream::loadBuffer()
+{
+    bufferStart += bufferCount;
+    bufferPos = 0;
+    bufferCount = 0;
+    
+    zstream.next_out = (Bytef*)inflateBuffer;
+    zstream.avail_out = GZIP_BUFFER_SIZE;
+    
+    while( !finished && ( zstream.avail_out == GZIP_BUFFER_SIZE ) )
+    {
+        if( zstream.avail_in == 0 )
+        {
+            long count = source->readBytes( sourceBuffer, GZIP_BUFFER_SIZE );
+            if( count <= 0 )
+            {
+                finished = true;
+                break;
+            }
+            zstream.next_in = (Bytef*)sourceBuffer;
+            zstream.avail_in = (uInt)count;
+        }
+        
+        int result = inflate( &zstream, Z_NO_FLUSH );
+        if( result == Z_STREAM_END )
+        {
+            //Appending to a compressed file adds another gzip member, which gzread carries straight on into.
+            inflateReset( &zstream );
+        }
+        else if( ( result != Z_OK ) && ( ( result != Z_BUF_ERROR ) || ( zstream.avail_in != 0 ) ) )
+        {
+            finished = true;
+        }
+    }
+    
+    bufferCount = GZIP_BUFFER_SIZE - zstream.avail_out;
+    if( bufferCount <= 0 )
+    {
+        bufferCount = 0;
+        isEof = true;
+        return 0;
+    }
+    
+    return 1;
+}
+
+
+void InflateInputStream::restart()
+{
+    inflateReset( &zstream );
+    zstream.avail_in = 0;
+    bufferStart = 0;
+    bufferCount = 0;
+    bufferPos = 0;
+    finished = !source->seek( 0 );
+    isEof = false;
+}
+
+
+long InflateInputStream::tell()
+{
+    return bufferStart + bufferPos;
+}
+
+
+bool InflateInputStream::seek( long pos )
+{
+    if( pos < 0 )
+    {
+        return false;
+    }
+    
+    if( pos < bufferStart )
+    {
+        //Positions are in the decompressed data, so going backwards means decompressing from the start again.
+        restart();
+    }
+    
+    while( pos >= bufferStart + bufferCount )
+    {
+        if( !loadBuffer() )
+        {
+            return false;
+        }
+    }
+    
+    bufferPos = pos - bufferStart;
+    isEof = false;
+    return true;
+}
+#endif //FIELDML_ZLIB_STREAMS
+
+
+ReadAheadInputStream::ReadAheadInputStream( FieldmlInputStream *_source ) :
+    source( _source ),
+    synchronous( false ),
+    stopping( false ),
+    fillPending( false ),
+    fillDone( false ),
+    fillCount( 0 )
+{
+    buffers[0] = new char[READ_AHEAD_BUFFER_SIZE];
+    buffers[1] = new char[READ_AHEAD_BUFFER_SIZE];
+    frontBuffer = 0;
+    buffer = buffers[frontBuffer];
+    bufferStart = source->tell();
+    
+    try
+    {
+        helper = thread( &ReadAheadInputStream::fill, this );
+    }
+    catch( const system_error & )
+    {
+        //Out of threads. Reading without the look-ahead is slower, but still gets there.
+        synchronous = true;
+    }
+    
+    startFill();
+}
+
+
+ReadAheadInputStream::~ReadAheadInputStream()
+{
+    finishFill();
+    
+    if( !synchronous )
+    {
+        {
+            lock_guard<mutex> guard( lock );
+            stopping = true;
+        }
+        fillChanged.notify_all();
+        helper.join();
+    }
+    
+    //Leave the source where this stream was, so that it can carry on from there.
+    source->seek( tell() );
+    
+    delete[] buffers[0];
+    delete[] buffers[1];
+}
+
+
+void ReadAheadInputStream::startFill()
+{
+    if( synchronous )
+    {
+        fillCount = source->readBytes( buffers[1 - frontBuffer], READ_AHEAD_BUFFER_SIZE );
+        fillPending = true;
+        fillDone = true;
+        return;
+    }
+    
+    {
+        lock_guard<mutex> guard( lock );
+        fillPending = true;
+        fillDone = false;
+    }
+    fillChanged.notify_all();
+}
+
+
+long ReadAheadInputStream::finishFill()
+{
+    unique_lock<mutex> guard( lock );
+    
+    if( !fillPending )
+    {
+        return 0;
+    }
+    
+    while( !fillDone )
+    {
+        fillChanged.wait( guard );
+    }
+    fillPending = false;
+    
+    return fillCount;
+}
+
+
+void ReadAheadInputStream::fill()
+{
+    unique_lock<mutex> guard( lock );
+    
+    while( true )
+    {
+        if( stopping )
+        {
+            return;
+        }
+        if( !fillPending || fillDone )
+        {
+            fillChanged.wait( guard );
+            continue;
+        }
+        
+        //The back buffer and the source are left alone by the caller's thread until the chunk is done.
+        char *fillBuffer = buffers[1 - frontBuffer];
+        guard.unlock();
+        long count = source->readBytes( fillBuffer, READ_AHEAD_BUFFER_SIZE );
+        guard.lock();
+        
+        fillCount = count;
+        fillDone = true;
+        fillChanged.notify_all();
+    }
+}
+
+
+int ReadAheadInputStream::loadBuffer()
+{
+    bufferStart += bufferCount;
+    bufferPos = 0;
+    bufferCount = 0;
+    
+    long count = finishFill();
+    if( count <= 0 )
+    {
+        isEof = true;
+        return 0;
+    }
+    
+    frontBuffer = 1 - frontBuffer;
+    buffer = buffers[frontBuffer];
+    bufferCount = (int)count;
+    
+    //The old front buffer is finished with, so the next chunk can go there.
+    startFill();
+    
+    return 1;
+}
+
+
+long ReadAheadInputStream::tell()
+{
+    return bufferStart + bufferPos;
+}
+
+
+bool ReadAheadInputStream::seek( long pos )
+{
+    if( ( pos >= bufferStart ) && ( pos < bufferStart + bufferCount ) )
+    {
+        bufferPos = pos - bufferStart;
+        isEof = false;
+        return true;
+    }
+    
+    //Anywhere else means starting afresh from the new position.
+    finishFill();
+    
+    if( !source->seek( pos ) )
+    {
+        //Carry on from wherever the source was left.
+        bufferStart = source->tell();
+        bufferPos = 0;
+        bufferCount = 0;
+        startFill();
+        return false;
+    }
+    
+    bufferStart = pos;
+    bufferPos = 0;
+    bufferCount = 0;
+    isEof = false;
+    startFill();
+    
+    return true;
+}
+
@@ -47,7 +47,8 @@
 class FieldmlInputStream
 {
 protected:
-    char *buffer;
+    //Subclasses point this at whatever holds their next run of characters.
+    const char *buffer;
     int bufferCount;
     int bufferPos;
     bool isEof;
@@ -64,6 +65,14 @@ public:
     
     int skipLine();
     
+    int skipValues( long count );
+    
+    /**
+     * Copies up to count raw bytes from the stream, returning the number copied. Fewer are only returned at the end
+     * of the stream.
+     */
+    long readBytes( char *destination, long count );
+    
     bool eof();
     
     virtual ~FieldmlInputStream();
@@ -71,8 +80,52 @@ public:
     virtual long tell() = 0;
     virtual bool seek( long pos ) = 0;
     
+    /**
+     * Returns true if the stream reads from memory, so that there's nothing to gain by reading ahead.
+     */
+    virtual bool isInMemory();
+    
+    /**
+     * Returns a stream that reads the given file. Gzip-compressed files are decompressed as they are read.
+     */
     static FieldmlInputStream *createTextFileStream( const std::string filename );
-    static FieldmlInputStream *createStringStream( const std::string string );
+    
+    /**
+     * Returns a stream that decompresses the given gzip file as it is read, or NULL if the library was built without
+     * zlib. Uncompressed files are read as is.
+     */
+    static FieldmlInputStream *createGzipFileStream( const std::string filename );
+    
+    /**
+     * Returns a stream that reads directly from the given characters, which must outlive the stream.
+     */
+    static FieldmlInputStream *createStringStream( const char *string, long length );
+    
+    /**
+     * Returns a stream that reads directly from the given data resource's inline data. The stream holds the data open
+     * until it is destroyed, so later changes to the resource don't affect it.
+     */
+    static FieldmlInputStream *createInlineDataStream( FmlSessionHandle session, FmlObjectHandle resource );
+    
+    /**
+     * Returns a stream that pulls the named resource's data through the given callback, one chunk at a time as it is
+     * needed. Seeking backwards asks the callback to start again from the beginning.
+     */
+    static FieldmlInputStream *createCallbackStream( const std::string href, Fieldml_StreamRequestCallbackFunction function, void *userData );
+    
+    /**
+     * Returns a stream that decompresses the given stream as it is read if its data starts with the gzip magic number,
+     * or else the given stream itself. The returned stream owns the given one. Returns NULL, destroying the given
+     * stream, if the data is compressed and the library was built without zlib.
+     */
+    static FieldmlInputStream *createDecompressingStream( FieldmlInputStream *source );
+    
+    /**
+     * Returns a stream that reads the given stream from its current position, fetching the next chunk on a helper
+     * thread while the current one is being parsed. The given stream must not be used until the returned one has been
+     * destroyed, at which point it is left positioned where the returned stream was.
+     */
+    static FieldmlInputStream *createReadAheadStream( FieldmlInputStream *source );
 };
 
 #endif //H_FIELDML_INPUT_STREAM
@@ -0,0 +1,487 @@
+/* \file
+ * $Id$
+ * \author Caton Little
+ * \brief 
+ *
+ * \section LICENSE
+ *
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is FieldML
+ *
+ * The Initial Developer of the Original Code is Auckland Uniservices Ltd,
+ * Auckland, New Zealand. Portions created by the Initial Developer are
+ * Copyright (C) 2010 the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either the GNU General Public License Version 2 or later (the "GPL"), or
+ * the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ */
+
+#include <cstdio>
+#include <cstring>
+
+#include "NumberFormat.h"
+
+/*
+ * The double formatter is an implementation of Florian Loitsch's Grisu2 algorithm, from "Printing Floating-Point
+ * Numbers Quickly and Accurately with Integers" (PLDI 2010). Grisu2 always produces digits that read back to exactly
+ * the same double, and for all but a tiny fraction of values it also produces the shortest such digit string.
+ */
+
+namespace
+{
+    const uint64_t DP_SIGNIFICAND_MASK = 0x000FFFFFFFFFFFFFULL;
+    const uint64_t DP_EXPONENT_MASK = 0x7FF0000000000000ULL;
+    const uint64_t DP_HIDDEN_BIT = 0x0010000000000000ULL;
+    const int DP_SIGNIFICAND_SIZE = 52;
+    const int DP_EXPONENT_BIAS = 0x3FF + DP_SIGNIFICAND_SIZE;
+    const int DIY_SIGNIFICAND_SIZE = 64;
+
+    const uint32_t POW10[] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000 };
+
+    //Normalized 64-bit approximations of 10^k, for k = -348, -340, ..., 340.
+    const uint64_t CACHED_POWERS_F[] = {
+    0xfa8fd5a0081c0288ULL, 0xbaaee17fa23ebf76ULL, 0x8b16fb203055ac76ULL,
+    0xcf42894a5dce35eaULL, 0x9a6bb0aa55653b2dULL, 0xe61acf033d1a45dfULL,
+    0xab70fe17c79ac6caULL, 0xff77b1fcbebcdc4fULL, 0xbe5691ef416bd60cULL,
+    0x8dd01fad907ffc3cULL, 0xd3515c2831559a83ULL, 0x9d71ac8fada6c9b5ULL,
+    0xea9c227723ee8bcbULL, 0xaecc49914078536dULL, 0x823c12795db6ce57ULL,
+    0xc21094364dfb5637ULL, 0x9096ea6f3848984fULL, 0xd77485cb25823ac7ULL,
+    0xa086cfcd97bf97f4ULL, 0xef340a98172aace5ULL, 0xb23867fb2a35b28eULL,
+    0x84c8d4dfd2c63f3bULL, 0xc5dd44271ad3cdbaULL, 0x936b9fcebb25c996ULL,
+    0xdbac6c247d62a584ULL, 0xa3ab66580d5fdaf6ULL, 0xf3e2f893dec3f126ULL,
+    0xb5b5ada8aaff80b8ULL, 0x87625f056c7c4a8bULL, 0xc9bcff6034c13053ULL,
+    0x964e858c91ba2655ULL, 0xdff9772470297ebdULL, 0xa6dfbd9fb8e5b88fULL,
+    0xf8a95fcf88747d94ULL, 0xb94470938fa89bcfULL, 0x8a08f0f8bf0f156bULL,
+    0xcdb02555653131b6ULL, 0x993fe2c6d07b7facULL, 0xe45c10c42a2b3b06ULL,
+    0xaa242499697392d3ULL, 0xfd87b5f28300ca0eULL, 0xbce5086492111aebULL,
+    0x8cbccc096f5088ccULL, 0xd1b71758e219652cULL, 0x9c40000000000000ULL,
+    0xe8d4a51000000000ULL, 0xad78ebc5ac620000ULL, 0x813f3978f8940984ULL,
+    0xc097ce7bc90715b3ULL, 0x8f7e32ce7bea5c70ULL, 0xd5d238a4abe98068ULL,
+    0x9f4f2726179a2245ULL, 0xed63a231d4c4fb27ULL, 0xb0de65388cc8ada8ULL,
+    0x83c7088e1aab65dbULL, 0xc45d1df942711d9aULL, 0x924d692ca61be758ULL,
+    0xda01ee641a708deaULL, 0xa26da3999aef774aULL, 0xf209787bb47d6b85ULL,
+    0xb454e4a179dd1877ULL, 0x865b86925b9bc5c2ULL, 0xc83553c5c8965d3dULL,
+    0x952ab45cfa97a0b3ULL, 0xde469fbd99a05fe3ULL, 0xa59bc234db398c25ULL,
+    0xf6c69a72a3989f5cULL, 0xb7dcbf5354e9beceULL, 0x88fcf317f22241e2ULL,
+    0xcc20ce9bd35c78a5ULL, 0x98165af37b2153dfULL, 0xe2a0b5dc971f303aULL,
+    0xa8d9d1535ce3b396ULL, 0xfb9b7cd9a4a7443cULL, 0xbb764c4ca7a44410ULL,
+    0x8bab8eefb6409c1aULL, 0xd01fef10a657842cULL, 0x9b10a4e5e9913129ULL,
+    0xe7109bfba19c0c9dULL, 0xac2820d9623bf429ULL, 0x80444b5e7aa7cf85ULL,
+    0xbf21e44003acdd2dULL, 0x8e679c2f5e44ff8fULL, 0xd433179d9c8cb841ULL,
+    0x9e19db92b4e31ba9ULL, 0xeb96bf6ebadf77d9ULL, 0xaf87023b9bf0ee6bULL
+    };
+
+    const int16_t CACHED_POWERS_E[] = {
+    -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980,
+    -954, -927, -901, -874, -847, -821, -794, -768, -741, -715,
+    -688, -661, -635, -608, -582, -555, -529, -502, -475, -449,
+    -422, -396, -369, -343, -316, -289, -263, -236, -210, -183,
+    -157, -130, -103, -77, -50, -24, 3, 30, 56, 83,
+    109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+    375, 402, 428, 455, 481, 508, 534, 561, 588, 614,
+    641, 667, 694, 720, 747, 774, 800, 827, 853, 880,
+    907, 933, 960, 986, 1013, 1039, 1066
+    };
+
+    const char DIGIT_PAIRS[] =
+        "00010203040506070809"
+        "10111213141516171819"
+        "20212223242526272829"
+        "30313233343536373839"
+        "40414243444546474849"
+        "50515253545556575859"
+        "60616263646566676869"
+        "70717273747576777879"
+        "80818283848586878889"
+        "90919293949596979899";
+
+
+    /**
+     * A do-it-yourself floating point number, with a 64-bit significand and no implicit bits.
+     */
+    class DiyFp
+    {
+    public:
+        uint64_t f;
+        int e;
+
+        DiyFp( uint64_t _f, int _e ) :
+            f( _f ), e( _e ) {}
+
+        DiyFp operator-( const DiyFp &rhs ) const
+        {
+            return DiyFp( f - rhs.f, e );
+        }
+
+        DiyFp operator*( const DiyFp &rhs ) const
+        {
+            const uint64_t M32 = 0xFFFFFFFFULL;
+            const uint64_t a = f >> 32;
+            const uint64_t b = f & M32;
+            const uint64_t c = rhs.f >> 32;
+            const uint64_t d = rhs.f & M32;
+            const uint64_t ac = a * c;
+            const uint64_t bc = b * c;
+            const uint64_t ad = a * d;
+            const uint64_t bd = b * d;
+            uint64_t tmp = ( bd >> 32 ) + ( ad & M32 ) + ( bc & M32 );
+            tmp += 1ULL << 31; //Round
+            return DiyFp( ac + ( ad >> 32 ) + ( bc >> 32 ) + ( tmp >> 32 ), e + rhs.e + 64 );
+        }
+    };
+
+
+    DiyFp fromDouble( double value )
+    {
+        uint64_t bits;
+        memcpy( &bits, &value, sizeof( bits ) );
+
+        const int biasedExponent = (int)( ( bits & DP_EXPONENT_MASK ) >> DP_SIGNIFICAND_SIZE );
+        const uint64_t significand = bits & DP_SIGNIFICAND_MASK;
+        if( biasedExponent != 0 )
+        {
+            return DiyFp( significand + DP_HIDDEN_BIT, biasedExponent - DP_EXPONENT_BIAS );
+        }
+
+        //Denormal.
+        return DiyFp( significand, 1 - DP_EXPONENT_BIAS );
+    }
+
+
+    DiyFp normalize( DiyFp value )
+    {
+        while( !( value.f & DP_HIDDEN_BIT ) )
+        {
+            value.f <<= 1;
+            value.e--;
+        }
+        value.f <<= ( DIY_SIGNIFICAND_SIZE - DP_SIGNIFICAND_SIZE - 1 );
+        value.e -= ( DIY_SIGNIFICAND_SIZE - DP_SIGNIFICAND_SIZE - 1 );
+
+        return value;
+    }
+
+
+    DiyFp normalizeBoundary( DiyFp value )
+    {
+        while( !( value.f & ( DP_HIDDEN_BIT << 1 ) ) )
+        {
+            value.f <<= 1;
+            value.e--;
+        }
+        value.f <<= ( DIY_SIGNIFICAND_SIZE - DP_SIGNIFICAND_SIZE - 2 );
+        value.e -= ( DIY_SIGNIFICAND_SIZE - DP_SIGNIFICAND_SIZE - 2 );
+
+        return value;
+    }
+
+
+    /**
+     * Gets the boundaries of the interval of real numbers that round to the given value, normalized to a common exponent.
+     */
+    void normalizedBoundaries( const DiyFp &value, DiyFp &minus, DiyFp &plus )
+    {
+        plus = normalizeBoundary( DiyFp( ( value.f << 1 ) + 1, value.e - 1 ) );
+        if( value.f == DP_HIDDEN_BIT )
+        {
+            //The gap below a power of two is half the size of the gap above it.
+            minus = DiyFp( ( value.f << 2 ) - 1, value.e - 2 );
+        }
+        else
+        {
+            minus = DiyFp( ( value.f << 1 ) - 1, value.e - 1 );
+        }
+        minus.f <<= minus.e - plus.e;
+        minus.e = plus.e;
+    }
+
+
+    DiyFp getCachedPower( int e, int &k )
+    {
+        //Finds the cached power c such that the product's exponent lands in [-60, -32].
+        const double dk = ( -61 - e ) * 0.30102999566398114 + 347;
+        int ik = (int)dk;
+        if( dk - ik > 0.0 )
+        {
+            ik++;
+        }
+
+        const unsigned index = (unsigned)( ( ik >> 3 ) + 1 );
+        k = -( -348 + (int)( index << 3 ) );
+
+        return DiyFp( CACHED_POWERS_F[index], CACHED_POWERS_E[index] );
+    }
+
+
+    int countDecimalDigits( uint32_t n )
+    {
+        int count = 1;
+        while( ( count < 10 ) && ( n >= POW10[count] ) )
+        {
+            count++;
+        }
+
+        return count;
+    }
+
+
+    void grisuRound( char *buffer, int length, uint64_t delta, uint64_t rest, uint64_t tenKappa, uint64_t wpW )
+    {
+        while( ( rest < wpW ) && ( delta - rest >= tenKappa ) &&
+            ( ( rest + tenKappa < wpW ) || ( wpW - rest > rest + tenKappa - wpW ) ) )
+        {
+            buffer[length - 1]--;
+            rest += tenKappa;
+        }
+    }
+
+
+    void digitGen( const DiyFp &w, const DiyFp &mp, uint64_t delta, char *buffer, int &length, int &k )
+    {
+        const DiyFp one( 1ULL << -mp.e, mp.e );
+        const DiyFp wpW = mp - w;
+        uint32_t p1 = (uint32_t)( mp.f >> -one.e );
+        uint64_t p2 = mp.f & ( one.f - 1 );
+        int kappa = countDecimalDigits( p1 );
+        length = 0;
+
+        while( kappa > 0 )
+        {
+            const uint32_t d = p1 / POW10[kappa - 1];
+            p1 %= POW10[kappa - 1];
+            if( d || length )
+            {
+                buffer[length++] = (char)( '0' + d );
+            }
+            kappa--;
+
+            const uint64_t tmp = ( (uint64_t)p1 << -one.e ) + p2;
+            if( tmp <= delta )
+            {
+                k += kappa;
+                grisuRound( buffer, length, delta, tmp, (uint64_t)POW10[kappa] << -one.e, wpW.f );
+                return;
+            }
+        }
+
+        while( true )
+        {
+            p2 *= 10;
+            delta *= 10;
+            const char d = (char)( p2 >> -one.e );
+            if( d || length )
+            {
+                buffer[length++] = (char)( '0' + d );
+            }
+            p2 &= one.f - 1;
+            kappa--;
+            if( p2 < delta )
+            {
+                k += kappa;
+                const int index = -kappa;
+                grisuRound( buffer, length, delta, p2, one.f, wpW.f * ( index < 10 ? POW10[index] : 0 ) );
+                return;
+            }
+        }
+    }
+
+
+    /**
+     * Generates the digits of a positive, finite, non-zero value. The value is digits * 10^k.
+     */
+    void grisu2( double value, char *buffer, int &length, int &k )
+    {
+        const DiyFp v = fromDouble( value );
+        DiyFp minus( 0, 0 );
+        DiyFp plus( 0, 0 );
+        normalizedBoundaries( v, minus, plus );
+
+        const DiyFp cachedPower = getCachedPower( plus.e, k );
+        const DiyFp w = normalize( v ) * cachedPower;
+        DiyFp wPlus = plus * cachedPower;
+        DiyFp wMinus = minus * cachedPower;
+        wMinus.f++;
+        wPlus.f--;
+
+        digitGen( w, wPlus, wPlus.f - wMinus.f, buffer, length, k );
+    }
+
+
+    int writeExponent( int exponent, char *buffer )
+    {
+        char *start = buffer;
+
+        *buffer++ = 'e';
+        if( exponent < 0 )
+        {
+            *buffer++ = '-';
+            exponent = -exponent;
+        }
+        else
+        {
+            *buffer++ = '+';
+        }
+
+        //Always at least two digits, as printf does.
+        if( exponent >= 100 )
+        {
+            *buffer++ = (char)( '0' + ( exponent / 100 ) );
+            exponent %= 100;
+        }
+        *buffer++ = DIGIT_PAIRS[exponent * 2];
+        *buffer++ = DIGIT_PAIRS[exponent * 2 + 1];
+
+        return (int)( buffer - start );
+    }
+
+
+    /**
+     * Lays the digits out the way printf's %g would, i.e. in fixed notation unless the decimal exponent is below -4 or
+     * at least 17, in which case exponential notation is used.
+     */
+    int prettify( char *buffer, int length, int k )
+    {
+        //The decimal exponent of the first digit.
+        const int exponent = length + k - 1;
+
+        if( ( exponent >= -4 ) && ( exponent < 17 ) )
+        {
+            if( k >= 0 )
+            {
+                //1234e3 -> 1234000
+                for( int i = 0; i < k; i++ )
+                {
+                    buffer[length + i] = '0';
+                }
+                return length + k;
+            }
+            else if( exponent >= 0 )
+            {
+                //1234e-2 -> 12.34
+                const int point = exponent + 1;
+                memmove( buffer + point + 1, buffer + point, length - point );
+                buffer[point] = '.';
+                return length + 1;
+            }
+            else
+            {
+                //1234e-6 -> 0.001234
+                const int offset = 1 - exponent;
+                memmove( buffer + offset, buffer, length );
+                buffer[0] = '0';
+                buffer[1] = '.';
+                for( int i = 2; i < offset; i++ )
+                {
+                    buffer[i] = '0';
+                }
+                return length + offset;
+            }
+        }
+
+        if( length == 1 )
+        {
+            //1e30
+            return 1 + writeExponent( exponent, buffer + 1 );
+        }
+
+        //1234e30 -> 1.234e+33
+        memmove( buffer + 2, buffer + 1, length - 1 );
+        buffer[1] = '.';
+        return length + 1 + writeExponent( exponent, buffer + length + 1 );
+    }
+}
+
+
+int NumberFormat::formatDouble( double value, char *buffer )
+{
+    uint64_t bits;
+    memcpy( &bits, &value, sizeof( bits ) );
+
+    if( ( bits & DP_EXPONENT_MASK ) == DP_EXPONENT_MASK )
+    {
+        //Infinities and NaNs have no digits. Do whatever printf does.
+        return sprintf( buffer, "%g", value );
+    }
+
+    char *start = buffer;
+    if( bits >> 63 )
+    {
+        *buffer++ = '-';
+        value = -value;
+    }
+
+    if( value == 0.0 )
+    {
+        *buffer++ = '0';
+        return (int)( buffer - start );
+    }
+
+    int length;
+    int k;
+    grisu2( value, buffer, length, k );
+
+    return (int)( buffer - start ) + prettify( buffer, length, k );
+}
+
+
+int NumberFormat::formatInt( int value, char *buffer )
+{
+    char *start = buffer;
+
+    uint32_t magnitude = (uint32_t)value;
+    if( value < 0 )
+    {
+        *buffer++ = '-';
+        magnitude = 0 - magnitude;
+    }
+
+    //Digits are generated two at a time, backwards, then copied into place.
+    char digits[10];
+    int count = 0;
+    while( magnitude >= 100 )
+    {
+        const uint32_t pair = ( magnitude % 100 ) * 2;
+        magnitude /= 100;
+        digits[count++] = DIGIT_PAIRS[pair + 1];
+        digits[count++] = DIGIT_PAIRS[pair];
+    }
+    if( magnitude >= 10 )
+    {
+        digits[count++] = DIGIT_PAIRS[magnitude * 2 + 1];
+        digits[count++] = DIGIT_PAIRS[magnitude * 2];
+    }
+    else
+    {
+        digits[count++] = (char)( '0' + magnitude );
+    }
+
+    while( count > 0 )
+    {
+        *buffer++ = digits[--count];
+    }
+
+    return (int)( buffer - start );
+}
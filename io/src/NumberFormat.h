@@ -0,0 +1,67 @@
+/* \file
+ * $Id$
+ * \author Caton Little
+ * \brief 
+ *
+ * \section LICENSE
+ *
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is FieldML
+ *
+ * The Initial Developer of the Original Code is Auckland Uniservices Ltd,
+ * Auckland, New Zealand. Portions created by the Initial Developer are
+ * Copyright (C) 2010 the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either the GNU General Public License Version 2 or later (the "GPL"), or
+ * the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ */
+
+#ifndef H_NUMBER_FORMAT
+#define H_NUMBER_FORMAT
+
+#include "FieldmlIoApi.h"
+
+/**
+ * Allocation-free number formatting for the text writers. Neither function null-terminates its output.
+ */
+namespace NumberFormat
+{
+    //Enough room for any formatted double or int.
+    const int MAX_LENGTH = 32;
+
+    /**
+     * Writes the shortest (in all but a tiny fraction of cases) digit string that reads back as exactly the same
+     * double, and returns the number of characters written.
+     */
+    int formatDouble( double value, char *buffer );
+
+    /**
+     * Writes the given value in decimal, and returns the number of characters written.
+     */
+    int formatInt( int value, char *buffer );
+}
+
+#endif //H_NUMBER_FORMAT
@@ -42,24 +42,72 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring> 
-#include <sstream>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <system_error>
+
+#ifndef _WIN32
+#include <sys/uio.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+#ifdef FIELDML_ZLIB_STREAMS
+#include <zlib.h>
+#endif //FIELDML_ZLIB_STREAMS
 
 #include "FieldmlIoApi.h"
+#include "NumberFormat.h"
 #include "OutputStream.h"
 
 //Using a #define because the relevant buffer is allocated on stack.
 #define NBUFFER_SIZE 64
 
+//File output is formatted into a buffer of this size, and written out whenever it fills up.
+static const int OUTPUT_BUFFER_SIZE = 256 * 1024;
+
+//Large runs of values are formatted in parallel, in chunks of this many values.
+static const int PARALLEL_CHUNK_VALUES = 16384;
+
+//Runs shorter than this aren't worth handing to other threads.
+static const int PARALLEL_MIN_VALUES = 4 * PARALLEL_CHUNK_VALUES;
+
+static const int PARALLEL_MAX_THREADS = 16;
+
+//The number of threads that new text file streams format values on, or zero to use one per processor.
+static std::atomic<int> fileThreadCount( 0 );
+
+//String output is handed to its close task in chunks of at least this size.
+static const size_t STRING_FLUSH_SIZE = 1024 * 1024;
+
 using namespace std;
 
 class FileOutputStream :
     public FieldmlOutputStream
 {
 private:
+    char *buffer;
+    
+    int bufferUsed;
+    
+protected:
     FILE *file;
     
     bool closed;
     
+    char *getBuffer( int &used );
+    
+    virtual FmlIoErrorNumber flush();
+    
+    /**
+     * Makes sure there's room for the given number of characters, returning the position to write them to.
+     */
+    char *reserve( int length );
+    
 public:
     FileOutputStream( FILE *_file );
 
@@ -71,11 +119,132 @@ public:
 
     FmlIoErrorNumber writeNewline();
     
+    FmlIoErrorNumber writeInts( const int *values, int count );
+
+    FmlIoErrorNumber writeDoubles( const double *values, int count );
+
+    FmlIoErrorNumber writeBooleans( const FmlBoolean *values, int count );
+    
     FmlIoErrorNumber close();
 
     virtual ~FileOutputStream();
 };
 
+
+/**
+ * Formats the values from start to end into the given buffer, returning the number of characters used.
+ */
+typedef int (*ChunkFormatter)( const void *values, int start, int end, char *buffer );
+
+
+/**
+ * A run of chunks being formatted, and the buffers they're formatted into.
+ */
+class FormatBatch
+{
+public:
+    std::vector<char*> buffers;
+    
+    std::vector<int> lengths;
+    
+    ChunkFormatter formatter;
+    
+    const void *values;
+    
+    int count;
+    
+    int chunkCount;
+    
+    //The next chunk to be handed out, and the number that have been formatted.
+    int nextChunk;
+    
+    int chunksDone;
+    
+    //Batches are handed out oldest first.
+    long sequence;
+};
+
+
+/**
+ * A file stream that formats large runs of values on several threads at once. The stream keeps a pool of helper
+ * threads for its lifetime, and two batches of chunk buffers, so that the helpers format one batch while the writing
+ * thread writes the other out, in order, with a single gathering write.
+ */
+class ParallelFileOutputStream :
+    public FileOutputStream
+{
+private:
+    //Drops to one if no helper threads can be started.
+    int threadCount;
+    
+    FormatBatch batches[2];
+    
+    long nextSequence;
+    
+    std::vector<std::thread> helpers;
+    
+    std::mutex lock;
+    
+    std::condition_variable workAvailable;
+    
+    std::condition_variable batchDone;
+    
+    bool stopping;
+    
+    template <class ValueFormatter> FmlIoErrorNumber writeParallel( const typename ValueFormatter::ValueType *values, int count );
+    
+    bool startHelpers();
+    
+    void startBatch( FormatBatch &batch, ChunkFormatter formatter, const void *values, int count );
+    
+    /**
+     * Formats chunks of the oldest batch that has any left, until the given batch has been formatted. The lock must
+     * be held.
+     */
+    void finishBatch( FormatBatch &batch, std::unique_lock<std::mutex> &guard );
+    
+    FormatBatch *takeBatch();
+    
+    void formatNextChunk( FormatBatch &batch, std::unique_lock<std::mutex> &guard );
+    
+    void work();
+    
+    FmlIoErrorNumber writeChunks( FormatBatch &batch );
+    
+public:
+    ParallelFileOutputStream( FILE *_file, int _threadCount );
+
+    FmlIoErrorNumber writeInts( const int *values, int count );
+
+    FmlIoErrorNumber writeDoubles( const double *values, int count );
+    
+    virtual ~ParallelFileOutputStream();
+};
+
+
+#ifdef FIELDML_ZLIB_STREAMS
+/**
+ * A file stream that gzip-compresses its output. Values are formatted into the same buffer as plain file output, and
+ * each full buffer is compressed on its way out.
+ */
+class GzipFileOutputStream :
+    public FileOutputStream
+{
+private:
+    gzFile gzipFile;
+    
+protected:
+    FmlIoErrorNumber flush();
+    
+public:
+    GzipFileOutputStream( gzFile _gzipFile );
+    
+    FmlIoErrorNumber close();
+    
+    virtual ~GzipFileOutputStream();
+};
+#endif //FIELDML_ZLIB_STREAMS
+
         
 class StringOutputStream :
     public FieldmlOutputStream
@@ -83,10 +252,12 @@ class StringOutputStream :
 private:
     bool closed;
     
-    stringstream buffer;
+    std::string buffer;
     
     StreamCloseTask * closeTask;
     
+    FmlIoErrorNumber flushIfFull();
+    
 public:
     StringOutputStream( StreamCloseTask *_closeTask = NULL );
 
@@ -98,6 +269,12 @@ public:
     
     FmlIoErrorNumber writeNewline();
     
+    FmlIoErrorNumber writeInts( const int *values, int count );
+
+    FmlIoErrorNumber writeDoubles( const double *values, int count );
+
+    FmlIoErrorNumber writeBooleans( const FmlBoolean *values, int count );
+    
     FmlIoErrorNumber close();
     
     virtual ~StringOutputStream();
@@ -113,11 +290,58 @@ FieldmlOutputStream::~FieldmlOutputStream()
 {
 }
 
+
+FmlIoErrorNumber FieldmlOutputStream::writeInts( const int *values, int count )
+{
+    for( int i = 0; i < count; i++ )
+    {
+        FmlIoErrorNumber err = writeInt( values[i] );
+        if( err != FML_IOERR_NO_ERROR )
+        {
+            return err;
+        }
+    }
+    
+    return FML_IOERR_NO_ERROR;
+}
+
+
+FmlIoErrorNumber FieldmlOutputStream::writeDoubles( const double *values, int count )
+{
+    for( int i = 0; i < count; i++ )
+    {
+        FmlIoErrorNumber err = writeDouble( values[i] );
+        if( err != FML_IOERR_NO_ERROR )
+        {
+            return err;
+        }
+    }
+    
+    return FML_IOERR_NO_ERROR;
+}
+
+
+FmlIoErrorNumber FieldmlOutputStream::writeBooleans( const FmlBoolean *values, int count )
+{
+    for( int i = 0; i < count; i++ )
+    {
+        FmlIoErrorNumber err = writeBoolean( values[i] != 0 );
+        if( err != FML_IOERR_NO_ERROR )
+        {
+            return err;
+        }
+    }
+    
+    return FML_IOERR_NO_ERROR;
+}
+
     
 FileOutputStream::FileOutputStream( FILE *_file ) :
+    bufferUsed( 0 ),
     file( _file ),
     closed( false )
 {
+    buffer = new char[OUTPUT_BUFFER_SIZE];
 }
 
 
@@ -139,26 +363,75 @@ FieldmlOutputStream *FieldmlOutputStream::createTextFileStream( const string fil
         return NULL;
     }
     
+    int threadCount = fileThreadCount;
+    if( threadCount == 0 )
+    {
+        threadCount = (int)std::thread::hardware_concurrency();
+    }
+    if( threadCount > PARALLEL_MAX_THREADS )
+    {
+        threadCount = PARALLEL_MAX_THREADS;
+    }
+    if( threadCount > 1 )
+    {
+        return new ParallelFileOutputStream( file, threadCount );
+    }
+    
     return new FileOutputStream( file );
 }
 
 
+void FieldmlOutputStream::setFileThreadCount( int threadCount )
+{
+    fileThreadCount = threadCount;
+}
+
+
+FieldmlOutputStream *FieldmlOutputStream::createGzipFileStream( const string filename, bool append )
+{
+#ifdef FIELDML_ZLIB_STREAMS
+    //Appending adds another gzip member to the file, which readers decompress as though it were all one.
+    gzFile file = gzopen( filename.c_str(), append ? "ab" : "wb" );
+    if( file == NULL )
+    {
+        return NULL;
+    }
+    gzbuffer( file, OUTPUT_BUFFER_SIZE );
+    
+    return new GzipFileOutputStream( file );
+#else
+    return NULL;
+#endif //FIELDML_ZLIB_STREAMS
+}
+
+
 FieldmlOutputStream *FieldmlOutputStream::createStringStream( StreamCloseTask *closeTask )
 {
     return new StringOutputStream( closeTask );
 }
 
 
-FmlIoErrorNumber FileOutputStream::writeBoolean( bool value )
+char *FileOutputStream::getBuffer( int &used )
 {
-    if( closed )
+    used = bufferUsed;
+    bufferUsed = 0;
+    
+    return buffer;
+}
+
+
+FmlIoErrorNumber FileOutputStream::flush()
+{
+    if( bufferUsed == 0 )
     {
-        return FML_IOERR_RESOURCE_CLOSED;
+        return FML_IOERR_NO_ERROR;
     }
     
-    int err = fprintf( file, "%d ", value ? 1 : 0 );
-
-    if( err < 0 )
+    const size_t length = bufferUsed;
+    size_t written = fwrite( buffer, 1, length, file );
+    bufferUsed = 0;
+    
+    if( written != length )
     {
         return FML_IOERR_WRITE_ERROR;
     }
@@ -167,54 +440,126 @@ FmlIoErrorNumber FileOutputStream::writeBoolean( bool value )
 }
 
 
+char *FileOutputStream::reserve( int length )
+{
+    if( bufferUsed + length > OUTPUT_BUFFER_SIZE )
+    {
+        if( flush() != FML_IOERR_NO_ERROR )
+        {
+            return NULL;
+        }
+    }
+    
+    return buffer + bufferUsed;
+}
+
+
+FmlIoErrorNumber FileOutputStream::writeBoolean( bool value )
+{
+    FmlBoolean booleanValue = value ? 1 : 0;
+    
+    return writeBooleans( &booleanValue, 1 );
+}
+
+
 FmlIoErrorNumber FileOutputStream::writeDouble( double value )
+{
+    return writeDoubles( &value, 1 );
+}
+
+
+FmlIoErrorNumber FileOutputStream::writeInt( int value )
+{
+    return writeInts( &value, 1 );
+}
+
+
+FmlIoErrorNumber FileOutputStream::writeNewline()
 {
     if( closed )
     {
         return FML_IOERR_RESOURCE_CLOSED;
     }
 
-    int err = fprintf( file, "%.17g ", value );
-
-    if( err < 0 )
+    char *output = reserve( 1 );
+    if( output == NULL )
     {
         return FML_IOERR_WRITE_ERROR;
     }
     
+    *output = '\n';
+    bufferUsed++;
+    
     return FML_IOERR_NO_ERROR;
 }
 
 
-FmlIoErrorNumber FileOutputStream::writeInt( int value )
+FmlIoErrorNumber FileOutputStream::writeInts( const int *values, int count )
 {
     if( closed )
     {
         return FML_IOERR_RESOURCE_CLOSED;
     }
 
-    int err = fprintf( file, "%d ", value );
-    
-    if( err < 0 )
+    for( int i = 0; i < count; i++ )
     {
-        return FML_IOERR_WRITE_ERROR;
+        char *output = reserve( NumberFormat::MAX_LENGTH + 1 );
+        if( output == NULL )
+        {
+            return FML_IOERR_WRITE_ERROR;
+        }
+        
+        int length = NumberFormat::formatInt( values[i], output );
+        output[length++] = ' ';
+        bufferUsed += length;
     }
     
     return FML_IOERR_NO_ERROR;
 }
 
 
-FmlIoErrorNumber FileOutputStream::writeNewline()
+FmlIoErrorNumber FileOutputStream::writeDoubles( const double *values, int count )
 {
     if( closed )
     {
         return FML_IOERR_RESOURCE_CLOSED;
     }
 
-    int err = fprintf( file, "\n" );
+    for( int i = 0; i < count; i++ )
+    {
+        char *output = reserve( NumberFormat::MAX_LENGTH + 1 );
+        if( output == NULL )
+        {
+            return FML_IOERR_WRITE_ERROR;
+        }
+        
+        int length = NumberFormat::formatDouble( values[i], output );
+        output[length++] = ' ';
+        bufferUsed += length;
+    }
     
-    if( err < 0 )
+    return FML_IOERR_NO_ERROR;
+}
+
+
+FmlIoErrorNumber FileOutputStream::writeBooleans( const FmlBoolean *values, int count )
+{
+    if( closed )
     {
-        return FML_IOERR_WRITE_ERROR;
+        return FML_IOERR_RESOURCE_CLOSED;
+    }
+
+    for( int i = 0; i < count; i++ )
+    {
+        char *output = reserve( 2 );
+        if( output == NULL )
+        {
+            return FML_IOERR_WRITE_ERROR;
+        }
+        
+        output[0] = values[i] ? '1' : '0';
+        output[1] = ' ';
+        bufferUsed += 2;
     }
     
     return FML_IOERR_NO_ERROR;
@@ -234,6 +579,8 @@ FmlIoErrorNumber FileOutputStream::close()
         return FML_IOERR_NO_ERROR;
     }
     
+    FmlIoErrorNumber flushErr = flush();
+    
     int err = fclose( file );
     file = NULL;
     
@@ -242,7 +589,7 @@ FmlIoErrorNumber FileOutputStream::close()
         return FML_IOERR_CLOSE_FAILED;
     }
     
-    return FML_IOERR_NO_ERROR;
+    return flushErr;
 }
 
 
@@ -252,7 +599,442 @@ FileOutputStream::~FileOutputStream()
     {
         close();
     }
+    
+    delete[] buffer;
+}
+
+
+class IntFormatter
+{
+public:
+    typedef int ValueType;
+    
+    static int format( int value, char *buffer )
+    {
+        return NumberFormat::formatInt( value, buffer );
+    }
+};
+
+
+class DoubleFormatter
+{
+public:
+    typedef double ValueType;
+    
+    static int format( double value, char *buffer )
+    {
+        return NumberFormat::formatDouble( value, buffer );
+    }
+};
+
+
+/**
+ * Formats a chunk's values, each followed by a space.
+ */
+template <class ValueFormatter> static int formatValues( const void *values, int start, int end, char *buffer )
+{
+    const typename ValueFormatter::ValueType *typedValues = (const typename ValueFormatter::ValueType *)values;
+    
+    char *output = buffer;
+    for( int i = start; i < end; i++ )
+    {
+        output += ValueFormatter::format( typedValues[i], output );
+        *output++ = ' ';
+    }
+    
+    return (int)( output - buffer );
+}
+
+
+ParallelFileOutputStream::ParallelFileOutputStream( FILE *_file, int _threadCount ) :
+    FileOutputStream( _file ),
+    threadCount( _threadCount ),
+    nextSequence( 0 ),
+    stopping( false )
+{
+    //A batch with no chunks is idle.
+    for( int b = 0; b < 2; b++ )
+    {
+        batches[b].formatter = NULL;
+        batches[b].values = NULL;
+        batches[b].count = 0;
+        batches[b].chunkCount = 0;
+        batches[b].nextChunk = 0;
+        batches[b].chunksDone = 0;
+        batches[b].sequence = 0;
+    }
+}
+
+
+bool ParallelFileOutputStream::startHelpers()
+{
+    if( !helpers.empty() )
+    {
+        return true;
+    }
+    
+    //Started on the first large write, so that streams that never see one don't pay for them. The writing thread
+    //formats too, so one fewer helper is needed.
+    for( int t = 1; t < threadCount; t++ )
+    {
+        try
+        {
+            helpers.push_back( std::thread( &ParallelFileOutputStream::work, this ) );
+        }
+        catch( const std::system_error & )
+        {
+            //Make do with however many started.
+            break;
+        }
+    }
+    
+    if( helpers.empty() )
+    {
+        //Out of threads, so the rest of the stream's output is formatted serially.
+        threadCount = 1;
+        return false;
+    }
+    
+    return true;
+}
+
+
+void ParallelFileOutputStream::startBatch( FormatBatch &batch, ChunkFormatter formatter, const void *values, int count )
+{
+    batch.formatter = formatter;
+    batch.values = values;
+    batch.count = count;
+    batch.chunkCount = ( count + PARALLEL_CHUNK_VALUES - 1 ) / PARALLEL_CHUNK_VALUES;
+    batch.nextChunk = 0;
+    batch.chunksDone = 0;
+    batch.sequence = nextSequence++;
+}
+
+
+FormatBatch *ParallelFileOutputStream::takeBatch()
+{
+    FormatBatch *oldest = NULL;
+    for( int b = 0; b < 2; b++ )
+    {
+        if( ( batches[b].nextChunk < batches[b].chunkCount ) && ( ( oldest == NULL ) || ( batches[b].sequence < oldest->sequence ) ) )
+        {
+            oldest = &batches[b];
+        }
+    }
+    
+    return oldest;
+}
+
+
+void ParallelFileOutputStream::formatNextChunk( FormatBatch &batch, std::unique_lock<std::mutex> &guard )
+{
+    const int chunk = batch.nextChunk++;
+    const int start = chunk * PARALLEL_CHUNK_VALUES;
+    int end = start + PARALLEL_CHUNK_VALUES;
+    if( end > batch.count )
+    {
+        end = batch.count;
+    }
+    ChunkFormatter formatter = batch.formatter;
+    const void *values = batch.values;
+    char *buffer = batch.buffers[chunk];
+    
+    guard.unlock();
+    int length = formatter( values, start, end, buffer );
+    guard.lock();
+    
+    batch.lengths[chunk] = length;
+    batch.chunksDone++;
+    if( batch.chunksDone == batch.chunkCount )
+    {
+        batchDone.notify_all();
+    }
+}
+
+
+void ParallelFileOutputStream::work()
+{
+    std::unique_lock<std::mutex> guard( lock );
+    
+    while( true )
+    {
+        FormatBatch *batch = takeBatch();
+        if( batch == NULL )
+        {
+            if( stopping )
+            {
+                return;
+            }
+            workAvailable.wait( guard );
+            continue;
+        }
+        
+        formatNextChunk( *batch, guard );
+    }
+}
+
+
+void ParallelFileOutputStream::finishBatch( FormatBatch &batch, std::unique_lock<std::mutex> &guard )
+{
+    while( batch.chunksDone < batch.chunkCount )
+    {
+        //The writing thread helps with the batch it's waiting for, but leaves the next one to the helpers.
+        if( batch.nextChunk < batch.chunkCount )
+        {
+            formatNextChunk( batch, guard );
+        }
+        else
+        {
+            batchDone.wait( guard );
+        }
+    }
+}
+
+
+FmlIoErrorNumber ParallelFileOutputStream::writeChunks( FormatBatch &batch )
+{
+    const int chunkCount = batch.chunkCount;
+    
+    //Anything already buffered has to go out first.
+    FmlIoErrorNumber err = flush();
+    if( err != FML_IOERR_NO_ERROR )
+    {
+        return err;
+    }
+    
+#ifdef _WIN32
+    for( int i = 0; i < chunkCount; i++ )
+    {
+        if( fwrite( batch.buffers[i], 1, batch.lengths[i], file ) != (size_t)batch.lengths[i] )
+        {
+            return FML_IOERR_WRITE_ERROR;
+        }
+    }
+#else
+    if( fflush( file ) != 0 )
+    {
+        return FML_IOERR_WRITE_ERROR;
+    }
+    
+    std::vector<struct iovec> vectors( chunkCount );
+    for( int i = 0; i < chunkCount; i++ )
+    {
+        vectors[i].iov_base = batch.buffers[i];
+        vectors[i].iov_len = batch.lengths[i];
+    }
+    
+    const int fd = fileno( file );
+    int first = 0;
+    while( first < chunkCount )
+    {
+        ssize_t written = writev( fd, &vectors[first], chunkCount - first );
+        if( written < 0 )
+        {
+            if( errno == EINTR )
+            {
+                continue;
+            }
+            return FML_IOERR_WRITE_ERROR;
+        }
+        
+        //Skip past whatever was written, which needn't end on a chunk boundary.
+        while( ( first < chunkCount ) && ( (size_t)written >= vectors[first].iov_len ) )
+        {
+            written -= vectors[first].iov_len;
+            first++;
+        }
+        if( first < chunkCount )
+        {
+            vectors[first].iov_base = (char*)vectors[first].iov_base + written;
+            vectors[first].iov_len -= written;
+        }
+    }
+#endif
+    
+    return FML_IOERR_NO_ERROR;
+}
+
+
+template <class ValueFormatter> FmlIoErrorNumber ParallelFileOutputStream::writeParallel( const typename ValueFormatter::ValueType *values, int count )
+{
+    //Bound the memory used by only formatting a chunk per thread in each batch.
+    const int batchValues = threadCount * PARALLEL_CHUNK_VALUES;
+    for( int b = 0; b < 2; b++ )
+    {
+        while( (int)batches[b].buffers.size() < threadCount )
+        {
+            batches[b].buffers.push_back( new char[PARALLEL_CHUNK_VALUES * ( NumberFormat::MAX_LENGTH + 1 )] );
+        }
+        batches[b].lengths.resize( threadCount );
+    }
+    
+    const ChunkFormatter formatter = formatValues<ValueFormatter>;
+    FmlIoErrorNumber err = FML_IOERR_NO_ERROR;
+    int nextStart = 0;
+    
+    std::unique_lock<std::mutex> guard( lock );
+    
+    for( int b = 0; ( b < 2 ) && ( nextStart < count ); b++ )
+    {
+        int batchCount = count - nextStart;
+        if( batchCount > batchValues )
+        {
+            batchCount = batchValues;
+        }
+        startBatch( batches[b], formatter, values + nextStart, batchCount );
+        nextStart += batchCount;
+    }
+    workAvailable.notify_all();
+    
+    //Batches are written out in order, each while the helpers format the one after it.
+    for( int current = 0; batches[current].chunkCount > 0; current = 1 - current )
+    {
+        FormatBatch &batch = batches[current];
+        if( err != FML_IOERR_NO_ERROR )
+        {
+            //Nothing more will be written, but chunks already handed out still have to be waited for.
+            batch.chunkCount = batch.nextChunk;
+        }
+        finishBatch( batch, guard );
+        
+        if( err == FML_IOERR_NO_ERROR )
+        {
+            guard.unlock();
+            err = writeChunks( batch );
+            guard.lock();
+        }
+        
+        batch.chunkCount = 0;
+        if( ( err == FML_IOERR_NO_ERROR ) && ( nextStart < count ) )
+        {
+            int batchCount = count - nextStart;
+            if( batchCount > batchValues )
+            {
+                batchCount = batchValues;
+            }
+            startBatch( batch, formatter, values + nextStart, batchCount );
+            nextStart += batchCount;
+            workAvailable.notify_all();
+        }
+    }
+    
+    return err;
+}
+
+
+FmlIoErrorNumber ParallelFileOutputStream::writeInts( const int *values, int count )
+{
+    if( closed )
+    {
+        return FML_IOERR_RESOURCE_CLOSED;
+    }
+    
+    if( ( threadCount < 2 ) || ( count < PARALLEL_MIN_VALUES ) || !startHelpers() )
+    {
+        return FileOutputStream::writeInts( values, count );
+    }
+    
+    return writeParallel<IntFormatter>( values, count );
+}
+
+
+FmlIoErrorNumber ParallelFileOutputStream::writeDoubles( const double *values, int count )
+{
+    if( closed )
+    {
+        return FML_IOERR_RESOURCE_CLOSED;
+    }
+    
+    if( ( threadCount < 2 ) || ( count < PARALLEL_MIN_VALUES ) || !startHelpers() )
+    {
+        return FileOutputStream::writeDoubles( values, count );
+    }
+    
+    return writeParallel<DoubleFormatter>( values, count );
+}
+
+
+ParallelFileOutputStream::~ParallelFileOutputStream()
+{
+    {
+        std::lock_guard<std::mutex> guard( lock );
+        stopping = true;
+    }
+    workAvailable.notify_all();
+    
+    for( size_t t = 0; t < helpers.size(); t++ )
+    {
+        helpers[t].join();
+    }
+    
+    for( int b = 0; b < 2; b++ )
+    {
+        for( size_t i = 0; i < batches[b].buffers.size(); i++ )
+        {
+            delete[] batches[b].buffers[i];
+        }
+    }
+}
+
+
+#ifdef FIELDML_ZLIB_STREAMS
+GzipFileOutputStream::GzipFileOutputStream( gzFile _gzipFile ) :
+    FileOutputStream( NULL ),
+    gzipFile( _gzipFile )
+{
+}
+
+
+FmlIoErrorNumber GzipFileOutputStream::flush()
+{
+    int length;
+    char *data = getBuffer( length );
+    if( length == 0 )
+    {
+        return FML_IOERR_NO_ERROR;
+    }
+    
+    if( gzwrite( gzipFile, data, length ) != length )
+    {
+        return FML_IOERR_WRITE_ERROR;
+    }
+    
+    return FML_IOERR_NO_ERROR;
+}
+
+
+FmlIoErrorNumber GzipFileOutputStream::close()
+{
+    if( closed )
+    {
+        return FML_IOERR_NO_ERROR;
+    }
+    
+    closed = true;
+    
+    FmlIoErrorNumber flushErr = flush();
+    
+    int err = gzclose( gzipFile );
+    gzipFile = NULL;
+    
+    if( err != Z_OK )
+    {
+        return FML_IOERR_CLOSE_FAILED;
+    }
+    
+    return flushErr;
+}
+
+
+GzipFileOutputStream::~GzipFileOutputStream()
+{
+    //The base class can't do this, as it would only flush to its own (non-existent) file.
+    if( !closed )
+    {
+        close();
+    }
 }
+#endif //FIELDML_ZLIB_STREAMS
 
 
 StringOutputStream::StringOutputStream( StreamCloseTask *_closeTask ) :
@@ -262,54 +1044,140 @@ StringOutputStream::StringOutputStream( StreamCloseTask *_closeTask ) :
 }
 
 
+FmlIoErrorNumber StringOutputStream::flushIfFull()
+{
+    if( buffer.size() < STRING_FLUSH_SIZE )
+    {
+        return FML_IOERR_NO_ERROR;
+    }
+    
+    //Hand the text over in chunks, so that large writes never hold a second full copy of the resource's data.
+    FmlIoErrorNumber err = FML_IOERR_NO_ERROR;
+    if( closeTask != NULL )
+    {
+        err = closeTask->onStreamFlush( buffer );
+    }
+    buffer.clear();
+    
+    return err;
+}
+
+
 FmlIoErrorNumber StringOutputStream::writeDouble( double value )
+{
+    return writeDoubles( &value, 1 );
+}
+
+
+FmlIoErrorNumber StringOutputStream::writeBoolean( bool value )
 {
     if( closed )
     {
         return FML_IOERR_RESOURCE_CLOSED;
     }
-    char tmpValueString[50];
-    sprintf(tmpValueString, "%.17g ", value);
-    buffer << tmpValueString;
+
+    buffer.append( value ? "1 " : "0 ", 2 );
     
-    return FML_IOERR_NO_ERROR;
+    return flushIfFull();
 }
 
 
-FmlIoErrorNumber StringOutputStream::writeBoolean( bool value )
+FmlIoErrorNumber StringOutputStream::writeInt( int value )
+{
+    return writeInts( &value, 1 );
+}
+
+
+FmlIoErrorNumber StringOutputStream::writeNewline()
+{
+    if( closed )
+    {
+        return FML_IOERR_RESOURCE_CLOSED;
+    }
+
+    buffer.push_back( '\n' );
+    
+    return flushIfFull();
+}
+
+
+FmlIoErrorNumber StringOutputStream::writeInts( const int *values, int count )
 {
     if( closed )
     {
         return FML_IOERR_RESOURCE_CLOSED;
     }
 
-    buffer << (value?1:0) << " ";
+    char tmpValueString[NumberFormat::MAX_LENGTH + 1];
+    for( int i = 0; i < count; i++ )
+    {
+        int length = NumberFormat::formatInt( values[i], tmpValueString );
+        tmpValueString[length++] = ' ';
+        buffer.append( tmpValueString, length );
+        
+        //Flushed as the text grows, so a large slab never holds all of its text at once.
+        if( buffer.size() >= STRING_FLUSH_SIZE )
+        {
+            FmlIoErrorNumber err = flushIfFull();
+            if( err != FML_IOERR_NO_ERROR )
+            {
+                return err;
+            }
+        }
+    }
     
     return FML_IOERR_NO_ERROR;
 }
 
 
-FmlIoErrorNumber StringOutputStream::writeInt( int value )
+FmlIoErrorNumber StringOutputStream::writeDoubles( const double *values, int count )
 {
     if( closed )
     {
         return FML_IOERR_RESOURCE_CLOSED;
     }
 
-    buffer << value << " ";
+    char tmpValueString[NumberFormat::MAX_LENGTH + 1];
+    for( int i = 0; i < count; i++ )
+    {
+        int length = NumberFormat::formatDouble( values[i], tmpValueString );
+        tmpValueString[length++] = ' ';
+        buffer.append( tmpValueString, length );
+        
+        if( buffer.size() >= STRING_FLUSH_SIZE )
+        {
+            FmlIoErrorNumber err = flushIfFull();
+            if( err != FML_IOERR_NO_ERROR )
+            {
+                return err;
+            }
+        }
+    }
     
     return FML_IOERR_NO_ERROR;
 }
 
 
-FmlIoErrorNumber StringOutputStream::writeNewline()
+FmlIoErrorNumber StringOutputStream::writeBooleans( const FmlBoolean *values, int count )
 {
     if( closed )
     {
         return FML_IOERR_RESOURCE_CLOSED;
     }
 
-    buffer << "\n";
+    for( int i = 0; i < count; i++ )
+    {
+        buffer.append( values[i] ? "1 " : "0 ", 2 );
+        
+        if( buffer.size() >= STRING_FLUSH_SIZE )
+        {
+            FmlIoErrorNumber err = flushIfFull();
+            if( err != FML_IOERR_NO_ERROR )
+            {
+                return err;
+            }
+        }
+    }
     
     return FML_IOERR_NO_ERROR;
 }
@@ -330,7 +1198,9 @@ FmlIoErrorNumber StringOutputStream::close()
     }
     else
     {
-        return closeTask->onStreamClose( buffer.str() );
+        FmlIoErrorNumber err = closeTask->onStreamClose( buffer );
+        buffer.clear();
+        return err;
     }
 }
 
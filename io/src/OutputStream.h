@@ -47,6 +47,14 @@
 class StreamCloseTask
 {
 public:
+    /**
+     * Called with each chunk of output that a string stream flushes before being closed, in order.
+     */
+    virtual FmlIoErrorNumber onStreamFlush( const std::string &info ) = 0;
+    
+    /**
+     * Called with whatever output remains when a string stream is closed.
+     */
     virtual FmlIoErrorNumber onStreamClose( const std::string &info ) = 0;
     
     virtual ~StreamCloseTask() {}
@@ -67,12 +75,34 @@ public:
     
     virtual FmlIoErrorNumber writeNewline() = 0;
     
+    /**
+     * Bulk versions of the single-value writes, so that writers pay for one virtual call per run of values rather
+     * than one per value. The default implementations just loop over the single-value writes.
+     */
+    virtual FmlIoErrorNumber writeInts( const int *values, int count );
+
+    virtual FmlIoErrorNumber writeDoubles( const double *values, int count );
+    
+    virtual FmlIoErrorNumber writeBooleans( const FmlBoolean *values, int count );
+    
     virtual FmlIoErrorNumber close() = 0;
     
     virtual ~FieldmlOutputStream();
     
     static FieldmlOutputStream *createTextFileStream( const std::string filename, bool append );
 
+    /**
+     * Sets the number of threads that text file streams created from now on format large runs of values on. Zero uses
+     * one per processor, and one formats everything on the calling thread.
+     */
+    static void setFileThreadCount( int threadCount );
+
+    /**
+     * Returns a stream that gzip-compresses its output into the given file, or NULL if the library was built without
+     * zlib.
+     */
+    static FieldmlOutputStream *createGzipFileStream( const std::string filename, bool append );
+
     static FieldmlOutputStream *createStringStream( StreamCloseTask *closeTask = NULL );
 };
 
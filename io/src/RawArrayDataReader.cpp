@@ -0,0 +1,628 @@
+/* \file
+ * $Id$
+ * \author Caton Little
+ * \brief 
+ *
+ * \section LICENSE
+ *
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is FieldML
+ *
+ * The Initial Developer of the Original Code is Auckland Uniservices Ltd,
+ * Auckland, New Zealand. Portions created by the Initial Developer are
+ * Copyright (C) 2010 the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either the GNU General Public License Version 2 or later (the "GPL"), or
+ * the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ */
+
+#include <cstdio>
+#include <cstring>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "StringUtil.h"
+#include "FieldmlIoApi.h"
+#include "FieldmlIoSession.h"
+
+#include "RawArrayDataReader.h"
+
+using namespace std;
+
+RawArrayDataReader *RawArrayDataReader::create( FieldmlIoContext *context, const string root, FmlObjectHandle source, void *buffer,
+    int64_t bufferLength )
+{
+    FmlObjectHandle resource = Fieldml_GetDataSourceResource( context->getSession(), source );
+    FieldmlDataResourceType type = Fieldml_GetDataResourceType( context->getSession(), resource );
+    
+    int rank = Fieldml_GetArrayDataSourceRank( context->getSession(), source );
+    if( rank <= 0 )
+    {
+        context->setError( FML_IOERR_CORE_ERROR );
+        return NULL;
+    }
+    
+    RawArrayDataReader *reader = new RawArrayDataReader( context, source, rank );
+    
+    if( buffer != NULL )
+    {
+        //The caller's buffer holds the file's contents, and must outlive the reader. If its length isn't known, the
+        //caller has to be trusted to supply as much data as the header describes.
+        reader->data = (const unsigned char *)buffer;
+        reader->dataLength = ( bufferLength >= 0 ) ? bufferLength : INT64_MAX;
+    }
+    else if( type == FML_DATA_RESOURCE_HREF )
+    {
+        string href;
+        char *temp_href = Fieldml_GetDataResourceHref( context->getSession(), resource );
+        if( !StringUtil::safeString( temp_href, href ) )
+        {
+            context->setError( FML_IOERR_CORE_ERROR );
+            delete reader;
+            return NULL;
+        }
+        Fieldml_FreeString(temp_href);
+        
+        void *userData;
+        Fieldml_StreamRequestCallbackFunction function = FieldmlIoSession::getSession().getStreamRequestCallback( context->getSession(), userData );
+        if( function != NULL )
+        {
+            //Reads can be for any part of the array, so the whole stream is needed up front.
+            FieldmlInputStream *stream = FieldmlInputStream::createCallbackStream( href, function, userData );
+            bool loaded = reader->loadStream( stream );
+            delete stream;
+            if( !loaded )
+            {
+                context->setError( FML_IOERR_READ_ERROR );
+                delete reader;
+                return NULL;
+            }
+        }
+        else if( !reader->mapFile( StringUtil::makeFilename( root, href ) ) )
+        {
+            context->setError( FML_IOERR_READ_ERROR );
+            delete reader;
+            return NULL;
+        }
+    }
+    else
+    {
+        //Binary data can't be held in a FieldML document as is.
+        context->setError( FML_IOERR_UNSUPPORTED );
+        delete reader;
+        return NULL;
+    }
+    
+    if( !reader->parseHeader() || ( (int)reader->dims.size() != rank ) )
+    {
+        context->setError( FML_IOERR_READ_ERROR );
+        delete reader;
+        return NULL;
+    }
+    
+    return reader;
+}
+
+
+RawArrayDataReader::RawArrayDataReader( FieldmlIoContext *_context, FmlObjectHandle _source, int rank ) :
+    ArrayDataReader( _context ),
+    closed( false ),
+    source( _source ),
+    sourceRank( rank ),
+    data( NULL ),
+    dataLength( 0 ),
+    mapped( false ),
+    valueType( BinaryData::VALUE_UNKNOWN ),
+    valueSize( 0 ),
+    littleEndian( true ),
+    values( NULL )
+{
+    sourceSizes = new int[sourceRank];
+    sourceRawSizes = new int[sourceRank];
+    sourceOffsets = new int[sourceRank];
+    
+    Fieldml_GetArrayDataSourceSizes( context->getSession(), source, sourceSizes );
+    Fieldml_GetArrayDataSourceRawSizes( context->getSession(), source, sourceRawSizes );
+    Fieldml_GetArrayDataSourceOffsets( context->getSession(), source, sourceOffsets );
+}
+
+
+bool RawArrayDataReader::mapFile( const string filename )
+{
+#ifdef _WIN32
+    FILE *file = fopen( filename.c_str(), "rb" );
+    if( file == NULL )
+    {
+        return false;
+    }
+    
+    unsigned char chunk[65536];
+    size_t count;
+    while( ( count = fread( chunk, 1, sizeof( chunk ), file ) ) > 0 )
+    {
+        fileContents.insert( fileContents.end(), chunk, chunk + count );
+    }
+    fclose( file );
+    
+    data = fileContents.empty() ? NULL : &fileContents[0];
+    dataLength = fileContents.size();
+#else
+    int fd = open( filename.c_str(), O_RDONLY );
+    if( fd < 0 )
+    {
+        return false;
+    }
+    
+    struct stat fileStat;
+    if( ( fstat( fd, &fileStat ) != 0 ) || ( fileStat.st_size < BinaryData::RAW_HEADER_FIXED_SIZE ) )
+    {
+        ::close( fd );
+        return false;
+    }
+    
+    void *mapping = mmap( NULL, fileStat.st_size, PROT_READ, MAP_SHARED, fd, 0 );
+    
+    //The mapping stays valid without the descriptor.
+    ::close( fd );
+    if( mapping == MAP_FAILED )
+    {
+        return false;
+    }
+    
+    data = (const unsigned char *)mapping;
+    dataLength = fileStat.st_size;
+    mapped = true;
+#endif
+    
+    return data != NULL;
+}
+
+
+bool RawArrayDataReader::loadStream( FieldmlInputStream *stream )
+{
+    if( stream == NULL )
+    {
+        return false;
+    }
+    
+    char chunk[65536];
+    long count;
+    while( ( count = stream->readBytes( chunk, sizeof( chunk ) ) ) > 0 )
+    {
+        fileContents.insert( fileContents.end(), chunk, chunk + count );
+    }
+    
+    data = fileContents.empty() ? NULL : &fileContents[0];
+    dataLength = fileContents.size();
+    
+    return data != NULL;
+}
+
+
+bool RawArrayDataReader::parseHeader()
+{
+    int64_t dataStart;
+    if( !BinaryData::readRawHeader( data, dataLength, valueType, littleEndian, dims, dataStart ) )
+    {
+        return false;
+    }
+    
+    valueSize = BinaryData::typeSize( valueType );
+    values = data + dataStart;
+    
+    strides.assign( dims.size(), 1 );
+    for( int i = (int)dims.size() - 2; i >= 0; i-- )
+    {
+        strides[i] = strides[i + 1] * dims[i + 1];
+    }
+    
+    return true;
+}
+
+
+bool RawArrayDataReader::checkDimensions( const int *offsets, const int *sizes )
+{
+    for( int i = 0; i < sourceRank; i++ )
+    {
+        if( offsets[i] < 0 )
+        {
+            return false;
+        }
+        if( sizes[i] <= 0 )
+        {
+            return false;
+        }
+        
+        int rawSize = sourceSizes[i];
+        if( rawSize == 0 )
+        {
+            //NOTE: Intentional. If the array-source size has not been set, use the underlying size.
+            rawSize = sourceRawSizes[i] - sourceOffsets[i];
+        }
+        if( offsets[i] + sizes[i] > rawSize )
+        {
+            return false;
+        }
+        
+        //The data source may describe more data than the file actually has.
+        if( (int64_t)sourceOffsets[i] + offsets[i] + sizes[i] > dims[i] )
+        {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+
+bool RawArrayDataReader::isNative( BinaryData::ValueType type )
+{
+    return ( valueType == type ) && ( littleEndian == BinaryData::isLittleEndian() );
+}
+
+
+const void *RawArrayDataReader::getSlabPointer( const int *offsets, const int *sizes, BinaryData::ValueType type )
+{
+    if( closed )
+    {
+        context->setError( FML_IOERR_RESOURCE_CLOSED );
+        return NULL;
+    }
+    
+    if( !checkDimensions( offsets, sizes ) )
+    {
+        context->setError( FML_IOERR_INVALID_PARAMETER );
+        return NULL;
+    }
+    
+    if( !isNative( type ) )
+    {
+        context->setError( FML_IOERR_UNSUPPORTED );
+        return NULL;
+    }
+    
+    //The slab is contiguous if every dimension inside the outermost one that spans more than one index is complete.
+    int outer = 0;
+    while( ( outer < sourceRank - 1 ) && ( sizes[outer] == 1 ) )
+    {
+        outer++;
+    }
+    for( int i = outer + 1; i < sourceRank; i++ )
+    {
+        if( ( sourceOffsets[i] + offsets[i] != 0 ) || ( sizes[i] != dims[i] ) )
+        {
+            context->setError( FML_IOERR_UNSUPPORTED );
+            return NULL;
+        }
+    }
+    
+    int64_t start = 0;
+    for( int i = 0; i < sourceRank; i++ )
+    {
+        start += ( sourceOffsets[i] + offsets[i] ) * strides[i];
+    }
+    
+    return values + ( start * valueSize );
+}
+
+
+//Raw booleans are stored as integers, so anything that isn't zero is true.
+static void normaliseBooleans( FmlBoolean *valueBuffer, long count )
+{
+    for( long i = 0; i < count; i++ )
+    {
+        valueBuffer[i] = ( valueBuffer[i] != 0 ) ? 1 : 0;
+    }
+}
+
+
+template <class T> FmlIoErrorNumber RawArrayDataReader::readSlab( const int *offsets, const int *sizes, const int *steps, BinaryData::ValueType nativeType, T *valueBuffer )
+{
+    if( closed )
+    {
+        return FML_IOERR_RESOURCE_CLOSED;
+    }
+    
+    //The part of the array that the slab spans, which is bigger than the slab itself if it's strided.
+    vector<int> extents( sizes, sizes + sourceRank );
+    if( steps != NULL )
+    {
+        for( int i = 0; i < sourceRank; i++ )
+        {
+            extents[i] = ( ( sizes[i] - 1 ) * steps[i] ) + 1;
+        }
+    }
+    
+    if( !checkDimensions( offsets, &extents[0] ) )
+    {
+        return context->setError( FML_IOERR_INVALID_PARAMETER );
+    }
+    
+    //Runs are only contiguous if the slab isn't strided along the innermost dimension. Otherwise, each value is a run
+    //of its own.
+    const bool native = isNative( nativeType );
+    const int innermost = sourceRank - 1;
+    const bool contiguousRuns = ( steps == NULL ) || ( steps[innermost] == 1 );
+    const int runLength = contiguousRuns ? sizes[innermost] : 1;
+    const int lastDimension = contiguousRuns ? innermost - 1 : innermost;
+    
+    int *index = new int[sourceRank];
+    for( int i = 0; i < sourceRank; i++ )
+    {
+        index[i] = 0;
+    }
+    
+    while( true )
+    {
+        int64_t runStart = 0;
+        for( int i = 0; i < sourceRank; i++ )
+        {
+            const int64_t step = ( steps == NULL ) ? 1 : steps[i];
+            runStart += ( sourceOffsets[i] + offsets[i] + ( index[i] * step ) ) * strides[i];
+        }
+        
+        const unsigned char *run = values + ( runStart * valueSize );
+        if( native )
+        {
+            memcpy( valueBuffer, run, runLength * sizeof( T ) );
+        }
+        else
+        {
+            for( int i = 0; i < runLength; i++ )
+            {
+                valueBuffer[i] = BinaryData::decodeValue<T>( run + ( i * valueSize ), valueType, littleEndian );
+            }
+        }
+        valueBuffer += runLength;
+        
+        int depth = lastDimension;
+        while( depth >= 0 )
+        {
+            index[depth]++;
+            if( index[depth] < sizes[depth] )
+            {
+                break;
+            }
+            index[depth] = 0;
+            depth--;
+        }
+        if( depth < 0 )
+        {
+            break;
+        }
+    }
+    
+    delete[] index;
+    
+    return FML_IOERR_NO_ERROR;
+}
+
+
+template <class T> FmlIoErrorNumber RawArrayDataReader::readPointValues( int pointCount, const int *points, BinaryData::ValueType nativeType, T *valueBuffer )
+{
+    if( closed )
+    {
+        return FML_IOERR_RESOURCE_CLOSED;
+    }
+    
+    const bool native = isNative( nativeType );
+    vector<int> unitSizes( sourceRank, 1 );
+    for( int p = 0; p < pointCount; p++ )
+    {
+        const int *point = points + ( p * sourceRank );
+        if( !checkDimensions( point, &unitSizes[0] ) )
+        {
+            return context->setError( FML_IOERR_INVALID_PARAMETER );
+        }
+        
+        int64_t start = 0;
+        for( int i = 0; i < sourceRank; i++ )
+        {
+            start += ( sourceOffsets[i] + point[i] ) * strides[i];
+        }
+        
+        const unsigned char *value = values + ( start * valueSize );
+        if( native )
+        {
+            memcpy( valueBuffer + p, value, sizeof( T ) );
+        }
+        else
+        {
+            valueBuffer[p] = BinaryData::decodeValue<T>( value, valueType, littleEndian );
+        }
+    }
+    
+    return FML_IOERR_NO_ERROR;
+}
+
+
+FmlIoErrorNumber RawArrayDataReader::readIntSlab( const int *offsets, const int *sizes, int *valueBuffer )
+{
+    return readSlab( offsets, sizes, NULL, BinaryData::VALUE_INT32, valueBuffer );
+}
+
+
+FmlIoErrorNumber RawArrayDataReader::readDoubleSlab( const int *offsets, const int *sizes, double *valueBuffer )
+{
+    return readSlab( offsets, sizes, NULL, BinaryData::VALUE_FLOAT64, valueBuffer );
+}
+
+
+FmlIoErrorNumber RawArrayDataReader::readBooleanSlab( const int *offsets, const int *sizes, FmlBoolean *valueBuffer )
+{
+    FmlIoErrorNumber err = readSlab( offsets, sizes, NULL, BinaryData::VALUE_INT32, valueBuffer );
+    if( err != FML_IOERR_NO_ERROR )
+    {
+        return err;
+    }
+    
+    long count = 1;
+    for( int i = 0; i < sourceRank; i++ )
+    {
+        count *= sizes[i];
+    }
+    normaliseBooleans( valueBuffer, count );
+    
+    return FML_IOERR_NO_ERROR;
+}
+
+
+FmlIoErrorNumber RawArrayDataReader::readStridedSlab( ArrayDataValueType valueType, const int *offsets, const int *sizes, const int *steps, void *valueBuffer )
+{
+    if( valueType == ARRAY_VALUE_INT )
+    {
+        return readSlab( offsets, sizes, steps, BinaryData::VALUE_INT32, (int*)valueBuffer );
+    }
+    else if( valueType == ARRAY_VALUE_DOUBLE )
+    {
+        return readSlab( offsets, sizes, steps, BinaryData::VALUE_FLOAT64, (double*)valueBuffer );
+    }
+    
+    FmlIoErrorNumber err = readSlab( offsets, sizes, steps, BinaryData::VALUE_INT32, (FmlBoolean*)valueBuffer );
+    if( err != FML_IOERR_NO_ERROR )
+    {
+        return err;
+    }
+    
+    long count = 1;
+    for( int i = 0; i < sourceRank; i++ )
+    {
+        count *= sizes[i];
+    }
+    normaliseBooleans( (FmlBoolean*)valueBuffer, count );
+    
+    return FML_IOERR_NO_ERROR;
+}
+
+
+FmlIoErrorNumber RawArrayDataReader::readPoints( ArrayDataValueType valueType, int pointCount, const int *points, void *valueBuffer )
+{
+    if( valueType == ARRAY_VALUE_INT )
+    {
+        return readPointValues( pointCount, points, BinaryData::VALUE_INT32, (int*)valueBuffer );
+    }
+    else if( valueType == ARRAY_VALUE_DOUBLE )
+    {
+        return readPointValues( pointCount, points, BinaryData::VALUE_FLOAT64, (double*)valueBuffer );
+    }
+    
+    FmlIoErrorNumber err = readPointValues( pointCount, points, BinaryData::VALUE_INT32, (FmlBoolean*)valueBuffer );
+    if( err != FML_IOERR_NO_ERROR )
+    {
+        return err;
+    }
+    normaliseBooleans( (FmlBoolean*)valueBuffer, pointCount );
+    
+    return FML_IOERR_NO_ERROR;
+}
+
+
+const int *RawArrayDataReader::getIntSlabPointer( const int *offsets, const int *sizes )
+{
+    return (const int *)getSlabPointer( offsets, sizes, BinaryData::VALUE_INT32 );
+}
+
+
+const double *RawArrayDataReader::getDoubleSlabPointer( const int *offsets, const int *sizes )
+{
+    return (const double *)getSlabPointer( offsets, sizes, BinaryData::VALUE_FLOAT64 );
+}
+
+
+bool RawArrayDataReader::isConcurrent()
+{
+    //The mapped data is only ever read.
+    return true;
+}
+
+
+FmlIoErrorNumber RawArrayDataReader::setAccessPattern( FieldmlAccessPattern pattern )
+{
+    if( closed )
+    {
+        return context->setError( FML_IOERR_RESOURCE_CLOSED );
+    }
+    
+#ifndef _WIN32
+    //Only mapped files are paged in on demand. Anything else is already in memory.
+    if( mapped )
+    {
+        int advice = MADV_NORMAL;
+        if( pattern == FML_ACCESS_PATTERN_SEQUENTIAL )
+        {
+            advice = MADV_SEQUENTIAL;
+        }
+        else if( pattern == FML_ACCESS_PATTERN_RANDOM )
+        {
+            advice = MADV_RANDOM;
+        }
+        
+        //Just a hint, so failure doesn't matter.
+        madvise( (void*)data, dataLength, advice );
+    }
+#endif
+    
+    return FML_IOERR_NO_ERROR;
+}
+
+
+FmlIoErrorNumber RawArrayDataReader::close()
+{
+    if( closed )
+    {
+        return FML_IOERR_NO_ERROR;
+    }
+    
+    closed = true;
+    
+#ifndef _WIN32
+    if( mapped )
+    {
+        munmap( (void*)data, dataLength );
+        mapped = false;
+    }
+#endif
+    data = NULL;
+    values = NULL;
+    fileContents.clear();
+    
+    return FML_IOERR_NO_ERROR;
+}
+
+
+RawArrayDataReader::~RawArrayDataReader()
+{
+    close();
+    
+    delete[] sourceSizes;
+    delete[] sourceRawSizes;
+    delete[] sourceOffsets;
+}
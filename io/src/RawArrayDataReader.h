@@ -0,0 +1,145 @@
+/* \file
+ * $Id$
+ * \author Caton Little
+ * \brief 
+ *
+ * \section LICENSE
+ *
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is FieldML
+ *
+ * The Initial Developer of the Original Code is Auckland Uniservices Ltd,
+ * Auckland, New Zealand. Portions created by the Initial Developer are
+ * Copyright (C) 2010 the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either the GNU General Public License Version 2 or later (the "GPL"), or
+ * the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ */
+
+#ifndef H_RAW_ARRAY_DATA_READER
+#define H_RAW_ARRAY_DATA_READER
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "FieldmlIoContext.h"
+#include "ArrayDataReader.h"
+#include "BinaryData.h"
+#include "InputStream.h"
+
+/**
+ * Reads arrays from raw binary files, which hold a single array after a small header describing it. The file is
+ * memory-mapped where the platform allows it, so slabs are copied straight out of the mapping, and contiguous slabs
+ * of the stored type can be handed out in place.
+ */
+class RawArrayDataReader :
+    public ArrayDataReader
+{
+private:
+    bool closed;
+    
+    const FmlObjectHandle source;
+
+    int sourceRank;
+    
+    int *sourceSizes;
+    
+    int *sourceRawSizes;
+    
+    int *sourceOffsets;
+    
+    //The start of the file's contents, and its length. Either a mapping of the file, or the caller's buffer.
+    const unsigned char *data;
+    
+    int64_t dataLength;
+    
+    bool mapped;
+    
+    //Only used where the data can't be mapped, i.e. where files can't be mapped or the data comes from a callback.
+    std::vector<unsigned char> fileContents;
+    
+    BinaryData::ValueType valueType;
+    
+    int valueSize;
+    
+    bool littleEndian;
+    
+    std::vector<int64_t> dims;
+    
+    //The number of values spanned by a unit step in each dimension.
+    std::vector<int64_t> strides;
+    
+    const unsigned char *values;
+    
+    RawArrayDataReader( FieldmlIoContext *_context, FmlObjectHandle _source, int _sourceRank );
+    
+    bool mapFile( const std::string filename );
+    
+    bool loadStream( FieldmlInputStream *stream );
+    
+    bool parseHeader();
+    
+    bool checkDimensions( const int *offsets, const int *sizes );
+    
+    bool isNative( BinaryData::ValueType type );
+    
+    const void *getSlabPointer( const int *offsets, const int *sizes, BinaryData::ValueType type );
+    
+    //Reads every steps[i]'th value along each dimension, or a contiguous slab if steps is NULL.
+    template <class T> FmlIoErrorNumber readSlab( const int *offsets, const int *sizes, const int *steps, BinaryData::ValueType nativeType, T *valueBuffer );
+    
+    template <class T> FmlIoErrorNumber readPointValues( int pointCount, const int *points, BinaryData::ValueType nativeType, T *valueBuffer );
+
+public:
+    virtual FmlIoErrorNumber readIntSlab( const int *offsets, const int *sizes, int *valueBuffer );
+    
+    virtual FmlIoErrorNumber readDoubleSlab( const int *offsets, const int *sizes, double *valueBuffer );
+    
+    virtual FmlIoErrorNumber readBooleanSlab( const int *offsets, const int *sizes, FmlBoolean *valueBuffer );
+    
+    virtual FmlIoErrorNumber readStridedSlab( ArrayDataValueType valueType, const int *offsets, const int *sizes, const int *steps, void *valueBuffer );
+    
+    virtual FmlIoErrorNumber readPoints( ArrayDataValueType valueType, int pointCount, const int *points, void *valueBuffer );
+    
+    virtual const int *getIntSlabPointer( const int *offsets, const int *sizes );
+    
+    virtual const double *getDoubleSlabPointer( const int *offsets, const int *sizes );
+
+    virtual FmlIoErrorNumber close();
+    
+    virtual bool isConcurrent();
+    
+    virtual FmlIoErrorNumber setAccessPattern( FieldmlAccessPattern pattern );
+    
+    virtual ~RawArrayDataReader();
+    
+    static RawArrayDataReader *create( FieldmlIoContext *_context, const std::string root, FmlObjectHandle source, void *buffer,
+        int64_t bufferLength );
+};
+
+
+#endif //H_RAW_ARRAY_DATA_READER
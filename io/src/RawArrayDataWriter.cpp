@@ -0,0 +1,327 @@
+/* \file
+ * $Id$
+ * \author Caton Little
+ * \brief 
+ *
+ * \section LICENSE
+ *
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is FieldML
+ *
+ * The Initial Developer of the Original Code is Auckland Uniservices Ltd,
+ * Auckland, New Zealand. Portions created by the Initial Developer are
+ * Copyright (C) 2010 the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either the GNU General Public License Version 2 or later (the "GPL"), or
+ * the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ */
+
+#include "StringUtil.h"
+#include "FieldmlIoApi.h"
+
+#include "RawArrayDataWriter.h"
+
+using namespace std;
+
+RawArrayDataWriter *RawArrayDataWriter::create( FieldmlIoContext *context, const string root, FmlObjectHandle source, FieldmlHandleType handleType, bool append, int *sizes, int rank )
+{
+    FmlObjectHandle resource = Fieldml_GetDataSourceResource( context->getSession(), source );
+    if( Fieldml_GetDataResourceType( context->getSession(), resource ) != FML_DATA_RESOURCE_HREF )
+    {
+        context->setError( FML_IOERR_UNSUPPORTED );
+        return NULL;
+    }
+    
+    if( ( sizes == NULL ) || ( rank <= 0 ) )
+    {
+        context->setError( FML_IOERR_INVALID_PARAMETER );
+        return NULL;
+    }
+    
+    vector<int64_t> dims;
+    for( int i = 0; i < rank; i++ )
+    {
+        if( sizes[i] <= 0 )
+        {
+            context->setError( FML_IOERR_INVALID_PARAMETER );
+            return NULL;
+        }
+        dims.push_back( sizes[i] );
+    }
+    
+    string typeName;
+    char *temp_string = Fieldml_GetDataResourceDataType( context->getSession(), resource );
+    if( !StringUtil::safeString( temp_string, typeName ) )
+    {
+        context->setError( FML_IOERR_CORE_ERROR );
+        return NULL;
+    }
+    Fieldml_FreeString(temp_string);
+    
+    //The file records its own value type, so the resource's dtype is only needed to override the default.
+    BinaryData::ValueType valueType;
+    if( !typeName.empty() )
+    {
+        valueType = BinaryData::parseType( typeName );
+    }
+    else if( handleType == FHT_CONTINUOUS_TYPE )
+    {
+        valueType = BinaryData::VALUE_FLOAT64;
+    }
+    else if( handleType == FHT_BOOLEAN_TYPE )
+    {
+        valueType = BinaryData::VALUE_INT8;
+    }
+    else
+    {
+        valueType = BinaryData::VALUE_INT32;
+    }
+    if( valueType == BinaryData::VALUE_UNKNOWN )
+    {
+        context->setError( FML_IOERR_UNSUPPORTED );
+        return NULL;
+    }
+    
+    string href;
+    temp_string = Fieldml_GetDataResourceHref( context->getSession(), resource );
+    if( !StringUtil::safeString( temp_string, href ) )
+    {
+        context->setError( FML_IOERR_CORE_ERROR );
+        return NULL;
+    }
+    Fieldml_FreeString(temp_string);
+    const string filename = StringUtil::makeFilename( root, href );
+    
+    vector<unsigned char> header;
+    BinaryData::writeRawHeader( valueType, dims, header );
+    
+    FILE *file = NULL;
+    if( append )
+    {
+        file = fopen( filename.c_str(), "r+b" );
+        if( file == NULL )
+        {
+            context->setError( FML_IOERR_WRITE_ERROR );
+            return NULL;
+        }
+        
+        //Only an identical header describes the same array.
+        vector<unsigned char> existing( header.size() );
+        if( ( fread( &existing[0], 1, existing.size(), file ) != existing.size() ) || ( existing != header ) )
+        {
+            fclose( file );
+            context->setError( FML_IOERR_UNSUPPORTED );
+            return NULL;
+        }
+    }
+    else
+    {
+        file = fopen( filename.c_str(), "w+b" );
+        if( file == NULL )
+        {
+            context->setError( FML_IOERR_WRITE_ERROR );
+            return NULL;
+        }
+        
+        if( fwrite( &header[0], 1, header.size(), file ) != header.size() )
+        {
+            fclose( file );
+            context->setError( FML_IOERR_WRITE_ERROR );
+            return NULL;
+        }
+    }
+    
+    RawArrayDataWriter *writer = new RawArrayDataWriter( context, file, valueType, dims, header.size() );
+    
+    if( !append )
+    {
+        //Lay out the whole array, so that slabs can be written in any order. Unwritten values read as zero.
+        int64_t count = 1;
+        for( int i = 0; i < rank; i++ )
+        {
+            count *= dims[i];
+        }
+        const int64_t end = writer->dataStart + ( count * BinaryData::typeSize( valueType ) );
+        const unsigned char zero = 0;
+        if( ( count > 0 ) && ( !writer->seek( end - 1 ) || ( fwrite( &zero, 1, 1, file ) != 1 ) ) )
+        {
+            context->setError( FML_IOERR_WRITE_ERROR );
+            delete writer;
+            return NULL;
+        }
+    }
+    
+    return writer;
+}
+
+
+RawArrayDataWriter::RawArrayDataWriter( FieldmlIoContext *_context, FILE *_file, BinaryData::ValueType _valueType, const vector<int64_t> &_dims, int64_t _dataStart ) :
+    ArrayDataWriter( _context ),
+    closed( false ),
+    file( _file ),
+    valueType( _valueType ),
+    dims( _dims ),
+    dataStart( _dataStart )
+{
+    strides.assign( dims.size(), 1 );
+    for( int i = (int)dims.size() - 2; i >= 0; i-- )
+    {
+        strides[i] = strides[i + 1] * dims[i + 1];
+    }
+}
+
+
+bool RawArrayDataWriter::seek( int64_t position )
+{
+#ifdef _WIN32
+    return _fseeki64( file, position, SEEK_SET ) == 0;
+#else
+    return fseeko( file, (off_t)position, SEEK_SET ) == 0;
+#endif
+}
+
+
+template <class T> FmlIoErrorNumber RawArrayDataWriter::writeSlab( const int *offsets, const int *sizes, BinaryData::ValueType nativeType, const T *valueBuffer )
+{
+    if( closed )
+    {
+        return FML_IOERR_RESOURCE_CLOSED;
+    }
+    
+    const int rank = (int)dims.size();
+    for( int i = 0; i < rank; i++ )
+    {
+        if( ( offsets[i] < 0 ) || ( sizes[i] <= 0 ) || ( offsets[i] + sizes[i] > dims[i] ) )
+        {
+            return context->setError( FML_IOERR_INVALID_PARAMETER );
+        }
+    }
+    
+    const int valueSize = BinaryData::typeSize( valueType );
+    const bool native = ( valueType == nativeType );
+    const int innermost = rank - 1;
+    const int runLength = sizes[innermost];
+    if( !native )
+    {
+        runBuffer.resize( runLength * valueSize );
+    }
+    
+    int *index = new int[rank];
+    for( int i = 0; i < rank; i++ )
+    {
+        index[i] = 0;
+    }
+    
+    FmlIoErrorNumber err = FML_IOERR_NO_ERROR;
+    while( true )
+    {
+        int64_t runStart = 0;
+        for( int i = 0; i < rank; i++ )
+        {
+            runStart += ( offsets[i] + index[i] ) * strides[i];
+        }
+        
+        const void *run = valueBuffer;
+        if( !native )
+        {
+            for( int i = 0; i < runLength; i++ )
+            {
+                BinaryData::encodeValue( valueBuffer[i], valueType, &runBuffer[i * valueSize] );
+            }
+            run = &runBuffer[0];
+        }
+        
+        if( !seek( dataStart + ( runStart * valueSize ) ) || ( fwrite( run, valueSize, runLength, file ) != (size_t)runLength ) )
+        {
+            err = context->setError( FML_IOERR_WRITE_ERROR );
+            break;
+        }
+        valueBuffer += runLength;
+        
+        int depth = innermost - 1;
+        while( depth >= 0 )
+        {
+            index[depth]++;
+            if( index[depth] < sizes[depth] )
+            {
+                break;
+            }
+            index[depth] = 0;
+            depth--;
+        }
+        if( depth < 0 )
+        {
+            break;
+        }
+    }
+    
+    delete[] index;
+    
+    return err;
+}
+
+
+FmlIoErrorNumber RawArrayDataWriter::writeIntSlab( const int *offsets, const int *sizes, const int *valueBuffer )
+{
+    return writeSlab( offsets, sizes, BinaryData::VALUE_INT32, valueBuffer );
+}
+
+
+FmlIoErrorNumber RawArrayDataWriter::writeDoubleSlab( const int *offsets, const int *sizes, const double *valueBuffer )
+{
+    return writeSlab( offsets, sizes, BinaryData::VALUE_FLOAT64, valueBuffer );
+}
+
+
+FmlIoErrorNumber RawArrayDataWriter::writeBooleanSlab( const int *offsets, const int *sizes, const FmlBoolean *valueBuffer )
+{
+    return writeSlab( offsets, sizes, BinaryData::VALUE_INT32, valueBuffer );
+}
+
+
+FmlIoErrorNumber RawArrayDataWriter::close()
+{
+    if( closed )
+    {
+        return FML_IOERR_NO_ERROR;
+    }
+    
+    closed = true;
+    
+    int err = fclose( file );
+    file = NULL;
+    
+    return ( err == 0 ) ? FML_IOERR_NO_ERROR : FML_IOERR_CLOSE_FAILED;
+}
+
+
+RawArrayDataWriter::~RawArrayDataWriter()
+{
+    if( file != NULL )
+    {
+        fclose( file );
+    }
+}
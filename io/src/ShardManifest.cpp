@@ -0,0 +1,378 @@
+/* \file
+ * $Id$
+ * \author Caton Little
+ * \brief 
+ *
+ * \section LICENSE
+ *
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is FieldML
+ *
+ * The Initial Developer of the Original Code is Auckland Uniservices Ltd,
+ * Auckland, New Zealand. Portions created by the Initial Developer are
+ * Copyright (C) 2010 the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either the GNU General Public License Version 2 or later (the "GPL"), or
+ * the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ */
+
+#include <algorithm>
+#include <sstream>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+
+#include "StringUtil.h"
+#include "FieldmlIoApi.h"
+#include "FieldmlIoSession.h"
+
+#include "ShardManifest.h"
+#include "InputStream.h"
+
+using namespace std;
+
+bool ShardManifest::Shard::operator<( const Shard &other ) const
+{
+    return firstRow < other.firstRow;
+}
+
+
+ShardManifest *ShardManifest::create( FieldmlIoContext *context, const string root, FmlObjectHandle source, void *buffer,
+    int64_t bufferLength )
+{
+    FmlSessionHandle session = context->getSession();
+    FmlObjectHandle resource = Fieldml_GetDataSourceResource( session, source );
+    FieldmlDataResourceType type = Fieldml_GetDataResourceType( session, resource );
+
+    int rank = Fieldml_GetArrayDataSourceRank( session, source );
+    if( rank <= 0 )
+    {
+        context->setError( FML_IOERR_CORE_ERROR );
+        return NULL;
+    }
+
+    string location;
+    char *temp_string = Fieldml_GetArrayDataSourceLocation( session, source );
+    if( !StringUtil::safeString( temp_string, location ) )
+    {
+        context->setError( FML_IOERR_CORE_ERROR );
+        return NULL;
+    }
+    Fieldml_FreeString( temp_string );
+
+    string shardRoot = root;
+    FieldmlInputStream *stream = NULL;
+    if( buffer != NULL )
+    {
+        const char *data = (const char *)buffer;
+        stream = FieldmlInputStream::createStringStream( data, ( bufferLength >= 0 ) ? bufferLength : strlen( data ) );
+    }
+    else if( type == FML_DATA_RESOURCE_HREF )
+    {
+        string href;
+        char *temp_href = Fieldml_GetDataResourceHref( session, resource );
+        if( !StringUtil::safeString( temp_href, href ) )
+        {
+            context->setError( FML_IOERR_CORE_ERROR );
+            return NULL;
+        }
+        Fieldml_FreeString( temp_href );
+
+        //Shard hrefs are relative to the manifest, wherever it is.
+        const string directory = StringUtil::getDirectory( href );
+        if( directory.length() > 0 )
+        {
+            shardRoot = StringUtil::makeFilename( root, directory );
+        }
+
+        void *userData;
+        Fieldml_StreamRequestCallbackFunction function = FieldmlIoSession::getSession().getStreamRequestCallback( session, userData );
+        if( function != NULL )
+        {
+            stream = FieldmlInputStream::createCallbackStream( href, function, userData );
+        }
+        else
+        {
+            stream = FieldmlInputStream::createTextFileStream( StringUtil::makeFilename( root, href ) );
+        }
+    }
+    else if( type == FML_DATA_RESOURCE_INLINE )
+    {
+        stream = FieldmlInputStream::createInlineDataStream( session, resource );
+    }
+
+    if( stream == NULL )
+    {
+        context->setError( FML_IOERR_READ_ERROR );
+        return NULL;
+    }
+
+    string text;
+    char chunk[4096];
+    long count;
+    while( ( count = stream->readBytes( chunk, sizeof( chunk ) ) ) > 0 )
+    {
+        text.append( chunk, count );
+    }
+    delete stream;
+
+    vector<Shard> shards;
+    if( !parse( text, shards ) )
+    {
+        context->setError( FML_IOERR_READ_ERROR );
+        return NULL;
+    }
+
+    FmlSessionHandle shardSession = Fieldml_Create( "", "shards" );
+    if( shardSession == FML_INVALID_HANDLE )
+    {
+        context->setError( FML_IOERR_CORE_ERROR );
+        return NULL;
+    }
+
+    //Shards are fetched and cached the same way as the manifest's own session's data.
+    void *userData;
+    Fieldml_StreamRequestCallbackFunction function = FieldmlIoSession::getSession().getStreamRequestCallback( session, userData );
+    if( function != NULL )
+    {
+        FieldmlIoSession::getSession().setStreamRequestCallback( shardSession, function, userData );
+    }
+    FieldmlHdf5CacheOptions cacheOptions;
+    if( FieldmlIoSession::getSession().getHdf5CacheOptions( session, cacheOptions ) )
+    {
+        FieldmlIoSession::getSession().setHdf5CacheOptions( shardSession, &cacheOptions );
+    }
+
+    ShardManifest *manifest = new ShardManifest();
+    manifest->shards = shards;
+    manifest->shardRoot = shardRoot;
+    manifest->location = location;
+    manifest->rawSizes.resize( rank );
+    Fieldml_GetArrayDataSourceRawSizes( session, source, &manifest->rawSizes[0] );
+    manifest->shardSession = shardSession;
+    manifest->shardSources.resize( shards.size(), FML_INVALID_HANDLE );
+
+    return manifest;
+}
+
+
+ShardManifest::ShardManifest() :
+    shardSession( FML_INVALID_HANDLE )
+{
+}
+
+
+int ShardManifest::getShardCount()
+{
+    return (int)shards.size();
+}
+
+
+const ShardManifest::Shard &ShardManifest::getShard( int index )
+{
+    return shards[index];
+}
+
+
+int ShardManifest::findShard( int row )
+{
+    int low = 0;
+    int high = (int)shards.size();
+    while( low < high )
+    {
+        const int middle = ( low + high ) / 2;
+        if( shards[middle].firstRow + shards[middle].rowCount <= row )
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    if( ( low < (int)shards.size() ) && ( shards[low].firstRow <= row ) )
+    {
+        return low;
+    }
+
+    return -1;
+}
+
+
+const string &ShardManifest::getShardRoot()
+{
+    return shardRoot;
+}
+
+
+FieldmlIoContext *ShardManifest::createShardContext()
+{
+    return FieldmlIoSession::getSession().createContext( shardSession );
+}
+
+
+void ShardManifest::fillRawSizes( const int *sizes )
+{
+    for( unsigned int i = 0; i < rawSizes.size(); i++ )
+    {
+        if( rawSizes[i] <= 0 )
+        {
+            rawSizes[i] = sizes[i];
+        }
+    }
+}
+
+
+FmlObjectHandle ShardManifest::getShardSource( int index )
+{
+    if( shardSources[index] != FML_INVALID_HANDLE )
+    {
+        return shardSources[index];
+    }
+
+    const Shard &shard = shards[index];
+    char name[64];
+    snprintf( name, sizeof( name ), "shard.%d.resource", index );
+    FmlObjectHandle resource = Fieldml_CreateHrefDataResource( shardSession, name, shard.format.c_str(), shard.href.c_str() );
+    snprintf( name, sizeof( name ), "shard.%d", index );
+    FmlObjectHandle source = Fieldml_CreateArrayDataSource( shardSession, name, resource, location.c_str(), (int)rawSizes.size() );
+    if( source == FML_INVALID_HANDLE )
+    {
+        return FML_INVALID_HANDLE;
+    }
+
+    //Each shard's source spans its whole array. Sizes can only be set all together, so shards of arrays whose raw sizes
+    //aren't known are left to work theirs out.
+    vector<int> sizes = rawSizes;
+    sizes[0] = shard.rowCount;
+    bool known = true;
+    for( unsigned int i = 1; i < sizes.size(); i++ )
+    {
+        if( sizes[i] <= 0 )
+        {
+            known = false;
+        }
+    }
+    if( known )
+    {
+        Fieldml_SetArrayDataSourceRawSizes( shardSession, source, &sizes[0] );
+        Fieldml_SetArrayDataSourceSizes( shardSession, source, &sizes[0] );
+    }
+
+    shardSources[index] = source;
+    return source;
+}
+
+
+ShardManifest::~ShardManifest()
+{
+    FieldmlIoSession::getSession().setStreamRequestCallback( shardSession, NULL, NULL );
+    FieldmlIoSession::getSession().setHdf5CacheOptions( shardSession, NULL );
+    Fieldml_Destroy( shardSession );
+}
+
+
+bool ShardManifest::parse( const string &text, vector<Shard> &shards )
+{
+    istringstream lines( text );
+    string line;
+    while( getline( lines, line ) )
+    {
+        size_t start = line.find_first_not_of( " \t\r" );
+        if( ( start == string::npos ) || ( line[start] == '#' ) )
+        {
+            continue;
+        }
+
+        Shard shard;
+        istringstream fields( line );
+        if( !( fields >> shard.firstRow >> shard.rowCount >> shard.format ) )
+        {
+            return false;
+        }
+
+        //The href is the rest of the line, so that it can contain spaces.
+        getline( fields, shard.href );
+        start = shard.href.find_first_not_of( " \t" );
+        if( start == string::npos )
+        {
+            return false;
+        }
+        shard.href = shard.href.substr( start, shard.href.find_last_not_of( " \t\r" ) + 1 - start );
+
+        shards.push_back( shard );
+    }
+
+    return validate( shards );
+}
+
+
+bool ShardManifest::validate( vector<Shard> &shards )
+{
+    if( shards.empty() )
+    {
+        return false;
+    }
+
+    sort( shards.begin(), shards.end() );
+
+    for( unsigned int i = 0; i < shards.size(); i++ )
+    {
+        const Shard &shard = shards[i];
+        if( ( shard.firstRow < 0 ) || ( shard.rowCount <= 0 ) || ( shard.rowCount > INT_MAX - shard.firstRow ) )
+        {
+            return false;
+        }
+        if( shard.format.empty() || ( shard.format.find_first_of( " \t\r\n" ) != string::npos ) || ( shard.format == StringUtil::SHARDED_NAME ) )
+        {
+            return false;
+        }
+        if( shard.href.empty() || ( shard.href.find_first_of( "\r\n" ) != string::npos ) )
+        {
+            return false;
+        }
+        if( ( i > 0 ) && ( shards[i - 1].firstRow + shards[i - 1].rowCount > shard.firstRow ) )
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+string ShardManifest::format( const vector<Shard> &shards )
+{
+    ostringstream text;
+    text << "# First row, row count, format, href" << "\n";
+    for( unsigned int i = 0; i < shards.size(); i++ )
+    {
+        text << shards[i].firstRow << " " << shards[i].rowCount << " " << shards[i].format << " " << shards[i].href << "\n";
+    }
+
+    return text.str();
+}
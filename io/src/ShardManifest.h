@@ -0,0 +1,144 @@
+/* \file
+ * $Id$
+ * \author Caton Little
+ * \brief 
+ *
+ * \section LICENSE
+ *
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is FieldML
+ *
+ * The Initial Developer of the Original Code is Auckland Uniservices Ltd,
+ * Auckland, New Zealand. Portions created by the Initial Developer are
+ * Copyright (C) 2010 the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either the GNU General Public License Version 2 or later (the "GPL"), or
+ * the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ */
+
+#ifndef H_SHARD_MANIFEST
+#define H_SHARD_MANIFEST
+
+#include <string>
+#include <vector>
+
+#include "FieldmlIoContext.h"
+
+/**
+ * Describes an array whose outermost rows are split across several shards, each a data resource of its own in any
+ * format. The manifest is plain text, with one line per shard giving its first row, its row count, its format and its
+ * href, which is relative to the manifest's own directory. Blank lines and lines starting with '#' are ignored. Every
+ * shard holds its rows of the array at the sharded data source's location.
+ *
+ * Shard readers and writers are opened on a private session holding a data resource and data source for each shard,
+ * so that the application's own session is left untouched.
+ */
+class ShardManifest
+{
+public:
+    class Shard
+    {
+    public:
+        int firstRow;
+
+        int rowCount;
+
+        std::string format;
+
+        std::string href;
+
+        bool operator<( const Shard &other ) const;
+    };
+
+private:
+    //Ordered by first row.
+    std::vector<Shard> shards;
+
+    //The directory that shard hrefs are relative to.
+    std::string shardRoot;
+
+    std::string location;
+
+    //The sharded data source's raw sizes. The outermost one is replaced by each shard's row count.
+    std::vector<int> rawSizes;
+
+    FmlSessionHandle shardSession;
+
+    std::vector<FmlObjectHandle> shardSources;
+
+    ShardManifest();
+
+public:
+    int getShardCount();
+
+    const Shard &getShard( int index );
+
+    /**
+     * Returns the index of the shard holding the given row, or -1 if there isn't one.
+     */
+    int findShard( int row );
+
+    const std::string &getShardRoot();
+
+    /**
+     * Returns a new context for a shard's reader or writer, which takes ownership of it.
+     */
+    FieldmlIoContext *createShardContext();
+
+    /**
+     * Uses the given array sizes wherever the data source doesn't give its raw sizes, e.g. for a new array.
+     */
+    void fillRawSizes( const int *sizes );
+
+    /**
+     * Returns the data source for the given shard's part of the array, creating it if need be.
+     */
+    FmlObjectHandle getShardSource( int index );
+
+    virtual ~ShardManifest();
+
+    /**
+     * Loads the manifest for the given data source from the given buffer, or from its resource if the buffer is NULL.
+     * The buffer's length in bytes is negative if it isn't known. Returns NULL if the manifest can't be read or isn't
+     * valid.
+     */
+    static ShardManifest *create( FieldmlIoContext *context, const std::string root, FmlObjectHandle source, void *buffer,
+        int64_t bufferLength );
+
+    /**
+     * Parses the given manifest text, returning false if it isn't valid.
+     */
+    static bool parse( const std::string &text, std::vector<Shard> &shards );
+
+    /**
+     * Sorts the given shards by first row, returning false if any of them are empty, overlap, or are themselves sharded.
+     */
+    static bool validate( std::vector<Shard> &shards );
+
+    static std::string format( const std::vector<Shard> &shards );
+};
+
+#endif //H_SHARD_MANIFEST
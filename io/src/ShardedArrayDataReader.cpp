@@ -0,0 +1,334 @@
+/* \file
+ * $Id$
+ * \author Caton Little
+ * \brief 
+ *
+ * \section LICENSE
+ *
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is FieldML
+ *
+ * The Initial Developer of the Original Code is Auckland Uniservices Ltd,
+ * Auckland, New Zealand. Portions created by the Initial Developer are
+ * Copyright (C) 2010 the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either the GNU General Public License Version 2 or later (the "GPL"), or
+ * the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ */
+
+#include "StringUtil.h"
+#include "FieldmlIoApi.h"
+
+#include "ShardedArrayDataReader.h"
+
+using namespace std;
+
+ShardedArrayDataReader *ShardedArrayDataReader::create( FieldmlIoContext *context, const string root, FmlObjectHandle source, void *buffer,
+    int64_t bufferLength )
+{
+    ShardManifest *manifest = ShardManifest::create( context, root, source, buffer, bufferLength );
+    if( manifest == NULL )
+    {
+        return NULL;
+    }
+
+    int rank = Fieldml_GetArrayDataSourceRank( context->getSession(), source );
+
+    return new ShardedArrayDataReader( context, manifest, source, rank );
+}
+
+
+ShardedArrayDataReader::ShardedArrayDataReader( FieldmlIoContext *_context, ShardManifest *_manifest, FmlObjectHandle source, int _rank ) :
+    ArrayDataReader( _context ),
+    closed( false ),
+    manifest( _manifest ),
+    rank( _rank ),
+    sourceOffsets( _rank ),
+    shardReaders( _manifest->getShardCount(), (ArrayDataReader *)NULL )
+{
+    Fieldml_GetArrayDataSourceOffsets( context->getSession(), source, &sourceOffsets[0] );
+}
+
+
+ArrayDataReader *ShardedArrayDataReader::getShardReader( int index )
+{
+    if( shardReaders[index] == NULL )
+    {
+        FmlObjectHandle shardSource = manifest->getShardSource( index );
+        if( shardSource == FML_INVALID_HANDLE )
+        {
+            context->setError( FML_IOERR_CORE_ERROR );
+            return NULL;
+        }
+
+        shardReaders[index] = ArrayDataReader::create( manifest->createShardContext(), manifest->getShardRoot(), shardSource );
+    }
+
+    return shardReaders[index];
+}
+
+
+bool ShardedArrayDataReader::checkDimensions( const int *offsets, const int *sizes )
+{
+    for( int i = 0; i < rank; i++ )
+    {
+        if( offsets[i] < 0 )
+        {
+            return false;
+        }
+        if( sizes[i] <= 0 )
+        {
+            return false;
+        }
+    }
+
+    const ShardManifest::Shard &last = manifest->getShard( manifest->getShardCount() - 1 );
+    const int64_t rowCount = (int64_t)last.firstRow + last.rowCount;
+    if( (int64_t)sourceOffsets[0] + offsets[0] + sizes[0] > rowCount )
+    {
+        return false;
+    }
+
+    return true;
+}
+
+
+FmlIoErrorNumber ShardedArrayDataReader::readShard( ArrayDataReader *shardReader, ArrayDataValueType valueType, const int *offsets, const int *sizes,
+    void *valueBuffer )
+{
+    if( valueType == ARRAY_VALUE_INT )
+    {
+        return shardReader->readIntSlab( offsets, sizes, (int*)valueBuffer );
+    }
+    else if( valueType == ARRAY_VALUE_DOUBLE )
+    {
+        return shardReader->readDoubleSlab( offsets, sizes, (double*)valueBuffer );
+    }
+    else if( valueType == ARRAY_VALUE_FLOAT )
+    {
+        return shardReader->readFloatSlab( offsets, sizes, (float*)valueBuffer );
+    }
+
+    return shardReader->readBooleanSlab( offsets, sizes, (FmlBoolean*)valueBuffer );
+}
+
+
+FmlIoErrorNumber ShardedArrayDataReader::readSlab( ArrayDataValueType valueType, const int *offsets, const int *sizes, void *valueBuffer )
+{
+    if( closed )
+    {
+        return FML_IOERR_RESOURCE_CLOSED;
+    }
+
+    if( !checkDimensions( offsets, sizes ) )
+    {
+        return context->setError( FML_IOERR_INVALID_PARAMETER );
+    }
+
+    int *shardOffsets = new int[rank];
+    int *shardSizes = new int[rank];
+
+    long sliceValues = 1;
+    for( int i = 1; i < rank; i++ )
+    {
+        shardOffsets[i] = sourceOffsets[i] + offsets[i];
+        shardSizes[i] = sizes[i];
+        sliceValues *= sizes[i];
+    }
+    const long sliceBytes = sliceValues * getValueSize( valueType );
+
+    //Each shard's part of the slab is a run of whole outer rows, so the parts follow one another in the buffer.
+    FmlIoErrorNumber err = FML_IOERR_NO_ERROR;
+    char *output = (char*)valueBuffer;
+    int row = sourceOffsets[0] + offsets[0];
+    const int endRow = row + sizes[0];
+    while( row < endRow )
+    {
+        const int index = manifest->findShard( row );
+        if( index < 0 )
+        {
+            err = context->setError( FML_IOERR_READ_ERROR );
+            break;
+        }
+
+        ArrayDataReader *shardReader = getShardReader( index );
+        if( shardReader == NULL )
+        {
+            err = context->setError( FML_IOERR_READ_ERROR );
+            break;
+        }
+
+        const ShardManifest::Shard &shard = manifest->getShard( index );
+        int rowCount = shard.firstRow + shard.rowCount - row;
+        if( rowCount > endRow - row )
+        {
+            rowCount = endRow - row;
+        }
+
+        shardOffsets[0] = row - shard.firstRow;
+        shardSizes[0] = rowCount;
+        err = readShard( shardReader, valueType, shardOffsets, shardSizes, output );
+        if( err != FML_IOERR_NO_ERROR )
+        {
+            break;
+        }
+
+        output += rowCount * sliceBytes;
+        row += rowCount;
+    }
+
+    delete[] shardOffsets;
+    delete[] shardSizes;
+
+    return err;
+}
+
+
+FmlIoErrorNumber ShardedArrayDataReader::readIntSlab( const int *offsets, const int *sizes, int *valueBuffer )
+{
+    return readSlab( ARRAY_VALUE_INT, offsets, sizes, valueBuffer );
+}
+
+
+FmlIoErrorNumber ShardedArrayDataReader::readDoubleSlab( const int *offsets, const int *sizes, double *valueBuffer )
+{
+    return readSlab( ARRAY_VALUE_DOUBLE, offsets, sizes, valueBuffer );
+}
+
+
+FmlIoErrorNumber ShardedArrayDataReader::readFloatSlab( const int *offsets, const int *sizes, float *valueBuffer )
+{
+    return readSlab( ARRAY_VALUE_FLOAT, offsets, sizes, valueBuffer );
+}
+
+
+FmlIoErrorNumber ShardedArrayDataReader::readBooleanSlab( const int *offsets, const int *sizes, FmlBoolean *valueBuffer )
+{
+    return readSlab( ARRAY_VALUE_BOOLEAN, offsets, sizes, valueBuffer );
+}
+
+
+FmlIoErrorNumber ShardedArrayDataReader::getExtents( FmlObjectHandle source, int sourceRank, int *sizes )
+{
+    if( closed )
+    {
+        return FML_IOERR_RESOURCE_CLOSED;
+    }
+
+    if( sourceRank != rank )
+    {
+        return FML_IOERR_INVALID_PARAMETER;
+    }
+
+    if( ArrayDataReader::getExtents( source, sourceRank, sizes ) == FML_IOERR_NO_ERROR )
+    {
+        return FML_IOERR_NO_ERROR;
+    }
+
+    if( sizes[0] <= 0 )
+    {
+        const ShardManifest::Shard &last = manifest->getShard( manifest->getShardCount() - 1 );
+        sizes[0] = last.firstRow + last.rowCount - sourceOffsets[0];
+    }
+
+    FmlIoErrorNumber err = FML_IOERR_NO_ERROR;
+    int *shardSizes = NULL;
+    for( int i = 1; i < rank; i++ )
+    {
+        if( sizes[i] > 0 )
+        {
+            continue;
+        }
+
+        if( shardSizes == NULL )
+        {
+            shardSizes = new int[rank];
+            ArrayDataReader *shardReader = getShardReader( 0 );
+            if( ( shardReader == NULL ) || ( shardReader->getExtents( manifest->getShardSource( 0 ), rank, shardSizes ) != FML_IOERR_NO_ERROR ) )
+            {
+                err = FML_IOERR_UNSUPPORTED;
+                break;
+            }
+        }
+        sizes[i] = shardSizes[i] - sourceOffsets[i];
+    }
+    delete[] shardSizes;
+
+    for( int i = 0; i < rank; i++ )
+    {
+        if( sizes[i] <= 0 )
+        {
+            err = FML_IOERR_UNSUPPORTED;
+        }
+    }
+
+    return err;
+}
+
+
+FmlIoErrorNumber ShardedArrayDataReader::close()
+{
+    if( closed )
+    {
+        return FML_IOERR_NO_ERROR;
+    }
+
+    FmlIoErrorNumber err = FML_IOERR_NO_ERROR;
+    for( unsigned int i = 0; i < shardReaders.size(); i++ )
+    {
+        if( shardReaders[i] == NULL )
+        {
+            continue;
+        }
+
+        FmlIoErrorNumber shardErr = shardReaders[i]->close();
+        if( err == FML_IOERR_NO_ERROR )
+        {
+            err = shardErr;
+        }
+    }
+
+    closed = true;
+
+    return err;
+}
+
+
+ShardedArrayDataReader::~ShardedArrayDataReader()
+{
+    if( !closed )
+    {
+        close();
+    }
+
+    for( unsigned int i = 0; i < shardReaders.size(); i++ )
+    {
+        delete shardReaders[i];
+    }
+
+    //The shards' data sources belong to the manifest's session, so it goes last.
+    delete manifest;
+}
@@ -0,0 +1,107 @@
+/* \file
+ * $Id$
+ * \author Caton Little
+ * \brief 
+ *
+ * \section LICENSE
+ *
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is FieldML
+ *
+ * The Initial Developer of the Original Code is Auckland Uniservices Ltd,
+ * Auckland, New Zealand. Portions created by the Initial Developer are
+ * Copyright (C) 2010 the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either the GNU General Public License Version 2 or later (the "GPL"), or
+ * the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ */
+
+#ifndef H_SHARDED_ARRAY_DATA_READER
+#define H_SHARDED_ARRAY_DATA_READER
+
+#include <string>
+#include <vector>
+
+#include "ArrayDataReader.h"
+#include "ShardManifest.h"
+
+/**
+ * Reads an array whose outermost rows are split across the shards listed in a manifest. Slabs that cross shard
+ * boundaries are assembled from a read of each shard they touch. Shards are only opened once they're first read.
+ */
+class ShardedArrayDataReader :
+    public ArrayDataReader
+{
+private:
+    bool closed;
+
+    ShardManifest * const manifest;
+
+    const int rank;
+
+    //The data source's offsets into the sharded array.
+    std::vector<int> sourceOffsets;
+
+    std::vector<ArrayDataReader *> shardReaders;
+
+    ShardedArrayDataReader( FieldmlIoContext *_context, ShardManifest *_manifest, FmlObjectHandle source, int _rank );
+
+    ArrayDataReader *getShardReader( int index );
+
+    //Checks that the slab is within the manifest's rows. Inner extents are left to the shards' own readers.
+    bool checkDimensions( const int *offsets, const int *sizes );
+
+    FmlIoErrorNumber readShard( ArrayDataReader *shardReader, ArrayDataValueType valueType, const int *offsets, const int *sizes, void *valueBuffer );
+
+    FmlIoErrorNumber readSlab( ArrayDataValueType valueType, const int *offsets, const int *sizes, void *valueBuffer );
+
+public:
+    virtual FmlIoErrorNumber readIntSlab( const int *offsets, const int *sizes, int *valueBuffer );
+
+    virtual FmlIoErrorNumber readDoubleSlab( const int *offsets, const int *sizes, double *valueBuffer );
+
+    virtual FmlIoErrorNumber readFloatSlab( const int *offsets, const int *sizes, float *valueBuffer );
+
+    virtual FmlIoErrorNumber readBooleanSlab( const int *offsets, const int *sizes, FmlBoolean *valueBuffer );
+
+    virtual FmlIoErrorNumber close();
+
+    /**
+     * Falls back on the manifest for the number of rows, and on the first shard for the inner extents, where the data
+     * source doesn't give them.
+     */
+    virtual FmlIoErrorNumber getExtents( FmlObjectHandle source, int sourceRank, int *sizes );
+
+    virtual ~ShardedArrayDataReader();
+
+    /**
+     * Creates a reader for the given data source, whose manifest is read from the given buffer if there is one.
+     */
+    static ShardedArrayDataReader *create( FieldmlIoContext *context, const std::string root, FmlObjectHandle source, void *buffer,
+        int64_t bufferLength );
+};
+
+#endif //H_SHARDED_ARRAY_DATA_READER
@@ -0,0 +1,259 @@
+/* \file
+ * $Id$
+ * \author Caton Little
+ * \brief 
+ *
+ * \section LICENSE
+ *
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is FieldML
+ *
+ * The Initial Developer of the Original Code is Auckland Uniservices Ltd,
+ * Auckland, New Zealand. Portions created by the Initial Developer are
+ * Copyright (C) 2010 the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either the GNU General Public License Version 2 or later (the "GPL"), or
+ * the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ */
+
+#include "StringUtil.h"
+#include "FieldmlIoApi.h"
+
+#include "ArrayDataReader.h"
+#include "ShardedArrayDataWriter.h"
+
+using namespace std;
+
+ShardedArrayDataWriter *ShardedArrayDataWriter::create( FieldmlIoContext *context, const string root, FmlObjectHandle source, FieldmlHandleType handleType,
+    bool append, int *sizes, int rank, const FieldmlArrayWriterOptions *options )
+{
+    if( ( sizes == NULL ) || ( rank != Fieldml_GetArrayDataSourceRank( context->getSession(), source ) ) )
+    {
+        context->setError( FML_IOERR_INVALID_PARAMETER );
+        return NULL;
+    }
+
+    //Writers only ever read the manifest. Which rows go where has to be settled before any process starts writing.
+    ShardManifest *manifest = ShardManifest::create( context, root, source, NULL, -1 );
+    if( manifest == NULL )
+    {
+        return NULL;
+    }
+    manifest->fillRawSizes( sizes );
+
+    return new ShardedArrayDataWriter( context, manifest, handleType, append, sizes, rank, options );
+}
+
+
+ShardedArrayDataWriter::ShardedArrayDataWriter( FieldmlIoContext *_context, ShardManifest *_manifest, FieldmlHandleType _handleType, bool _append, int *sizes,
+    int rank, const FieldmlArrayWriterOptions *_options ) :
+    ArrayDataWriter( _context ),
+    closed( false ),
+    manifest( _manifest ),
+    handleType( _handleType ),
+    append( _append ),
+    arraySizes( sizes, sizes + rank ),
+    hasOptions( _options != NULL ),
+    options(),
+    shardWriters( _manifest->getShardCount(), (ArrayDataWriter *)NULL )
+{
+    //The options are only valid for the duration of the open call, but shards are opened later.
+    if( hasOptions )
+    {
+        options = *_options;
+        if( options.chunkSizes != NULL )
+        {
+            chunkSizes.assign( options.chunkSizes, options.chunkSizes + rank );
+            options.chunkSizes = &chunkSizes[0];
+        }
+    }
+}
+
+
+ArrayDataWriter *ShardedArrayDataWriter::getShardWriter( int index )
+{
+    if( shardWriters[index] == NULL )
+    {
+        FmlObjectHandle shardSource = manifest->getShardSource( index );
+        if( shardSource == FML_INVALID_HANDLE )
+        {
+            context->setError( FML_IOERR_CORE_ERROR );
+            return NULL;
+        }
+
+        vector<int> shardSizes = arraySizes;
+        shardSizes[0] = manifest->getShard( index ).rowCount;
+        shardWriters[index] = ArrayDataWriter::create( manifest->createShardContext(), manifest->getShardRoot(), shardSource, handleType, append,
+            &shardSizes[0], (int)shardSizes.size(), hasOptions ? &options : NULL );
+    }
+
+    return shardWriters[index];
+}
+
+
+FmlIoErrorNumber ShardedArrayDataWriter::writeShard( ArrayDataWriter *shardWriter, ArrayDataValueType valueType, const int *offsets, const int *sizes,
+    const void *valueBuffer )
+{
+    if( valueType == ARRAY_VALUE_INT )
+    {
+        return shardWriter->writeIntSlab( offsets, sizes, (const int*)valueBuffer );
+    }
+    else if( valueType == ARRAY_VALUE_DOUBLE )
+    {
+        return shardWriter->writeDoubleSlab( offsets, sizes, (const double*)valueBuffer );
+    }
+
+    return shardWriter->writeBooleanSlab( offsets, sizes, (const FmlBoolean*)valueBuffer );
+}
+
+
+FmlIoErrorNumber ShardedArrayDataWriter::writeSlab( ArrayDataValueType valueType, const int *offsets, const int *sizes, const void *valueBuffer )
+{
+    if( closed )
+    {
+        return FML_IOERR_RESOURCE_CLOSED;
+    }
+
+    const int rank = (int)arraySizes.size();
+    int *shardOffsets = new int[rank];
+    int *shardSizes = new int[rank];
+
+    long sliceValues = 1;
+    for( int i = 1; i < rank; i++ )
+    {
+        shardOffsets[i] = offsets[i];
+        shardSizes[i] = sizes[i];
+        sliceValues *= sizes[i];
+    }
+    const long sliceBytes = sliceValues * ArrayDataReader::getValueSize( valueType );
+
+    FmlIoErrorNumber err = FML_IOERR_NO_ERROR;
+    const char *input = (const char*)valueBuffer;
+    int row = offsets[0];
+    const int endRow = row + sizes[0];
+    while( row < endRow )
+    {
+        const int index = manifest->findShard( row );
+        if( index < 0 )
+        {
+            err = context->setError( FML_IOERR_WRITE_ERROR );
+            break;
+        }
+
+        ArrayDataWriter *shardWriter = getShardWriter( index );
+        if( shardWriter == NULL )
+        {
+            err = context->setError( FML_IOERR_WRITE_ERROR );
+            break;
+        }
+
+        const ShardManifest::Shard &shard = manifest->getShard( index );
+        int rowCount = shard.firstRow + shard.rowCount - row;
+        if( rowCount > endRow - row )
+        {
+            rowCount = endRow - row;
+        }
+
+        shardOffsets[0] = row - shard.firstRow;
+        shardSizes[0] = rowCount;
+        err = writeShard( shardWriter, valueType, shardOffsets, shardSizes, input );
+        if( err != FML_IOERR_NO_ERROR )
+        {
+            break;
+        }
+
+        input += rowCount * sliceBytes;
+        row += rowCount;
+    }
+
+    delete[] shardOffsets;
+    delete[] shardSizes;
+
+    return err;
+}
+
+
+FmlIoErrorNumber ShardedArrayDataWriter::writeIntSlab( const int *offsets, const int *sizes, const int *valueBuffer )
+{
+    return writeSlab( ARRAY_VALUE_INT, offsets, sizes, valueBuffer );
+}
+
+
+FmlIoErrorNumber ShardedArrayDataWriter::writeDoubleSlab( const int *offsets, const int *sizes, const double *valueBuffer )
+{
+    return writeSlab( ARRAY_VALUE_DOUBLE, offsets, sizes, valueBuffer );
+}
+
+
+FmlIoErrorNumber ShardedArrayDataWriter::writeBooleanSlab( const int *offsets, const int *sizes, const FmlBoolean *valueBuffer )
+{
+    return writeSlab( ARRAY_VALUE_BOOLEAN, offsets, sizes, valueBuffer );
+}
+
+
+FmlIoErrorNumber ShardedArrayDataWriter::close()
+{
+    if( closed )
+    {
+        return FML_IOERR_NO_ERROR;
+    }
+
+    FmlIoErrorNumber err = FML_IOERR_NO_ERROR;
+    for( unsigned int i = 0; i < shardWriters.size(); i++ )
+    {
+        if( shardWriters[i] == NULL )
+        {
+            continue;
+        }
+
+        FmlIoErrorNumber shardErr = shardWriters[i]->close();
+        if( err == FML_IOERR_NO_ERROR )
+        {
+            err = shardErr;
+        }
+    }
+
+    closed = true;
+
+    return err;
+}
+
+
+ShardedArrayDataWriter::~ShardedArrayDataWriter()
+{
+    if( !closed )
+    {
+        close();
+    }
+
+    for( unsigned int i = 0; i < shardWriters.size(); i++ )
+    {
+        delete shardWriters[i];
+    }
+
+    //The shards' data sources belong to the manifest's session, so it goes last.
+    delete manifest;
+}
@@ -58,8 +58,12 @@ namespace StringUtil
     const std::string FMLIO_VERSION_STRING                  = "0.5.0";
     
     const std::string PLAIN_TEXT_NAME                     = "PLAIN_TEXT";
+    const std::string PLAIN_TEXT_GZIP_NAME                = "PLAIN_TEXT_GZIP";
     const std::string HDF5_NAME                           = "HDF5";
     const std::string PHDF5_NAME                          = "PHDF5";
+    const std::string BASE64_NAME                         = "BASE64";
+    const std::string RAW_BINARY_NAME                     = "RAW_BINARY";
+    const std::string SHARDED_NAME                        = "SHARDED";
     
     const string makeFilename( const string dir, const string file )
     {
@@ -77,6 +81,27 @@ namespace StringUtil
     }
 
 
+    const string getDirectory( const string path )
+    {
+        size_t index = path.rfind( NIX_PATH_SEP );
+        
+#ifdef WIN32
+        size_t winIndex = path.rfind( WIN_PATH_SEP );
+        if( ( winIndex != string::npos ) && ( ( index == string::npos ) || ( winIndex > index ) ) )
+        {
+            index = winIndex;
+        }
+#endif
+        
+        if( index == string::npos )
+        {
+            return string();
+        }
+        
+        return path.substr( 0, index );
+    }
+
+
     const bool safeString( const char *charString, std::string &target )
     {
         if( charString == NULL )
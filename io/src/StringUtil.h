@@ -50,11 +50,20 @@ namespace StringUtil
     extern const std::string FMLIO_VERSION_STRING;
 
     extern const std::string PLAIN_TEXT_NAME;
+    extern const std::string PLAIN_TEXT_GZIP_NAME;
     extern const std::string HDF5_NAME;
     extern const std::string PHDF5_NAME;
+    extern const std::string BASE64_NAME;
+    extern const std::string RAW_BINARY_NAME;
+    extern const std::string SHARDED_NAME;
 
     const std::string makeFilename( const std::string dir, const std::string file );
     
+    /**
+     * Returns the directory part of the given path, or an empty string if it has none.
+     */
+    const std::string getDirectory( const std::string path );
+    
     const bool safeString( const char *charString, std::string &target );
 }
 
@@ -40,9 +40,12 @@
  */
 
 #include <sstream>
+#include <algorithm>
+#include <cstring>
 #include <stdio.h>
 #include "StringUtil.h"
 #include "FieldmlIoApi.h"
+#include "FieldmlIoSession.h"
 
 #include "TextArrayDataReader.h"
 #include "InputStream.h"
@@ -50,88 +53,57 @@
 using namespace std;
 
 /**
- * A pseudo-lambda class that removes the need to duplicate the slab and slice reading implementations.
- * No point in making this a template class, as we need to use a different method on stream depending on the type,
- * and there's no superclass functionality, so template specialization is redundant.
+ * Compile-time value kernels for the slab reader. Each one reads a contiguous run of values straight into the
+ * caller's buffer, so the only per-value cost is the parse itself.
+ * NOTE: FmlBoolean and int are the same C type, so these can't simply be selected by value type.
  */
-class BufferReader
+class IntValueReader
 {
-protected:
-    int bufferPos;
-    FieldmlInputStream * const stream;
-    
-public:
-    BufferReader( FieldmlInputStream *_stream ) :
-        stream( _stream ), bufferPos( 0 ) {}
-    
-    virtual ~BufferReader() {}
-    
-    virtual void read( int count ) = 0;
-};
-
-
-class DoubleBufferReader :
-    public BufferReader
-{
-private:
-    double * const buffer;
-    
 public:
-    DoubleBufferReader( FieldmlInputStream *_stream, double *_buffer ) :
-        BufferReader( _stream ), buffer( _buffer ) {}
+    typedef int ValueType;
     
-    void read( int count )
+    static void read( FieldmlInputStream *stream, int *buffer, int count )
     {
         for( int i = 0; i < count; i++ )
         {
-            buffer[bufferPos++] = stream->readDouble();
+            buffer[i] = stream->readInt();
         }
     }
 };
 
 
-class IntBufferReader :
-    public BufferReader
+class DoubleValueReader
 {
-private:
-    int * const buffer;
-    
 public:
-    IntBufferReader( FieldmlInputStream *_stream, int *_buffer ) :
-        BufferReader( _stream ), buffer( _buffer ) {}
+    typedef double ValueType;
     
-    void read( int count )
+    static void read( FieldmlInputStream *stream, double *buffer, int count )
     {
         for( int i = 0; i < count; i++ )
         {
-            buffer[bufferPos++] = stream->readInt();
+            buffer[i] = stream->readDouble();
         }
     }
 };
 
 
-class BooleanBufferReader :
-    public BufferReader
+class BooleanValueReader
 {
-private:
-    	FmlBoolean * const buffer;
-    
 public:
-    BooleanBufferReader( FieldmlInputStream *_stream, FmlBoolean *_buffer ) :
-        BufferReader( _stream ), buffer( _buffer ) {}
+    typedef FmlBoolean ValueType;
     
-    void read( int count )
+    static void read( FieldmlInputStream *stream, FmlBoolean *buffer, int count )
     {
         for( int i = 0; i < count; i++ )
         {
-            buffer[bufferPos++] = stream->readBoolean();
+            buffer[i] = stream->readBoolean();
         }
     }
 };
 
     
 TextArrayDataReader *TextArrayDataReader::create( FieldmlIoContext *context, const string root, FmlObjectHandle source,
-	void *buffer)
+	void *buffer, int64_t bufferLength )
 {
     FieldmlInputStream *stream = NULL;
     
@@ -153,7 +125,15 @@ TextArrayDataReader *TextArrayDataReader::create( FieldmlIoContext *context, con
         return NULL;
     }
 
-    if( format != StringUtil::PLAIN_TEXT_NAME )
+    const bool compressed = ( format == StringUtil::PLAIN_TEXT_GZIP_NAME );
+    if( ( format != StringUtil::PLAIN_TEXT_NAME ) && !compressed )
+    {
+        context->setError( FML_IOERR_UNSUPPORTED );
+        return NULL;
+    }
+    
+    //Compressed data can only live in files.
+    if( compressed && ( ( buffer != NULL ) || ( type != FML_DATA_RESOURCE_HREF ) ) )
     {
         context->setError( FML_IOERR_UNSUPPORTED );
         return NULL;
@@ -171,29 +151,33 @@ TextArrayDataReader *TextArrayDataReader::create( FieldmlIoContext *context, con
     			return NULL;
     		}
     		Fieldml_FreeString(temp_href);
-    		stream = FieldmlInputStream::createTextFileStream( StringUtil::makeFilename( root, href ) );
+    		void *userData;
+    		Fieldml_StreamRequestCallbackFunction function = FieldmlIoSession::getSession().getStreamRequestCallback( context->getSession(), userData );
+    		if( function != NULL )
+    		{
+    			//The callback serves the resource's data as stored, so compressed data is decompressed here.
+    			stream = FieldmlInputStream::createDecompressingStream( FieldmlInputStream::createCallbackStream( href, function, userData ) );
+    		}
+    		else if( compressed )
+    		{
+    			stream = FieldmlInputStream::createGzipFileStream( StringUtil::makeFilename( root, href ) );
+    		}
+    		else
+    		{
+    			stream = FieldmlInputStream::createTextFileStream( StringUtil::makeFilename( root, href ) );
+    		}
     	}
     	else if( type == FML_DATA_RESOURCE_INLINE )
     	{
-    		string data;
-    		char *temp_inline_data = Fieldml_GetInlineData( context->getSession(), resource );
-    		if( !StringUtil::safeString( temp_inline_data, data ) )
-    		{
-    			return NULL;
-    		}
-    		Fieldml_FreeString(temp_inline_data);
-    		stream = FieldmlInputStream::createStringStream( data );
+    		//Read straight from the resource's own storage, rather than from a copy of it.
+    		stream = FieldmlInputStream::createInlineDataStream( context->getSession(), resource );
     	}
     }
     else
     {
-    	string data;
-    	char *temp_data = (char *)buffer;
-		if( !StringUtil::safeString( temp_data, data ) )
-		{
-			return NULL;
-		}
-		stream = FieldmlInputStream::createStringStream( data );
+    	//The caller's buffer must outlive the reader, so it can be read in place.
+    	const char *data = (const char *)buffer;
+		stream = FieldmlInputStream::createStringStream( data, ( bufferLength >= 0 ) ? bufferLength : strlen( data ) );
     }
     
     if( stream == NULL )
@@ -207,13 +191,15 @@ TextArrayDataReader *TextArrayDataReader::create( FieldmlIoContext *context, con
 
 TextArrayDataReader::TextArrayDataReader( FieldmlIoContext *_context, FieldmlInputStream *_stream, FmlObjectHandle _source, int rank ) :
     ArrayDataReader( _context ),
+    closed( false ),
     stream( _stream ),
+    resourceStream( _stream ),
     source( _source ),
     sourceRank( rank ),
     sourceSizes( NULL ),
-    sourceOffsets( NULL ),
     sourceRawSizes( NULL ),
-    closed( false )
+    sourceOffsets( NULL ),
+    sourceRawStrides( NULL )
 {
     startPos = -1;
     
@@ -227,6 +213,14 @@ TextArrayDataReader::TextArrayDataReader( FieldmlIoContext *_context, FieldmlInp
     Fieldml_GetArrayDataSourceRawSizes( context->getSession(), source, sourceRawSizes );
     Fieldml_GetArrayDataSourceOffsets( context->getSession(), source, sourceOffsets );
     
+    sourceRawStrides = new long[sourceRank];
+    sourceRawStrides[sourceRank - 1] = 1;
+    for( int i = sourceRank - 2; i >= 0; i-- )
+    {
+        //NOTE This could overflow in the event that someone puts that much data into a text file. Probability: Lilliputian.
+        sourceRawStrides[i] = sourceRawStrides[i + 1] * sourceRawSizes[i + 1];
+    }
+    
     char *temp_string = Fieldml_GetArrayDataSourceLocation( context->getSession(), source );
     StringUtil::safeString( temp_string, sourceLocation );
     Fieldml_FreeString(temp_string);
@@ -288,166 +282,306 @@ FmlIoErrorNumber TextArrayDataReader::skipPreamble()
 }
 
 
-bool TextArrayDataReader::applyOffsets( const int *offsets, const int *sizes, int depth, bool isHead )
+FmlIoErrorNumber TextArrayDataReader::readPreSlab( const int *offsets, const int *sizes, long &position )
 {
-    long count = 1;
+    if( !checkDimensions( offsets, sizes ) )
+    {
+        return context->setError( FML_IOERR_INVALID_PARAMETER );
+    }
     
-    for( int i = depth+1; i < sourceRank; i++ )
+    if( ( nextOutermostOffset >= 0 ) && ( sourceOffsets[0] + offsets[0] >= nextOutermostOffset ) )
     {
-        //NOTE This could overflow in the event that someone puts that much data into a text file. Probability: Lilliputian.
-        count *= sourceRawSizes[i];
+        //The stream is still sitting at the start of the row after the previous slab.
+        position = nextOutermostOffset * sourceRawStrides[0];
+        return FML_IOERR_NO_ERROR;
     }
     
-    int sliceCount;
-    if( isHead )
+    if( startPos == -1 )
     {
-        sliceCount = sourceOffsets[depth] + offsets[depth];
-        if( ( depth == 0 ) && ( nextOutermostOffset >= 0 ) && ( sliceCount >= nextOutermostOffset ) )
+        int err = skipPreamble();
+        if( err != FML_IOERR_NO_ERROR )
         {
-            sliceCount -= nextOutermostOffset;
+            return err;
         }
     }
     else
     {
-        sliceCount = sourceRawSizes[depth] - ( sourceOffsets[depth] + offsets[depth] + sizes[depth] );
+        stream->seek( startPos );
     }
     
-    if( sliceCount == 0 )
-    {
-        return true;
-    }
+    position = 0;
     
-    for( int j = 0; j < sliceCount; j++ )
+    return FML_IOERR_NO_ERROR;
+}
+
+
+FmlIoErrorNumber TextArrayDataReader::skipToRow( int nextOffset, long position )
+{
+    //Leave the stream at the start of the next outermost row, so that sequential reads needn't rewind.
+    const long nextPosition = nextOffset * sourceRawStrides[0];
+    if( ( nextOffset < sourceRawSizes[0] ) && ( nextPosition > position ) )
     {
-        for( int i = 0; i < count; i++ )
+        stream->skipValues( nextPosition - position );
+        if( stream->eof() )
         {
-            stream->readDouble();
+            nextOutermostOffset = -1;
+            return context->setError( FML_IOERR_UNEXPECTED_EOF );
         }
     }
+    nextOutermostOffset = nextOffset;
     
-    return !stream->eof();
+    return FML_IOERR_NO_ERROR;
 }
 
 
-FmlIoErrorNumber TextArrayDataReader::readPreSlab( const int *offsets, const int *sizes )
+template <class ValueReader> FmlIoErrorNumber TextArrayDataReader::readSlab( const int *offsets, const int *sizes, const int *steps, typename ValueReader::ValueType *valueBuffer )
 {
-    if( !checkDimensions( offsets, sizes ) )
+    if( closed )
     {
-        return context->setError( FML_IOERR_INVALID_PARAMETER );
+        return FML_IOERR_RESOURCE_CLOSED;
     }
     
-    if( ( nextOutermostOffset >= 0 ) && ( sourceOffsets[0] + offsets[0] >= nextOutermostOffset ) )
+    //The part of the array that the slab spans, which is bigger than the slab itself if it's strided.
+    int *extents = new int[sourceRank];
+    for( int i = 0; i < sourceRank; i++ )
     {
-        return FML_IOERR_NO_ERROR;
+        extents[i] = ( steps == NULL ) ? sizes[i] : ( ( sizes[i] - 1 ) * steps[i] ) + 1;
     }
     
-    if( startPos == -1 )
+    long position;
+    int err = readPreSlab( offsets, extents, position );
+    const int nextOffset = sourceOffsets[0] + offsets[0] + extents[0];
+    delete[] extents;
+    if( err != FML_IOERR_NO_ERROR )
     {
-        int err = skipPreamble();
-        if( err != FML_IOERR_NO_ERROR )
+        return err;
+    }
+    
+    //Text data can only be read forwards, so walk the slab's innermost runs in storage order, skipping the values in
+    //between. 'position' is the raw index of the next value in the stream. Runs are only contiguous if the slab isn't
+    //strided along the innermost dimension. Otherwise, each value is a run of its own.
+    const int innermost = sourceRank - 1;
+    const bool contiguousRuns = ( steps == NULL ) || ( steps[innermost] == 1 );
+    const int runLength = contiguousRuns ? sizes[innermost] : 1;
+    const int lastDimension = contiguousRuns ? innermost - 1 : innermost;
+    
+    int *index = new int[sourceRank];
+    for( int i = 0; i < sourceRank; i++ )
+    {
+        index[i] = 0;
+    }
+    
+    while( true )
+    {
+        long runStart = 0;
+        for( int i = 0; i < sourceRank; i++ )
         {
-            return err;
+            const long step = ( steps == NULL ) ? 1 : steps[i];
+            runStart += ( sourceOffsets[i] + offsets[i] + ( index[i] * step ) ) * sourceRawStrides[i];
+        }
+        
+        if( runStart > position )
+        {
+            stream->skipValues( runStart - position );
+            if( stream->eof() )
+            {
+                err = context->setError( FML_IOERR_UNEXPECTED_EOF );
+                break;
+            }
+        }
+        
+        ValueReader::read( stream, valueBuffer, runLength );
+        if( stream->eof() )
+        {
+            err = context->setError( FML_IOERR_UNEXPECTED_EOF );
+            break;
+        }
+        valueBuffer += runLength;
+        position = runStart + runLength;
+        
+        int depth = lastDimension;
+        while( depth >= 0 )
+        {
+            index[depth]++;
+            if( index[depth] < sizes[depth] )
+            {
+                break;
+            }
+            index[depth] = 0;
+            depth--;
+        }
+        if( depth < 0 )
+        {
+            break;
         }
     }
-    else
+    
+    delete[] index;
+    
+    if( err != FML_IOERR_NO_ERROR )
     {
-        stream->seek( startPos );
+        nextOutermostOffset = -1;
+        return err;
     }
     
-    return FML_IOERR_NO_ERROR;
+    return skipToRow( nextOffset, position );
 }
 
 
-FmlIoErrorNumber TextArrayDataReader::readSlice( const int *offsets, const int *sizes, int depth, BufferReader &reader )
+template <class ValueReader> FmlIoErrorNumber TextArrayDataReader::readPointValues( int pointCount, const int *points, typename ValueReader::ValueType *valueBuffer )
 {
-    if( !applyOffsets( offsets, sizes, depth, true ) )
+    if( closed )
     {
-        return context->setError( FML_IOERR_UNEXPECTED_EOF );
+        return FML_IOERR_RESOURCE_CLOSED;
     }
     
-    if( depth == sourceRank - 1 )
+    if( pointCount == 0 )
     {
-        reader.read( sizes[depth] );
-        if( stream->eof() )
-        {
-            return context->setError( FML_IOERR_UNEXPECTED_EOF );
-        }
+        return FML_IOERR_NO_ERROR;
     }
-    else
+    
+    vector<int> unitSizes( sourceRank, 1 );
+    
+    //The raw index of each point, along with where its value goes.
+    vector< pair<long, int> > rawIndexes( pointCount );
+    for( int p = 0; p < pointCount; p++ )
     {
-        int err;
-        for( int i = 0; i < sizes[depth]; i++ )
+        const int *point = points + ( p * sourceRank );
+        if( !checkDimensions( point, &unitSizes[0] ) )
         {
-            err = readSlice( offsets, sizes, depth + 1, reader );
-            if( err != FML_IOERR_NO_ERROR )
-            {
-                return err;
-            }
+            return context->setError( FML_IOERR_INVALID_PARAMETER );
         }
+        
+        long rawIndex = 0;
+        for( int i = 0; i < sourceRank; i++ )
+        {
+            rawIndex += ( sourceOffsets[i] + point[i] ) * sourceRawStrides[i];
+        }
+        rawIndexes[p] = make_pair( rawIndex, p );
     }
     
-    if( depth == 0 )
+    //Visiting the points in storage order means that they can all be read in a single forward pass.
+    sort( rawIndexes.begin(), rawIndexes.end() );
+    
+    long position;
+    int err = readPreSlab( points + ( rawIndexes[0].second * sourceRank ), &unitSizes[0], position );
+    if( err != FML_IOERR_NO_ERROR )
     {
-        nextOutermostOffset = sourceOffsets[0] + offsets[0] + sizes[0];
+        return err;
     }
-    else if( !applyOffsets( offsets, sizes, depth, false ) )
+    
+    typename ValueReader::ValueType value = 0;
+    long lastIndex = -1;
+    for( int p = 0; p < pointCount; p++ )
     {
-        return context->setError( FML_IOERR_UNEXPECTED_EOF );
+        const long rawIndex = rawIndexes[p].first;
+        if( rawIndex != lastIndex )
+        {
+            if( rawIndex > position )
+            {
+                stream->skipValues( rawIndex - position );
+            }
+            if( !stream->eof() )
+            {
+                ValueReader::read( stream, &value, 1 );
+            }
+            if( stream->eof() )
+            {
+                nextOutermostOffset = -1;
+                return context->setError( FML_IOERR_UNEXPECTED_EOF );
+            }
+            position = rawIndex + 1;
+            lastIndex = rawIndex;
+        }
+        
+        valueBuffer[rawIndexes[p].second] = value;
     }
     
-    
-    return FML_IOERR_NO_ERROR;
+    return skipToRow( (int)( lastIndex / sourceRawStrides[0] ) + 1, position );
 }
 
 
-FmlIoErrorNumber TextArrayDataReader::readSlab( const int *offsets, const int *sizes, BufferReader &reader )
+FmlIoErrorNumber TextArrayDataReader::readIntSlab( const int *offsets, const int *sizes, int *valueBuffer )
 {
-    int err = readPreSlab( offsets, sizes );
-    if( err != FML_IOERR_NO_ERROR )
-    {
-        return err;
-    }
-    
-    return readSlice( offsets, sizes, 0, reader );
+    return readSlab<IntValueReader>( offsets, sizes, NULL, valueBuffer );
 }
 
 
-FmlIoErrorNumber TextArrayDataReader::readIntSlab( const int *offsets, const int *sizes, int *valueBuffer )
+FmlIoErrorNumber TextArrayDataReader::readDoubleSlab( const int *offsets, const int *sizes, double *valueBuffer )
 {
-    if( closed )
+    return readSlab<DoubleValueReader>( offsets, sizes, NULL, valueBuffer );
+}
+
+
+FmlIoErrorNumber TextArrayDataReader::readBooleanSlab( const int *offsets, const int *sizes, FmlBoolean *valueBuffer )
+{
+    return readSlab<BooleanValueReader>( offsets, sizes, NULL, valueBuffer );
+}
+
+
+FmlIoErrorNumber TextArrayDataReader::readStridedSlab( ArrayDataValueType valueType, const int *offsets, const int *sizes, const int *strides, void *valueBuffer )
+{
+    if( valueType == ARRAY_VALUE_INT )
     {
-        return FML_IOERR_RESOURCE_CLOSED;
+        return readSlab<IntValueReader>( offsets, sizes, strides, (int*)valueBuffer );
+    }
+    else if( valueType == ARRAY_VALUE_DOUBLE )
+    {
+        return readSlab<DoubleValueReader>( offsets, sizes, strides, (double*)valueBuffer );
     }
     
-    IntBufferReader reader( stream, valueBuffer );
-    
-    return readSlab( offsets, sizes, reader );
+    return readSlab<BooleanValueReader>( offsets, sizes, strides, (FmlBoolean*)valueBuffer );
 }
 
 
-FmlIoErrorNumber TextArrayDataReader::readDoubleSlab( const int *offsets, const int *sizes, double *valueBuffer )
+FmlIoErrorNumber TextArrayDataReader::readPoints( ArrayDataValueType valueType, int pointCount, const int *points, void *valueBuffer )
 {
-    if( closed )
+    if( valueType == ARRAY_VALUE_INT )
     {
-        return FML_IOERR_RESOURCE_CLOSED;
+        return readPointValues<IntValueReader>( pointCount, points, (int*)valueBuffer );
+    }
+    else if( valueType == ARRAY_VALUE_DOUBLE )
+    {
+        return readPointValues<DoubleValueReader>( pointCount, points, (double*)valueBuffer );
     }
-
-    DoubleBufferReader reader( stream, valueBuffer );
     
-    return readSlab( offsets, sizes, reader );
+    return readPointValues<BooleanValueReader>( pointCount, points, (FmlBoolean*)valueBuffer );
 }
 
 
-FmlIoErrorNumber TextArrayDataReader::readBooleanSlab( const int *offsets, const int *sizes, FmlBoolean *valueBuffer )
+bool TextArrayDataReader::isConcurrent()
+{
+    //Each reader has its own stream. Streams fed by callbacks leave thread safety to the application's callback.
+    return true;
+}
+
+
+FmlIoErrorNumber TextArrayDataReader::setAccessPattern( FieldmlAccessPattern pattern )
 {
     if( closed )
     {
-        return FML_IOERR_RESOURCE_CLOSED;
+        return context->setError( FML_IOERR_RESOURCE_CLOSED );
+    }
+    
+    //Streams that read from memory have nothing to wait for.
+    if( resourceStream->isInMemory() )
+    {
+        return FML_IOERR_NO_ERROR;
     }
-
-    BooleanBufferReader reader( stream, valueBuffer );
     
-    return readSlab( offsets, sizes, reader );
+    const bool readingAhead = ( stream != resourceStream );
+    if( ( pattern == FML_ACCESS_PATTERN_SEQUENTIAL ) && !readingAhead )
+    {
+        stream = FieldmlInputStream::createReadAheadStream( resourceStream );
+    }
+    else if( ( pattern != FML_ACCESS_PATTERN_SEQUENTIAL ) && readingAhead )
+    {
+        //Leaves the resource's stream where the read-ahead stream was.
+        delete stream;
+        stream = resourceStream;
+    }
+    
+    return FML_IOERR_NO_ERROR;
 }
 
 
@@ -466,9 +600,14 @@ FmlIoErrorNumber TextArrayDataReader::close()
 
 TextArrayDataReader::~TextArrayDataReader()
 {
-    delete stream;
+    if( stream != resourceStream )
+    {
+        delete stream;
+    }
+    delete resourceStream;
     
-    delete sourceRawSizes;
-    delete sourceSizes;
-    delete sourceOffsets;
+    delete[] sourceRawSizes;
+    delete[] sourceRawStrides;
+    delete[] sourceSizes;
+    delete[] sourceOffsets;
 }
@@ -46,15 +46,16 @@
 #include "ArrayDataReader.h"
 #include "InputStream.h"
 
-class BufferReader;
-
 class TextArrayDataReader :
     public ArrayDataReader
 {
 private:
     bool closed;
     
-    FieldmlInputStream * const stream;
+    //The stream that values are parsed from. Either the resource's own stream, or a read-ahead stream wrapping it.
+    FieldmlInputStream *stream;
+    
+    FieldmlInputStream * const resourceStream;
     
     const FmlObjectHandle source;
 
@@ -66,6 +67,9 @@ private:
     
     int *sourceOffsets;
     
+    //The number of raw values spanned by a unit step in each dimension.
+    long *sourceRawStrides;
+    
     std::string sourceLocation;
     
     int nextOutermostOffset;
@@ -77,13 +81,15 @@ private:
     
     bool checkDimensions( const int *offsets, const int *sizes );
     
-    bool applyOffsets( const int *offsets, const int *sizes, int depth, bool isHead );
+    FmlIoErrorNumber readPreSlab( const int *offsets, const int *sizes, long &position );
     
-    FmlIoErrorNumber readPreSlab( const int *offsets, const int *sizes );
+    //Leaves the stream at the start of the given outermost row, having read up to the given raw position.
+    FmlIoErrorNumber skipToRow( int nextOffset, long position );
     
-    FmlIoErrorNumber readSlice( const int *offsets, const int *sizes, int depth, BufferReader &reader );
+    //Reads every steps[i]'th value along each dimension, or a contiguous slab if steps is NULL.
+    template <class ValueReader> FmlIoErrorNumber readSlab( const int *offsets, const int *sizes, const int *steps, typename ValueReader::ValueType *valueBuffer );
     
-    FmlIoErrorNumber readSlab( const int *offsets, const int *sizes, BufferReader &reader );
+    template <class ValueReader> FmlIoErrorNumber readPointValues( int pointCount, const int *points, typename ValueReader::ValueType *valueBuffer );
     
     FmlIoErrorNumber skipPreamble();
 
@@ -93,13 +99,21 @@ public:
     virtual FmlIoErrorNumber readDoubleSlab( const int *offsets, const int *sizes, double *valueBuffer );
     
     virtual FmlIoErrorNumber readBooleanSlab( const int *offsets, const int *sizes, FmlBoolean *valueBuffer );
+    
+    virtual FmlIoErrorNumber readStridedSlab( ArrayDataValueType valueType, const int *offsets, const int *sizes, const int *strides, void *valueBuffer );
+    
+    virtual FmlIoErrorNumber readPoints( ArrayDataValueType valueType, int pointCount, const int *points, void *valueBuffer );
 
     virtual FmlIoErrorNumber close();
     
+    virtual bool isConcurrent();
+    
+    virtual FmlIoErrorNumber setAccessPattern( FieldmlAccessPattern pattern );
+    
     virtual ~TextArrayDataReader();
     
     static TextArrayDataReader *create( FieldmlIoContext *_context, const std::string root, FmlObjectHandle source,
-    	void *buffer);
+    	void *buffer, int64_t bufferLength );
 };
 
 
@@ -60,20 +60,14 @@ private:
     const FmlObjectHandle dataResource;
     const bool append;
     
-public:
-    SetStringResourceTask( FmlSessionHandle _sessionHandle, FmlObjectHandle _dataResource, bool _append ) :
-        sessionHandle( _sessionHandle ),
-        dataResource( _dataResource ),
-        append( _append )
-    {
-    }
+    //Only the first chunk of a non-appending write replaces the resource's data. The rest are appended to it.
+    bool started;
     
-
-    FmlIoErrorNumber onStreamClose( const std::string &info )
+    FmlIoErrorNumber store( const std::string &info )
     {
         FmlIoErrorNumber err;
         
-        if( append )
+        if( append || started )
         {
             err = Fieldml_AddInlineData( sessionHandle, dataResource, info.c_str(), info.size() );
         }
@@ -81,91 +75,78 @@ public:
         {
             err = Fieldml_SetInlineData( sessionHandle, dataResource, info.c_str(), info.size() );
         }
+        started = true;
         
         return err;
     }
     
+public:
+    SetStringResourceTask( FmlSessionHandle _sessionHandle, FmlObjectHandle _dataResource, bool _append ) :
+        sessionHandle( _sessionHandle ),
+        dataResource( _dataResource ),
+        append( _append ),
+        started( false )
+    {
+    }
     
-    virtual ~SetStringResourceTask() {}
-};
 
-/**
- * A pseudo-lambda class that removes the need to duplicate the slab and slice writing implementations.
- * No point in making this a template class, as we need to use a different method on stream depending on the type,
- * and there's no superclass functionality, so template specialization is redundant.
- */
-class BufferWriter
-{
-protected:
-    int bufferPos;
-    FieldmlOutputStream * const stream;
+    FmlIoErrorNumber onStreamFlush( const std::string &info )
+    {
+        return store( info );
+    }
     
-public:
-    BufferWriter( FieldmlOutputStream *_stream ) :
-        stream( _stream ), bufferPos( 0 ) {}
+
+    FmlIoErrorNumber onStreamClose( const std::string &info )
+    {
+        if( started && info.empty() )
+        {
+            return FML_IOERR_NO_ERROR;
+        }
+        
+        return store( info );
+    }
     
-    virtual ~BufferWriter() {}
     
-    virtual void write( int count ) = 0;
+    virtual ~SetStringResourceTask() {}
 };
 
-
-class DoubleBufferWriter :
-    public BufferWriter
+/**
+ * Compile-time value kernels for the slab writer. Each one hands a contiguous run of values to the stream in a single
+ * call.
+ * NOTE: FmlBoolean and int are the same C type, so these can't simply be selected by value type.
+ */
+class IntValueWriter
 {
-private:
-    const double * const buffer;
-    
 public:
-    DoubleBufferWriter( FieldmlOutputStream *_stream, const double *_buffer ) :
-        BufferWriter( _stream ), buffer( _buffer ) {}
+    typedef int ValueType;
     
-    void write( int count )
+    static FmlIoErrorNumber write( FieldmlOutputStream *stream, const int *buffer, int count )
     {
-        for( int i = 0; i < count; i++ )
-        {
-            stream->writeDouble( buffer[bufferPos++] );
-        }
+        return stream->writeInts( buffer, count );
     }
 };
 
 
-class IntBufferWriter :
-    public BufferWriter
+class DoubleValueWriter
 {
-private:
-    const int * const buffer;
-    
 public:
-    IntBufferWriter( FieldmlOutputStream *_stream, const int *_buffer ) :
-        BufferWriter( _stream ), buffer( _buffer ) {}
+    typedef double ValueType;
     
-    void write( int count )
+    static FmlIoErrorNumber write( FieldmlOutputStream *stream, const double *buffer, int count )
     {
-        for( int i = 0; i < count; i++ )
-        {
-            stream->writeInt( buffer[bufferPos++] );
-        }
+        return stream->writeDoubles( buffer, count );
     }
 };
 
 
-class BooleanBufferWriter :
-    public BufferWriter
+class BooleanValueWriter
 {
-private:
-    const FmlBoolean * const buffer;
-    
 public:
-    BooleanBufferWriter( FieldmlOutputStream *_stream, const FmlBoolean *_buffer ) :
-        BufferWriter( _stream ), buffer( _buffer ) {}
+    typedef FmlBoolean ValueType;
     
-    void write( int count )
+    static FmlIoErrorNumber write( FieldmlOutputStream *stream, const FmlBoolean *buffer, int count )
     {
-        for( int i = 0; i < count; i++ )
-        {
-            stream->writeBoolean( buffer[bufferPos++] );
-        }
+        return stream->writeBooleans( buffer, count );
     }
 };
 
@@ -185,13 +166,21 @@ TextArrayDataWriter *TextArrayDataWriter::create( FieldmlIoContext *context, str
     }
     Fieldml_FreeString(temp_string);
     
-    if( format != StringUtil::PLAIN_TEXT_NAME )
+    const bool compressed = ( format == StringUtil::PLAIN_TEXT_GZIP_NAME );
+    if( ( format != StringUtil::PLAIN_TEXT_NAME ) && !compressed )
     {
         context->setError( FML_IOERR_UNSUPPORTED );
         return writer;
     }
     
-    writer = new TextArrayDataWriter( context, root, source, handleType, append, sizes, rank );
+    //Compressed data can only live in files.
+    if( compressed && ( Fieldml_GetDataResourceType( context->getSession(), resource ) != FML_DATA_RESOURCE_HREF ) )
+    {
+        context->setError( FML_IOERR_UNSUPPORTED );
+        return writer;
+    }
+    
+    writer = new TextArrayDataWriter( context, root, source, handleType, append, sizes, rank, compressed );
     if( !writer->ok )
     {
         delete writer;
@@ -202,7 +191,8 @@ TextArrayDataWriter *TextArrayDataWriter::create( FieldmlIoContext *context, str
 }
 
 
-TextArrayDataWriter::TextArrayDataWriter( FieldmlIoContext *_context, const string root, FmlObjectHandle _source, FieldmlHandleType handleType, bool append, int *sizes, int _rank ) :
+TextArrayDataWriter::TextArrayDataWriter( FieldmlIoContext *_context, const string root, FmlObjectHandle _source, FieldmlHandleType handleType, bool append, int *sizes, int _rank,
+    bool compressed ) :
     ArrayDataWriter( _context ),
     source( _source ),
     sourceSizes( NULL ),
@@ -236,7 +226,21 @@ TextArrayDataWriter::TextArrayDataWriter( FieldmlIoContext *_context, const stri
         else
         {
             string path = StringUtil::makeFilename( root, href );
-            stream = FieldmlOutputStream::createTextFileStream( path, append );
+            
+            //Plain text files named *.gz are compressed too where possible, so that they're what their name says they are.
+            //Readers recognise compressed files by their contents, so either way they read back.
+            const string suffix = ".gz";
+            const bool gzipName = ( href.size() > suffix.size() ) && ( href.compare( href.size() - suffix.size(), suffix.size(), suffix ) == 0 );
+            
+            stream = NULL;
+            if( compressed || gzipName )
+            {
+                stream = FieldmlOutputStream::createGzipFileStream( path, append );
+            }
+            if( ( stream == NULL ) && !compressed )
+            {
+                stream = FieldmlOutputStream::createTextFileStream( path, append );
+            }
         }
         Fieldml_FreeString(temp_href);
     }
@@ -253,30 +257,13 @@ TextArrayDataWriter::TextArrayDataWriter( FieldmlIoContext *_context, const stri
 }
 
 
-FmlIoErrorNumber TextArrayDataWriter::writeSlice( const int *sizes, const int depth, BufferWriter &writer )
+template <class ValueWriter> FmlIoErrorNumber TextArrayDataWriter::writeSlab( const int *offsets, const int *sizes, const typename ValueWriter::ValueType *valueBuffer )
 {
-    if( depth == sourceRank - 1 )
-    {
-        writer.write( sizes[depth] );
-        return FML_IOERR_NO_ERROR;
-    }
-    
-    int err;
-    for( int i = 0; i < sizes[depth]; i++ )
+    if( closed )
     {
-        err = writeSlice( sizes, depth + 1, writer );
-        if( err != FML_IOERR_NO_ERROR )
-        {
-            return err;
-        }
+        return FML_IOERR_RESOURCE_CLOSED;
     }
     
-    return FML_IOERR_NO_ERROR;
-}
-    
-
-FmlIoErrorNumber TextArrayDataWriter::writeSlab( const int *offsets, const int *sizes, BufferWriter &writer )
-{
     if( offsets[0] != offset )
     {
         return context->setError( FML_IOERR_UNSUPPORTED );
@@ -295,7 +282,14 @@ FmlIoErrorNumber TextArrayDataWriter::writeSlab( const int *offsets, const int *
         }
     }
     
-    int err = writeSlice( sizes, 0, writer );
+    //Only whole outermost rows can be written, so the slab is one contiguous run of values.
+    int count = 1;
+    for( int i = 0; i < sourceRank; i++ )
+    {
+        count *= sizes[i];
+    }
+    
+    int err = ValueWriter::write( stream, valueBuffer, count );
 
     if( err == FML_IOERR_NO_ERROR )
     {
@@ -308,40 +302,19 @@ FmlIoErrorNumber TextArrayDataWriter::writeSlab( const int *offsets, const int *
 
 FmlIoErrorNumber TextArrayDataWriter::writeIntSlab( const int *offsets, const int *sizes, const int *valueBuffer )
 {
-    if( closed )
-    {
-        return FML_IOERR_RESOURCE_CLOSED;
-    }
-    
-    IntBufferWriter writer( stream, valueBuffer );
-    
-    return writeSlab( offsets, sizes, writer );
+    return writeSlab<IntValueWriter>( offsets, sizes, valueBuffer );
 }
 
 
 FmlIoErrorNumber TextArrayDataWriter::writeDoubleSlab( const int *offsets, const int *sizes, const double *valueBuffer )
 {
-    if( closed )
-    {
-        return FML_IOERR_RESOURCE_CLOSED;
-    }
-    
-    DoubleBufferWriter writer( stream, valueBuffer );
-    
-    return writeSlab( offsets, sizes, writer );
+    return writeSlab<DoubleValueWriter>( offsets, sizes, valueBuffer );
 }
 
 
 FmlIoErrorNumber TextArrayDataWriter::writeBooleanSlab( const int *offsets, const int *sizes, const FmlBoolean *valueBuffer )
 {
-    if( closed )
-    {
-        return FML_IOERR_RESOURCE_CLOSED;
-    }
-    
-    BooleanBufferWriter writer( stream, valueBuffer );
-    
-    return writeSlab( offsets, sizes, writer );
+    return writeSlab<BooleanValueWriter>( offsets, sizes, valueBuffer );
 }
 
 
@@ -45,8 +45,6 @@
 #include "ArrayDataWriter.h"
 #include "OutputStream.h"
 
-class BufferWriter;
-
 class TextArrayDataWriter :
     public ArrayDataWriter
 {
@@ -63,14 +61,13 @@ private:
     
     int offset;
 
-    FmlIoErrorNumber writeSlice( const int *sizes, const int depth, BufferWriter &writer );
-
-    FmlIoErrorNumber writeSlab( const int *offsets, const int *sizes, BufferWriter &writer );
+    template <class ValueWriter> FmlIoErrorNumber writeSlab( const int *offsets, const int *sizes, const typename ValueWriter::ValueType *valueBuffer );
 
 public:
     bool ok;
 
-    TextArrayDataWriter( FieldmlIoContext *_context, const std::string root, FmlObjectHandle _source, FieldmlHandleType handleType, bool append, int *sizes, int rank );
+    TextArrayDataWriter( FieldmlIoContext *_context, const std::string root, FmlObjectHandle _source, FieldmlHandleType handleType, bool append, int *sizes, int rank,
+        bool compressed );
     
     virtual FmlIoErrorNumber writeIntSlab( const int *offsets, const int *sizes, const int *valueBuffer );
     
@@ -0,0 +1,532 @@
+/* \file
+ * $Id$
+ * \author Caton Little
+ * \brief 
+ *
+ * \section LICENSE
+ *
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is FieldML
+ *
+ * The Initial Developer of the Original Code is Auckland Uniservices Ltd,
+ * Auckland, New Zealand. Portions created by the Initial Developer are
+ * Copyright (C) 2010 the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either the GNU General Public License Version 2 or later (the "GPL"), or
+ * the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "fieldml_api.h"
+#include "FieldmlIoApi.h"
+
+/**
+ * Times whole-array writes, whole-array reads and inner sub-slab reads of inline text arrays of rank 1 to 4.
+ * Every shape holds the same number of values, so the timings show the per-dimension overhead of the slab code.
+ * Also times exporting arrays to text files, and reports the resulting file sizes, and times random single-value reads
+ * from a chunked, compressed HDF5 array with HDF5's default caches and with tuned ones.
+ * Slab timings are given as the mean and standard deviation of the repeats, so that differences between builds can be
+ * told apart from run-to-run noise.
+ * Usage: fieldml_benchmark_slabs [repeats]
+ */
+
+static const int MAX_RANK = 4;
+
+static const int SHAPES[MAX_RANK][MAX_RANK] = {
+    { 262144, 0, 0, 0 },
+    { 512, 512, 0, 0 },
+    { 64, 64, 64, 0 },
+    { 32, 32, 16, 16 },
+};
+
+
+typedef std::chrono::steady_clock Clock;
+
+
+//Wall-clock time, as some writes are spread over several threads.
+static double elapsed( Clock::time_point start )
+{
+    return std::chrono::duration<double, std::milli>( Clock::now() - start ).count();
+}
+
+
+class Timings
+{
+private:
+    int count;
+    
+    double sum;
+    
+    double sumOfSquares;
+    
+public:
+    Timings() :
+        count( 0 ),
+        sum( 0 ),
+        sumOfSquares( 0 )
+    {
+    }
+    
+    void add( double time )
+    {
+        count++;
+        sum += time;
+        sumOfSquares += time * time;
+    }
+    
+    double mean() const
+    {
+        return ( count > 0 ) ? ( sum / count ) : 0;
+    }
+    
+    //The sample standard deviation.
+    double deviation() const
+    {
+        if( count < 2 )
+        {
+            return 0;
+        }
+        
+        double variance = ( sumOfSquares - ( sum * sum / count ) ) / ( count - 1 );
+        return ( variance > 0 ) ? sqrt( variance ) : 0;
+    }
+};
+
+
+static int benchmarkRank( int rank, int repeats )
+{
+    int sizes[MAX_RANK];
+    int offsets[MAX_RANK];
+    int subSizes[MAX_RANK];
+    int valueCount = 1;
+    int subCount = 1;
+    char name[64];
+    
+    for( int i = 0; i < rank; i++ )
+    {
+        sizes[i] = SHAPES[rank - 1][i];
+        offsets[i] = 0;
+        valueCount *= sizes[i];
+        
+        //The sub-slab takes the middle half of each inner dimension, so that every row needs skipping.
+        subSizes[i] = sizes[i];
+        if( i > 0 )
+        {
+            offsets[i] = sizes[i] / 4;
+            subSizes[i] = sizes[i] / 2;
+        }
+        subCount *= subSizes[i];
+    }
+    
+    double *values = (double*)malloc( valueCount * sizeof( double ) );
+    double *buffer = (double*)malloc( valueCount * sizeof( double ) );
+    for( int i = 0; i < valueCount; i++ )
+    {
+        values[i] = ( i * 0.5 ) - 1000.25;
+    }
+    
+    FmlSessionHandle session = Fieldml_Create( "benchmark_path", "benchmark" );
+    FmlObjectHandle realType = Fieldml_CreateContinuousType( session, "benchmark.real" );
+    FmlObjectHandle resource = Fieldml_CreateInlineDataResource( session, "benchmark.resource" );
+    sprintf( name, "benchmark.source.%d", rank );
+    FmlObjectHandle source = Fieldml_CreateArrayDataSource( session, name, resource, "1", rank );
+    Fieldml_SetArrayDataSourceRawSizes( session, source, sizes );
+    Fieldml_SetArrayDataSourceSizes( session, source, sizes );
+    
+    int zeroOffsets[MAX_RANK] = { 0, 0, 0, 0 };
+    int err = FML_IOERR_NO_ERROR;
+    
+    Timings writeTimes;
+    for( int r = 0; ( r < repeats ) && ( err == FML_IOERR_NO_ERROR ); r++ )
+    {
+        Clock::time_point start = Clock::now();
+        FmlWriterHandle writer = Fieldml_OpenArrayWriter( session, source, realType, 0, sizes, rank );
+        err = Fieldml_WriteDoubleSlab( writer, zeroOffsets, sizes, values );
+        Fieldml_CloseWriter( writer );
+        writeTimes.add( elapsed( start ) );
+    }
+    
+    Timings readTimes;
+    for( int r = 0; ( r < repeats ) && ( err == FML_IOERR_NO_ERROR ); r++ )
+    {
+        Clock::time_point start = Clock::now();
+        FmlReaderHandle reader = Fieldml_OpenReader( session, source );
+        err = Fieldml_ReadDoubleSlab( reader, zeroOffsets, sizes, buffer );
+        Fieldml_CloseReader( reader );
+        readTimes.add( elapsed( start ) );
+    }
+    
+    for( int i = 0; ( i < valueCount ) && ( err == FML_IOERR_NO_ERROR ); i++ )
+    {
+        if( buffer[i] != values[i] )
+        {
+            fprintf( stderr, "Rank %d: value %d read back as %.17g, expected %.17g\n", rank, i, buffer[i], values[i] );
+            err = FML_IOERR_READ_ERROR;
+        }
+    }
+    
+    Timings subReadTimes;
+    for( int r = 0; ( r < repeats ) && ( err == FML_IOERR_NO_ERROR ); r++ )
+    {
+        Clock::time_point start = Clock::now();
+        FmlReaderHandle reader = Fieldml_OpenReader( session, source );
+        err = Fieldml_ReadDoubleSlab( reader, offsets, subSizes, buffer );
+        Fieldml_CloseReader( reader );
+        subReadTimes.add( elapsed( start ) );
+    }
+    
+    Fieldml_Destroy( session );
+    free( values );
+    free( buffer );
+    
+    if( err != FML_IOERR_NO_ERROR )
+    {
+        fprintf( stderr, "Rank %d: failed with error %d\n", rank, err );
+        return 1;
+    }
+    
+    printf( "%4d %10d %8.2f +-%6.2f %8.2f +-%6.2f %10d %8.2f +-%6.2f\n", rank, valueCount, writeTimes.mean(), writeTimes.deviation(),
+        readTimes.mean(), readTimes.deviation(), subCount, subReadTimes.mean(), subReadTimes.deviation() );
+    
+    return 0;
+}
+
+
+static const int EXPORT_VALUES = 1048576;
+
+static const char *EXPORT_FILENAME = "benchmark_export.txt";
+
+
+static int benchmarkExport( const char *label, const double *values, int repeats )
+{
+    int sizes[1] = { EXPORT_VALUES };
+    int offsets[1] = { 0 };
+    
+    FmlSessionHandle session = Fieldml_Create( ".", "benchmark" );
+    FmlObjectHandle realType = Fieldml_CreateContinuousType( session, "benchmark.real" );
+    FmlObjectHandle resource = Fieldml_CreateHrefDataResource( session, "benchmark.resource", "PLAIN_TEXT", EXPORT_FILENAME );
+    FmlObjectHandle source = Fieldml_CreateArrayDataSource( session, "benchmark.source", resource, "1", 1 );
+    Fieldml_SetArrayDataSourceRawSizes( session, source, sizes );
+    Fieldml_SetArrayDataSourceSizes( session, source, sizes );
+    
+    int err = FML_IOERR_NO_ERROR;
+    Clock::time_point start = Clock::now();
+    for( int r = 0; ( r < repeats ) && ( err == FML_IOERR_NO_ERROR ); r++ )
+    {
+        FmlWriterHandle writer = Fieldml_OpenArrayWriter( session, source, realType, 0, sizes, 1 );
+        err = Fieldml_WriteDoubleSlab( writer, offsets, sizes, values );
+        if( err == FML_IOERR_NO_ERROR )
+        {
+            err = Fieldml_CloseWriter( writer );
+        }
+    }
+    double writeTime = elapsed( start ) / repeats;
+    
+    long fileSize = 0;
+    FILE *file = fopen( EXPORT_FILENAME, "rb" );
+    if( file != NULL )
+    {
+        fseek( file, 0, SEEK_END );
+        fileSize = ftell( file );
+        fclose( file );
+    }
+    
+    double *buffer = (double*)malloc( EXPORT_VALUES * sizeof( double ) );
+    if( err == FML_IOERR_NO_ERROR )
+    {
+        FmlReaderHandle reader = Fieldml_OpenReader( session, source );
+        err = Fieldml_ReadDoubleSlab( reader, offsets, sizes, buffer );
+        Fieldml_CloseReader( reader );
+    }
+    for( int i = 0; ( i < EXPORT_VALUES ) && ( err == FML_IOERR_NO_ERROR ); i++ )
+    {
+        if( memcmp( &buffer[i], &values[i], sizeof( double ) ) != 0 )
+        {
+            fprintf( stderr, "%s: value %d read back as %.17g, expected %.17g\n", label, i, buffer[i], values[i] );
+            err = FML_IOERR_READ_ERROR;
+        }
+    }
+    
+    free( buffer );
+    Fieldml_Destroy( session );
+    remove( EXPORT_FILENAME );
+    
+    if( err != FML_IOERR_NO_ERROR )
+    {
+        fprintf( stderr, "%s: failed with error %d\n", label, err );
+        return 1;
+    }
+    
+    printf( "%-10s %10d %12.2f %12.2f %12ld\n", label, EXPORT_VALUES, writeTime, ( fileSize / 1048576.0 ) / ( writeTime / 1000.0 ), fileSize );
+    
+    return 0;
+}
+
+
+static const int HDF5_ROWS = 1024;
+
+static const int HDF5_COLUMNS = 1024;
+
+static const int HDF5_READS = 4000;
+
+static const char *HDF5_FILENAME = "benchmark_cache.h5";
+
+
+static int benchmarkHdf5Cache( const char *label, const FieldmlHdf5CacheOptions *options, int repeats )
+{
+    int sizes[2] = { HDF5_ROWS, HDF5_COLUMNS };
+    int pointSizes[2] = { 1, 1 };
+    
+    FmlSessionHandle session = Fieldml_Create( ".", "benchmark" );
+    FmlObjectHandle resource = Fieldml_CreateHrefDataResource( session, "benchmark.resource", "HDF5", HDF5_FILENAME );
+    FmlObjectHandle source = Fieldml_CreateArrayDataSource( session, "benchmark.source", resource, "values", 2 );
+    Fieldml_SetArrayDataSourceRawSizes( session, source, sizes );
+    Fieldml_SetArrayDataSourceSizes( session, source, sizes );
+    Fieldml_SetHdf5CacheOptions( session, options );
+    
+    int err = FML_IOERR_NO_ERROR;
+    Clock::time_point start = Clock::now();
+    for( int r = 0; ( r < repeats ) && ( err == FML_IOERR_NO_ERROR ); r++ )
+    {
+        //The same points every time, spread over every chunk.
+        unsigned int seed = 12345;
+        FmlReaderHandle reader = Fieldml_OpenReader( session, source );
+        for( int i = 0; ( i < HDF5_READS ) && ( err == FML_IOERR_NO_ERROR ); i++ )
+        {
+            seed = seed * 1103515245 + 12345;
+            int offsets[2] = { (int)( ( seed >> 8 ) % HDF5_ROWS ), (int)( ( seed >> 20 ) % HDF5_COLUMNS ) };
+            double value;
+            err = Fieldml_ReadDoubleSlab( reader, offsets, pointSizes, &value );
+            if( ( err == FML_IOERR_NO_ERROR ) && ( value != offsets[0] * HDF5_COLUMNS + offsets[1] ) )
+            {
+                fprintf( stderr, "%s: value at %d, %d read back as %.17g\n", label, offsets[0], offsets[1], value );
+                err = FML_IOERR_READ_ERROR;
+            }
+        }
+        Fieldml_CloseReader( reader );
+    }
+    double readTime = elapsed( start ) / repeats;
+    
+    Fieldml_Destroy( session );
+    
+    if( err != FML_IOERR_NO_ERROR )
+    {
+        fprintf( stderr, "%s: failed with error %d\n", label, err );
+        return 1;
+    }
+    
+    printf( "%-10s %10d %12.2f %12.0f\n", label, HDF5_READS, readTime, HDF5_READS / ( readTime / 1000.0 ) );
+    
+    return 0;
+}
+
+
+static const int HDF5_REOPENS = 2000;
+
+
+/**
+ * Opens a reader, reads a value and closes the reader again, over and over, as applications stepping through arrays
+ * one at a time do. Idle files and datasets are kept open, so only the first open actually opens anything.
+ */
+static int benchmarkHdf5Reopen( int repeats )
+{
+    int sizes[2] = { HDF5_ROWS, HDF5_COLUMNS };
+    int pointSizes[2] = { 1, 1 };
+    
+    FmlSessionHandle session = Fieldml_Create( ".", "benchmark" );
+    FmlObjectHandle resource = Fieldml_CreateHrefDataResource( session, "benchmark.resource", "HDF5", HDF5_FILENAME );
+    FmlObjectHandle source = Fieldml_CreateArrayDataSource( session, "benchmark.source", resource, "values", 2 );
+    Fieldml_SetArrayDataSourceRawSizes( session, source, sizes );
+    Fieldml_SetArrayDataSourceSizes( session, source, sizes );
+    
+    int err = FML_IOERR_NO_ERROR;
+    Timings reopenTimes;
+    for( int r = 0; ( r < repeats ) && ( err == FML_IOERR_NO_ERROR ); r++ )
+    {
+        Clock::time_point start = Clock::now();
+        for( int i = 0; ( i < HDF5_REOPENS ) && ( err == FML_IOERR_NO_ERROR ); i++ )
+        {
+            int offsets[2] = { i % HDF5_ROWS, ( i * 7 ) % HDF5_COLUMNS };
+            double value;
+            FmlReaderHandle reader = Fieldml_OpenReader( session, source );
+            err = Fieldml_ReadDoubleSlab( reader, offsets, pointSizes, &value );
+            Fieldml_CloseReader( reader );
+            if( ( err == FML_IOERR_NO_ERROR ) && ( value != offsets[0] * HDF5_COLUMNS + offsets[1] ) )
+            {
+                fprintf( stderr, "reopen: value at %d, %d read back as %.17g\n", offsets[0], offsets[1], value );
+                err = FML_IOERR_READ_ERROR;
+            }
+        }
+        reopenTimes.add( elapsed( start ) );
+    }
+    
+    Fieldml_Destroy( session );
+    
+    if( err != FML_IOERR_NO_ERROR )
+    {
+        fprintf( stderr, "reopen: failed with error %d\n", err );
+        return 1;
+    }
+    
+    printf( "\n%-10s %10s %18s %12s\n", "hdf5", "opens", "ms", "opens/s" );
+    printf( "%-10s %10d %8.2f +-%6.2f %12.0f\n", "reopen", HDF5_REOPENS, reopenTimes.mean(), reopenTimes.deviation(),
+        HDF5_REOPENS / ( reopenTimes.mean() / 1000.0 ) );
+    
+    return 0;
+}
+
+
+static int benchmarkHdf5Caches( int repeats )
+{
+    int sizes[2] = { HDF5_ROWS, HDF5_COLUMNS };
+    int offsets[2] = { 0, 0 };
+    int chunkSizes[2] = { 256, 256 };
+    
+    double *values = (double*)malloc( HDF5_ROWS * HDF5_COLUMNS * sizeof( double ) );
+    for( int i = 0; i < HDF5_ROWS * HDF5_COLUMNS; i++ )
+    {
+        values[i] = i;
+    }
+    
+    //Sixteen 512KB chunks, of which HDF5's default 1MB chunk cache holds at most two.
+    FieldmlArrayWriterOptions writerOptions;
+    writerOptions.chunkSizes = chunkSizes;
+    writerOptions.deflateLevel = 1;
+    writerOptions.shuffle = 1;
+    writerOptions.extendable = 0;
+    writerOptions.storageBits = 0;
+    
+    //The file has paged file space, so that it can be page buffered.
+    writerOptions.pagedFileSpace = 1;
+    
+    FieldmlHdf5CacheOptions paged = { 0, 0, -1, 0, 16 * 1024 * 1024 };
+    
+    FmlSessionHandle session = Fieldml_Create( ".", "benchmark" );
+    FmlObjectHandle realType = Fieldml_CreateContinuousType( session, "benchmark.real" );
+    FmlObjectHandle resource = Fieldml_CreateHrefDataResource( session, "benchmark.resource", "HDF5", HDF5_FILENAME );
+    FmlObjectHandle source = Fieldml_CreateArrayDataSource( session, "benchmark.source", resource, "values", 2 );
+    
+    FmlWriterHandle writer = Fieldml_OpenArrayWriterWithOptions( session, source, realType, 0, sizes, 2, &writerOptions );
+    int err = Fieldml_WriteDoubleSlab( writer, offsets, sizes, values );
+    Fieldml_CloseWriter( writer );
+    Fieldml_Destroy( session );
+    free( values );
+    
+    if( err != FML_IOERR_NO_ERROR )
+    {
+        fprintf( stderr, "HDF5 cache: write failed with error %d\n", err );
+        remove( HDF5_FILENAME );
+        return 1;
+    }
+    
+    //Enough for every chunk, with a prime number of slots about a hundred times the chunk count.
+    FieldmlHdf5CacheOptions chunked = { 16 * 1024 * 1024, 1601, -1, 0, 0 };
+    FieldmlHdf5CacheOptions tuned = { 16 * 1024 * 1024, 1601, -1, 4 * 1024 * 1024, 16 * 1024 * 1024 };
+    
+    printf( "\n%-10s %10s %12s %12s\n", "hdf5 cache", "reads", "ms", "reads/s" );
+    int failures = 0;
+    failures += benchmarkHdf5Cache( "default", NULL, repeats );
+    failures += benchmarkHdf5Cache( "paged", &paged, repeats );
+    failures += benchmarkHdf5Cache( "chunked", &chunked, repeats );
+    failures += benchmarkHdf5Cache( "tuned", &tuned, repeats );
+    
+    failures += benchmarkHdf5Reopen( repeats );
+    
+    remove( HDF5_FILENAME );
+    
+    return failures;
+}
+
+
+int main( int argc, char **argv )
+{
+    int repeats = 5;
+    if( argc > 1 )
+    {
+        repeats = atoi( argv[1] );
+        if( repeats <= 0 )
+        {
+            repeats = 1;
+        }
+    }
+    
+    printf( "Mean and standard deviation of milliseconds over %d repeats\n", repeats );
+    printf( "%4s %10s %18s %18s %10s %18s\n", "rank", "values", "write", "read", "subvalues", "sub read" );
+    
+    int failures = 0;
+    for( int rank = 1; rank <= MAX_RANK; rank++ )
+    {
+        failures += benchmarkRank( rank, repeats );
+    }
+    
+    //Exactly representable values, short decimal values that aren't exactly representable, and values that need all
+    //seventeen significant digits.
+    double *values = (double*)malloc( EXPORT_VALUES * sizeof( double ) );
+    
+    printf( "\n%-10s %10s %12s %12s %12s\n", "export", "values", "ms", "MB/s", "bytes" );
+    for( int i = 0; i < EXPORT_VALUES; i++ )
+    {
+        values[i] = ( i * 0.125 ) - 1000.5;
+    }
+    failures += benchmarkExport( "binary", values, repeats );
+    
+    for( int i = 0; i < EXPORT_VALUES; i++ )
+    {
+        values[i] = ( i / 100.0 ) - 1000.0;
+    }
+    failures += benchmarkExport( "decimal", values, repeats );
+    
+    for( int i = 0; i < EXPORT_VALUES; i++ )
+    {
+        values[i] = sin( i * 0.001 ) * 1000.0;
+    }
+    failures += benchmarkExport( "full", values, repeats );
+    
+    //The same values formatted on a given number of threads. Extra threads only help with as many processors.
+    const int threadCounts[3] = { 1, 2, 4 };
+    for( int i = 0; i < 3; i++ )
+    {
+        char label[32];
+        sprintf( label, "full x%d", threadCounts[i] );
+        Fieldml_SetTextWriterThreads( threadCounts[i] );
+        failures += benchmarkExport( label, values, repeats );
+    }
+    Fieldml_SetTextWriterThreads( 0 );
+    
+    free( values );
+    
+    if( Fieldml_IsArrayFormatRegistered( "HDF5" ) )
+    {
+        failures += benchmarkHdf5Caches( repeats );
+    }
+    
+    return failures;
+}
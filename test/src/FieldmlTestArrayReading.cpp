@@ -42,6 +42,8 @@
 #include <cstring>
 #include <sstream>
 #include <cstdlib>
+#include <cstdio>
+#include <vector>
 
 #include "fieldml_api.h"
 #include "FieldmlIoApi.h"
@@ -177,125 +179,3232 @@ SIMPLE_TEST( FieldmlDataArrayReadTest )
 
 
 /**
- * Ensure that newly created HDF5 data sources have the correct state.
+ * Ensure that values written to inline text arrays read back exactly.
  */
-SIMPLE_TEST( FieldmlDataHdf5ArrayCreateTest )
+SIMPLE_TEST( FieldmlDataTextArrayRoundTripTest )
 {
-    const int MAX_STRLEN = 255;
-    char *strbuf = (char*)malloc(MAX_STRLEN);
+    FmlSessionHandle session = Fieldml_Create( "test_path", "test" );
+    Fieldml_SetDebug( session, 0 );
+    SIMPLE_ASSERT( session != FML_INVALID_HANDLE );
+    
+    FmlObjectHandle realType = Fieldml_CreateContinuousType( session, "test.real" );
+    FmlObjectHandle resource = Fieldml_CreateInlineDataResource( session, "test.resource" );
+
+    const int count = 10;
+    FmlObjectHandle source = Fieldml_CreateArrayDataSource( session, "test.source", resource, "1", 1 );
+    int sizes[1] = { count };
+    int offsets[1] = { 0 };
+    Fieldml_SetArrayDataSourceRawSizes( session, source, sizes );
+    Fieldml_SetArrayDataSourceSizes( session, source, sizes );
+    
+    const double values[count] = { 0.1, 1.0 / 3.0, -2.5e-5, 1e22, 1.7976931348623157e308, 4.9406564584124654e-324,
+        123456789012345678.0, -1234.5, 0.0, 9007199254740993.0 };
+    
+    FmlWriterHandle writer = Fieldml_OpenArrayWriter( session, source, realType, 0, sizes, 1 );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != writer );
+    int err = Fieldml_WriteDoubleSlab( writer, offsets, sizes, values );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    Fieldml_CloseWriter( writer );
+    
+    double buffer[count];
+    FmlReaderHandle reader = Fieldml_OpenReader( session, source );
+    err = Fieldml_ReadDoubleSlab( reader, offsets, sizes, buffer );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    Fieldml_CloseReader( reader );
+    
+    for( int i = 0; i < count; i++ )
+    {
+        SIMPLE_ASSERT( memcmp( &values[i], &buffer[i], sizeof( double ) ) == 0 );
+    }
+    
+    const int intValues[count] = { 0, -1, 7, 10, 99, 100, -123456, 2147483647, -2147483647 - 1, 1000000000 };
+    FmlObjectHandle ensembleType = Fieldml_CreateEnsembleType( session, "test.ensemble" );
+    writer = Fieldml_OpenArrayWriter( session, source, ensembleType, 0, sizes, 1 );
+    err = Fieldml_WriteIntSlab( writer, offsets, sizes, intValues );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    Fieldml_CloseWriter( writer );
+    
+    int intBuffer[count];
+    reader = Fieldml_OpenReader( session, source );
+    err = Fieldml_ReadIntSlab( reader, offsets, sizes, intBuffer );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    Fieldml_CloseReader( reader );
+    
+    for( int i = 0; i < count; i++ )
+    {
+        SIMPLE_ASSERT_EQUALS( intValues[i], intBuffer[i] );
+    }
+    
+    Fieldml_Destroy( session );
+}
+
 
+/**
+ * Ensure that row iterators deliver every outermost row of an inline text array, in order.
+ */
+SIMPLE_TEST( FieldmlDataArrayRowIteratorTest )
+{
     FmlSessionHandle session = Fieldml_Create( "test_path", "test" );
     Fieldml_SetDebug( session, 0 );
     SIMPLE_ASSERT( session != FML_INVALID_HANDLE );
     
-    FmlObjectHandle resource = Fieldml_CreateHrefDataResource( session, "test.resource", "HDF5", ".\\input\\I16BE.h5" );
+    FmlObjectHandle resource = Fieldml_CreateInlineDataResource( session, "test.resource" );
 
     const int rank = 3;
-    FmlObjectHandle source = Fieldml_CreateArrayDataSource( session, "test.source", resource, "ArrayReadTestData", rank );
+    const int rowSize = 12;
+    FmlObjectHandle source = Fieldml_CreateArrayDataSource( session, "test.source", resource, "1", rank );
     
-    int err = Fieldml_AddInlineData( session, resource, "foo", 3 );
-    SIMPLE_ASSERT( FML_ERR_NO_ERROR != err );
+    int sizes[rank] = { 3, 3, 4 };
+    Fieldml_SetArrayDataSourceRawSizes( session, source, sizes );
+    const string rawData = "1 2 3 4\n5 6 7 8\n9 10 11 12\n\n13 14 15 16\n17 18 19 20\n21 22 23 24\n\n25 26 27 28\n29 30 31 32\n33 34 35 36\n";
+    int err = Fieldml_SetInlineData( session, resource, rawData.c_str(), rawData.length() );
+    SIMPLE_ASSERT_EQUALS( FML_ERR_NO_ERROR, err );
     
-    Fieldml_CopyDataResourceFormat( session, resource, strbuf, MAX_STRLEN );
-    SIMPLE_ASSERT_EQUALS( "HDF5", strbuf );
+    FmlReaderHandle reader = Fieldml_OpenRowIterator( session, source );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != reader );
     
-    int testRank = Fieldml_GetArrayDataSourceRank( session, source );
-    SIMPLE_ASSERT_EQUALS( rank, testRank );
+    double buffer[2 * rowSize];
+    int rows = Fieldml_ReadNextRows( reader, 2, buffer );
+    SIMPLE_ASSERT_EQUALS( 2, rows );
+    for( int i = 0; i < 2 * rowSize; i++ )
+    {
+        SIMPLE_ASSERT_EQUALS( i + 1.0, buffer[i] );
+    }
     
-    int length = Fieldml_CopyArrayDataSourceLocation( session, source, strbuf, MAX_STRLEN );
-    SIMPLE_ASSERT_EQUALS( 17, length );
-    SIMPLE_ASSERT_EQUALS( "ArrayReadTestData", strbuf );
+    rows = Fieldml_ReadNextRows( reader, 2, buffer );
+    SIMPLE_ASSERT_EQUALS( 1, rows );
+    for( int i = 0; i < rowSize; i++ )
+    {
+        SIMPLE_ASSERT_EQUALS( i + 25.0, buffer[i] );
+    }
     
-    memset( strbuf, 0, MAX_STRLEN );
-    int llength = Fieldml_CopyInlineData( session, resource, strbuf, MAX_STRLEN, 0 );
-    SIMPLE_ASSERT_EQUALS( -1, llength );
+    rows = Fieldml_ReadNextRows( reader, 2, buffer );
+    SIMPLE_ASSERT_EQUALS( 0, rows );
+    
+    rows = Fieldml_ReadNextRows( reader, 0, buffer );
+    SIMPLE_ASSERT_EQUALS( -1, rows );
+    
+    Fieldml_CloseReader( reader );
+    
+    //Plain readers can't be used as row iterators.
+    reader = Fieldml_OpenReader( session, source );
+    int intBuffer[rowSize];
+    rows = Fieldml_ReadNextIntRows( reader, 1, intBuffer );
+    SIMPLE_ASSERT_EQUALS( -1, rows );
+    Fieldml_CloseReader( reader );
     
     Fieldml_Destroy( session );
 }
 
 
 /**
- * Ensure that various kinds of reads work with arrays based on inline text resources.
+ * Ensure that inline text arrays too large to be buffered in one piece are written and read back intact.
  */
-SIMPLE_TEST( FieldmlDataHdf5ArrayReadTest )
+SIMPLE_TEST( FieldmlDataTextArrayLargeWriteTest )
 {
     FmlSessionHandle session = Fieldml_Create( "test_path", "test" );
     Fieldml_SetDebug( session, 0 );
     SIMPLE_ASSERT( session != FML_INVALID_HANDLE );
     
-    FmlObjectHandle resource = Fieldml_CreateHrefDataResource( session, "test.resource", "HDF5", "./input/I16BE.h5" );
+    FmlObjectHandle ensembleType = Fieldml_CreateEnsembleType( session, "test.ensemble" );
+    FmlObjectHandle resource = Fieldml_CreateInlineDataResource( session, "test.resource" );
+    
+    //Existing data must be replaced, not appended to.
+    const string oldData = "99 99 99 99\n";
+    int err = Fieldml_SetInlineData( session, resource, oldData.c_str(), oldData.length() );
+    SIMPLE_ASSERT_EQUALS( FML_ERR_NO_ERROR, err );
 
-    const int rank = 3;
-    const int totalSize = 60;
-    FmlObjectHandle source = Fieldml_CreateArrayDataSource( session, "test.source", resource, "ArrayReadTestData", rank );
+    const int rank = 2;
+    const int rowCount = 200000;
+    const int rowSize = 4;
+    const int blockRows = 1000;
+    FmlObjectHandle source = Fieldml_CreateArrayDataSource( session, "test.source", resource, "1", rank );
+    int sizes[rank] = { rowCount, rowSize };
+    Fieldml_SetArrayDataSourceRawSizes( session, source, sizes );
+    Fieldml_SetArrayDataSourceSizes( session, source, sizes );
+    
+    vector<int> values( rowCount * rowSize );
+    for( int i = 0; i < rowCount * rowSize; i++ )
+    {
+        values[i] = i;
+    }
+    
+    FmlWriterHandle writer = Fieldml_OpenArrayWriter( session, source, ensembleType, 0, sizes, rank );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != writer );
+    int offsets[rank] = { 0, 0 };
+    int blockSizes[rank] = { blockRows, rowSize };
+    for( int row = 0; row < rowCount; row += blockRows )
+    {
+        offsets[0] = row;
+        err = Fieldml_WriteIntSlab( writer, offsets, blockSizes, &values[row * rowSize] );
+        SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    }
+    Fieldml_CloseWriter( writer );
+    
+    vector<int> buffer( rowCount * rowSize, -1 );
+    offsets[0] = 0;
+    FmlReaderHandle reader = Fieldml_OpenReader( session, source );
+    err = Fieldml_ReadIntSlab( reader, offsets, sizes, &buffer[0] );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    Fieldml_CloseReader( reader );
+    
+    SIMPLE_ASSERT( values == buffer );
+    
+    //A single slab whose text runs to several megabytes is handed over in pieces too.
+    for( int i = 0; i < rowCount * rowSize; i++ )
+    {
+        values[i] = rowCount * rowSize - i;
+    }
+    writer = Fieldml_OpenArrayWriter( session, source, ensembleType, 0, sizes, rank );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != writer );
+    err = Fieldml_WriteIntSlab( writer, offsets, sizes, &values[0] );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    Fieldml_CloseWriter( writer );
+    
+    int dataLength = Fieldml_GetInlineDataLength( session, resource );
+    SIMPLE_ASSERT( dataLength > 4 * 1024 * 1024 );
+    
+    buffer.assign( rowCount * rowSize, -1 );
+    reader = Fieldml_OpenReader( session, source );
+    err = Fieldml_ReadIntSlab( reader, offsets, sizes, &buffer[0] );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    Fieldml_CloseReader( reader );
+    
+    SIMPLE_ASSERT( values == buffer );
+    
+    Fieldml_Destroy( session );
+}
 
-    int readOffsets[rank] = { 0, 0, 0 };
-    int readSizes[rank] = { 3, 4, 5 };
-    double buffer[totalSize];
-    int fakeBuffer[1];
+
+/**
+ * Ensure that open readers keep reading the inline data they were opened on, even if the resource is changed.
+ */
+SIMPLE_TEST( FieldmlDataArrayInlineViewTest )
+{
+    FmlSessionHandle session = Fieldml_Create( "test_path", "test" );
+    Fieldml_SetDebug( session, 0 );
+    SIMPLE_ASSERT( session != FML_INVALID_HANDLE );
     
-    FmlObjectHandle reader = Fieldml_OpenReader( session, source );
+    FmlObjectHandle resource = Fieldml_CreateInlineDataResource( session, "test.resource" );
+
+    const int count = 4;
+    FmlObjectHandle source = Fieldml_CreateArrayDataSource( session, "test.source", resource, "1", 1 );
+    int sizes[1] = { count };
+    int offsets[1] = { 0 };
+    Fieldml_SetArrayDataSourceRawSizes( session, source, sizes );
+    
+    const string oldData = "1 2 3 4\n";
+    int err = Fieldml_SetInlineData( session, resource, oldData.c_str(), oldData.length() );
+    SIMPLE_ASSERT_EQUALS( FML_ERR_NO_ERROR, err );
+    
+    int length = 0;
+    const char *view = Fieldml_OpenInlineDataView( session, resource, &length );
+    SIMPLE_ASSERT( view != NULL );
+    SIMPLE_ASSERT_EQUALS( (int)oldData.length(), length );
+    SIMPLE_ASSERT( memcmp( oldData.c_str(), view, length ) == 0 );
+    
+    FmlReaderHandle reader = Fieldml_OpenReader( session, source );
     SIMPLE_ASSERT( FML_INVALID_HANDLE != reader );
     
-    FmlErrorNumber err = Fieldml_ReadIntSlab( reader, readOffsets, readSizes, fakeBuffer );
-    SIMPLE_ASSERT( FML_ERR_NO_ERROR != err );
+    const string newData = "5 6 7 8\n";
+    err = Fieldml_SetInlineData( session, resource, newData.c_str(), newData.length() );
+    SIMPLE_ASSERT_EQUALS( FML_ERR_NO_ERROR, err );
+    err = Fieldml_AddInlineData( session, resource, newData.c_str(), newData.length() );
+    SIMPLE_ASSERT_EQUALS( FML_ERR_NO_ERROR, err );
     
-    for( int i = 0; i < totalSize; i++ ) buffer[i] = -1;
-    err = Fieldml_ReadDoubleSlab( reader, readOffsets, readSizes, buffer );
+    SIMPLE_ASSERT( memcmp( oldData.c_str(), view, length ) == 0 );
+    err = Fieldml_CloseInlineDataView( session, resource, view );
     SIMPLE_ASSERT_EQUALS( FML_ERR_NO_ERROR, err );
     
-    double expected;
-    for( int i = 0; i < totalSize; i++ )
+    int buffer[count];
+    err = Fieldml_ReadIntSlab( reader, offsets, sizes, buffer );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    for( int i = 0; i < count; i++ )
     {
-        int x = ( ( i % 60 ) / 20 ) + readOffsets[0];
-        int y = ( ( i % 20 ) / 5 ) + readOffsets[1];
-        int z = ( ( i % 5 ) / 1 ) + readOffsets[2];
-        
-        expected = ( 100.0 * x ) + ( 10.0 * y ) + ( 1.0 * z );
-        
-        SIMPLE_ASSERT_EQUALS( expected, buffer[i] );
+        SIMPLE_ASSERT_EQUALS( i + 1, buffer[i] );
+    }
+    Fieldml_CloseReader( reader );
+    
+    err = Fieldml_CloseInlineDataView( session, resource, view );
+    SIMPLE_ASSERT( FML_ERR_NO_ERROR != err );
+    
+    reader = Fieldml_OpenReader( session, source );
+    err = Fieldml_ReadIntSlab( reader, offsets, sizes, buffer );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    for( int i = 0; i < count; i++ )
+    {
+        SIMPLE_ASSERT_EQUALS( i + 5, buffer[i] );
+    }
+    Fieldml_CloseReader( reader );
+    
+    //Caller-supplied buffers are read in place.
+    char userData[] = "9 10 11 12\n";
+    reader = Fieldml_OpenReaderWithBuffer( session, source, userData );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != reader );
+    err = Fieldml_ReadIntSlab( reader, offsets, sizes, buffer );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    for( int i = 0; i < count; i++ )
+    {
+        SIMPLE_ASSERT_EQUALS( i + 9, buffer[i] );
     }
+    Fieldml_CloseReader( reader );
+    
+    Fieldml_Destroy( session );
+}
 
-    readOffsets[0] = 1;
-    readSizes[0] = 1;
+
+/**
+ * Ensure that lazily loaded inline data is read from the document on demand, and matches what a full load reads.
+ */
+SIMPLE_TEST( FieldmlDataArrayLazyInlineTest )
+{
+    const char *filename = "lazy_inline_test.xml";
     
-    for( int i = 0; i < totalSize; i++ ) buffer[i] = -1;
-    err = Fieldml_ReadDoubleSlab( reader, readOffsets, readSizes, buffer );
+    FmlSessionHandle session = Fieldml_Create( "test_path", "test" );
+    Fieldml_SetDebug( session, 0 );
+    SIMPLE_ASSERT( session != FML_INVALID_HANDLE );
+    
+    const int rank = 2;
+    int sizes[rank] = { 2, 4 };
+    int offsets[rank] = { 0, 0 };
+    FmlObjectHandle resource = Fieldml_CreateInlineDataResource( session, "test.resource" );
+    FmlObjectHandle source = Fieldml_CreateArrayDataSource( session, "test.source", resource, "1", rank );
+    Fieldml_SetArrayDataSourceRawSizes( session, source, sizes );
+    Fieldml_SetArrayDataSourceSizes( session, source, sizes );
+    const string rawData = "1 2 3 4\n5 6 7 8\n";
+    Fieldml_SetInlineData( session, resource, rawData.c_str(), rawData.length() );
+    
+    //Text that needs decoding.
+    FmlObjectHandle markupResource = Fieldml_CreateInlineDataResource( session, "test.markup_resource" );
+    Fieldml_CreateArrayDataSource( session, "test.markup_source", markupResource, "1", 1 );
+    const string markupData = "a & b < c\r\nd\n";
+    Fieldml_SetInlineData( session, markupResource, markupData.c_str(), markupData.length() );
+    
+    int err = Fieldml_WriteFile( session, filename );
     SIMPLE_ASSERT_EQUALS( FML_ERR_NO_ERROR, err );
+    Fieldml_Destroy( session );
     
-    for( int i = 0; i < 20; i++ )
+    FmlSessionHandle fullSession = Fieldml_CreateFromFile( filename );
+    SIMPLE_ASSERT_EQUALS( FML_ERR_NO_ERROR, Fieldml_GetLastError( fullSession ) );
+    session = Fieldml_CreateFromFileLazily( filename );
+    SIMPLE_ASSERT_EQUALS( FML_ERR_NO_ERROR, Fieldml_GetLastError( session ) );
+    Fieldml_SetDebug( session, 0 );
+    
+    const char *names[2] = { "test.resource", "test.markup_resource" };
+    for( int i = 0; i < 2; i++ )
     {
-        int x = ( ( i % 20 ) / 20 ) + readOffsets[0];
-        int y = ( ( i % 20 ) / 5 ) + readOffsets[1];
-        int z = ( ( i % 5 ) / 1 ) + readOffsets[2];
-        
-        expected = ( 100.0 * x ) + ( 10.0 * y ) + ( 1.0 * z );
-        
-        SIMPLE_ASSERT_EQUALS( expected, buffer[i] );
+        char *expected = Fieldml_GetInlineData( fullSession, Fieldml_GetObjectByName( fullSession, names[i] ) );
+        char *actual = Fieldml_GetInlineData( session, Fieldml_GetObjectByName( session, names[i] ) );
+        SIMPLE_ASSERT( ( expected != NULL ) && ( actual != NULL ) );
+        SIMPLE_ASSERT_EQUALS( string( expected ), string( actual ) );
+        Fieldml_FreeString( expected );
+        Fieldml_FreeString( actual );
     }
+    Fieldml_Destroy( fullSession );
     
-    readOffsets[0] = 0;
-    readSizes[0] = 2;
-    readOffsets[1] = 1;
-    readSizes[1] = 2;
-    readOffsets[2] = 2;
-    readSizes[2] = 1;
-    for( int i = 0; i < totalSize; i++ ) buffer[i] = -1;
-    err = Fieldml_ReadDoubleSlab( reader, readOffsets, readSizes, buffer );
-    SIMPLE_ASSERT_EQUALS( FML_ERR_NO_ERROR, err );
+    FmlReaderHandle reader = Fieldml_OpenReader( session, Fieldml_GetObjectByName( session, "test.source" ) );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != reader );
+    int buffer[8];
+    err = Fieldml_ReadIntSlab( reader, offsets, sizes, buffer );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    for( int i = 0; i < 8; i++ )
+    {
+        SIMPLE_ASSERT_EQUALS( i + 1, buffer[i] );
+    }
+    Fieldml_CloseReader( reader );
+    
+    Fieldml_Destroy( session );
+    remove( filename );
+}
 
-    for( int i = 0; i < 4; i++ )
+
+/**
+ * Ensure that base64 inline arrays round trip exactly, survive being written to and read from a document, and that
+ * separately padded segments of base64 data are read as one run of values.
+ */
+SIMPLE_TEST( FieldmlDataBase64ArrayTest )
+{
+    const char *filename = "base64_array_test.xml";
+    
+    FmlSessionHandle session = Fieldml_Create( "test_path", "test" );
+    Fieldml_SetDebug( session, 0 );
+    SIMPLE_ASSERT( session != FML_INVALID_HANDLE );
+    
+    FmlObjectHandle realType = Fieldml_CreateContinuousType( session, "test.real" );
+    FmlObjectHandle resource = Fieldml_CreateInlineDataResourceWithFormat( session, "test.resource", "BASE64" );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != resource );
+    
+    const int rank = 2;
+    int sizes[rank] = { 50, 7 };
+    int offsets[rank] = { 0, 0 };
+    FmlObjectHandle source = Fieldml_CreateArrayDataSource( session, "test.source", resource, "1", rank );
+    Fieldml_SetArrayDataSourceRawSizes( session, source, sizes );
+    Fieldml_SetArrayDataSourceSizes( session, source, sizes );
+    
+    vector<double> values( 50 * 7 );
+    for( size_t i = 0; i < values.size(); i++ )
     {
-        int x = ( ( i % 4 ) / 2 ) + readOffsets[0];
-        int y = ( ( i % 2 ) / 1 ) + readOffsets[1];
-        int z = ( ( i % 1 ) / 1 ) + readOffsets[2];
-        
-        expected = ( 100.0 * x ) + ( 10.0 * y ) + ( 1.0 * z );
-        
-        SIMPLE_ASSERT_EQUALS( expected, (buffer[i]) );
+        values[i] = ( i * 1.0 / 3.0 ) - 17.25;
     }
     
+    FmlWriterHandle writer = Fieldml_OpenArrayWriter( session, source, realType, 0, sizes, rank );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != writer );
+    int rowSizes[rank] = { 20, 7 };
+    int err = Fieldml_WriteDoubleSlab( writer, offsets, rowSizes, &values[0] );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    int rowOffsets[rank] = { 20, 0 };
+    rowSizes[0] = 30;
+    err = Fieldml_WriteDoubleSlab( writer, rowOffsets, rowSizes, &values[20 * 7] );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    Fieldml_CloseWriter( writer );
+    
+    char *dataType = Fieldml_GetDataResourceDataType( session, resource );
+    SIMPLE_ASSERT_EQUALS( string( "float64" ), string( dataType ) );
+    Fieldml_FreeString( dataType );
+    
+    //Base64 takes 4 characters for every 3 bytes, plus a newline every 76 characters.
+    char *data = Fieldml_GetInlineData( session, resource );
+    SIMPLE_ASSERT( strlen( data ) < values.size() * 11 );
+    Fieldml_FreeString( data );
+    
+    err = Fieldml_WriteFile( session, filename );
+    SIMPLE_ASSERT_EQUALS( FML_ERR_NO_ERROR, err );
+    Fieldml_Destroy( session );
+    
+    session = Fieldml_CreateFromFile( filename );
+    SIMPLE_ASSERT_EQUALS( FML_ERR_NO_ERROR, Fieldml_GetLastError( session ) );
+    Fieldml_SetDebug( session, 0 );
+    resource = Fieldml_GetObjectByName( session, "test.resource" );
+    source = Fieldml_GetObjectByName( session, "test.source" );
+    
+    char *format = Fieldml_GetDataResourceFormat( session, resource );
+    SIMPLE_ASSERT_EQUALS( string( "BASE64" ), string( format ) );
+    Fieldml_FreeString( format );
+    
+    int sliceOffsets[rank] = { 3, 2 };
+    int sliceSizes[rank] = { 5, 3 };
+    double buffer[15];
+    FmlReaderHandle reader = Fieldml_OpenReader( session, source );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != reader );
+    err = Fieldml_ReadDoubleSlab( reader, sliceOffsets, sliceSizes, buffer );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
     Fieldml_CloseReader( reader );
-
+    
+    for( int i = 0; i < 5; i++ )
+    {
+        for( int j = 0; j < 3; j++ )
+        {
+            const double expected = values[( i + 3 ) * 7 + j + 2];
+            SIMPLE_ASSERT( memcmp( &expected, &buffer[i * 3 + j], sizeof( double ) ) == 0 );
+        }
+    }
+    
+    FmlObjectHandle intResource = Fieldml_CreateInlineDataResourceWithFormat( session, "test.int_resource", "BASE64" );
+    Fieldml_SetDataResourceDataType( session, intResource, "int32" );
+    const string firstSegment = "AQAAAAIAAAA=\n";
+    const string secondSegment = "AwAAAP////8=\n";
+    Fieldml_SetInlineData( session, intResource, firstSegment.c_str(), firstSegment.length() );
+    Fieldml_AddInlineData( session, intResource, secondSegment.c_str(), secondSegment.length() );
+    
+    int intSizes[1] = { 3 };
+    int intOffsets[1] = { 0 };
+    FmlObjectHandle intSource = Fieldml_CreateArrayDataSource( session, "test.int_source", intResource, "2", 1 );
+    Fieldml_SetArrayDataSourceRawSizes( session, intSource, intSizes );
+    
+    int intBuffer[3];
+    reader = Fieldml_OpenReader( session, intSource );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != reader );
+    err = Fieldml_ReadIntSlab( reader, intOffsets, intSizes, intBuffer );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    Fieldml_CloseReader( reader );
+    SIMPLE_ASSERT_EQUALS( 2, intBuffer[0] );
+    SIMPLE_ASSERT_EQUALS( 3, intBuffer[1] );
+    SIMPLE_ASSERT_EQUALS( -1, intBuffer[2] );
+    
+    //The data runs out one value short of this array.
+    FmlObjectHandle shortSource = Fieldml_CreateArrayDataSource( session, "test.short_source", intResource, "3", 1 );
+    Fieldml_SetArrayDataSourceRawSizes( session, shortSource, intSizes );
+    reader = Fieldml_OpenReader( session, shortSource );
+    err = Fieldml_ReadIntSlab( reader, intOffsets, intSizes, intBuffer );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_UNEXPECTED_EOF, err );
+    Fieldml_CloseReader( reader );
+    
     Fieldml_Destroy( session );
+    remove( filename );
+}
+
+
+/**
+ * Ensure that raw binary arrays can be written in any order, read back through the file mapping, converted to other
+ * value types, and handed out in place where the slab is contiguous.
+ */
+SIMPLE_TEST( FieldmlDataRawArrayTest )
+{
+    const char *filename = "raw_array_test.raw";
+    
+    FmlSessionHandle session = Fieldml_Create( "test_path", "test" );
+    Fieldml_SetDebug( session, 0 );
+    SIMPLE_ASSERT( session != FML_INVALID_HANDLE );
+    
+    FmlObjectHandle realType = Fieldml_CreateContinuousType( session, "test.real" );
+    FmlObjectHandle resource = Fieldml_CreateHrefDataResource( session, "test.resource", "RAW_BINARY", filename );
+    
+    const int rank = 3;
+    int sizes[rank] = { 4, 5, 6 };
+    FmlObjectHandle source = Fieldml_CreateArrayDataSource( session, "test.source", resource, "", rank );
+    Fieldml_SetArrayDataSourceRawSizes( session, source, sizes );
+    Fieldml_SetArrayDataSourceSizes( session, source, sizes );
+    
+    double values[4 * 5 * 6];
+    for( int i = 0; i < 4 * 5 * 6; i++ )
+    {
+        values[i] = i * 0.5;
+    }
+    
+    FmlWriterHandle writer = Fieldml_OpenArrayWriter( session, source, realType, 0, sizes, rank );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != writer );
+    int halfOffsets[rank] = { 2, 0, 0 };
+    int halfSizes[rank] = { 2, 5, 6 };
+    int err = Fieldml_WriteDoubleSlab( writer, halfOffsets, halfSizes, &values[2 * 5 * 6] );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    halfOffsets[0] = 0;
+    err = Fieldml_WriteDoubleSlab( writer, halfOffsets, halfSizes, values );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    Fieldml_CloseWriter( writer );
+    
+    //The file header can't describe an empty dimension, so the writer refuses one rather than leave an unreadable file.
+    int emptySizes[rank] = { 4, 0, 6 };
+    SIMPLE_ASSERT_EQUALS( FML_INVALID_HANDLE, Fieldml_OpenArrayWriter( session, source, realType, 0, emptySizes, rank ) );
+    
+    FmlReaderHandle reader = Fieldml_OpenReader( session, source );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != reader );
+    
+    int sliceOffsets[rank] = { 1, 2, 3 };
+    int sliceSizes[rank] = { 2, 2, 3 };
+    double buffer[12];
+    err = Fieldml_ReadDoubleSlab( reader, sliceOffsets, sliceSizes, buffer );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    int intBuffer[12];
+    err = Fieldml_ReadIntSlab( reader, sliceOffsets, sliceSizes, intBuffer );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    int n = 0;
+    for( int i = 0; i < 2; i++ )
+    {
+        for( int j = 0; j < 2; j++ )
+        {
+            for( int k = 0; k < 3; k++ )
+            {
+                const double expected = values[( i + 1 ) * 30 + ( j + 2 ) * 6 + k + 3];
+                SIMPLE_ASSERT_EQUALS( expected, buffer[n] );
+                SIMPLE_ASSERT_EQUALS( (int)expected, intBuffer[n] );
+                n++;
+            }
+        }
+    }
+    
+    int rowOffsets[rank] = { 1, 0, 0 };
+    int rowSizes[rank] = { 2, 5, 6 };
+    const double *inPlace = Fieldml_GetDoubleSlabPointer( reader, rowOffsets, rowSizes );
+    SIMPLE_ASSERT( inPlace != NULL );
+    SIMPLE_ASSERT( memcmp( inPlace, &values[30], 60 * sizeof( double ) ) == 0 );
+    
+    //Neither a partial innermost dimension, nor a different value type, can be handed out in place.
+    SIMPLE_ASSERT( Fieldml_GetDoubleSlabPointer( reader, sliceOffsets, sliceSizes ) == NULL );
+    SIMPLE_ASSERT( Fieldml_GetIntSlabPointer( reader, rowOffsets, rowSizes ) == NULL );
+    
+    //The data source can't describe more data than the file holds.
+    int overSizes[rank] = { 5, 5, 6 };
+    Fieldml_SetArrayDataSourceRawSizes( session, source, overSizes );
+    Fieldml_SetArrayDataSourceSizes( session, source, overSizes );
+    FmlReaderHandle overReader = Fieldml_OpenReader( session, source );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != overReader );
+    int overOffsets[rank] = { 3, 0, 0 };
+    halfSizes[0] = 2;
+    err = Fieldml_ReadDoubleSlab( overReader, overOffsets, halfSizes, buffer );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_INVALID_PARAMETER, err );
+    Fieldml_CloseReader( overReader );
+    Fieldml_CloseReader( reader );
+    
+    //Narrower storage types are converted on the way in and out.
+    Fieldml_SetDataResourceDataType( session, resource, "float32" );
+    Fieldml_SetArrayDataSourceRawSizes( session, source, sizes );
+    Fieldml_SetArrayDataSourceSizes( session, source, sizes );
+    writer = Fieldml_OpenArrayWriter( session, source, realType, 0, sizes, rank );
+    int offsets[rank] = { 0, 0, 0 };
+    err = Fieldml_WriteDoubleSlab( writer, offsets, sizes, values );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    Fieldml_CloseWriter( writer );
+    
+    reader = Fieldml_OpenReader( session, source );
+    double allValues[4 * 5 * 6];
+    err = Fieldml_ReadDoubleSlab( reader, offsets, sizes, allValues );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    for( int i = 0; i < 4 * 5 * 6; i++ )
+    {
+        SIMPLE_ASSERT_EQUALS( values[i], allValues[i] );
+    }
+    SIMPLE_ASSERT( Fieldml_GetDoubleSlabPointer( reader, offsets, sizes ) == NULL );
+    Fieldml_CloseReader( reader );
+    
+    //Headers with dimensions that are empty, negative, or whose product overflows are rejected.
+    FILE *file = fopen( filename, "rb" );
+    SIMPLE_ASSERT( file != NULL );
+    vector<char> contents;
+    char chunk[256];
+    size_t count;
+    while( ( count = fread( chunk, 1, sizeof( chunk ), file ) ) > 0 )
+    {
+        contents.insert( contents.end(), chunk, chunk + count );
+    }
+    fclose( file );
+    
+    const int64_t badDims[3][rank] = {
+        { 4, 0, 6 },
+        { 4, -5, -6 },
+        { (int64_t)1 << 40, (int64_t)1 << 40, 4 },
+    };
+    for( int i = 0; i < 3; i++ )
+    {
+        vector<char> badContents = contents;
+        memcpy( &badContents[16], badDims[i], sizeof( badDims[i] ) );
+        file = fopen( filename, "wb" );
+        fwrite( &badContents[0], 1, badContents.size(), file );
+        fclose( file );
+        
+        //Headers are written in the writer's byte order, so these dimensions are in the right one.
+        reader = Fieldml_OpenReader( session, source );
+        SIMPLE_ASSERT_EQUALS( FML_INVALID_HANDLE, reader );
+    }
+    
+    Fieldml_Destroy( session );
+    remove( filename );
+}
+
+
+/**
+ * A trivial application-defined array format, holding a single 1D array of doubles in memory.
+ */
+static vector<double> externalFormatValues;
+
+static int64_t externalFormatBufferLength;
+
+static void *openExternalReader( FmlSessionHandle handle, FmlObjectHandle sourceHandle, const char *root, void *buffer, int64_t bufferLength,
+    void *userData )
+{
+    externalFormatBufferLength = ( buffer != NULL ) ? bufferLength : -2;
+    return userData;
+}
+
+
+static FmlIoErrorNumber readExternalDoubleSlab( void *reader, const int *offsets, const int *sizes, double *valueBuffer )
+{
+    if( offsets[0] + sizes[0] > (int)externalFormatValues.size() )
+    {
+        return FML_IOERR_INVALID_PARAMETER;
+    }
+    
+    memcpy( valueBuffer, &externalFormatValues[offsets[0]], sizes[0] * sizeof( double ) );
+    return FML_IOERR_NO_ERROR;
+}
+
+
+static void *openExternalWriter( FmlSessionHandle handle, FmlObjectHandle sourceHandle, const char *root, FieldmlHandleType valueType,
+    FmlBoolean append, const int *sizes, int rank, void *userData )
+{
+    externalFormatValues.assign( sizes[0], 0.0 );
+    return userData;
+}
+
+
+static FmlIoErrorNumber writeExternalDoubleSlab( void *writer, const int *offsets, const int *sizes, const double *valueBuffer )
+{
+    memcpy( &externalFormatValues[offsets[0]], valueBuffer, sizes[0] * sizeof( double ) );
+    return FML_IOERR_NO_ERROR;
+}
+
+
+/**
+ * Ensure that application-defined array formats are used for resources in that format once registered, and not once
+ * unregistered.
+ */
+SIMPLE_TEST( FieldmlDataArrayFormatRegistryTest )
+{
+    SIMPLE_ASSERT_EQUALS( 1, Fieldml_IsArrayFormatRegistered( "PLAIN_TEXT" ) );
+    SIMPLE_ASSERT_EQUALS( 0, Fieldml_IsArrayFormatRegistered( "TEST_FORMAT" ) );
+    
+    FieldmlArrayFormatCallbacks callbacks;
+    memset( &callbacks, 0, sizeof( callbacks ) );
+    callbacks.openReader = openExternalReader;
+    callbacks.readDoubleSlab = readExternalDoubleSlab;
+    callbacks.openWriter = openExternalWriter;
+    callbacks.writeDoubleSlab = writeExternalDoubleSlab;
+    
+    int state = 0;
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, Fieldml_RegisterArrayFormat( "TEST_FORMAT", &callbacks, &state ) );
+    SIMPLE_ASSERT_EQUALS( 1, Fieldml_IsArrayFormatRegistered( "TEST_FORMAT" ) );
+    
+    FmlSessionHandle session = Fieldml_Create( "test_path", "test" );
+    Fieldml_SetDebug( session, 0 );
+    SIMPLE_ASSERT( session != FML_INVALID_HANDLE );
+    
+    FmlObjectHandle realType = Fieldml_CreateContinuousType( session, "test.real" );
+    FmlObjectHandle resource = Fieldml_CreateHrefDataResource( session, "test.resource", "TEST_FORMAT", "unused" );
+    int sizes[1] = { 6 };
+    int offsets[1] = { 0 };
+    FmlObjectHandle source = Fieldml_CreateArrayDataSource( session, "test.source", resource, "", 1 );
+    Fieldml_SetArrayDataSourceRawSizes( session, source, sizes );
+    Fieldml_SetArrayDataSourceSizes( session, source, sizes );
+    
+    const double values[6] = { 1.5, 2.5, 3.5, 4.5, 5.5, 6.5 };
+    FmlWriterHandle writer = Fieldml_OpenArrayWriter( session, source, realType, 0, sizes, 1 );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != writer );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, Fieldml_WriteDoubleSlab( writer, offsets, sizes, values ) );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_UNSUPPORTED, Fieldml_WriteIntSlab( writer, offsets, sizes, (const int*)values ) );
+    Fieldml_CloseWriter( writer );
+    
+    double buffer[3];
+    int sliceOffsets[1] = { 2 };
+    int sliceSizes[1] = { 3 };
+    FmlReaderHandle reader = Fieldml_OpenReader( session, source );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != reader );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, Fieldml_ReadDoubleSlab( reader, sliceOffsets, sliceSizes, buffer ) );
+    for( int i = 0; i < 3; i++ )
+    {
+        SIMPLE_ASSERT_EQUALS( values[i + 2], buffer[i] );
+    }
+    Fieldml_CloseReader( reader );
+    SIMPLE_ASSERT_EQUALS( -2, (int)externalFormatBufferLength );
+    
+    //Buffers and images are passed on with their lengths.
+    char image[16] = "unused";
+    reader = Fieldml_OpenReaderWithImage( session, source, image, sizeof( image ) );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != reader );
+    Fieldml_CloseReader( reader );
+    SIMPLE_ASSERT_EQUALS( (int)sizeof( image ), (int)externalFormatBufferLength );
+    
+    reader = Fieldml_OpenReaderWithBuffer( session, source, image );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != reader );
+    Fieldml_CloseReader( reader );
+    SIMPLE_ASSERT( externalFormatBufferLength < 0 );
+    SIMPLE_ASSERT( externalFormatBufferLength != -2 );
+    
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, Fieldml_UnregisterArrayFormat( "TEST_FORMAT" ) );
+    reader = Fieldml_OpenReader( session, source );
+    SIMPLE_ASSERT_EQUALS( FML_INVALID_HANDLE, reader );
+    
+    Fieldml_Destroy( session );
+}
+
+
+/**
+ * Serves the contents of a string through a stream request callback, a few bytes at a time.
+ */
+class CallbackStreamSource
+{
+public:
+    string contents;
+    size_t position;
+    int starts;
+    int ends;
+};
+
+static FieldmlStreamRequestStatus serveStreamRequest( const char *href, FieldmlStreamRequestStatus status, char *buffer, int bufferSize,
+    int *bytesRead, void *userData )
+{
+    CallbackStreamSource *source = (CallbackStreamSource*)userData;
+    
+    *bytesRead = 0;
+    if( strcmp( href, "callback_stream_test.data" ) != 0 )
+    {
+        return FML_STREAM_REQUEST_STATUS_ERROR;
+    }
+    if( status == FML_STREAM_REQUEST_STATUS_END )
+    {
+        source->ends++;
+        return FML_STREAM_REQUEST_STATUS_END;
+    }
+    if( status == FML_STREAM_REQUEST_STATUS_START )
+    {
+        source->starts++;
+        source->position = 0;
+    }
+    
+    size_t count = source->contents.size() - source->position;
+    if( count > 7 )
+    {
+        count = 7;
+    }
+    if( count > (size_t)bufferSize )
+    {
+        count = bufferSize;
+    }
+    memcpy( buffer, source->contents.data() + source->position, count );
+    source->position += count;
+    *bytesRead = count;
+    
+    return ( source->position == source->contents.size() ) ? FML_STREAM_REQUEST_STATUS_END : FML_STREAM_REQUEST_STATUS_OK;
+}
+
+
+/**
+ * Ensure that href data resources can be read through an application's stream request callback instead of from files.
+ */
+SIMPLE_TEST( FieldmlDataCallbackStreamTest )
+{
+    const char *filename = "callback_stream_test.data";
+    
+    FmlSessionHandle session = Fieldml_Create( "test_path", "test" );
+    Fieldml_SetDebug( session, 0 );
+    SIMPLE_ASSERT( session != FML_INVALID_HANDLE );
+    
+    CallbackStreamSource streamSource;
+    streamSource.contents = "1 2 3\n4 5 6\n7 8 9\n10 11 12\n";
+    streamSource.position = 0;
+    streamSource.starts = 0;
+    streamSource.ends = 0;
+    int err = Fieldml_SetStreamRequestCallback( session, serveStreamRequest, &streamSource );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    
+    //There is no such file, so everything has to come through the callback.
+    FmlObjectHandle resource = Fieldml_CreateHrefDataResource( session, "test.resource", "PLAIN_TEXT", filename );
+    const int rank = 2;
+    int sizes[rank] = { 4, 3 };
+    FmlObjectHandle source = Fieldml_CreateArrayDataSource( session, "test.source", resource, "1", rank );
+    Fieldml_SetArrayDataSourceRawSizes( session, source, sizes );
+    Fieldml_SetArrayDataSourceSizes( session, source, sizes );
+    
+    FmlReaderHandle reader = Fieldml_OpenReader( session, source );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != reader );
+    
+    int offsets[rank] = { 2, 1 };
+    int slabSizes[rank] = { 2, 2 };
+    int values[4];
+    err = Fieldml_ReadIntSlab( reader, offsets, slabSizes, values );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    SIMPLE_ASSERT_EQUALS( 8, values[0] );
+    SIMPLE_ASSERT_EQUALS( 9, values[1] );
+    SIMPLE_ASSERT_EQUALS( 11, values[2] );
+    SIMPLE_ASSERT_EQUALS( 12, values[3] );
+    
+    //Going back to earlier data restarts the stream.
+    offsets[0] = 0;
+    offsets[1] = 0;
+    err = Fieldml_ReadIntSlab( reader, offsets, slabSizes, values );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    SIMPLE_ASSERT_EQUALS( 1, values[0] );
+    SIMPLE_ASSERT_EQUALS( 2, values[1] );
+    SIMPLE_ASSERT_EQUALS( 4, values[2] );
+    SIMPLE_ASSERT_EQUALS( 5, values[3] );
+    SIMPLE_ASSERT( streamSource.starts >= 2 );
+    
+    Fieldml_CloseReader( reader );
+    SIMPLE_ASSERT_EQUALS( 1, streamSource.ends );
+    
+    //Binary data is fetched in full when the reader is opened.
+    FmlObjectHandle realType = Fieldml_CreateContinuousType( session, "test.real" );
+    FmlObjectHandle rawResource = Fieldml_CreateHrefDataResource( session, "test.raw_resource", "RAW_BINARY", filename );
+    FmlObjectHandle rawSource = Fieldml_CreateArrayDataSource( session, "test.raw_source", rawResource, "", rank );
+    Fieldml_SetArrayDataSourceRawSizes( session, rawSource, sizes );
+    Fieldml_SetArrayDataSourceSizes( session, rawSource, sizes );
+    
+    double doubleValues[12];
+    for( int i = 0; i < 12; i++ )
+    {
+        doubleValues[i] = i * 1.5;
+    }
+    int allOffsets[rank] = { 0, 0 };
+    FmlWriterHandle writer = Fieldml_OpenArrayWriter( session, rawSource, realType, 0, sizes, rank );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != writer );
+    err = Fieldml_WriteDoubleSlab( writer, allOffsets, sizes, doubleValues );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    Fieldml_CloseWriter( writer );
+    
+    FILE *file = fopen( filename, "rb" );
+    SIMPLE_ASSERT( file != NULL );
+    streamSource.contents.clear();
+    char chunk[256];
+    size_t count;
+    while( ( count = fread( chunk, 1, sizeof( chunk ), file ) ) > 0 )
+    {
+        streamSource.contents.append( chunk, count );
+    }
+    fclose( file );
+    remove( filename );
+    
+    reader = Fieldml_OpenReader( session, rawSource );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != reader );
+    offsets[0] = 1;
+    offsets[1] = 1;
+    double readValues[4];
+    err = Fieldml_ReadDoubleSlab( reader, offsets, slabSizes, readValues );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    SIMPLE_ASSERT_EQUALS( doubleValues[4], readValues[0] );
+    SIMPLE_ASSERT_EQUALS( doubleValues[5], readValues[1] );
+    SIMPLE_ASSERT_EQUALS( doubleValues[7], readValues[2] );
+    SIMPLE_ASSERT_EQUALS( doubleValues[8], readValues[3] );
+    Fieldml_CloseReader( reader );
+    
+    //Without the callback, the (now missing) file is used again.
+    Fieldml_SetStreamRequestCallback( session, NULL, NULL );
+    reader = Fieldml_OpenReader( session, source );
+    SIMPLE_ASSERT_EQUALS( FML_INVALID_HANDLE, reader );
+    
+    Fieldml_Destroy( session );
+}
+
+
+/**
+ * Ensure that gzip-compressed text resources can be written and read back, whether declared through their format or
+ * their name.
+ */
+SIMPLE_TEST( FieldmlDataGzipTextArrayTest )
+{
+    if( !Fieldml_IsArrayFormatRegistered( "PLAIN_TEXT_GZIP" ) )
+    {
+        //Built without zlib.
+        return;
+    }
+    
+    const char *filename = "gzip_text_test.txt";
+    const char *namedFilename = "gzip_text_test.txt.gz";
+    
+    FmlSessionHandle session = Fieldml_Create( "test_path", "test" );
+    Fieldml_SetDebug( session, 0 );
+    SIMPLE_ASSERT( session != FML_INVALID_HANDLE );
+    
+    FmlObjectHandle realType = Fieldml_CreateContinuousType( session, "test.real" );
+    FmlObjectHandle resource = Fieldml_CreateHrefDataResource( session, "test.resource", "PLAIN_TEXT_GZIP", filename );
+    
+    const int rank = 2;
+    int sizes[rank] = { 100, 7 };
+    FmlObjectHandle source = Fieldml_CreateArrayDataSource( session, "test.source", resource, "1", rank );
+    Fieldml_SetArrayDataSourceRawSizes( session, source, sizes );
+    Fieldml_SetArrayDataSourceSizes( session, source, sizes );
+    
+    double values[100 * 7];
+    for( int i = 0; i < 100 * 7; i++ )
+    {
+        values[i] = i * 0.25;
+    }
+    
+    //Written in two halves, the second appended to the first. Each writer counts rows from its own start.
+    int halfSizes[rank] = { 50, 7 };
+    int offsets[rank] = { 0, 0 };
+    FmlWriterHandle writer = Fieldml_OpenArrayWriter( session, source, realType, 0, sizes, rank );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != writer );
+    int err = Fieldml_WriteDoubleSlab( writer, offsets, halfSizes, values );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    Fieldml_CloseWriter( writer );
+    
+    writer = Fieldml_OpenArrayWriter( session, source, realType, 1, sizes, rank );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != writer );
+    err = Fieldml_WriteDoubleSlab( writer, offsets, halfSizes, &values[50 * 7] );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    Fieldml_CloseWriter( writer );
+    
+    FILE *file = fopen( filename, "rb" );
+    SIMPLE_ASSERT( file != NULL );
+    unsigned char magic[2] = { 0, 0 };
+    SIMPLE_ASSERT_EQUALS( 2, (int)fread( magic, 1, 2, file ) );
+    fclose( file );
+    SIMPLE_ASSERT_EQUALS( 0x1f, (int)magic[0] );
+    SIMPLE_ASSERT_EQUALS( 0x8b, (int)magic[1] );
+    
+    FmlReaderHandle reader = Fieldml_OpenReader( session, source );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != reader );
+    double readValues[100 * 7];
+    int sliceOffsets[rank] = { 48, 2 };
+    int sliceSizes[rank] = { 4, 3 };
+    err = Fieldml_ReadDoubleSlab( reader, sliceOffsets, sliceSizes, readValues );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    for( int i = 0; i < 4; i++ )
+    {
+        for( int j = 0; j < 3; j++ )
+        {
+            SIMPLE_ASSERT_EQUALS( values[( 48 + i ) * 7 + 2 + j], readValues[i * 3 + j] );
+        }
+    }
+    
+    //Going backwards in the decompressed data.
+    err = Fieldml_ReadDoubleSlab( reader, offsets, sizes, readValues );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    for( int i = 0; i < 100 * 7; i++ )
+    {
+        SIMPLE_ASSERT_EQUALS( values[i], readValues[i] );
+    }
+    Fieldml_CloseReader( reader );
+    
+    //Plain text readers recognise compressed files by their contents.
+    FmlObjectHandle plainResource = Fieldml_CreateHrefDataResource( session, "test.plain_resource", "PLAIN_TEXT", filename );
+    FmlObjectHandle plainSource = Fieldml_CreateArrayDataSource( session, "test.plain_source", plainResource, "1", rank );
+    Fieldml_SetArrayDataSourceRawSizes( session, plainSource, sizes );
+    Fieldml_SetArrayDataSourceSizes( session, plainSource, sizes );
+    reader = Fieldml_OpenReader( session, plainSource );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != reader );
+    err = Fieldml_ReadDoubleSlab( reader, offsets, sizes, readValues );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    SIMPLE_ASSERT_EQUALS( values[100 * 7 - 1], readValues[100 * 7 - 1] );
+    Fieldml_CloseReader( reader );
+    
+    //Plain text written to a file named *.gz is compressed.
+    FmlObjectHandle namedResource = Fieldml_CreateHrefDataResource( session, "test.named_resource", "PLAIN_TEXT", namedFilename );
+    FmlObjectHandle namedSource = Fieldml_CreateArrayDataSource( session, "test.named_source", namedResource, "1", rank );
+    Fieldml_SetArrayDataSourceRawSizes( session, namedSource, sizes );
+    Fieldml_SetArrayDataSourceSizes( session, namedSource, sizes );
+    writer = Fieldml_OpenArrayWriter( session, namedSource, realType, 0, sizes, rank );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != writer );
+    err = Fieldml_WriteDoubleSlab( writer, offsets, sizes, values );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    Fieldml_CloseWriter( writer );
+    
+    file = fopen( namedFilename, "rb" );
+    SIMPLE_ASSERT( file != NULL );
+    SIMPLE_ASSERT_EQUALS( 2, (int)fread( magic, 1, 2, file ) );
+    fclose( file );
+    SIMPLE_ASSERT_EQUALS( 0x1f, (int)magic[0] );
+    
+    reader = Fieldml_OpenReader( session, namedSource );
+    err = Fieldml_ReadDoubleSlab( reader, sliceOffsets, sliceSizes, readValues );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    SIMPLE_ASSERT_EQUALS( values[48 * 7 + 2], readValues[0] );
+    Fieldml_CloseReader( reader );
+    
+    //Compressed data served through a stream request callback is decompressed too, whatever its format says.
+    CallbackStreamSource streamSource;
+    streamSource.position = 0;
+    streamSource.starts = 0;
+    streamSource.ends = 0;
+    file = fopen( filename, "rb" );
+    SIMPLE_ASSERT( file != NULL );
+    char chunk[256];
+    size_t count;
+    while( ( count = fread( chunk, 1, sizeof( chunk ), file ) ) > 0 )
+    {
+        streamSource.contents.append( chunk, count );
+    }
+    fclose( file );
+    err = Fieldml_SetStreamRequestCallback( session, serveStreamRequest, &streamSource );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    
+    const char *callbackFormats[2] = { "PLAIN_TEXT_GZIP", "PLAIN_TEXT" };
+    for( int f = 0; f < 2; f++ )
+    {
+        string name = string( "test.callback_resource." ) + callbackFormats[f];
+        FmlObjectHandle callbackResource = Fieldml_CreateHrefDataResource( session, name.c_str(), callbackFormats[f], "callback_stream_test.data" );
+        name = string( "test.callback_source." ) + callbackFormats[f];
+        FmlObjectHandle callbackSource = Fieldml_CreateArrayDataSource( session, name.c_str(), callbackResource, "1", rank );
+        Fieldml_SetArrayDataSourceRawSizes( session, callbackSource, sizes );
+        Fieldml_SetArrayDataSourceSizes( session, callbackSource, sizes );
+        
+        reader = Fieldml_OpenReader( session, callbackSource );
+        SIMPLE_ASSERT( FML_INVALID_HANDLE != reader );
+        err = Fieldml_ReadDoubleSlab( reader, sliceOffsets, sliceSizes, readValues );
+        SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+        SIMPLE_ASSERT_EQUALS( values[48 * 7 + 2], readValues[0] );
+        SIMPLE_ASSERT_EQUALS( values[51 * 7 + 4], readValues[11] );
+        
+        //Both gzip members, and going backwards through them.
+        err = Fieldml_ReadDoubleSlab( reader, offsets, sizes, readValues );
+        SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+        for( int i = 0; i < 100 * 7; i++ )
+        {
+            SIMPLE_ASSERT_EQUALS( values[i], readValues[i] );
+        }
+        Fieldml_CloseReader( reader );
+    }
+    SIMPLE_ASSERT( streamSource.starts >= 2 );
+    Fieldml_SetStreamRequestCallback( session, NULL, NULL );
+    
+    //Compressed data can't be held inline.
+    FmlObjectHandle inlineResource = Fieldml_CreateInlineDataResourceWithFormat( session, "test.inline_resource", "PLAIN_TEXT_GZIP" );
+    FmlObjectHandle inlineSource = Fieldml_CreateArrayDataSource( session, "test.inline_source", inlineResource, "1", rank );
+    Fieldml_SetArrayDataSourceRawSizes( session, inlineSource, sizes );
+    Fieldml_SetArrayDataSourceSizes( session, inlineSource, sizes );
+    writer = Fieldml_OpenArrayWriter( session, inlineSource, realType, 0, sizes, rank );
+    SIMPLE_ASSERT_EQUALS( FML_INVALID_HANDLE, writer );
+    
+    Fieldml_Destroy( session );
+    remove( filename );
+    remove( namedFilename );
+}
+
+
+/**
+ * Ensure that asynchronous slab reads deliver the same data as synchronous ones, with several outstanding at once.
+ */
+SIMPLE_TEST( FieldmlDataAsyncReadTest )
+{
+    const char *textFilename = "async_read_test.txt";
+    const char *rawFilename = "async_read_test.raw";
+    
+    FmlSessionHandle session = Fieldml_Create( "test_path", "test" );
+    Fieldml_SetDebug( session, 0 );
+    SIMPLE_ASSERT( session != FML_INVALID_HANDLE );
+    
+    FmlObjectHandle realType = Fieldml_CreateContinuousType( session, "test.real" );
+    FmlObjectHandle textResource = Fieldml_CreateHrefDataResource( session, "test.text_resource", "PLAIN_TEXT", textFilename );
+    FmlObjectHandle rawResource = Fieldml_CreateHrefDataResource( session, "test.raw_resource", "RAW_BINARY", rawFilename );
+    
+    const int rank = 2;
+    const int rowCount = 64;
+    const int columnCount = 10;
+    int sizes[rank] = { rowCount, columnCount };
+    FmlObjectHandle textSource = Fieldml_CreateArrayDataSource( session, "test.text_source", textResource, "1", rank );
+    Fieldml_SetArrayDataSourceRawSizes( session, textSource, sizes );
+    Fieldml_SetArrayDataSourceSizes( session, textSource, sizes );
+    FmlObjectHandle rawSource = Fieldml_CreateArrayDataSource( session, "test.raw_source", rawResource, "", rank );
+    Fieldml_SetArrayDataSourceRawSizes( session, rawSource, sizes );
+    Fieldml_SetArrayDataSourceSizes( session, rawSource, sizes );
+    
+    vector<double> values( rowCount * columnCount );
+    for( size_t i = 0; i < values.size(); i++ )
+    {
+        values[i] = i * 0.5;
+    }
+    
+    int offsets[rank] = { 0, 0 };
+    FmlWriterHandle writer = Fieldml_OpenArrayWriter( session, textSource, realType, 0, sizes, rank );
+    int err = Fieldml_WriteDoubleSlab( writer, offsets, sizes, &values[0] );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    Fieldml_CloseWriter( writer );
+    writer = Fieldml_OpenArrayWriter( session, rawSource, realType, 0, sizes, rank );
+    err = Fieldml_WriteDoubleSlab( writer, offsets, sizes, &values[0] );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    Fieldml_CloseWriter( writer );
+    
+    FmlReaderHandle textReader = Fieldml_OpenReader( session, textSource );
+    FmlReaderHandle rawReader = Fieldml_OpenReader( session, rawSource );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != textReader );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != rawReader );
+    
+    //Every row from both readers, in reverse order, all outstanding together.
+    const int requestCount = rowCount * 2;
+    vector<double> readValues( requestCount * columnCount, -1.0 );
+    vector<FmlRequestHandle> requests( requestCount );
+    int rowSizes[rank] = { 1, columnCount };
+    for( int i = 0; i < requestCount; i++ )
+    {
+        int rowOffsets[rank] = { rowCount - 1 - ( i % rowCount ), 0 };
+        FmlReaderHandle reader = ( i < rowCount ) ? textReader : rawReader;
+        requests[i] = Fieldml_ReadDoubleSlabAsync( reader, rowOffsets, rowSizes, &readValues[i * columnCount] );
+        SIMPLE_ASSERT( FML_INVALID_HANDLE != requests[i] );
+    }
+    
+    FmlBoolean isComplete = 0;
+    err = Fieldml_TestRequest( requests[0], &isComplete );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    
+    for( int i = 0; i < requestCount; i++ )
+    {
+        err = Fieldml_WaitRequest( requests[i] );
+        SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+        
+        const int row = rowCount - 1 - ( i % rowCount );
+        for( int j = 0; j < columnCount; j++ )
+        {
+            SIMPLE_ASSERT_EQUALS( values[row * columnCount + j], readValues[i * columnCount + j] );
+        }
+    }
+    
+    //Requests are released once waited on.
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_UNKNOWN_OBJECT, Fieldml_WaitRequest( requests[0] ) );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_UNKNOWN_OBJECT, Fieldml_TestRequest( requests[0], &isComplete ) );
+    
+    //Errors come back through the request.
+    int badOffsets[rank] = { rowCount, 0 };
+    FmlRequestHandle badRequest = Fieldml_ReadDoubleSlabAsync( rawReader, badOffsets, rowSizes, &readValues[0] );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != badRequest );
+    SIMPLE_ASSERT( FML_IOERR_NO_ERROR != Fieldml_WaitRequest( badRequest ) );
+    SIMPLE_ASSERT_EQUALS( FML_INVALID_HANDLE, Fieldml_ReadDoubleSlabAsync( FML_INVALID_HANDLE, offsets, rowSizes, &readValues[0] ) );
+    
+    //Closing a reader waits for its outstanding reads, which can still be collected afterwards.
+    vector<int> intValues( rowCount * columnCount, -1 );
+    FmlRequestHandle intRequest = Fieldml_ReadIntSlabAsync( rawReader, offsets, sizes, &intValues[0] );
+    Fieldml_CloseReader( rawReader );
+    err = Fieldml_TestRequest( intRequest, &isComplete );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    SIMPLE_ASSERT_EQUALS( 1, isComplete );
+    err = Fieldml_WaitRequest( intRequest );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    SIMPLE_ASSERT_EQUALS( (int)values[rowCount * columnCount - 1], intValues[rowCount * columnCount - 1] );
+    
+    Fieldml_CloseReader( textReader );
+    Fieldml_Destroy( session );
+    remove( textFilename );
+    remove( rawFilename );
+}
+
+
+/**
+ * Ensure that the access pattern hint doesn't change what gets read, however often it changes.
+ */
+SIMPLE_TEST( FieldmlDataReadAheadTest )
+{
+    const char *textFilename = "read_ahead_test.txt";
+    const char *rawFilename = "read_ahead_test.raw";
+    
+    FmlSessionHandle session = Fieldml_Create( "test_path", "test" );
+    Fieldml_SetDebug( session, 0 );
+    SIMPLE_ASSERT( session != FML_INVALID_HANDLE );
+    
+    FmlObjectHandle realType = Fieldml_CreateContinuousType( session, "test.real" );
+    FmlObjectHandle textResource = Fieldml_CreateHrefDataResource( session, "test.text_resource", "PLAIN_TEXT", textFilename );
+    FmlObjectHandle rawResource = Fieldml_CreateHrefDataResource( session, "test.raw_resource", "RAW_BINARY", rawFilename );
+    
+    //Large enough that the text spans several read-ahead chunks.
+    const int rank = 2;
+    const int rowCount = 20000;
+    const int columnCount = 10;
+    int sizes[rank] = { rowCount, columnCount };
+    FmlObjectHandle textSource = Fieldml_CreateArrayDataSource( session, "test.text_source", textResource, "1", rank );
+    Fieldml_SetArrayDataSourceRawSizes( session, textSource, sizes );
+    Fieldml_SetArrayDataSourceSizes( session, textSource, sizes );
+    FmlObjectHandle rawSource = Fieldml_CreateArrayDataSource( session, "test.raw_source", rawResource, "", rank );
+    Fieldml_SetArrayDataSourceRawSizes( session, rawSource, sizes );
+    Fieldml_SetArrayDataSourceSizes( session, rawSource, sizes );
+    
+    vector<double> values( rowCount * columnCount );
+    for( size_t i = 0; i < values.size(); i++ )
+    {
+        values[i] = i * 0.25;
+    }
+    
+    int offsets[rank] = { 0, 0 };
+    FmlWriterHandle writer = Fieldml_OpenArrayWriter( session, textSource, realType, 0, sizes, rank );
+    int err = Fieldml_WriteDoubleSlab( writer, offsets, sizes, &values[0] );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    Fieldml_CloseWriter( writer );
+    writer = Fieldml_OpenArrayWriter( session, rawSource, realType, 0, sizes, rank );
+    err = Fieldml_WriteDoubleSlab( writer, offsets, sizes, &values[0] );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    Fieldml_CloseWriter( writer );
+    
+    FmlReaderHandle textReader = Fieldml_OpenReader( session, textSource );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != textReader );
+    err = Fieldml_SetReaderAccessPattern( textReader, FML_ACCESS_PATTERN_SEQUENTIAL );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    
+    //Read the first half in order.
+    const int chunkRows = 1000;
+    vector<double> readValues( chunkRows * columnCount );
+    int chunkSizes[rank] = { chunkRows, columnCount };
+    for( int row = 0; row < rowCount / 2; row += chunkRows )
+    {
+        int chunkOffsets[rank] = { row, 0 };
+        err = Fieldml_ReadDoubleSlab( textReader, chunkOffsets, chunkSizes, &readValues[0] );
+        SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+        SIMPLE_ASSERT_EQUALS( values[row * columnCount], readValues[0] );
+        SIMPLE_ASSERT_EQUALS( values[( row + chunkRows ) * columnCount - 1], readValues[chunkRows * columnCount - 1] );
+    }
+    
+    //Dropping the hint leaves the reader where it was, and going backwards still works.
+    err = Fieldml_SetReaderAccessPattern( textReader, FML_ACCESS_PATTERN_NORMAL );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    int rowOffsets[rank] = { rowCount / 2, 0 };
+    int rowSizes[rank] = { 1, columnCount };
+    err = Fieldml_ReadDoubleSlab( textReader, rowOffsets, rowSizes, &readValues[0] );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    SIMPLE_ASSERT_EQUALS( values[( rowCount / 2 ) * columnCount], readValues[0] );
+    rowOffsets[0] = 5;
+    err = Fieldml_ReadDoubleSlab( textReader, rowOffsets, rowSizes, &readValues[0] );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    SIMPLE_ASSERT_EQUALS( values[5 * columnCount], readValues[0] );
+    
+    //Read the second half in order, starting from behind the read-ahead stream's first chunk.
+    err = Fieldml_SetReaderAccessPattern( textReader, FML_ACCESS_PATTERN_SEQUENTIAL );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    for( int row = rowCount / 2; row < rowCount; row += chunkRows )
+    {
+        int chunkOffsets[rank] = { row, 0 };
+        err = Fieldml_ReadDoubleSlab( textReader, chunkOffsets, chunkSizes, &readValues[0] );
+        SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+        SIMPLE_ASSERT_EQUALS( values[row * columnCount], readValues[0] );
+        SIMPLE_ASSERT_EQUALS( values[( row + chunkRows ) * columnCount - 1], readValues[chunkRows * columnCount - 1] );
+    }
+    
+    //And back to the start while still reading ahead.
+    rowOffsets[0] = 0;
+    err = Fieldml_ReadDoubleSlab( textReader, rowOffsets, rowSizes, &readValues[0] );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    SIMPLE_ASSERT_EQUALS( values[columnCount - 1], readValues[columnCount - 1] );
+    
+    Fieldml_CloseReader( textReader );
+    
+    //Binary readers take the hint too.
+    FmlReaderHandle rawReader = Fieldml_OpenReader( session, rawSource );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != rawReader );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, Fieldml_SetReaderAccessPattern( rawReader, FML_ACCESS_PATTERN_RANDOM ) );
+    rowOffsets[0] = rowCount - 1;
+    err = Fieldml_ReadDoubleSlab( rawReader, rowOffsets, rowSizes, &readValues[0] );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    SIMPLE_ASSERT_EQUALS( values[( rowCount - 1 ) * columnCount], readValues[0] );
+    Fieldml_CloseReader( rawReader );
+    
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_UNKNOWN_OBJECT, Fieldml_SetReaderAccessPattern( FML_INVALID_HANDLE, FML_ACCESS_PATTERN_SEQUENTIAL ) );
+    
+    Fieldml_Destroy( session );
+    
+    remove( textFilename );
+    remove( rawFilename );
+}
+
+
+/**
+ * Ensure that single precision reads narrow whatever the reader reads as doubles, with or without the data cache.
+ */
+SIMPLE_TEST( FieldmlDataFloatReadTest )
+{
+    FmlSessionHandle session = Fieldml_Create( "test_path", "test" );
+    Fieldml_SetDebug( session, 0 );
+    SIMPLE_ASSERT( session != FML_INVALID_HANDLE );
+    
+    FmlObjectHandle resource = Fieldml_CreateInlineDataResource( session, "test.resource" );
+    const string data = "0.1 0.2 0.3\n-1.5 2.25 1e30\n";
+    Fieldml_SetInlineData( session, resource, data.c_str(), data.length() );
+    
+    FmlObjectHandle source = Fieldml_CreateArrayDataSource( session, "test.source", resource, "1", 2 );
+    int sizes[2] = { 2, 3 };
+    Fieldml_SetArrayDataSourceRawSizes( session, source, sizes );
+    
+    const double expected[6] = { 0.1, 0.2, 0.3, -1.5, 2.25, 1e30 };
+    int offsets[2] = { 0, 0 };
+    for( int pass = 0; pass < 2; pass++ )
+    {
+        Fieldml_SetDataCacheLimit( session, pass * 1024 * 1024 );
+        for( int repeat = 0; repeat < 2; repeat++ )
+        {
+            FmlReaderHandle reader = Fieldml_OpenReader( session, source );
+            SIMPLE_ASSERT( FML_INVALID_HANDLE != reader );
+            
+            float values[6];
+            int err = Fieldml_ReadFloatSlab( reader, offsets, sizes, values );
+            SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+            for( int i = 0; i < 6; i++ )
+            {
+                SIMPLE_ASSERT_EQUALS( (float)expected[i], values[i] );
+            }
+            
+            int rowOffsets[2] = { 1, 1 };
+            int rowSizes[2] = { 1, 2 };
+            err = Fieldml_ReadFloatSlab( reader, rowOffsets, rowSizes, values );
+            SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+            SIMPLE_ASSERT_EQUALS( 2.25f, values[0] );
+            SIMPLE_ASSERT_EQUALS( 1e30f, values[1] );
+            
+            Fieldml_CloseReader( reader );
+        }
+    }
+    
+    Fieldml_Destroy( session );
+}
+
+
+/**
+ * Ensure that an array split across shards in different formats can be written a shard at a time, and read back with
+ * slabs that span several shards.
+ */
+SIMPLE_TEST( FieldmlDataShardedArrayTest )
+{
+    const char *manifestName = "sharded_test.manifest";
+    const char *shardNames[3] = { "sharded_test.0.txt", "sharded_test.1.raw", "sharded_test.2.txt" };
+    const char *shardFormats[3] = { "PLAIN_TEXT", "RAW_BINARY", "PLAIN_TEXT" };
+    
+    FmlSessionHandle session = Fieldml_Create( "test_path", "test" );
+    Fieldml_SetDebug( session, 0 );
+    SIMPLE_ASSERT( session != FML_INVALID_HANDLE );
+    
+    FmlObjectHandle realType = Fieldml_CreateContinuousType( session, "test.real" );
+    FmlObjectHandle resource = Fieldml_CreateHrefDataResource( session, "test.resource", "SHARDED", manifestName );
+    FmlObjectHandle textResource = Fieldml_CreateHrefDataResource( session, "test.text", "PLAIN_TEXT", shardNames[0] );
+    
+    const int rank = 2;
+    const int rowCount = 12;
+    const int columnCount = 3;
+    FmlObjectHandle source = Fieldml_CreateArrayDataSource( session, "test.source", resource, "1", rank );
+    int sizes[rank] = { rowCount, columnCount };
+    Fieldml_SetArrayDataSourceRawSizes( session, source, sizes );
+    
+    //Shards must not overlap, and only sharded resources have manifests.
+    int firstRows[3] = { 0, 4, 7 };
+    int rowCounts[3] = { 4, 4, 5 };
+    int err = Fieldml_WriteShardManifest( session, resource, 3, firstRows, rowCounts, shardFormats, shardNames );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_INVALID_PARAMETER, err );
+    rowCounts[1] = 3;
+    err = Fieldml_WriteShardManifest( session, textResource, 3, firstRows, rowCounts, shardFormats, shardNames );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_UNSUPPORTED, err );
+    err = Fieldml_WriteShardManifest( session, resource, 3, firstRows, rowCounts, shardFormats, shardNames );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    
+    double values[rowCount * columnCount];
+    for( int i = 0; i < rowCount * columnCount; i++ )
+    {
+        values[i] = i * 0.5;
+    }
+    
+    //Each writer only opens the shards it writes to, as separate processes would.
+    int offsets[rank] = { 0, 0 };
+    int writeSizes[rank] = { 4, columnCount };
+    FmlWriterHandle writer = Fieldml_OpenArrayWriter( session, source, realType, 0, sizes, rank );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != writer );
+    err = Fieldml_WriteDoubleSlab( writer, offsets, writeSizes, values );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    Fieldml_CloseWriter( writer );
+    
+    FILE *unwritten = fopen( shardNames[1], "rb" );
+    SIMPLE_ASSERT( unwritten == NULL );
+    
+    writer = Fieldml_OpenArrayWriter( session, source, realType, 0, sizes, rank );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != writer );
+    offsets[0] = 4;
+    writeSizes[0] = 8;
+    err = Fieldml_WriteDoubleSlab( writer, offsets, writeSizes, values + ( 4 * columnCount ) );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    
+    //There's no shard for rows past the end of the manifest.
+    offsets[0] = 12;
+    writeSizes[0] = 1;
+    err = Fieldml_WriteDoubleSlab( writer, offsets, writeSizes, values );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_WRITE_ERROR, err );
+    Fieldml_CloseWriter( writer );
+    
+    for( int pass = 0; pass < 2; pass++ )
+    {
+        Fieldml_SetDataCacheLimit( session, pass * 1024 * 1024 );
+        
+        FmlReaderHandle reader = Fieldml_OpenReader( session, source );
+        SIMPLE_ASSERT( FML_INVALID_HANDLE != reader );
+        
+        double readValues[rowCount * columnCount];
+        offsets[0] = 0;
+        err = Fieldml_ReadDoubleSlab( reader, offsets, sizes, readValues );
+        SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+        for( int i = 0; i < rowCount * columnCount; i++ )
+        {
+            SIMPLE_ASSERT_EQUALS( values[i], readValues[i] );
+        }
+        
+        //Rows 2 to 9 take in part of every shard.
+        int slabOffsets[rank] = { 2, 1 };
+        int slabSizes[rank] = { 8, 2 };
+        float floats[16];
+        err = Fieldml_ReadFloatSlab( reader, slabOffsets, slabSizes, floats );
+        SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+        for( int row = 0; row < 8; row++ )
+        {
+            for( int column = 0; column < 2; column++ )
+            {
+                SIMPLE_ASSERT_EQUALS( (float)values[( ( row + 2 ) * columnCount ) + column + 1], floats[( row * 2 ) + column] );
+            }
+        }
+        
+        Fieldml_CloseReader( reader );
+    }
+    
+    //Slabs that start before the first row, are empty, or run past the manifest's last row are refused.
+    Fieldml_SetDataCacheLimit( session, 0 );
+    FmlReaderHandle reader = Fieldml_OpenReader( session, source );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != reader );
+    double readValues[rowCount * columnCount];
+    int badOffsets[4][rank] = { { -1, 0 }, { 0, 0 }, { 10, 0 }, { 0, -1 } };
+    int badSizes[4][rank] = { { 2, columnCount }, { 0, columnCount }, { 3, columnCount }, { 2, columnCount } };
+    for( int i = 0; i < 4; i++ )
+    {
+        err = Fieldml_ReadDoubleSlab( reader, badOffsets[i], badSizes[i], readValues );
+        SIMPLE_ASSERT_EQUALS( FML_IOERR_INVALID_PARAMETER, err );
+    }
+    Fieldml_CloseReader( reader );
+    
+    //Manifests can be supplied along with the reader, like any other resource's contents.
+    FmlObjectHandle bufferResource = Fieldml_CreateHrefDataResource( session, "test.buffered", "SHARDED", "unused.manifest" );
+    FmlObjectHandle bufferSource = Fieldml_CreateArrayDataSource( session, "test.bufferSource", bufferResource, "1", rank );
+    Fieldml_SetArrayDataSourceRawSizes( session, bufferSource, sizes );
+    const string manifest = string( "7 5 PLAIN_TEXT " ) + shardNames[2] + "\n";
+    reader = Fieldml_OpenReaderWithBuffer( session, bufferSource, (void*)manifest.c_str() );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != reader );
+    double lastRow[columnCount];
+    offsets[0] = 11;
+    int rowSizes[rank] = { 1, columnCount };
+    err = Fieldml_ReadDoubleSlab( reader, offsets, rowSizes, lastRow );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    SIMPLE_ASSERT_EQUALS( values[11 * columnCount], lastRow[0] );
+    offsets[0] = 6;
+    err = Fieldml_ReadDoubleSlab( reader, offsets, rowSizes, lastRow );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_READ_ERROR, err );
+    Fieldml_CloseReader( reader );
+    
+    Fieldml_Destroy( session );
+    
+    remove( manifestName );
+    for( int i = 0; i < 3; i++ )
+    {
+        remove( shardNames[i] );
+    }
+}
+
+
+/**
+ * Ensure that inline data views, and readers reading inline data in place, outlive the session they came from.
+ */
+SIMPLE_TEST( FieldmlDataInlineViewLifetimeTest )
+{
+    FmlSessionHandle session = Fieldml_Create( "test_path", "test" );
+    Fieldml_SetDebug( session, 0 );
+    SIMPLE_ASSERT( session != FML_INVALID_HANDLE );
+    
+    FmlObjectHandle resource = Fieldml_CreateInlineDataResource( session, "test.resource" );
+    
+    const int rank = 2;
+    const int totalSize = 6;
+    FmlObjectHandle source = Fieldml_CreateArrayDataSource( session, "test.source", resource, "1", rank );
+    int sizes[rank] = { 2, 3 };
+    Fieldml_SetArrayDataSourceRawSizes( session, source, sizes );
+    Fieldml_SetArrayDataSourceSizes( session, source, sizes );
+    const string rawData = "1 2 3\n4 5 6\n";
+    int err = Fieldml_SetInlineData( session, resource, rawData.c_str(), rawData.length() );
+    SIMPLE_ASSERT_EQUALS( FML_ERR_NO_ERROR, err );
+    
+    int length;
+    const char *view = Fieldml_OpenInlineDataView( session, resource, &length );
+    SIMPLE_ASSERT( view != NULL );
+    
+    FmlReaderHandle reader = Fieldml_OpenReader( session, source );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != reader );
+    
+    Fieldml_Destroy( session );
+    
+    SIMPLE_ASSERT_EQUALS( (int)rawData.length(), length );
+    SIMPLE_ASSERT( string( view, length ) == rawData );
+    err = Fieldml_CloseInlineDataView( session, resource, view );
+    SIMPLE_ASSERT_EQUALS( FML_ERR_NO_ERROR, err );
+    
+    int offsets[rank] = { 0, 0 };
+    int buffer[totalSize];
+    err = Fieldml_ReadIntSlab( reader, offsets, sizes, buffer );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    for( int i = 0; i < totalSize; i++ )
+    {
+        SIMPLE_ASSERT_EQUALS( i + 1, buffer[i] );
+    }
+    
+    err = Fieldml_CloseReader( reader );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+}
+
+
+static string readWholeFile( const char *filename )
+{
+    string contents;
+    FILE *file = fopen( filename, "rb" );
+    if( file == NULL )
+    {
+        return contents;
+    }
+    
+    char chunk[65536];
+    size_t count;
+    while( ( count = fread( chunk, 1, sizeof( chunk ), file ) ) > 0 )
+    {
+        contents.append( chunk, count );
+    }
+    fclose( file );
+    
+    return contents;
+}
+
+
+/**
+ * Ensure that large text file writes formatted on several threads read back, and match those formatted on one.
+ */
+SIMPLE_TEST( FieldmlDataParallelTextWriteTest )
+{
+    const char *filename = "parallel_write_test.txt";
+    
+    FmlSessionHandle session = Fieldml_Create( "test_path", "test" );
+    Fieldml_SetDebug( session, 0 );
+    SIMPLE_ASSERT( session != FML_INVALID_HANDLE );
+    
+    //Enough values for several batches of chunks on every thread, and some left over.
+    const int rank = 2;
+    int sizes[rank] = { 1000, 1025 };
+    const int totalSize = sizes[0] * sizes[1];
+    int offsets[rank] = { 0, 0 };
+    
+    FmlObjectHandle realType = Fieldml_CreateContinuousType( session, "test.real" );
+    FmlObjectHandle resource = Fieldml_CreateHrefDataResource( session, "test.resource", "PLAIN_TEXT", filename );
+    FmlObjectHandle source = Fieldml_CreateArrayDataSource( session, "test.source", resource, "1", rank );
+    Fieldml_SetArrayDataSourceRawSizes( session, source, sizes );
+    Fieldml_SetArrayDataSourceSizes( session, source, sizes );
+    
+    vector<double> values( totalSize );
+    for( int i = 0; i < totalSize; i++ )
+    {
+        values[i] = ( i * 0.37 ) - 12345.5;
+    }
+    
+    SIMPLE_ASSERT( FML_IOERR_NO_ERROR != Fieldml_SetTextWriterThreads( -1 ) );
+    
+    //The last pass writes two slabs, so that the second reuses the first one's threads and buffers.
+    string contents[3];
+    const int threadCounts[3] = { 4, 1, 4 };
+    const int slabCounts[3] = { 1, 1, 2 };
+    for( int pass = 0; pass < 3; pass++ )
+    {
+        int err = Fieldml_SetTextWriterThreads( threadCounts[pass] );
+        SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+        
+        FmlWriterHandle writer = Fieldml_OpenArrayWriter( session, source, realType, 0, sizes, rank );
+        SIMPLE_ASSERT( FML_INVALID_HANDLE != writer );
+        int slabOffsets[rank] = { 0, 0 };
+        int slabSizes[rank] = { sizes[0] / slabCounts[pass], sizes[1] };
+        for( int slab = 0; slab < slabCounts[pass]; slab++ )
+        {
+            slabOffsets[0] = slab * slabSizes[0];
+            err = Fieldml_WriteDoubleSlab( writer, slabOffsets, slabSizes, &values[slabOffsets[0] * sizes[1]] );
+            SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+        }
+        err = Fieldml_CloseWriter( writer );
+        SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+        
+        contents[pass] = readWholeFile( filename );
+    }
+    Fieldml_SetTextWriterThreads( 0 );
+    
+    SIMPLE_ASSERT( contents[0].length() > 4 * 1024 * 1024 );
+    SIMPLE_ASSERT( contents[0] == contents[1] );
+    SIMPLE_ASSERT( contents[2] == contents[1] );
+    
+    vector<double> buffer( totalSize, -1 );
+    FmlReaderHandle reader = Fieldml_OpenReader( session, source );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != reader );
+    int err = Fieldml_ReadDoubleSlab( reader, offsets, sizes, &buffer[0] );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    Fieldml_CloseReader( reader );
+    
+    int mismatches = 0;
+    for( int i = 0; i < totalSize; i++ )
+    {
+        if( buffer[i] != values[i] )
+        {
+            mismatches++;
+        }
+    }
+    SIMPLE_ASSERT_EQUALS( 0, mismatches );
+    
+    Fieldml_Destroy( session );
+    remove( filename );
+}
+
+
+/**
+ * Ensure that the decoded data cache is shared between readers, and is discarded when the resource is rewritten.
+ */
+SIMPLE_TEST( FieldmlDataArrayCacheTest )
+{
+    FmlSessionHandle session = Fieldml_Create( "test_path", "test" );
+    Fieldml_SetDebug( session, 0 );
+    SIMPLE_ASSERT( session != FML_INVALID_HANDLE );
+    
+    FmlObjectHandle resource = Fieldml_CreateInlineDataResource( session, "test.resource" );
+
+    const int rank = 2;
+    const int totalSize = 12;
+    FmlObjectHandle source = Fieldml_CreateArrayDataSource( session, "test.source", resource, "1", rank );
+    
+    int sizes[rank] = { 3, 4 };
+    Fieldml_SetArrayDataSourceRawSizes( session, source, sizes );
+    const string rawData = "1 2 3 4\n5 6 7 8\n9 10 11 12\n";
+    int err = Fieldml_SetInlineData( session, resource, rawData.c_str(), rawData.length() );
+    SIMPLE_ASSERT_EQUALS( FML_ERR_NO_ERROR, err );
+    
+    err = Fieldml_SetDataCacheLimit( session, 1024 * 1024 );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+
+    int readOffsets[rank] = { 0, 0 };
+    int readSizes[rank] = { 3, 4 };
+    int buffer[totalSize];
+    
+    int64_t hits, misses, bytesUsed;
+    for( int pass = 0; pass < 2; pass++ )
+    {
+        FmlObjectHandle reader = Fieldml_OpenReader( session, source );
+        SIMPLE_ASSERT( FML_INVALID_HANDLE != reader );
+        
+        for( int i = 0; i < totalSize; i++ ) buffer[i] = -1;
+        err = Fieldml_ReadIntSlab( reader, readOffsets, readSizes, buffer );
+        SIMPLE_ASSERT_EQUALS( FML_ERR_NO_ERROR, err );
+        for( int i = 0; i < totalSize; i++ )
+        {
+            SIMPLE_ASSERT_EQUALS( i + 1, buffer[i] );
+        }
+        
+        Fieldml_CloseReader( reader );
+    }
+    
+    err = Fieldml_GetDataCacheStatistics( session, &hits, &misses, &bytesUsed );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    SIMPLE_ASSERT_EQUALS( 1, (int)hits );
+    SIMPLE_ASSERT_EQUALS( 1, (int)misses );
+    SIMPLE_ASSERT_EQUALS( (int)( totalSize * sizeof( int ) ), (int)bytesUsed );
+    
+    //A partial read from the cache.
+    FmlObjectHandle reader = Fieldml_OpenReader( session, source );
+    readOffsets[0] = 1;
+    readSizes[0] = 2;
+    readOffsets[1] = 2;
+    readSizes[1] = 1;
+    err = Fieldml_ReadIntSlab( reader, readOffsets, readSizes, buffer );
+    SIMPLE_ASSERT_EQUALS( FML_ERR_NO_ERROR, err );
+    SIMPLE_ASSERT_EQUALS( 7, buffer[0] );
+    SIMPLE_ASSERT_EQUALS( 11, buffer[1] );
+    Fieldml_CloseReader( reader );
+
+    //Writing to the resource must discard its cached data.
+    FmlObjectHandle realType = Fieldml_CreateContinuousType( session, "test.real" );
+    FmlObjectHandle writer = Fieldml_OpenArrayWriter( session, source, realType, 0, sizes, rank );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != writer );
+    Fieldml_GetDataCacheStatistics( session, &hits, &misses, &bytesUsed );
+    SIMPLE_ASSERT_EQUALS( 0, (int)bytesUsed );
+    Fieldml_CloseWriter( writer );
+    
+    err = Fieldml_ClearDataCache( session );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    
+    Fieldml_Destroy( session );
+    
+    err = Fieldml_SetDataCacheLimit( session, 1024 );
+    SIMPLE_ASSERT( FML_IOERR_NO_ERROR != err );
+}
+
+
+/**
+ * Ensure that cached data is not used once the resource's inline data has been changed through the core API.
+ */
+SIMPLE_TEST( FieldmlDataArrayCacheInlineChangeTest )
+{
+    FmlSessionHandle session = Fieldml_Create( "test_path", "test" );
+    Fieldml_SetDebug( session, 0 );
+    SIMPLE_ASSERT( session != FML_INVALID_HANDLE );
+    
+    FmlObjectHandle resource = Fieldml_CreateInlineDataResource( session, "test.resource" );
+
+    const int rank = 2;
+    const int totalSize = 6;
+    FmlObjectHandle source = Fieldml_CreateArrayDataSource( session, "test.source", resource, "1", rank );
+    
+    int sizes[rank] = { 2, 3 };
+    Fieldml_SetArrayDataSourceRawSizes( session, source, sizes );
+    const string rawData = "1 2 3\n4 5 6\n";
+    int err = Fieldml_SetInlineData( session, resource, rawData.c_str(), rawData.length() );
+    SIMPLE_ASSERT_EQUALS( FML_ERR_NO_ERROR, err );
+    const int generation = Fieldml_GetDataResourceGeneration( session, resource );
+    SIMPLE_ASSERT( generation >= 0 );
+    
+    err = Fieldml_SetDataCacheLimit( session, 1024 * 1024 );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+
+    int readOffsets[rank] = { 0, 0 };
+    int buffer[totalSize];
+    
+    FmlObjectHandle reader = Fieldml_OpenReader( session, source );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != reader );
+    err = Fieldml_ReadIntSlab( reader, readOffsets, sizes, buffer );
+    SIMPLE_ASSERT_EQUALS( FML_ERR_NO_ERROR, err );
+    SIMPLE_ASSERT_EQUALS( 6, buffer[5] );
+    Fieldml_CloseReader( reader );
+    
+    const string newData = "10 20 30\n40 50 60\n";
+    err = Fieldml_SetInlineData( session, resource, newData.c_str(), newData.length() );
+    SIMPLE_ASSERT_EQUALS( FML_ERR_NO_ERROR, err );
+    SIMPLE_ASSERT_EQUALS( generation + 1, Fieldml_GetDataResourceGeneration( session, resource ) );
+
+    reader = Fieldml_OpenReader( session, source );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != reader );
+    err = Fieldml_ReadIntSlab( reader, readOffsets, sizes, buffer );
+    SIMPLE_ASSERT_EQUALS( FML_ERR_NO_ERROR, err );
+    for( int i = 0; i < totalSize; i++ )
+    {
+        SIMPLE_ASSERT_EQUALS( ( i + 1 ) * 10, buffer[i] );
+    }
+    Fieldml_CloseReader( reader );
+    
+    //Appending is a change too.
+    err = Fieldml_AddInlineData( session, resource, " ", 1 );
+    SIMPLE_ASSERT_EQUALS( FML_ERR_NO_ERROR, err );
+    SIMPLE_ASSERT_EQUALS( generation + 2, Fieldml_GetDataResourceGeneration( session, resource ) );
+
+    //Only the blocks decoded from the latest data are kept.
+    int64_t hits, misses, bytesUsed;
+    reader = Fieldml_OpenReader( session, source );
+    Fieldml_GetDataCacheStatistics( session, &hits, &misses, &bytesUsed );
+    SIMPLE_ASSERT_EQUALS( 0, (int)bytesUsed );
+    Fieldml_CloseReader( reader );
+    
+    SIMPLE_ASSERT_EQUALS( -1, Fieldml_GetDataResourceGeneration( session, source ) );
+    
+    Fieldml_Destroy( session );
+}
+
+
+/**
+ * Ensure that newly created HDF5 data sources have the correct state.
+ */
+SIMPLE_TEST( FieldmlDataHdf5ArrayCreateTest )
+{
+    const int MAX_STRLEN = 255;
+    char *strbuf = (char*)malloc(MAX_STRLEN);
+
+    FmlSessionHandle session = Fieldml_Create( "test_path", "test" );
+    Fieldml_SetDebug( session, 0 );
+    SIMPLE_ASSERT( session != FML_INVALID_HANDLE );
+    
+    FmlObjectHandle resource = Fieldml_CreateHrefDataResource( session, "test.resource", "HDF5", ".\\input\\I16BE.h5" );
+
+    const int rank = 3;
+    FmlObjectHandle source = Fieldml_CreateArrayDataSource( session, "test.source", resource, "ArrayReadTestData", rank );
+    
+    int err = Fieldml_AddInlineData( session, resource, "foo", 3 );
+    SIMPLE_ASSERT( FML_ERR_NO_ERROR != err );
+    
+    Fieldml_CopyDataResourceFormat( session, resource, strbuf, MAX_STRLEN );
+    SIMPLE_ASSERT_EQUALS( "HDF5", strbuf );
+    
+    int testRank = Fieldml_GetArrayDataSourceRank( session, source );
+    SIMPLE_ASSERT_EQUALS( rank, testRank );
+    
+    int length = Fieldml_CopyArrayDataSourceLocation( session, source, strbuf, MAX_STRLEN );
+    SIMPLE_ASSERT_EQUALS( 17, length );
+    SIMPLE_ASSERT_EQUALS( "ArrayReadTestData", strbuf );
+    
+    memset( strbuf, 0, MAX_STRLEN );
+    int llength = Fieldml_CopyInlineData( session, resource, strbuf, MAX_STRLEN, 0 );
+    SIMPLE_ASSERT_EQUALS( -1, llength );
+    
+    Fieldml_Destroy( session );
+}
+
+
+/**
+ * Ensure that various kinds of reads work with arrays based on inline text resources.
+ */
+SIMPLE_TEST( FieldmlDataHdf5ArrayReadTest )
+{
+    FmlSessionHandle session = Fieldml_Create( "test_path", "test" );
+    Fieldml_SetDebug( session, 0 );
+    SIMPLE_ASSERT( session != FML_INVALID_HANDLE );
+    
+    FmlObjectHandle resource = Fieldml_CreateHrefDataResource( session, "test.resource", "HDF5", "./input/I16BE.h5" );
+
+    const int rank = 3;
+    const int totalSize = 60;
+    FmlObjectHandle source = Fieldml_CreateArrayDataSource( session, "test.source", resource, "ArrayReadTestData", rank );
+
+    int readOffsets[rank] = { 0, 0, 0 };
+    int readSizes[rank] = { 3, 4, 5 };
+    double buffer[totalSize];
+    int fakeBuffer[1];
+    
+    FmlObjectHandle reader = Fieldml_OpenReader( session, source );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != reader );
+    
+    FmlErrorNumber err = Fieldml_ReadIntSlab( reader, readOffsets, readSizes, fakeBuffer );
+    SIMPLE_ASSERT( FML_ERR_NO_ERROR != err );
+    
+    for( int i = 0; i < totalSize; i++ ) buffer[i] = -1;
+    err = Fieldml_ReadDoubleSlab( reader, readOffsets, readSizes, buffer );
+    SIMPLE_ASSERT_EQUALS( FML_ERR_NO_ERROR, err );
+    
+    double expected;
+    for( int i = 0; i < totalSize; i++ )
+    {
+        int x = ( ( i % 60 ) / 20 ) + readOffsets[0];
+        int y = ( ( i % 20 ) / 5 ) + readOffsets[1];
+        int z = ( ( i % 5 ) / 1 ) + readOffsets[2];
+        
+        expected = ( 100.0 * x ) + ( 10.0 * y ) + ( 1.0 * z );
+        
+        SIMPLE_ASSERT_EQUALS( expected, buffer[i] );
+    }
+
+    readOffsets[0] = 1;
+    readSizes[0] = 1;
+    
+    for( int i = 0; i < totalSize; i++ ) buffer[i] = -1;
+    err = Fieldml_ReadDoubleSlab( reader, readOffsets, readSizes, buffer );
+    SIMPLE_ASSERT_EQUALS( FML_ERR_NO_ERROR, err );
+    
+    for( int i = 0; i < 20; i++ )
+    {
+        int x = ( ( i % 20 ) / 20 ) + readOffsets[0];
+        int y = ( ( i % 20 ) / 5 ) + readOffsets[1];
+        int z = ( ( i % 5 ) / 1 ) + readOffsets[2];
+        
+        expected = ( 100.0 * x ) + ( 10.0 * y ) + ( 1.0 * z );
+        
+        SIMPLE_ASSERT_EQUALS( expected, buffer[i] );
+    }
+    
+    readOffsets[0] = 0;
+    readSizes[0] = 2;
+    readOffsets[1] = 1;
+    readSizes[1] = 2;
+    readOffsets[2] = 2;
+    readSizes[2] = 1;
+    for( int i = 0; i < totalSize; i++ ) buffer[i] = -1;
+    err = Fieldml_ReadDoubleSlab( reader, readOffsets, readSizes, buffer );
+    SIMPLE_ASSERT_EQUALS( FML_ERR_NO_ERROR, err );
+
+    for( int i = 0; i < 4; i++ )
+    {
+        int x = ( ( i % 4 ) / 2 ) + readOffsets[0];
+        int y = ( ( i % 2 ) / 1 ) + readOffsets[1];
+        int z = ( ( i % 1 ) / 1 ) + readOffsets[2];
+        
+        expected = ( 100.0 * x ) + ( 10.0 * y ) + ( 1.0 * z );
+        
+        SIMPLE_ASSERT_EQUALS( expected, (buffer[i]) );
+    }
+    
+    Fieldml_CloseReader( reader );
+    
+    //Row iteration takes its extents from the dataset.
+    reader = Fieldml_OpenRowIterator( session, source );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != reader );
+    
+    int rowCount = 0;
+    int rows;
+    while( ( rows = Fieldml_ReadNextRows( reader, 2, buffer ) ) > 0 )
+    {
+        for( int i = 0; i < rows * 20; i++ )
+        {
+            int x = ( i / 20 ) + rowCount;
+            int y = ( i % 20 ) / 5;
+            int z = i % 5;
+            
+            expected = ( 100.0 * x ) + ( 10.0 * y ) + ( 1.0 * z );
+            
+            SIMPLE_ASSERT_EQUALS( expected, buffer[i] );
+        }
+        rowCount += rows;
+    }
+    SIMPLE_ASSERT_EQUALS( 0, rows );
+    SIMPLE_ASSERT_EQUALS( 3, rowCount );
+    
+    Fieldml_CloseReader( reader );
+    
+    //Extents taken from the dataset leave out the source's offsets into it.
+    FmlObjectHandle offsetSource = Fieldml_CreateArrayDataSource( session, "test.offset_source", resource, "ArrayReadTestData", rank );
+    int sourceOffsets[rank] = { 1, 1, 2 };
+    err = Fieldml_SetArrayDataSourceOffsets( session, offsetSource, sourceOffsets );
+    SIMPLE_ASSERT_EQUALS( FML_ERR_NO_ERROR, err );
+    
+    reader = Fieldml_OpenRowIterator( session, offsetSource );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != reader );
+    
+    rowCount = 0;
+    while( ( rows = Fieldml_ReadNextRows( reader, 1, buffer ) ) > 0 )
+    {
+        for( int i = 0; i < 9; i++ )
+        {
+            int x = rowCount + 1;
+            int y = ( i / 3 ) + 1;
+            int z = ( i % 3 ) + 2;
+            
+            expected = ( 100.0 * x ) + ( 10.0 * y ) + ( 1.0 * z );
+            
+            SIMPLE_ASSERT_EQUALS( expected, buffer[i] );
+        }
+        rowCount += rows;
+    }
+    SIMPLE_ASSERT_EQUALS( 0, rows );
+    SIMPLE_ASSERT_EQUALS( 2, rowCount );
+    
+    Fieldml_CloseReader( reader );
+
+    Fieldml_Destroy( session );
+}
+
+
+/**
+ * Ensure that HDF5 arrays written with chunking and compression options read back the same as contiguous ones.
+ */
+SIMPLE_TEST( FieldmlDataHdf5ArrayWriteOptionsTest )
+{
+    if( !Fieldml_IsArrayFormatRegistered( "HDF5" ) )
+    {
+        return;
+    }
+    
+    const char *plainFilename = "hdf5_options_plain_test.h5";
+    const char *compressedFilename = "hdf5_options_compressed_test.h5";
+    
+    FmlSessionHandle session = Fieldml_Create( "test_path", "test" );
+    Fieldml_SetDebug( session, 0 );
+    SIMPLE_ASSERT( session != FML_INVALID_HANDLE );
+    
+    FmlObjectHandle realType = Fieldml_CreateContinuousType( session, "test.real" );
+    FmlObjectHandle plainResource = Fieldml_CreateHrefDataResource( session, "test.plain_resource", "HDF5", plainFilename );
+    FmlObjectHandle compressedResource = Fieldml_CreateHrefDataResource( session, "test.compressed_resource", "HDF5", compressedFilename );
+    
+    const int rank = 2;
+    const int rowCount = 2000;
+    const int columnCount = 50;
+    int sizes[rank] = { rowCount, columnCount };
+    FmlObjectHandle plainSource = Fieldml_CreateArrayDataSource( session, "test.plain_source", plainResource, "values", rank );
+    Fieldml_SetArrayDataSourceRawSizes( session, plainSource, sizes );
+    Fieldml_SetArrayDataSourceSizes( session, plainSource, sizes );
+    FmlObjectHandle compressedSource = Fieldml_CreateArrayDataSource( session, "test.compressed_source", compressedResource, "values", rank );
+    Fieldml_SetArrayDataSourceRawSizes( session, compressedSource, sizes );
+    Fieldml_SetArrayDataSourceSizes( session, compressedSource, sizes );
+    FmlObjectHandle chunkedSource = Fieldml_CreateArrayDataSource( session, "test.chunked_source", compressedResource, "chunked", rank );
+    Fieldml_SetArrayDataSourceRawSizes( session, chunkedSource, sizes );
+    Fieldml_SetArrayDataSourceSizes( session, chunkedSource, sizes );
+    
+    vector<double> values( rowCount * columnCount );
+    for( size_t i = 0; i < values.size(); i++ )
+    {
+        values[i] = (double)( i % 7 );
+    }
+    
+    int offsets[rank] = { 0, 0 };
+    FmlWriterHandle writer = Fieldml_OpenArrayWriter( session, plainSource, realType, 0, sizes, rank );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != writer );
+    int err = Fieldml_WriteDoubleSlab( writer, offsets, sizes, &values[0] );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    Fieldml_CloseWriter( writer );
+    
+    //Automatic chunk sizes.
+    FieldmlArrayWriterOptions options;
+    options.chunkSizes = NULL;
+    options.deflateLevel = 6;
+    options.shuffle = 1;
+    options.extendable = 0;
+    options.storageBits = 0;
+    options.pagedFileSpace = 0;
+    writer = Fieldml_OpenArrayWriterWithOptions( session, compressedSource, realType, 0, sizes, rank, &options );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != writer );
+    err = Fieldml_WriteDoubleSlab( writer, offsets, sizes, &values[0] );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    Fieldml_CloseWriter( writer );
+    
+    FILE *file = fopen( plainFilename, "rb" );
+    fseek( file, 0, SEEK_END );
+    long plainLength = ftell( file );
+    fclose( file );
+    file = fopen( compressedFilename, "rb" );
+    fseek( file, 0, SEEK_END );
+    long compressedLength = ftell( file );
+    fclose( file );
+    SIMPLE_ASSERT( compressedLength * 4 < plainLength );
+    
+    //Explicit chunk sizes, the inner one larger than the array, written a few rows at a time.
+    int chunkSizes[rank] = { 128, 1000 };
+    options.chunkSizes = chunkSizes;
+    options.deflateLevel = 1;
+    options.shuffle = 0;
+    writer = Fieldml_OpenArrayWriterWithOptions( session, chunkedSource, realType, 1, sizes, rank, &options );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != writer );
+    const int slabRows = 300;
+    for( int row = 0; row < rowCount; row += slabRows )
+    {
+        int slabOffsets[rank] = { row, 0 };
+        int slabSizes[rank] = { ( row + slabRows > rowCount ) ? ( rowCount - row ) : slabRows, columnCount };
+        err = Fieldml_WriteDoubleSlab( writer, slabOffsets, slabSizes, &values[row * columnCount] );
+        SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    }
+    Fieldml_CloseWriter( writer );
+    
+    FmlObjectHandle readSources[] = { compressedSource, chunkedSource };
+    vector<double> readValues( rowCount * columnCount );
+    for( int s = 0; s < 2; s++ )
+    {
+        FmlReaderHandle reader = Fieldml_OpenReader( session, readSources[s] );
+        SIMPLE_ASSERT( FML_INVALID_HANDLE != reader );
+        
+        for( size_t i = 0; i < readValues.size(); i++ )
+        {
+            readValues[i] = -1;
+        }
+        err = Fieldml_ReadDoubleSlab( reader, offsets, sizes, &readValues[0] );
+        SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+        for( size_t i = 0; i < values.size(); i++ )
+        {
+            SIMPLE_ASSERT_EQUALS( values[i], readValues[i] );
+        }
+        
+        //A read that spans chunk boundaries.
+        int partOffsets[rank] = { 1500, 20 };
+        int partSizes[rank] = { 100, 3 };
+        err = Fieldml_ReadDoubleSlab( reader, partOffsets, partSizes, &readValues[0] );
+        SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+        for( int i = 0; i < 300; i++ )
+        {
+            SIMPLE_ASSERT_EQUALS( values[( 1500 + ( i / 3 ) ) * columnCount + 20 + ( i % 3 )], readValues[i] );
+        }
+        
+        Fieldml_CloseReader( reader );
+    }
+    
+    options.chunkSizes = NULL;
+    options.deflateLevel = 10;
+    writer = Fieldml_OpenArrayWriterWithOptions( session, chunkedSource, realType, 1, sizes, rank, &options );
+    SIMPLE_ASSERT_EQUALS( FML_INVALID_HANDLE, writer );
+    chunkSizes[0] = 0;
+    options.chunkSizes = chunkSizes;
+    options.deflateLevel = 0;
+    writer = Fieldml_OpenArrayWriterWithOptions( session, chunkedSource, realType, 1, sizes, rank, &options );
+    SIMPLE_ASSERT_EQUALS( FML_INVALID_HANDLE, writer );
+    
+    //Just setting the storage size leaves the array contiguous, so the whole array is allocated by the first write,
+    //rather than just the chunk it touches.
+    const char *contiguousFilename = "hdf5_contiguous_test.h5";
+    FmlObjectHandle contiguousResource = Fieldml_CreateHrefDataResource( session, "test.contiguous_resource", "HDF5", contiguousFilename );
+    int contiguousSizes[rank] = { 1000, 1000 };
+    FmlObjectHandle contiguousSource = Fieldml_CreateArrayDataSource( session, "test.contiguous_source", contiguousResource, "values", rank );
+    Fieldml_SetArrayDataSourceRawSizes( session, contiguousSource, contiguousSizes );
+    Fieldml_SetArrayDataSourceSizes( session, contiguousSource, contiguousSizes );
+    options.chunkSizes = NULL;
+    options.storageBits = 32;
+    writer = Fieldml_OpenArrayWriterWithOptions( session, contiguousSource, realType, 0, contiguousSizes, rank, &options );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != writer );
+    int rowSizes[rank] = { 1, 1000 };
+    err = Fieldml_WriteDoubleSlab( writer, offsets, rowSizes, &values[0] );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    Fieldml_CloseWriter( writer );
+    
+    file = fopen( contiguousFilename, "rb" );
+    fseek( file, 0, SEEK_END );
+    long contiguousLength = ftell( file );
+    fclose( file );
+    SIMPLE_ASSERT( contiguousLength >= 1000 * 1000 * 4 );
+    
+    Fieldml_Destroy( session );
+    
+    remove( plainFilename );
+    remove( compressedFilename );
+    remove( contiguousFilename );
+}
+
+
+/**
+ * Ensure that transfer modes are only accepted where they're supported, and that empty slabs transfer nothing.
+ */
+SIMPLE_TEST( FieldmlDataHdf5TransferModeTest )
+{
+    if( !Fieldml_IsArrayFormatRegistered( "HDF5" ) )
+    {
+        return;
+    }
+    
+    const char *filename = "hdf5_transfer_mode_test.h5";
+    
+    FmlSessionHandle session = Fieldml_Create( "test_path", "test" );
+    Fieldml_SetDebug( session, 0 );
+    SIMPLE_ASSERT( session != FML_INVALID_HANDLE );
+    
+    FmlObjectHandle realType = Fieldml_CreateContinuousType( session, "test.real" );
+    FmlObjectHandle resource = Fieldml_CreateHrefDataResource( session, "test.resource", "HDF5", filename );
+    FmlObjectHandle textResource = Fieldml_CreateInlineDataResource( session, "test.text_resource" );
+    Fieldml_AddInlineData( session, textResource, "1 2 3\n", 6 );
+    
+    const int rank = 2;
+    int sizes[rank] = { 4, 3 };
+    FmlObjectHandle source = Fieldml_CreateArrayDataSource( session, "test.source", resource, "values", rank );
+    Fieldml_SetArrayDataSourceRawSizes( session, source, sizes );
+    Fieldml_SetArrayDataSourceSizes( session, source, sizes );
+    int textSizes[rank] = { 1, 3 };
+    FmlObjectHandle textSource = Fieldml_CreateArrayDataSource( session, "test.text_source", textResource, "1", rank );
+    Fieldml_SetArrayDataSourceRawSizes( session, textSource, textSizes );
+    Fieldml_SetArrayDataSourceSizes( session, textSource, textSizes );
+    
+    double values[12] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12 };
+    int offsets[rank] = { 0, 0 };
+    int emptySizes[rank] = { 0, 3 };
+    
+    FmlWriterHandle writer = Fieldml_OpenArrayWriter( session, source, realType, 0, sizes, rank );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != writer );
+    
+    //Collective transfers need the MPI-IO driver, which plain HDF5 files aren't opened with.
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_UNSUPPORTED, Fieldml_SetWriterTransferMode( writer, FML_TRANSFER_MODE_COLLECTIVE ) );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, Fieldml_SetWriterTransferMode( writer, FML_TRANSFER_MODE_INDEPENDENT ) );
+    
+    int err = Fieldml_WriteDoubleSlab( writer, offsets, sizes, values );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    err = Fieldml_WriteDoubleSlab( writer, offsets, emptySizes, values );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    Fieldml_CloseWriter( writer );
+    
+    FmlReaderHandle reader = Fieldml_OpenReader( session, source );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != reader );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_UNSUPPORTED, Fieldml_SetReaderTransferMode( reader, FML_TRANSFER_MODE_COLLECTIVE ) );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, Fieldml_SetReaderTransferMode( reader, FML_TRANSFER_MODE_INDEPENDENT ) );
+    
+    double readValues[12];
+    readValues[0] = -1;
+    err = Fieldml_ReadDoubleSlab( reader, offsets, emptySizes, readValues );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    SIMPLE_ASSERT_EQUALS( -1.0, readValues[0] );
+    
+    err = Fieldml_ReadDoubleSlab( reader, offsets, sizes, readValues );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    for( int i = 0; i < 12; i++ )
+    {
+        SIMPLE_ASSERT_EQUALS( values[i], readValues[i] );
+    }
+    Fieldml_CloseReader( reader );
+    
+    //Other formats only ever transfer independently.
+    reader = Fieldml_OpenReader( session, textSource );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != reader );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_UNSUPPORTED, Fieldml_SetReaderTransferMode( reader, FML_TRANSFER_MODE_COLLECTIVE ) );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, Fieldml_SetReaderTransferMode( reader, FML_TRANSFER_MODE_INDEPENDENT ) );
+    Fieldml_CloseReader( reader );
+    
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_UNKNOWN_OBJECT, Fieldml_SetReaderTransferMode( FML_INVALID_HANDLE, FML_TRANSFER_MODE_INDEPENDENT ) );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_UNKNOWN_OBJECT, Fieldml_SetWriterTransferMode( FML_INVALID_HANDLE, FML_TRANSFER_MODE_INDEPENDENT ) );
+    
+    Fieldml_Destroy( session );
+    
+    remove( filename );
+}
+
+
+/**
+ * Ensure that readers and writers of arrays in the same HDF5 file can be open together, but that a file in use can't be
+ * replaced.
+ */
+SIMPLE_TEST( FieldmlDataHdf5SharedFileTest )
+{
+    if( !Fieldml_IsArrayFormatRegistered( "HDF5" ) )
+    {
+        return;
+    }
+    
+    const char *filename = "hdf5_shared_file_test.h5";
+    
+    FmlSessionHandle session = Fieldml_Create( "test_path", "test" );
+    Fieldml_SetDebug( session, 0 );
+    SIMPLE_ASSERT( session != FML_INVALID_HANDLE );
+    
+    FmlObjectHandle realType = Fieldml_CreateContinuousType( session, "test.real" );
+    FmlObjectHandle resource = Fieldml_CreateHrefDataResource( session, "test.resource", "HDF5", filename );
+    
+    const int rank = 1;
+    int sizes[rank] = { 5 };
+    int offsets[rank] = { 0 };
+    FmlObjectHandle firstSource = Fieldml_CreateArrayDataSource( session, "test.first_source", resource, "first", rank );
+    Fieldml_SetArrayDataSourceRawSizes( session, firstSource, sizes );
+    FmlObjectHandle secondSource = Fieldml_CreateArrayDataSource( session, "test.second_source", resource, "second", rank );
+    Fieldml_SetArrayDataSourceRawSizes( session, secondSource, sizes );
+    
+    double firstValues[5] = { 1, 2, 3, 4, 5 };
+    double secondValues[5] = { 10, 20, 30, 40, 50 };
+    double readValues[5];
+    
+    FmlWriterHandle firstWriter = Fieldml_OpenArrayWriter( session, firstSource, realType, 0, sizes, rank );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != firstWriter );
+    int err = Fieldml_WriteDoubleSlab( firstWriter, offsets, sizes, firstValues );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    
+    //The file is in use, so it can be added to but not replaced.
+    SIMPLE_ASSERT_EQUALS( FML_INVALID_HANDLE, Fieldml_OpenArrayWriter( session, secondSource, realType, 0, sizes, rank ) );
+    FmlWriterHandle secondWriter = Fieldml_OpenArrayWriter( session, secondSource, realType, 1, sizes, rank );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != secondWriter );
+    err = Fieldml_WriteDoubleSlab( secondWriter, offsets, sizes, secondValues );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    
+    //Readers share the writers' handles, so they see what's been written so far.
+    FmlReaderHandle firstReader = Fieldml_OpenReader( session, firstSource );
+    FmlReaderHandle secondReader = Fieldml_OpenReader( session, secondSource );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != firstReader );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != secondReader );
+    err = Fieldml_ReadDoubleSlab( firstReader, offsets, sizes, readValues );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    SIMPLE_ASSERT_EQUALS( 5.0, readValues[4] );
+    err = Fieldml_ReadDoubleSlab( secondReader, offsets, sizes, readValues );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    SIMPLE_ASSERT_EQUALS( 50.0, readValues[4] );
+    
+    Fieldml_CloseWriter( firstWriter );
+    Fieldml_CloseWriter( secondWriter );
+    
+    //Still open for reading after the writers have gone.
+    FmlReaderHandle otherReader = Fieldml_OpenReader( session, firstSource );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != otherReader );
+    err = Fieldml_ReadDoubleSlab( otherReader, offsets, sizes, readValues );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    SIMPLE_ASSERT_EQUALS( 1.0, readValues[0] );
+    
+    Fieldml_CloseReader( firstReader );
+    Fieldml_CloseReader( secondReader );
+    Fieldml_CloseReader( otherReader );
+    
+    //Once nothing is using the file, it can be replaced.
+    secondWriter = Fieldml_OpenArrayWriter( session, secondSource, realType, 0, sizes, rank );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != secondWriter );
+    Fieldml_CloseWriter( secondWriter );
+    SIMPLE_ASSERT_EQUALS( FML_INVALID_HANDLE, Fieldml_OpenReader( session, firstSource ) );
+    
+    Fieldml_Destroy( session );
+    
+    remove( filename );
+}
+
+
+/**
+ * Ensure that files kept open after their readers close are still read correctly when reopened, and don't get in the
+ * way of writers, whether in the same session or another one.
+ */
+SIMPLE_TEST( FieldmlDataHdf5IdleFileTest )
+{
+    if( !Fieldml_IsArrayFormatRegistered( "HDF5" ) )
+    {
+        return;
+    }
+    
+    const char *filename = "hdf5_idle_file_test.h5";
+    
+    FmlSessionHandle sessions[2];
+    FmlObjectHandle realTypes[2];
+    FmlObjectHandle sources[2];
+    const int rank = 1;
+    int sizes[rank] = { 4 };
+    int offsets[rank] = { 0 };
+    for( int s = 0; s < 2; s++ )
+    {
+        sessions[s] = Fieldml_Create( "test_path", "test" );
+        Fieldml_SetDebug( sessions[s], 0 );
+        SIMPLE_ASSERT( sessions[s] != FML_INVALID_HANDLE );
+        realTypes[s] = Fieldml_CreateContinuousType( sessions[s], "test.real" );
+        FmlObjectHandle resource = Fieldml_CreateHrefDataResource( sessions[s], "test.resource", "HDF5", filename );
+        sources[s] = Fieldml_CreateArrayDataSource( sessions[s], "test.source", resource, "values", rank );
+        Fieldml_SetArrayDataSourceRawSizes( sessions[s], sources[s], sizes );
+        Fieldml_SetArrayDataSourceSizes( sessions[s], sources[s], sizes );
+    }
+    
+    double values[4] = { 1, 2, 3, 4 };
+    double readValues[4];
+    FmlWriterHandle writer = Fieldml_OpenArrayWriter( sessions[0], sources[0], realTypes[0], 0, sizes, rank );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != writer );
+    int err = Fieldml_WriteDoubleSlab( writer, offsets, sizes, values );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    Fieldml_CloseWriter( writer );
+    
+    for( int pass = 0; pass < 3; pass++ )
+    {
+        FmlReaderHandle reader = Fieldml_OpenReader( sessions[0], sources[0] );
+        SIMPLE_ASSERT( FML_INVALID_HANDLE != reader );
+        err = Fieldml_ReadDoubleSlab( reader, offsets, sizes, readValues );
+        SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+        SIMPLE_ASSERT_EQUALS( values[3], readValues[3] );
+        Fieldml_CloseReader( reader );
+        
+        //The file is idle in the first session, and each pass writes to it from a different place.
+        for( int i = 0; i < 4; i++ )
+        {
+            values[i] += 10;
+        }
+        const int s = pass % 2;
+        writer = Fieldml_OpenArrayWriter( sessions[s], sources[s], realTypes[s], ( pass == 2 ) ? 0 : 1, sizes, rank );
+        SIMPLE_ASSERT( FML_INVALID_HANDLE != writer );
+        err = Fieldml_WriteDoubleSlab( writer, offsets, sizes, values );
+        SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+        Fieldml_CloseWriter( writer );
+    }
+    
+    //Changing the cache options and destroying the first session both let go of its idle file.
+    FmlReaderHandle reader = Fieldml_OpenReader( sessions[0], sources[0] );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != reader );
+    Fieldml_CloseReader( reader );
+    FieldmlHdf5CacheOptions options = { 0, 0, -1, 0, 0 };
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, Fieldml_SetHdf5CacheOptions( sessions[0], &options ) );
+    reader = Fieldml_OpenReader( sessions[0], sources[0] );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != reader );
+    err = Fieldml_ReadDoubleSlab( reader, offsets, sizes, readValues );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    SIMPLE_ASSERT_EQUALS( values[0], readValues[0] );
+    Fieldml_CloseReader( reader );
+    Fieldml_Destroy( sessions[0] );
+    
+    reader = Fieldml_OpenReader( sessions[1], sources[1] );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != reader );
+    err = Fieldml_ReadDoubleSlab( reader, offsets, sizes, readValues );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    SIMPLE_ASSERT_EQUALS( values[3], readValues[3] );
+    Fieldml_CloseReader( reader );
+    Fieldml_Destroy( sessions[1] );
+    
+    remove( filename );
+}
+
+
+/**
+ * Ensure that prepared reads of identically shaped slabs match ordinary reads, and that HDF5 readers switch between
+ * slab shapes correctly.
+ */
+SIMPLE_TEST( FieldmlDataPreparedReadTest )
+{
+    const char *textFilename = "prepared_read_test.txt";
+    const char *hdf5Filename = "prepared_read_test.h5";
+    const bool hasHdf5 = ( Fieldml_IsArrayFormatRegistered( "HDF5" ) == 1 );
+    
+    FmlSessionHandle session = Fieldml_Create( "test_path", "test" );
+    Fieldml_SetDebug( session, 0 );
+    SIMPLE_ASSERT( session != FML_INVALID_HANDLE );
+    
+    FmlObjectHandle realType = Fieldml_CreateContinuousType( session, "test.real" );
+    FmlObjectHandle textResource = Fieldml_CreateHrefDataResource( session, "test.text_resource", "PLAIN_TEXT", textFilename );
+    FmlObjectHandle hdf5Resource = Fieldml_CreateHrefDataResource( session, "test.hdf5_resource", hasHdf5 ? "HDF5" : "PLAIN_TEXT", hdf5Filename );
+    
+    const int rank = 2;
+    const int rowCount = 100;
+    const int columnCount = 4;
+    int sizes[rank] = { rowCount, columnCount };
+    FmlObjectHandle textSource = Fieldml_CreateArrayDataSource( session, "test.text_source", textResource, "1", rank );
+    Fieldml_SetArrayDataSourceRawSizes( session, textSource, sizes );
+    Fieldml_SetArrayDataSourceSizes( session, textSource, sizes );
+    FmlObjectHandle hdf5Source = Fieldml_CreateArrayDataSource( session, "test.hdf5_source", hdf5Resource, hasHdf5 ? "values" : "1", rank );
+    Fieldml_SetArrayDataSourceRawSizes( session, hdf5Source, sizes );
+    Fieldml_SetArrayDataSourceSizes( session, hdf5Source, sizes );
+    
+    double values[rowCount * columnCount];
+    for( int i = 0; i < rowCount * columnCount; i++ )
+    {
+        values[i] = i * 1.5;
+    }
+    
+    int offsets[rank] = { 0, 0 };
+    FmlObjectHandle sources[2] = { textSource, hdf5Source };
+    for( int s = 0; s < 2; s++ )
+    {
+        FmlWriterHandle writer = Fieldml_OpenArrayWriter( session, sources[s], realType, 0, sizes, rank );
+        SIMPLE_ASSERT( FML_INVALID_HANDLE != writer );
+        int err = Fieldml_WriteDoubleSlab( writer, offsets, sizes, values );
+        SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+        Fieldml_CloseWriter( writer );
+    }
+    
+    double readValues[rowCount * columnCount];
+    for( int s = 0; s < 2; s++ )
+    {
+        FmlReaderHandle reader = Fieldml_OpenReader( session, sources[s] );
+        SIMPLE_ASSERT( FML_INVALID_HANDLE != reader );
+        
+        int rowOffsets[rank] = { 0, 1 };
+        SIMPLE_ASSERT_EQUALS( FML_IOERR_UNSUPPORTED, Fieldml_ReadPreparedDoubleSlab( reader, rowOffsets, readValues ) );
+        
+        //Part of each row, one row at a time.
+        int rowSizes[rank] = { 1, 2 };
+        int err = Fieldml_PrepareSlabReads( reader, rowSizes );
+        SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+        for( int row = 0; row < rowCount; row++ )
+        {
+            rowOffsets[0] = row;
+            err = Fieldml_ReadPreparedDoubleSlab( reader, rowOffsets, readValues );
+            SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+            SIMPLE_ASSERT_EQUALS( values[row * columnCount + 1], readValues[0] );
+            SIMPLE_ASSERT_EQUALS( values[row * columnCount + 2], readValues[1] );
+        }
+        
+        //Ordinary reads of other shapes in between don't disturb prepared ones.
+        int blockOffsets[rank] = { 10, 0 };
+        int blockSizes[rank] = { 3, columnCount };
+        err = Fieldml_ReadDoubleSlab( reader, blockOffsets, blockSizes, readValues );
+        SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+        SIMPLE_ASSERT_EQUALS( values[12 * columnCount + 3], readValues[11] );
+        
+        rowOffsets[0] = 50;
+        err = Fieldml_ReadPreparedDoubleSlab( reader, rowOffsets, readValues );
+        SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+        SIMPLE_ASSERT_EQUALS( values[50 * columnCount + 1], readValues[0] );
+        
+        //Slabs that run off the end of the array fail.
+        rowOffsets[1] = 3;
+        SIMPLE_ASSERT( FML_IOERR_NO_ERROR != Fieldml_ReadPreparedDoubleSlab( reader, rowOffsets, readValues ) );
+        
+        //Preparing again replaces the sizes.
+        int columnSizes[rank] = { rowCount, 1 };
+        err = Fieldml_PrepareSlabReads( reader, columnSizes );
+        SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+        int columnOffsets[rank] = { 0, 3 };
+        err = Fieldml_ReadPreparedDoubleSlab( reader, columnOffsets, readValues );
+        SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+        for( int row = 0; row < rowCount; row++ )
+        {
+            SIMPLE_ASSERT_EQUALS( values[row * columnCount + 3], readValues[row] );
+        }
+        
+        Fieldml_CloseReader( reader );
+    }
+    
+    int rowSizes[rank] = { 1, 2 };
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_UNKNOWN_OBJECT, Fieldml_PrepareSlabReads( FML_INVALID_HANDLE, rowSizes ) );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_UNKNOWN_OBJECT, Fieldml_ReadPreparedDoubleSlab( FML_INVALID_HANDLE, offsets, readValues ) );
+    
+    Fieldml_Destroy( session );
+    
+    remove( textFilename );
+    remove( hdf5Filename );
+}
+
+
+/**
+ * Ensure that strided slabs, lists of slabs and lists of points are read correctly by every format, with and without
+ * the decoded data cache.
+ */
+SIMPLE_TEST( FieldmlDataGatherReadTest )
+{
+    const char *textFilename = "gather_read_test.txt";
+    const char *rawFilename = "gather_read_test.raw";
+    const char *hdf5Filename = "gather_read_test.h5";
+    const bool hasHdf5 = ( Fieldml_IsArrayFormatRegistered( "HDF5" ) == 1 );
+    
+    FmlSessionHandle session = Fieldml_Create( "test_path", "test" );
+    Fieldml_SetDebug( session, 0 );
+    SIMPLE_ASSERT( session != FML_INVALID_HANDLE );
+    
+    FmlObjectHandle realType = Fieldml_CreateContinuousType( session, "test.real" );
+    FmlObjectHandle textResource = Fieldml_CreateHrefDataResource( session, "test.text_resource", "PLAIN_TEXT", textFilename );
+    FmlObjectHandle rawResource = Fieldml_CreateHrefDataResource( session, "test.raw_resource", "RAW_BINARY", rawFilename );
+    FmlObjectHandle hdf5Resource = Fieldml_CreateHrefDataResource( session, "test.hdf5_resource", hasHdf5 ? "HDF5" : "PLAIN_TEXT", hdf5Filename );
+    
+    const int rank = 3;
+    int sizes[rank] = { 6, 5, 4 };
+    FmlObjectHandle sources[3];
+    sources[0] = Fieldml_CreateArrayDataSource( session, "test.text_source", textResource, "1", rank );
+    sources[1] = Fieldml_CreateArrayDataSource( session, "test.raw_source", rawResource, "", rank );
+    sources[2] = Fieldml_CreateArrayDataSource( session, "test.hdf5_source", hdf5Resource, hasHdf5 ? "values" : "1", rank );
+    
+    double values[6 * 5 * 4];
+    for( int i = 0; i < 6 * 5 * 4; i++ )
+    {
+        values[i] = i * 0.5;
+    }
+    
+    int offsets[rank] = { 0, 0, 0 };
+    for( int s = 0; s < 3; s++ )
+    {
+        Fieldml_SetArrayDataSourceRawSizes( session, sources[s], sizes );
+        Fieldml_SetArrayDataSourceSizes( session, sources[s], sizes );
+        
+        FmlWriterHandle writer = Fieldml_OpenArrayWriter( session, sources[s], realType, 0, sizes, rank );
+        SIMPLE_ASSERT( FML_INVALID_HANDLE != writer );
+        int err = Fieldml_WriteDoubleSlab( writer, offsets, sizes, values );
+        SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+        Fieldml_CloseWriter( writer );
+    }
+    
+    double readValues[6 * 5 * 4];
+    for( int pass = 0; pass < 2; pass++ )
+    {
+        if( pass == 1 )
+        {
+            SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, Fieldml_SetDataCacheLimit( session, 1024 * 1024 ) );
+        }
+        
+        for( int s = 0; s < 3; s++ )
+        {
+            FmlReaderHandle reader = Fieldml_OpenReader( session, sources[s] );
+            SIMPLE_ASSERT( FML_INVALID_HANDLE != reader );
+            
+            //Strided in every dimension.
+            int stridedOffsets[rank] = { 1, 0, 1 };
+            int stridedSizes[rank] = { 2, 3, 2 };
+            int strides[rank] = { 3, 2, 2 };
+            int err = Fieldml_ReadDoubleSlabStrided( reader, stridedOffsets, stridedSizes, strides, readValues );
+            SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+            int v = 0;
+            for( int i = 1; i < 6; i += 3 )
+            {
+                for( int j = 0; j < 5; j += 2 )
+                {
+                    for( int k = 1; k < 4; k += 2 )
+                    {
+                        SIMPLE_ASSERT_EQUALS( values[( ( i * 5 ) + j ) * 4 + k], readValues[v++] );
+                    }
+                }
+            }
+            
+            //Contiguous along the innermost dimension.
+            int runOffsets[rank] = { 0, 1, 0 };
+            int runSizes[rank] = { 3, 2, 4 };
+            int runStrides[rank] = { 2, 3, 1 };
+            err = Fieldml_ReadDoubleSlabStrided( reader, runOffsets, runSizes, runStrides, readValues );
+            SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+            v = 0;
+            for( int i = 0; i < 6; i += 2 )
+            {
+                for( int j = 1; j < 5; j += 3 )
+                {
+                    for( int k = 0; k < 4; k++ )
+                    {
+                        SIMPLE_ASSERT_EQUALS( values[( ( i * 5 ) + j ) * 4 + k], readValues[v++] );
+                    }
+                }
+            }
+            
+            int overrunSizes[rank] = { 2, 1, 1 };
+            int overrunStrides[rank] = { 5, 1, 1 };
+            SIMPLE_ASSERT( FML_IOERR_NO_ERROR != Fieldml_ReadDoubleSlabStrided( reader, stridedOffsets, overrunSizes, overrunStrides, readValues ) );
+            int zeroStrides[rank] = { 1, 0, 1 };
+            SIMPLE_ASSERT_EQUALS( FML_IOERR_INVALID_PARAMETER, Fieldml_ReadDoubleSlabStrided( reader, stridedOffsets, stridedSizes, zeroStrides, readValues ) );
+            
+            //Slabs out of order, sharing an outermost row.
+            int listOffsets[3 * rank] = { 4, 1, 0,   0, 0, 2,   4, 0, 1 };
+            int listSizes[3 * rank] = { 1, 2, 4,   2, 1, 2,   1, 1, 1 };
+            double expected[8 + 4 + 1];
+            v = 0;
+            for( int slab = 0; slab < 3; slab++ )
+            {
+                const int *o = listOffsets + ( slab * rank );
+                const int *z = listSizes + ( slab * rank );
+                for( int i = o[0]; i < o[0] + z[0]; i++ )
+                {
+                    for( int j = o[1]; j < o[1] + z[1]; j++ )
+                    {
+                        for( int k = o[2]; k < o[2] + z[2]; k++ )
+                        {
+                            expected[v++] = values[( ( i * 5 ) + j ) * 4 + k];
+                        }
+                    }
+                }
+            }
+            err = Fieldml_ReadDoubleSlabList( reader, 3, listOffsets, listSizes, readValues );
+            SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+            for( int i = 0; i < v; i++ )
+            {
+                SIMPLE_ASSERT_EQUALS( expected[i], readValues[i] );
+            }
+            
+            //Slabs out of order, in separate outermost rows.
+            int rowOffsets[2 * rank] = { 3, 0, 0,   0, 2, 1 };
+            int rowSizes[2 * rank] = { 2, 5, 4,   1, 1, 3 };
+            err = Fieldml_ReadDoubleSlabList( reader, 2, rowOffsets, rowSizes, readValues );
+            SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+            for( int i = 0; i < 40; i++ )
+            {
+                SIMPLE_ASSERT_EQUALS( values[60 + i], readValues[i] );
+            }
+            for( int i = 0; i < 3; i++ )
+            {
+                SIMPLE_ASSERT_EQUALS( values[9 + i], readValues[40 + i] );
+            }
+            
+            //The same slabs, in order.
+            int sortedOffsets[2 * rank] = { 0, 2, 1,   3, 0, 0 };
+            int sortedSizes[2 * rank] = { 1, 1, 3,   2, 5, 4 };
+            err = Fieldml_ReadDoubleSlabList( reader, 2, sortedOffsets, sortedSizes, readValues );
+            SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+            SIMPLE_ASSERT_EQUALS( values[9], readValues[0] );
+            SIMPLE_ASSERT_EQUALS( values[60], readValues[3] );
+            SIMPLE_ASSERT_EQUALS( values[99], readValues[42] );
+            
+            //Points out of order, with repeats.
+            int points[6 * rank] = { 5, 4, 3,   0, 0, 0,   2, 3, 1,   0, 0, 0,   5, 4, 3,   2, 3, 2 };
+            err = Fieldml_ReadDoublePoints( reader, 6, points, readValues );
+            SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+            for( int p = 0; p < 6; p++ )
+            {
+                const int *point = points + ( p * rank );
+                SIMPLE_ASSERT_EQUALS( values[( ( point[0] * 5 ) + point[1] ) * 4 + point[2]], readValues[p] );
+            }
+            
+            SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, Fieldml_ReadDoublePoints( reader, 0, NULL, readValues ) );
+            int badPoint[rank] = { 6, 0, 0 };
+            SIMPLE_ASSERT( FML_IOERR_NO_ERROR != Fieldml_ReadDoublePoints( reader, 1, badPoint, readValues ) );
+            SIMPLE_ASSERT_EQUALS( FML_IOERR_INVALID_PARAMETER, Fieldml_ReadDoublePoints( reader, -1, points, readValues ) );
+            
+            //Ordinary reads carry on as before.
+            int slabOffsets[rank] = { 3, 0, 0 };
+            int slabSizes[rank] = { 1, 5, 4 };
+            err = Fieldml_ReadDoubleSlab( reader, slabOffsets, slabSizes, readValues );
+            SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+            for( int i = 0; i < 20; i++ )
+            {
+                SIMPLE_ASSERT_EQUALS( values[60 + i], readValues[i] );
+            }
+            
+            Fieldml_CloseReader( reader );
+        }
+    }
+    
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_UNKNOWN_OBJECT, Fieldml_ReadDoublePoints( FML_INVALID_HANDLE, 0, NULL, readValues ) );
+    
+    Fieldml_Destroy( session );
+    
+    remove( textFilename );
+    remove( rawFilename );
+    remove( hdf5Filename );
+}
+
+
+/**
+ * Ensure that HDF5 arrays created as extendable grow as rows are written past their end, along with their data
+ * source's sizes, and that arrays which aren't extendable don't.
+ */
+SIMPLE_TEST( FieldmlDataHdf5ExtendableWriteTest )
+{
+    if( !Fieldml_IsArrayFormatRegistered( "HDF5" ) )
+    {
+        return;
+    }
+    
+    const char *filename = "hdf5_extendable_test.h5";
+    
+    FmlSessionHandle session = Fieldml_Create( "test_path", "test" );
+    Fieldml_SetDebug( session, 0 );
+    SIMPLE_ASSERT( session != FML_INVALID_HANDLE );
+    
+    FmlObjectHandle realType = Fieldml_CreateContinuousType( session, "test.real" );
+    FmlObjectHandle resource = Fieldml_CreateHrefDataResource( session, "test.resource", "HDF5", filename );
+    
+    const int rank = 2;
+    const int columnCount = 3;
+    FmlObjectHandle stepSource = Fieldml_CreateArrayDataSource( session, "test.steps", resource, "steps", rank );
+    FmlObjectHandle fixedSource = Fieldml_CreateArrayDataSource( session, "test.fixed", resource, "fixed", rank );
+    
+    //Sizes that run to the end of the array follow it as it grows.
+    int sizes[rank] = { 1, columnCount };
+    Fieldml_SetArrayDataSourceSizes( session, stepSource, sizes );
+    
+    FieldmlArrayWriterOptions options;
+    options.chunkSizes = NULL;
+    options.deflateLevel = 0;
+    options.shuffle = 0;
+    options.extendable = 1;
+    options.storageBits = 0;
+    options.pagedFileSpace = 0;
+    
+    int initialSizes[rank] = { 0, columnCount };
+    FmlWriterHandle writer = Fieldml_OpenArrayWriterWithOptions( session, stepSource, realType, 0, initialSizes, rank, &options );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != writer );
+    
+    double values[14 * columnCount];
+    for( int i = 0; i < 14 * columnCount; i++ )
+    {
+        values[i] = i * 0.125;
+    }
+    
+    int offsets[rank] = { 0, 0 };
+    int stepSizes[rank] = { 1, columnCount };
+    int rawSizes[rank];
+    for( int step = 0; step < 10; step++ )
+    {
+        offsets[0] = step;
+        int err = Fieldml_WriteDoubleSlab( writer, offsets, stepSizes, values + ( step * columnCount ) );
+        SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+        
+        Fieldml_GetArrayDataSourceRawSizes( session, stepSource, rawSizes );
+        SIMPLE_ASSERT_EQUALS( step + 1, rawSizes[0] );
+        SIMPLE_ASSERT_EQUALS( columnCount, rawSizes[1] );
+    }
+    
+    //Only the outermost dimension can grow.
+    offsets[0] = 0;
+    offsets[1] = 1;
+    SIMPLE_ASSERT( FML_IOERR_NO_ERROR != Fieldml_WriteDoubleSlab( writer, offsets, stepSizes, values ) );
+    offsets[1] = 0;
+    Fieldml_CloseWriter( writer );
+    
+    Fieldml_GetArrayDataSourceSizes( session, stepSource, sizes );
+    SIMPLE_ASSERT_EQUALS( 10, sizes[0] );
+    
+    //Appending writers grow existing extendable arrays too.
+    writer = Fieldml_OpenArrayWriter( session, stepSource, realType, 1, initialSizes, rank );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != writer );
+    offsets[0] = 10;
+    int blockSizes[rank] = { 2, columnCount };
+    int err = Fieldml_WriteDoubleSlab( writer, offsets, blockSizes, values + ( 10 * columnCount ) );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    Fieldml_CloseWriter( writer );
+    
+    Fieldml_GetArrayDataSourceRawSizes( session, stepSource, rawSizes );
+    SIMPLE_ASSERT_EQUALS( 12, rawSizes[0] );
+    
+    //Writers of the same array share its handle. One growing it mustn't leave the other to shrink it back again.
+    writer = Fieldml_OpenArrayWriter( session, stepSource, realType, 1, initialSizes, rank );
+    FmlWriterHandle otherWriter = Fieldml_OpenArrayWriter( session, stepSource, realType, 1, initialSizes, rank );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != writer );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != otherWriter );
+    offsets[0] = 12;
+    err = Fieldml_WriteDoubleSlab( writer, offsets, blockSizes, values + ( 12 * columnCount ) );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    err = Fieldml_WriteDoubleSlab( otherWriter, offsets, stepSizes, values + ( 12 * columnCount ) );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    Fieldml_CloseWriter( writer );
+    Fieldml_CloseWriter( otherWriter );
+    
+    Fieldml_GetArrayDataSourceRawSizes( session, stepSource, rawSizes );
+    SIMPLE_ASSERT_EQUALS( 14, rawSizes[0] );
+    
+    double readValues[14 * columnCount];
+    FmlReaderHandle reader = Fieldml_OpenReader( session, stepSource );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != reader );
+    offsets[0] = 0;
+    int allSizes[rank] = { 14, columnCount };
+    err = Fieldml_ReadDoubleSlab( reader, offsets, allSizes, readValues );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    for( int i = 0; i < 14 * columnCount; i++ )
+    {
+        SIMPLE_ASSERT_EQUALS( values[i], readValues[i] );
+    }
+    Fieldml_CloseReader( reader );
+    
+    //Arrays that aren't extendable stay the size they were created.
+    int fixedSizes[rank] = { 2, columnCount };
+    writer = Fieldml_OpenArrayWriterWithOptions( session, fixedSource, realType, 1, fixedSizes, rank, NULL );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != writer );
+    offsets[0] = 1;
+    err = Fieldml_WriteDoubleSlab( writer, offsets, stepSizes, values );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    offsets[0] = 2;
+    SIMPLE_ASSERT( FML_IOERR_NO_ERROR != Fieldml_WriteDoubleSlab( writer, offsets, stepSizes, values ) );
+    Fieldml_CloseWriter( writer );
+    
+    Fieldml_GetArrayDataSourceRawSizes( session, fixedSource, rawSizes );
+    SIMPLE_ASSERT_EQUALS( 0, rawSizes[0] );
+    
+    Fieldml_Destroy( session );
+    
+    remove( filename );
+}
+
+
+/**
+ * Ensure that data sources can be read from sized in-memory images of their resources, including HDF5 files.
+ */
+SIMPLE_TEST( FieldmlDataImageReadTest )
+{
+    FmlSessionHandle session = Fieldml_Create( "test_path", "test" );
+    Fieldml_SetDebug( session, 0 );
+    SIMPLE_ASSERT( session != FML_INVALID_HANDLE );
+    
+    const int count = 4;
+    int offsets[1] = { 0 };
+    int sizes[1] = { count };
+    int buffer[count];
+    
+    FmlObjectHandle textResource = Fieldml_CreateInlineDataResource( session, "test.text" );
+    FmlObjectHandle textSource = Fieldml_CreateArrayDataSource( session, "test.text_source", textResource, "1", 1 );
+    Fieldml_SetArrayDataSourceRawSizes( session, textSource, sizes );
+    
+    //Text images need not be null-terminated, and only their given length is read.
+    const char textImage[] = { '9', ' ', '1', '0', ' ', '1', '1', ' ', '1', '2', ' ', '1', '3' };
+    FmlReaderHandle reader = Fieldml_OpenReaderWithImage( session, textSource, textImage, 11 );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != reader );
+    int err = Fieldml_ReadIntSlab( reader, offsets, sizes, buffer );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    for( int i = 0; i < count; i++ )
+    {
+        SIMPLE_ASSERT_EQUALS( i + 9, buffer[i] );
+    }
+    Fieldml_CloseReader( reader );
+    
+    SIMPLE_ASSERT_EQUALS( FML_INVALID_HANDLE, Fieldml_OpenReaderWithImage( session, textSource, NULL, 11 ) );
+    SIMPLE_ASSERT_EQUALS( FML_INVALID_HANDLE, Fieldml_OpenReaderWithImage( session, textSource, textImage, 0 ) );
+    
+    if( !Fieldml_IsArrayFormatRegistered( "HDF5" ) )
+    {
+        Fieldml_Destroy( session );
+        return;
+    }
+    
+    const char *filename = "hdf5_image_test.h5";
+    
+    FmlObjectHandle intType = Fieldml_CreateEnsembleType( session, "test.ensemble" );
+    FmlObjectHandle resource = Fieldml_CreateHrefDataResource( session, "test.resource", "HDF5", filename );
+    
+    const int rank = 2;
+    const int rowCount = 4;
+    const int columnCount = 3;
+    FmlObjectHandle source = Fieldml_CreateArrayDataSource( session, "test.source", resource, "values", rank );
+    
+    int arraySizes[rank] = { rowCount, columnCount };
+    int arrayOffsets[rank] = { 0, 0 };
+    int values[rowCount * columnCount];
+    for( int i = 0; i < rowCount * columnCount; i++ )
+    {
+        values[i] = i * 7 - 5;
+    }
+    
+    FmlWriterHandle writer = Fieldml_OpenArrayWriter( session, source, intType, 0, arraySizes, rank );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != writer );
+    err = Fieldml_WriteIntSlab( writer, arrayOffsets, arraySizes, values );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    Fieldml_CloseWriter( writer );
+    
+    FILE *file = fopen( filename, "rb" );
+    SIMPLE_ASSERT( file != NULL );
+    fseek( file, 0, SEEK_END );
+    const long imageLength = ftell( file );
+    fseek( file, 0, SEEK_SET );
+    char *image = new char[imageLength];
+    SIMPLE_ASSERT_EQUALS( (size_t)imageLength, fread( image, 1, imageLength, file ) );
+    fclose( file );
+    
+    //The image is read in place of the file, so the file isn't needed once it's loaded.
+    remove( filename );
+    
+    FmlReaderHandle first = Fieldml_OpenReaderWithImage( session, source, image, imageLength );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != first );
+    FmlReaderHandle second = Fieldml_OpenReaderWithImage( session, source, image, imageLength );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != second );
+    
+    int readValues[rowCount * columnCount];
+    err = Fieldml_ReadIntSlab( first, arrayOffsets, arraySizes, readValues );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    for( int i = 0; i < rowCount * columnCount; i++ )
+    {
+        SIMPLE_ASSERT_EQUALS( values[i], readValues[i] );
+    }
+    Fieldml_CloseReader( first );
+    
+    int rowOffsets[rank] = { 2, 0 };
+    int rowSizes[rank] = { 1, columnCount };
+    err = Fieldml_ReadIntSlab( second, rowOffsets, rowSizes, readValues );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    for( int i = 0; i < columnCount; i++ )
+    {
+        SIMPLE_ASSERT_EQUALS( values[2 * columnCount + i], readValues[i] );
+    }
+    Fieldml_CloseReader( second );
+    
+    //Without a length, there's no way to open an HDF5 image.
+    SIMPLE_ASSERT_EQUALS( FML_INVALID_HANDLE, Fieldml_OpenReaderWithBuffer( session, source, image ) );
+    
+    //Images that aren't HDF5 files are rejected.
+    memset( image, 0, imageLength );
+    SIMPLE_ASSERT_EQUALS( FML_INVALID_HANDLE, Fieldml_OpenReaderWithImage( session, source, image, imageLength ) );
+    
+    delete[] image;
+    
+    Fieldml_Destroy( session );
+}
+
+
+/**
+ * Ensure that HDF5 cache tuning is validated, and that tuned sessions read and write HDF5 files as usual, whether or
+ * not the files can be page buffered.
+ */
+SIMPLE_TEST( FieldmlDataHdf5CacheOptionsTest )
+{
+    if( !Fieldml_IsArrayFormatRegistered( "HDF5" ) )
+    {
+        return;
+    }
+    
+    const char *filename = "hdf5_cache_options_test.h5";
+    
+    FmlSessionHandle session = Fieldml_Create( "test_path", "test" );
+    Fieldml_SetDebug( session, 0 );
+    SIMPLE_ASSERT( session != FML_INVALID_HANDLE );
+    
+    FieldmlHdf5CacheOptions options;
+    options.chunkCacheBytes = 4 * 1024 * 1024;
+    options.chunkCacheSlots = 10007;
+    options.chunkCachePreemption = 0.5;
+    options.metadataCacheBytes = 2 * 1024 * 1024;
+    options.pageBufferBytes = 1024 * 1024;
+    
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_UNKNOWN_OBJECT, Fieldml_SetHdf5CacheOptions( session + 1000, &options ) );
+    options.chunkCachePreemption = 2;
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_INVALID_PARAMETER, Fieldml_SetHdf5CacheOptions( session, &options ) );
+    options.chunkCachePreemption = -1;
+    options.chunkCacheBytes = -1;
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_INVALID_PARAMETER, Fieldml_SetHdf5CacheOptions( session, &options ) );
+    options.chunkCacheBytes = 4 * 1024 * 1024;
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, Fieldml_SetHdf5CacheOptions( session, &options ) );
+    
+    FmlObjectHandle realType = Fieldml_CreateContinuousType( session, "test.real" );
+    FmlObjectHandle resource = Fieldml_CreateHrefDataResource( session, "test.resource", "HDF5", filename );
+    
+    const int rank = 2;
+    const int rowCount = 64;
+    const int columnCount = 32;
+    FmlObjectHandle source = Fieldml_CreateArrayDataSource( session, "test.source", resource, "values", rank );
+    
+    int sizes[rank] = { rowCount, columnCount };
+    int offsets[rank] = { 0, 0 };
+    int chunkSizes[rank] = { 16, 16 };
+    double values[rowCount * columnCount];
+    for( int i = 0; i < rowCount * columnCount; i++ )
+    {
+        values[i] = i * 0.25 - 3.0;
+    }
+    
+    FieldmlArrayWriterOptions writerOptions;
+    writerOptions.chunkSizes = chunkSizes;
+    writerOptions.deflateLevel = 6;
+    writerOptions.shuffle = 1;
+    writerOptions.extendable = 0;
+    writerOptions.storageBits = 0;
+    writerOptions.pagedFileSpace = 1;
+    
+    //The writer asks for paged file space, so that the file can be page buffered.
+    FmlWriterHandle writer = Fieldml_OpenArrayWriterWithOptions( session, source, realType, 0, sizes, rank, &writerOptions );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != writer );
+    int err = Fieldml_WriteDoubleSlab( writer, offsets, sizes, values );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    Fieldml_CloseWriter( writer );
+    
+    double readValues[rowCount * columnCount];
+    for( int pass = 0; pass < 2; pass++ )
+    {
+        FmlReaderHandle reader = Fieldml_OpenReader( session, source );
+        SIMPLE_ASSERT( FML_INVALID_HANDLE != reader );
+        
+        int pointSizes[rank] = { 1, 1 };
+        for( int i = 0; i < rowCount * columnCount; i += 37 )
+        {
+            int pointOffsets[rank] = { i / columnCount, i % columnCount };
+            err = Fieldml_ReadDoubleSlab( reader, pointOffsets, pointSizes, readValues );
+            SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+            SIMPLE_ASSERT_EQUALS( values[i], readValues[0] );
+        }
+        
+        err = Fieldml_ReadDoubleSlab( reader, offsets, sizes, readValues );
+        SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+        for( int i = 0; i < rowCount * columnCount; i++ )
+        {
+            SIMPLE_ASSERT_EQUALS( values[i], readValues[i] );
+        }
+        Fieldml_CloseReader( reader );
+        
+        //The defaults are restored for the second pass.
+        SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, Fieldml_SetHdf5CacheOptions( session, NULL ) );
+    }
+    
+    //Files without paged file space are still read while page buffering is set.
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, Fieldml_SetHdf5CacheOptions( session, &options ) );
+    FmlObjectHandle unpagedResource = Fieldml_CreateHrefDataResource( session, "test.unpaged", "HDF5", "./input/I16BE.h5" );
+    FmlObjectHandle unpagedSource = Fieldml_CreateArrayDataSource( session, "test.unpaged_source", unpagedResource, "ArrayReadTestData", 3 );
+    FmlReaderHandle reader = Fieldml_OpenReader( session, unpagedSource );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != reader );
+    int unpagedOffsets[3] = { 0, 0, 0 };
+    int unpagedSizes[3] = { 3, 4, 5 };
+    err = Fieldml_ReadDoubleSlab( reader, unpagedOffsets, unpagedSizes, readValues );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    Fieldml_CloseReader( reader );
+    
+    //Page buffering doesn't make new files paged unless the writer asks, and they're read without it.
+    const char *plainFilename = "hdf5_cache_options_plain_test.h5";
+    FmlObjectHandle plainResource = Fieldml_CreateHrefDataResource( session, "test.plain", "HDF5", plainFilename );
+    FmlObjectHandle plainSource = Fieldml_CreateArrayDataSource( session, "test.plain_source", plainResource, "values", rank );
+    writerOptions.pagedFileSpace = 0;
+    writer = Fieldml_OpenArrayWriterWithOptions( session, plainSource, realType, 0, sizes, rank, &writerOptions );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != writer );
+    err = Fieldml_WriteDoubleSlab( writer, offsets, sizes, values );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    Fieldml_CloseWriter( writer );
+    reader = Fieldml_OpenReader( session, plainSource );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != reader );
+    err = Fieldml_ReadDoubleSlab( reader, offsets, sizes, readValues );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    SIMPLE_ASSERT_EQUALS( values[rowCount * columnCount - 1], readValues[rowCount * columnCount - 1] );
+    Fieldml_CloseReader( reader );
+    
+    Fieldml_Destroy( session );
+    
+    remove( filename );
+    remove( plainFilename );
+}
+
+
+/**
+ * Ensure that HDF5 arrays can be stored in narrower types than the values written to them, and that reads convert
+ * stored values to any compatible type.
+ */
+SIMPLE_TEST( FieldmlDataHdf5NarrowStorageTest )
+{
+    if( !Fieldml_IsArrayFormatRegistered( "HDF5" ) )
+    {
+        return;
+    }
+    
+    const char *filename = "hdf5_narrow_storage_test.h5";
+    
+    FmlSessionHandle session = Fieldml_Create( "test_path", "test" );
+    Fieldml_SetDebug( session, 0 );
+    SIMPLE_ASSERT( session != FML_INVALID_HANDLE );
+    
+    FmlObjectHandle realType = Fieldml_CreateContinuousType( session, "test.real" );
+    FmlObjectHandle intType = Fieldml_CreateEnsembleType( session, "test.ensemble" );
+    FmlObjectHandle resource = Fieldml_CreateHrefDataResource( session, "test.resource", "HDF5", filename );
+    
+    const int rank = 2;
+    const int rowCount = 8;
+    const int columnCount = 3;
+    const int count = rowCount * columnCount;
+    FmlObjectHandle realSource = Fieldml_CreateArrayDataSource( session, "test.reals", resource, "reals", rank );
+    FmlObjectHandle intSource = Fieldml_CreateArrayDataSource( session, "test.ints", resource, "ints", rank );
+    FmlObjectHandle badSource = Fieldml_CreateArrayDataSource( session, "test.bad", resource, "bad", rank );
+    
+    int sizes[rank] = { rowCount, columnCount };
+    int offsets[rank] = { 0, 0 };
+    double reals[count];
+    int ints[count];
+    for( int i = 0; i < count; i++ )
+    {
+        reals[i] = ( i * 0.1 ) - 1.0;
+        ints[i] = ( i * 1000 ) - 12000;
+    }
+    
+    FieldmlArrayWriterOptions options;
+    options.chunkSizes = NULL;
+    options.deflateLevel = 0;
+    options.shuffle = 0;
+    options.extendable = 0;
+    options.pagedFileSpace = 0;
+    
+    //Doubles can't be stored in 16 bits.
+    options.storageBits = 16;
+    SIMPLE_ASSERT_EQUALS( FML_INVALID_HANDLE, Fieldml_OpenArrayWriterWithOptions( session, badSource, realType, 0, sizes, rank, &options ) );
+    options.storageBits = -1;
+    SIMPLE_ASSERT_EQUALS( FML_INVALID_HANDLE, Fieldml_OpenArrayWriterWithOptions( session, badSource, realType, 0, sizes, rank, &options ) );
+    
+    options.storageBits = 32;
+    FmlWriterHandle writer = Fieldml_OpenArrayWriterWithOptions( session, realSource, realType, 0, sizes, rank, &options );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != writer );
+    int err = Fieldml_WriteDoubleSlab( writer, offsets, sizes, reals );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    Fieldml_CloseWriter( writer );
+    
+    options.storageBits = 16;
+    writer = Fieldml_OpenArrayWriterWithOptions( session, intSource, intType, 1, sizes, rank, &options );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != writer );
+    err = Fieldml_WriteIntSlab( writer, offsets, sizes, ints );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    Fieldml_CloseWriter( writer );
+    
+    //Integers that don't fit are refused, including by writers that add to an existing array.
+    writer = Fieldml_OpenArrayWriter( session, intSource, intType, 1, sizes, rank );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != writer );
+    int bigSizes[rank] = { 1, 1 };
+    int big = 40000;
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_INVALID_PARAMETER, Fieldml_WriteIntSlab( writer, offsets, bigSizes, &big ) );
+    Fieldml_CloseWriter( writer );
+    
+    float floats[count];
+    double doubles[count];
+    int readInts[count];
+    FmlBoolean booleans[count];
+    
+    FmlReaderHandle reader = Fieldml_OpenReader( session, realSource );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != reader );
+    err = Fieldml_ReadFloatSlab( reader, offsets, sizes, floats );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    err = Fieldml_ReadDoubleSlab( reader, offsets, sizes, doubles );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    for( int i = 0; i < count; i++ )
+    {
+        SIMPLE_ASSERT_EQUALS( (float)reals[i], floats[i] );
+        SIMPLE_ASSERT_EQUALS( (double)(float)reals[i], doubles[i] );
+    }
+    
+    //Reading floating point values as integers would truncate them.
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_UNSUPPORTED, Fieldml_ReadIntSlab( reader, offsets, sizes, readInts ) );
+    Fieldml_CloseReader( reader );
+    
+    reader = Fieldml_OpenReader( session, intSource );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != reader );
+    err = Fieldml_ReadIntSlab( reader, offsets, sizes, readInts );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    err = Fieldml_ReadDoubleSlab( reader, offsets, sizes, doubles );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    err = Fieldml_ReadFloatSlab( reader, offsets, sizes, floats );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    for( int i = 0; i < count; i++ )
+    {
+        SIMPLE_ASSERT_EQUALS( ints[i], readInts[i] );
+        SIMPLE_ASSERT_EQUALS( (double)ints[i], doubles[i] );
+        SIMPLE_ASSERT_EQUALS( (float)ints[i], floats[i] );
+    }
+    
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_UNSUPPORTED, Fieldml_ReadBooleanSlab( reader, offsets, sizes, booleans ) );
+    Fieldml_CloseReader( reader );
+    
+    Fieldml_Destroy( session );
+    
+    remove( filename );
+}
+
+
+/**
+ * Ensure that separate writers can each write their own HDF5 shard of an array, which then reads back as one.
+ */
+SIMPLE_TEST( FieldmlDataHdf5ShardedArrayTest )
+{
+    if( !Fieldml_IsArrayFormatRegistered( "HDF5" ) )
+    {
+        return;
+    }
+    
+    const char *manifestName = "hdf5_sharded_test.manifest";
+    const char *shardNames[2] = { "hdf5_sharded_test.0.h5", "hdf5_sharded_test.1.h5" };
+    const char *shardFormats[2] = { "HDF5", "HDF5" };
+    
+    FmlSessionHandle session = Fieldml_Create( "test_path", "test" );
+    Fieldml_SetDebug( session, 0 );
+    SIMPLE_ASSERT( session != FML_INVALID_HANDLE );
+    
+    FmlObjectHandle intType = Fieldml_CreateEnsembleType( session, "test.ensemble" );
+    FmlObjectHandle resource = Fieldml_CreateHrefDataResource( session, "test.resource", "SHARDED", manifestName );
+    
+    const int rank = 2;
+    const int rowCount = 10;
+    const int columnCount = 4;
+    FmlObjectHandle source = Fieldml_CreateArrayDataSource( session, "test.source", resource, "ints", rank );
+    int sizes[rank] = { rowCount, columnCount };
+    
+    int firstRows[2] = { 0, 6 };
+    int rowCounts[2] = { 6, 4 };
+    int err = Fieldml_WriteShardManifest( session, resource, 2, firstRows, rowCounts, shardFormats, shardNames );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    
+    int values[rowCount * columnCount];
+    for( int i = 0; i < rowCount * columnCount; i++ )
+    {
+        values[i] = ( i * 7 ) - 100;
+    }
+    
+    //Each shard is written in full by a writer of its own, in reverse order.
+    for( int shard = 1; shard >= 0; shard-- )
+    {
+        FmlWriterHandle writer = Fieldml_OpenArrayWriter( session, source, intType, 0, sizes, rank );
+        SIMPLE_ASSERT( FML_INVALID_HANDLE != writer );
+        int offsets[rank] = { firstRows[shard], 0 };
+        int writeSizes[rank] = { rowCounts[shard], columnCount };
+        err = Fieldml_WriteIntSlab( writer, offsets, writeSizes, values + ( firstRows[shard] * columnCount ) );
+        SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+        Fieldml_CloseWriter( writer );
+    }
+    
+    //The data source doesn't give its sizes, so they come from the manifest and the shards.
+    FmlReaderHandle reader = Fieldml_OpenRowIterator( session, source );
+    SIMPLE_ASSERT( FML_INVALID_HANDLE != reader );
+    int readValues[rowCount * columnCount];
+    int rowsRead = Fieldml_ReadNextIntRows( reader, rowCount, readValues );
+    SIMPLE_ASSERT_EQUALS( rowCount, rowsRead );
+    for( int i = 0; i < rowCount * columnCount; i++ )
+    {
+        SIMPLE_ASSERT_EQUALS( values[i], readValues[i] );
+    }
+    
+    int slabOffsets[rank] = { 4, 1 };
+    int slabSizes[rank] = { 4, 3 };
+    err = Fieldml_ReadIntSlab( reader, slabOffsets, slabSizes, readValues );
+    SIMPLE_ASSERT_EQUALS( FML_IOERR_NO_ERROR, err );
+    for( int row = 0; row < 4; row++ )
+    {
+        for( int column = 0; column < 3; column++ )
+        {
+            SIMPLE_ASSERT_EQUALS( values[( ( row + 4 ) * columnCount ) + column + 1], readValues[( row * 3 ) + column] );
+        }
+    }
+    Fieldml_CloseReader( reader );
+    
+    Fieldml_Destroy( session );
+    
+    remove( manifestName );
+    remove( shardNames[0] );
+    remove( shardNames[1] );
 }
@@ -516,6 +516,7 @@ int writeLowResActivationTime(FmlSessionHandle session, FmlObjectHandle cType, F
 	sizes = lowResArraySize;
 
 	FmlObjectHandle writer = Fieldml_OpenArrayWriter( session, sourceD, cType, 0, &sizes, 1 );
+	Fieldml_SetWriterTransferMode( writer, FML_TRANSFER_MODE_COLLECTIVE );
 
 	if (lowResNumberOfNodes > mpi_rank)
 	{
@@ -531,6 +532,14 @@ int writeLowResActivationTime(FmlSessionHandle session, FmlObjectHandle cType, F
 		findActivationTimes(potentialArray, &activationTimes[0], offsets, highResOffset, ratioPerNode);
 		Fieldml_WriteDoubleSlab( writer, &offsets, &sizes, activationTimes );
 	}
+	else
+	{
+		/* nothing to write, but every node has to take part in a collective write */
+		double unused = 0.0;
+		sizes = 0;
+		offsets = 0;
+		Fieldml_WriteDoubleSlab( writer, &offsets, &sizes, &unused );
+	}
 
 	Fieldml_CloseWriter( writer );
 
@@ -921,6 +930,7 @@ int writeHighResPotential(FmlSessionHandle session, FmlObjectHandle cType, FmlOb
 	sizes[1] = numberOfTimes;
 
 	FmlObjectHandle writer = Fieldml_OpenArrayWriter( session, sourceD, cType, 0, sizes, 2 );
+	Fieldml_SetWriterTransferMode( writer, FML_TRANSFER_MODE_COLLECTIVE );
 
 	sizes[0] = arraySizeForEachNode[mpi_rank];
 	sizes[1] = 1;